@@ -8,8 +8,10 @@ ifneq ($(TARGET_BOARD_AUTO),true)
       include $(MY_LOCAL_PATH)/legacy/Android.mk
     else
       include $(MY_LOCAL_PATH)/hal/Android.mk
+      include $(MY_LOCAL_PATH)/hal/audio_extn/tests/Android.mk
       include $(MY_LOCAL_PATH)/voice_processing/Android.mk
       include $(MY_LOCAL_PATH)/visualizer/Android.mk
+      include $(MY_LOCAL_PATH)/visualizer/tests/Android.mk
       include $(MY_LOCAL_PATH)/post_proc/Android.mk
     endif
   endif
@@ -212,6 +212,11 @@ ifeq ($(strip $(AUDIO_FEATURE_ENABLED_AUDIO_ZOOM)), true)
     LOCAL_SRC_FILES += audio_extn/audiozoom.c
 endif
 
+ifeq ($(strip $(AUDIO_FEATURE_ENABLED_CAPTURE_SHARE)), true)
+    LOCAL_CFLAGS += -DCAPTURE_SHARE_ENABLED
+    LOCAL_SRC_FILES += audio_extn/capture_share.c
+endif
+
 ifeq ($(strip $(AUDIO_FEATURE_ENABLED_24BITS_CAMCORDER)), true)
     LOCAL_CFLAGS += -DENABLED_24BITS_CAMCORDER
 endif
@@ -43,6 +43,7 @@ void audio_extn_set_snd_card_split(const char* in_snd_card_name);
 #define audio_extn_spkr_prot_is_enabled() (false)
 #define audio_extn_get_spkr_prot_snd_device(snd_device) (snd_device)
 #define audio_extn_spkr_prot_deinit(adev)       (0)
+#define audio_extn_spkr_prot_dump(fd)           (0)
 #else
 void audio_extn_spkr_prot_init(void *adev);
 int audio_extn_spkr_prot_start_processing(snd_device_t snd_device);
@@ -51,6 +52,7 @@ bool audio_extn_spkr_prot_is_enabled();
 int audio_extn_get_spkr_prot_snd_device(snd_device_t snd_device);
 void audio_extn_spkr_prot_calib_cancel(void *adev);
 void audio_extn_spkr_prot_deinit(void *adev);
+void audio_extn_spkr_prot_dump(int fd);
 
 #endif
 
@@ -123,6 +125,8 @@ char *audio_extn_usb_usbid(void);
 #define audio_extn_sound_trigger_check_and_get_session(in)             (0)
 #define audio_extn_sound_trigger_stop_lab(in)                          (0)
 #define audio_extn_sound_trigger_read(in, buffer, bytes)               (0)
+#define audio_extn_sound_trigger_release_session(in)                   (0)
+#define audio_extn_sound_trigger_dump(in, fd)                          (0)
 
 #else
 
@@ -146,6 +150,8 @@ void audio_extn_sound_trigger_check_and_get_session(struct stream_in *in);
 void audio_extn_sound_trigger_stop_lab(struct stream_in *in);
 int audio_extn_sound_trigger_read(struct stream_in *in, void *buffer,
                                   size_t bytes);
+void audio_extn_sound_trigger_release_session(struct stream_in *in);
+void audio_extn_sound_trigger_dump(struct stream_in *in, int fd);
 #endif
 
 #ifndef A2DP_OFFLOAD_ENABLED
@@ -232,8 +238,46 @@ int audio_extn_snd_mon_register_listener(void *stream, snd_mon_cb cb);
 int audio_extn_snd_mon_unregister_listener(void *stream);
 #endif
 
+#ifndef CAPTURE_SHARE_ENABLED
+#define audio_extn_capture_share_start(in, priority)            (-ENOSYS)
+#define audio_extn_capture_share_attach(owner, in, priority)    (-ENOSYS)
+#define audio_extn_capture_share_detach(in)                     (NULL)
+#define audio_extn_capture_share_join(adev, in, priority)       (-ENOSYS)
+#define audio_extn_capture_share_leave(adev, in, new_owner)     (false)
+#define audio_extn_capture_share_read(in, buffer, bytes)        (-ENOSYS)
+#define audio_extn_capture_share_get_position(in, frames, time) (-ENOSYS)
+#define audio_extn_capture_share_get_frames_lost(in)            (0)
+#define audio_extn_capture_share_dump(in, fd)                   (0)
+#else
+int audio_extn_capture_share_start(struct stream_in *in, int priority);
+int audio_extn_capture_share_attach(struct stream_in *owner, struct stream_in *in,
+                                    int priority);
+struct stream_in *audio_extn_capture_share_detach(struct stream_in *in);
+int audio_extn_capture_share_join(struct audio_device *adev, struct stream_in *in,
+                                  int priority);
+bool audio_extn_capture_share_leave(struct audio_device *adev, struct stream_in *in,
+                                    struct stream_in **new_owner);
+int audio_extn_capture_share_read(struct stream_in *in, void *buffer, size_t bytes);
+int audio_extn_capture_share_get_position(struct stream_in *in,
+                                          int64_t *frames, int64_t *time);
+uint32_t audio_extn_capture_share_get_frames_lost(struct stream_in *in);
+void audio_extn_capture_share_dump(struct stream_in *in, int fd);
+#endif
+
 bool audio_extn_utils_resolve_config_file(char[]);
 int audio_extn_utils_get_platform_info(const char* snd_card_name,
                                        char* platform_info_file);
 int audio_extn_utils_get_snd_card_num();
+
+/* One PCM of a batch opened by audio_extn_utils_pcm_open_batch() */
+struct pcm_open_req {
+    unsigned int card;
+    unsigned int device;
+    unsigned int flags;
+    struct pcm_config *config;
+    struct pcm *pcm;        /* out: opened and prepared PCM, NULL on failure */
+    int status;             /* out */
+    uint32_t open_us;       /* out: time spent in open and prepare */
+};
+int audio_extn_utils_pcm_open_batch(struct pcm_open_req *reqs, int count);
 #endif /* AUDIO_EXTN_H */
@@ -0,0 +1,565 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "audio_hw_capture_share"
+/*#define LOG_NDEBUG 0*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <log/log.h>
+#include <cutils/atomic.h>
+#include <processgroup/sched_policy.h>
+#include <system/thread_defs.h>
+#include <tinyalsa/asoundlib.h>
+
+#include "audio_hw.h"
+#include "audio_extn.h"
+
+/*
+ * Capture fan-out. The first stream to start a shareable record usecase
+ * hands its PCM to a session whose reader thread copies every period into
+ * one ring per attached stream. Later streams of the same usecase attach
+ * to the running session instead of opening the front end again, and the
+ * streams already attached see no gap.
+ *
+ * Each ring is single producer (reader thread), single consumer (the
+ * stream's read, serialized by in->lock) and holds frames in the PCM's
+ * format and channel count. Streams convert to their own format and pick
+ * their leading channels when they read.
+ */
+
+#define CAPTURE_SHARE_MAX_CLIENTS 4
+/* ring depth in periods of the larger of the session and client period */
+#define CAPTURE_SHARE_RING_PERIODS 4
+/* a read gives up after this many session periods without data */
+#define CAPTURE_SHARE_READ_TIMEOUT_PERIODS 8
+
+struct share_session;
+
+struct share_client {
+    struct stream_in *in;
+    struct share_session *session;
+    int priority;
+    uint8_t *ring;
+    uint32_t ring_frames;           /* power of two */
+    volatile int32_t rear;          /* frames written, reader thread only */
+    volatile int32_t front;         /* frames consumed, client only */
+    int32_t rear_at_timestamp;      /* rear when the session timestamp was taken */
+    uint32_t overruns;
+    uint64_t frames_dropped;
+    uint32_t frames_lost;           /* dropped since the last get_frames_lost */
+};
+
+struct share_session {
+    struct pcm *pcm;
+    struct pcm_config config;
+    size_t frame_size;
+    size_t period_bytes;
+    uint8_t *period_buf;
+    pthread_t thread;
+    pthread_mutex_t lock;           /* clients, timestamp, exit */
+    pthread_cond_t cond;            /* new data or error */
+    struct share_client *clients[CAPTURE_SHARE_MAX_CLIENTS];
+    int num_clients;
+    bool exit;
+    volatile int32_t error;         /* first pcm_read error, 0 while healthy */
+    unsigned int avail;             /* frames left in the kernel at timestamp */
+    struct timespec timestamp;
+    bool timestamp_valid;
+    uint64_t periods_read;
+    unsigned int max_clients;
+};
+
+static bool capture_share_usecase(const struct stream_in *in)
+{
+    if (in->realtime || in->source == AUDIO_SOURCE_VOICE_COMMUNICATION ||
+        (in->flags & (AUDIO_INPUT_FLAG_HW_HOTWORD | AUDIO_INPUT_FLAG_MMAP_NOIRQ)))
+        return false;
+
+    return in->usecase == USECASE_AUDIO_RECORD ||
+           in->usecase == USECASE_AUDIO_RECORD_LOW_LATENCY;
+}
+
+static uint32_t ring_frames_for(size_t frames)
+{
+    uint32_t n = 1;
+
+    while (n < frames)
+        n <<= 1;
+    return n;
+}
+
+static struct share_client *client_create(struct share_session *session,
+                                          struct stream_in *in, int priority)
+{
+    struct share_client *client = calloc(1, sizeof(struct share_client));
+    size_t period = in->config.period_size;
+
+    if (client == NULL)
+        return NULL;
+
+    if (period < session->config.period_size)
+        period = session->config.period_size;
+    client->ring_frames = ring_frames_for(period * CAPTURE_SHARE_RING_PERIODS);
+    client->ring = malloc(client->ring_frames * session->frame_size);
+    if (client->ring == NULL) {
+        free(client);
+        return NULL;
+    }
+    client->in = in;
+    client->session = session;
+    client->priority = priority;
+    return client;
+}
+
+static void client_destroy(struct share_client *client)
+{
+    free(client->ring);
+    free(client);
+}
+
+/* Called by the reader thread with the session lock held */
+static void client_push_l(struct share_client *client, const uint8_t *data,
+                          uint32_t frames)
+{
+    const size_t frame_size = client->session->frame_size;
+    const uint32_t mask = client->ring_frames - 1;
+    int32_t rear = client->rear;
+    int32_t front = android_atomic_acquire_load(&client->front);
+    uint32_t offset = (uint32_t)rear & mask;
+    uint32_t first = client->ring_frames - offset;
+
+    if (client->ring_frames - (uint32_t)(rear - front) < frames) {
+        /* a stalled client loses the new period, the others are not held back */
+        client->overruns++;
+        client->frames_dropped += frames;
+        client->frames_lost += frames;
+        return;
+    }
+
+    if (first > frames)
+        first = frames;
+    memcpy(client->ring + offset * frame_size, data, first * frame_size);
+    memcpy(client->ring, data + first * frame_size, (frames - first) * frame_size);
+    android_atomic_release_store(rear + (int32_t)frames, &client->rear);
+}
+
+static void *capture_share_thread_loop(void *context)
+{
+    struct share_session *session = (struct share_session *)context;
+    const uint32_t frames = session->config.period_size;
+    int i, ret;
+
+    setpriority(PRIO_PROCESS, 0, ANDROID_PRIORITY_AUDIO);
+    set_sched_policy(0, SP_FOREGROUND);
+    prctl(PR_SET_NAME, (unsigned long)"Capture Share", 0, 0, 0);
+
+    for (;;) {
+        ret = pcm_read(session->pcm, session->period_buf, session->period_bytes);
+        if (ret != 0)
+            ret = errno ? -errno : -EIO;
+
+        pthread_mutex_lock(&session->lock);
+        if (session->exit) {
+            pthread_mutex_unlock(&session->lock);
+            break;
+        }
+        if (ret != 0) {
+            ALOGE("%s: pcm_read failed: %s", __func__, pcm_get_error(session->pcm));
+            android_atomic_release_store(ret, &session->error);
+            pthread_cond_broadcast(&session->cond);
+            pthread_mutex_unlock(&session->lock);
+            break;
+        }
+        for (i = 0; i < session->num_clients; i++)
+            client_push_l(session->clients[i], session->period_buf, frames);
+
+        session->timestamp_valid = pcm_get_htimestamp(session->pcm, &session->avail,
+                                                      &session->timestamp) == 0;
+        for (i = 0; i < session->num_clients; i++)
+            session->clients[i]->rear_at_timestamp = session->clients[i]->rear;
+        session->periods_read++;
+        pthread_cond_broadcast(&session->cond);
+        pthread_mutex_unlock(&session->lock);
+    }
+
+    ALOGV("%s: exit", __func__);
+    return NULL;
+}
+
+/*
+ * Called with the stream and adev locks held once in->pcm is open and
+ * prepared. On success the session owns the PCM and in->pcm is NULL.
+ */
+int audio_extn_capture_share_start(struct stream_in *in, int priority)
+{
+    struct share_session *session;
+    struct share_client *client;
+    pthread_condattr_t attr;
+
+    if (!capture_share_usecase(in) || in->pcm == NULL)
+        return -ENOSYS;
+
+    if (in->config.format != PCM_FORMAT_S16_LE &&
+        in->config.format != PCM_FORMAT_S24_LE)
+        return -ENOSYS;
+
+    session = calloc(1, sizeof(struct share_session));
+    if (session == NULL)
+        return -ENOMEM;
+
+    session->config = in->config;
+    session->frame_size = pcm_frames_to_bytes(in->pcm, 1);
+    session->period_bytes = session->config.period_size * session->frame_size;
+    session->period_buf = malloc(session->period_bytes);
+    client = session->period_buf ? client_create(session, in, priority) : NULL;
+    if (client == NULL) {
+        free(session->period_buf);
+        free(session);
+        return -ENOMEM;
+    }
+
+    pthread_mutex_init(&session->lock, (const pthread_mutexattr_t *) NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&session->cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    session->pcm = in->pcm;
+    session->clients[0] = client;
+    session->num_clients = 1;
+    session->max_clients = 1;
+
+    if (pthread_create(&session->thread, (const pthread_attr_t *) NULL,
+                       capture_share_thread_loop, session)) {
+        ALOGW("%s: could not start reader thread, reading directly", __func__);
+        pthread_cond_destroy(&session->cond);
+        pthread_mutex_destroy(&session->lock);
+        client_destroy(client);
+        free(session->period_buf);
+        free(session);
+        return -ENOSYS;
+    }
+
+    in->pcm = NULL;
+    in->capture_share = client;
+    ALOGV("%s: usecase(%d) rate %u channels %u", __func__, in->usecase,
+          session->config.rate, session->config.channels);
+    return 0;
+}
+
+/*
+ * Called with the stream and adev locks held. owner is the stream that
+ * holds the usecase in->usecase. Returns 0 when in now reads from owner's
+ * session; in->pcm is left NULL.
+ */
+int audio_extn_capture_share_attach(struct stream_in *owner, struct stream_in *in,
+                                    int priority)
+{
+    struct share_client *owner_client = owner->capture_share;
+    struct share_session *session;
+    struct share_client *client;
+
+    if (owner_client == NULL || !capture_share_usecase(in))
+        return -ENOSYS;
+    session = owner_client->session;
+
+    if (android_atomic_acquire_load(&session->error) != 0 ||
+        in->device != owner->device ||
+        in->config.rate != session->config.rate ||
+        in->config.channels > session->config.channels ||
+        in->enable_aec != owner->enable_aec ||
+        in->enable_ns != owner->enable_ns ||
+        in->zoom != owner->zoom ||
+        in->direction != owner->direction)
+        return -EINVAL;
+
+    /* a higher priority source would reroute the mic under the other streams */
+    if (priority > owner_client->priority)
+        return -EINVAL;
+
+    if (session->num_clients >= CAPTURE_SHARE_MAX_CLIENTS)
+        return -EBUSY;
+
+    client = client_create(session, in, priority);
+    if (client == NULL)
+        return -ENOMEM;
+
+    pthread_mutex_lock(&session->lock);
+    session->clients[session->num_clients++] = client;
+    if ((unsigned int)session->num_clients > session->max_clients)
+        session->max_clients = session->num_clients;
+    pthread_mutex_unlock(&session->lock);
+
+    in->capture_share = client;
+    in->pcm_device_id = owner->pcm_device_id;
+    ALOGD("%s: usecase(%d) %d clients", __func__, in->usecase, session->num_clients);
+    return 0;
+}
+
+/*
+ * Called with the stream and adev locks held. Returns the remaining stream
+ * with the highest priority, or NULL when in was the last one and the PCM
+ * has been closed.
+ */
+struct stream_in *audio_extn_capture_share_detach(struct stream_in *in)
+{
+    struct share_client *client = in->capture_share;
+    struct share_session *session;
+    struct stream_in *next = NULL;
+    int i, best = -1;
+
+    if (client == NULL)
+        return NULL;
+    session = client->session;
+    in->capture_share = NULL;
+
+    pthread_mutex_lock(&session->lock);
+    for (i = 0; i < session->num_clients; i++) {
+        if (session->clients[i] == client) {
+            session->clients[i] = session->clients[--session->num_clients];
+            break;
+        }
+    }
+    for (i = 0; i < session->num_clients; i++) {
+        if (session->clients[i]->priority > best) {
+            best = session->clients[i]->priority;
+            next = session->clients[i]->in;
+        }
+    }
+    if (next == NULL)
+        session->exit = true;
+    pthread_mutex_unlock(&session->lock);
+
+    if (next != NULL) {
+        ALOGD("%s: usecase(%d) %d clients", __func__, in->usecase, session->num_clients);
+        client_destroy(client);
+        return next;
+    }
+
+    /* wakes a pcm_read blocked on a stalled front end */
+    pcm_stop(session->pcm);
+    pthread_join(session->thread, (void **) NULL);
+    pcm_close(session->pcm);
+
+    pthread_cond_destroy(&session->cond);
+    pthread_mutex_destroy(&session->lock);
+    client_destroy(client);
+    free(session->period_buf);
+    free(session);
+    return NULL;
+}
+
+/*
+ * Called with the stream and adev locks held before in opens its own PCM.
+ * Joins the session of the stream holding in->usecase, if it takes in.
+ * The effects and the zoom of the owner already match and stay applied.
+ */
+int audio_extn_capture_share_join(struct audio_device *adev, struct stream_in *in,
+                                  int priority)
+{
+    struct audio_usecase *uc_info = get_usecase_from_list(adev, in->usecase);
+
+    if (uc_info == NULL || uc_info->type != PCM_CAPTURE || uc_info->stream.in == NULL)
+        return -ENOSYS;
+    return audio_extn_capture_share_attach(uc_info->stream.in, in, priority);
+}
+
+/*
+ * Called with the stream and adev locks held when in stops reading. Returns
+ * false when in was the last reader and the usecase has to be stopped.
+ * Otherwise the usecase stays up; if in held it, it now belongs to the
+ * remaining stream with the highest priority, which is returned in
+ * new_owner so its route can be applied. new_owner is NULL otherwise.
+ */
+bool audio_extn_capture_share_leave(struct audio_device *adev, struct stream_in *in,
+                                    struct stream_in **new_owner)
+{
+    struct audio_usecase *uc_info;
+    struct stream_in *next = audio_extn_capture_share_detach(in);
+
+    *new_owner = NULL;
+    if (next == NULL)
+        return false;
+
+    uc_info = get_usecase_from_list(adev, in->usecase);
+    if (uc_info != NULL && uc_info->stream.in == in) {
+        uc_info->stream.in = next;
+        *new_owner = next;
+    }
+    return true;
+}
+
+static void convert_frames(const struct share_session *session,
+                           const struct stream_in *in,
+                           void *dst, const uint8_t *src, uint32_t frames)
+{
+    const unsigned int src_ch = session->config.channels;
+    const unsigned int dst_ch = in->config.channels;
+    uint32_t f;
+    unsigned int c;
+
+    if (session->config.format == PCM_FORMAT_S16_LE) {
+        const int16_t *s = (const int16_t *)src;
+        if (in->format == AUDIO_FORMAT_PCM_8_24_BIT) {
+            int32_t *d = (int32_t *)dst;
+            for (f = 0; f < frames; f++, s += src_ch)
+                for (c = 0; c < dst_ch; c++)
+                    *d++ = (int32_t)s[c] << 8;
+        } else if (src_ch == dst_ch) {
+            memcpy(dst, src, frames * session->frame_size);
+        } else {
+            int16_t *d = (int16_t *)dst;
+            for (f = 0; f < frames; f++, s += src_ch)
+                for (c = 0; c < dst_ch; c++)
+                    *d++ = s[c];
+        }
+    } else {
+        /* data from DSP comes in 24_8 format */
+        const int32_t *s = (const int32_t *)src;
+        if (in->format == AUDIO_FORMAT_PCM_8_24_BIT) {
+            int32_t *d = (int32_t *)dst;
+            for (f = 0; f < frames; f++, s += src_ch)
+                for (c = 0; c < dst_ch; c++)
+                    *d++ = s[c] >> 8;
+        } else {
+            int16_t *d = (int16_t *)dst;
+            for (f = 0; f < frames; f++, s += src_ch)
+                for (c = 0; c < dst_ch; c++)
+                    *d++ = (int16_t)(s[c] >> 16);
+        }
+    }
+}
+
+/*
+ * Called with the stream lock held. Blocks until bytes have been delivered
+ * in the stream's own format and channel count.
+ */
+int audio_extn_capture_share_read(struct stream_in *in, void *buffer, size_t bytes)
+{
+    struct share_client *client = in->capture_share;
+    struct share_session *session = client->session;
+    const size_t frame_size = audio_stream_in_frame_size(&in->stream);
+    const uint32_t mask = client->ring_frames - 1;
+    const int64_t timeout_ns = (int64_t)session->config.period_size *
+            CAPTURE_SHARE_READ_TIMEOUT_PERIODS * 1000000000LL / session->config.rate;
+    size_t frames = bytes / frame_size;
+    uint8_t *dst = (uint8_t *)buffer;
+    int32_t front = client->front;
+
+    while (frames > 0) {
+        int32_t rear = android_atomic_acquire_load(&client->rear);
+        uint32_t avail = (uint32_t)(rear - front);
+        uint32_t offset, n;
+
+        if (avail == 0) {
+            struct timespec ts;
+            int ret = android_atomic_acquire_load(&session->error);
+
+            if (ret != 0)
+                return ret;
+
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            ts.tv_sec += (ts.tv_nsec + timeout_ns) / 1000000000LL;
+            ts.tv_nsec = (ts.tv_nsec + timeout_ns) % 1000000000LL;
+
+            pthread_mutex_lock(&session->lock);
+            while (client->rear == front && session->error == 0 && ret == 0)
+                ret = pthread_cond_timedwait(&session->cond, &session->lock, &ts);
+            pthread_mutex_unlock(&session->lock);
+            if (ret == ETIMEDOUT) {
+                ALOGE("%s: no capture data for %lld ms", __func__,
+                      (long long)(timeout_ns / 1000000));
+                return -ETIMEDOUT;
+            }
+            continue;
+        }
+
+        offset = (uint32_t)front & mask;
+        n = client->ring_frames - offset;
+        if (n > avail)
+            n = avail;
+        if (n > frames)
+            n = frames;
+        convert_frames(session, in, dst, client->ring + offset * session->frame_size, n);
+        front += (int32_t)n;
+        android_atomic_release_store(front, &client->front);
+        dst += n * frame_size;
+        frames -= n;
+    }
+    return 0;
+}
+
+/* Called with the stream lock held */
+int audio_extn_capture_share_get_position(struct stream_in *in,
+                                          int64_t *frames, int64_t *time)
+{
+    struct share_client *client = in->capture_share;
+    struct share_session *session = client->session;
+    int ret = -ENODATA;
+
+    pthread_mutex_lock(&session->lock);
+    if (session->timestamp_valid) {
+        /* frames still queued in the ring were captured before the timestamp */
+        *frames = in->frames_read + (int32_t)(client->rear_at_timestamp - client->front) +
+                  session->avail;
+        *time = session->timestamp.tv_sec * 1000000000LL + session->timestamp.tv_nsec;
+        ret = 0;
+    }
+    pthread_mutex_unlock(&session->lock);
+    return ret;
+}
+
+/*
+ * Called with the stream lock held. Returns the frames the stream's ring
+ * dropped on overrun since the previous call.
+ */
+uint32_t audio_extn_capture_share_get_frames_lost(struct stream_in *in)
+{
+    struct share_client *client = in->capture_share;
+    struct share_session *session = client->session;
+    uint32_t frames_lost;
+
+    pthread_mutex_lock(&session->lock);
+    frames_lost = client->frames_lost;
+    client->frames_lost = 0;
+    pthread_mutex_unlock(&session->lock);
+    return frames_lost;
+}
+
+void audio_extn_capture_share_dump(struct stream_in *in, int fd)
+{
+    struct share_client *client = in->capture_share;
+    struct share_session *session;
+
+    if (client == NULL)
+        return;
+    session = client->session;
+
+    pthread_mutex_lock(&session->lock);
+    dprintf(fd, "      Capture share: %d clients (max %u), %u Hz %u ch, %llu periods read%s\n",
+            session->num_clients, session->max_clients, session->config.rate,
+            session->config.channels, (unsigned long long)session->periods_read,
+            session->error ? ", failed" : "");
+    dprintf(fd, "      Capture share ring: %u frames, %u overruns, %llu frames dropped\n",
+            client->ring_frames, client->overruns,
+            (unsigned long long)client->frames_dropped);
+    pthread_mutex_unlock(&session->lock);
+}
@@ -43,6 +43,15 @@ struct cirrus_playback_session {
     pthread_t calibration_thread;
 #ifdef ENABLE_CIRRUS_DETECTION
     pthread_t failure_detect_thread;
+    pthread_cond_t fail_det_cond; /* signalled with fb_prot_mutex on state change */
+    bool fail_det_exit;
+    /* failure detection counters, protected by fb_prot_mutex */
+    int64_t fail_det_start_ns;
+    uint64_t fail_det_wakeups;
+    uint32_t fail_det_interval_us;
+    uint32_t fail_det_faults;
+    int64_t fail_det_latency_last_us;
+    int64_t fail_det_latency_max_us;
 #endif
     struct pcm *pcm_rx;
     struct pcm *pcm_tx;
@@ -118,6 +127,10 @@ struct crus_rx_run_case_ctrl_t {
 
 #define FAIL_DETECT_INIT_WAIT_US 500000
 #define FAIL_DETECT_LOOP_WAIT_US 300000
+/* polling interval backs off exponentially up to this while readings are stable */
+#define FAIL_DETECT_MAX_LOOP_WAIT_US 4800000
+/* a reading is stable if it moved less than 1/STABLE_DIV of the error range */
+#define FAIL_DETECT_STABLE_DIV 10
 
 #define CRUS_DEFAULT_CAL_L 0x2A11
 #define CRUS_DEFAULT_CAL_R 0x29CB
@@ -179,6 +192,16 @@ void audio_extn_spkr_prot_init(void *adev) {
 
     pthread_mutex_init(&handle.fb_prot_mutex, NULL);
 
+#ifdef ENABLE_CIRRUS_DETECTION
+    /* the monitor sleeps until a speaker snd device is enabled */
+    pthread_cond_init(&handle.fail_det_cond, NULL);
+    handle.fail_det_exit = false;
+    handle.fail_det_interval_us = FAIL_DETECT_LOOP_WAIT_US;
+    (void)pthread_create(&handle.failure_detect_thread,
+                (const pthread_attr_t *) NULL,
+                audio_extn_cirrus_failure_detect_thread, &handle);
+#endif
+
 #ifdef CIRRUS_FACTORY_CALIBRATION
     (void)pthread_create(&handle.calibration_thread,
                 (const pthread_attr_t *) NULL,
@@ -194,7 +217,12 @@ void audio_extn_spkr_prot_deinit(void *adev __unused) {
     ALOGV("%s: Entry", __func__);
 
 #ifdef ENABLE_CIRRUS_DETECTION
+    pthread_mutex_lock(&handle.fb_prot_mutex);
+    handle.fail_det_exit = true;
+    pthread_cond_signal(&handle.fail_det_cond);
+    pthread_mutex_unlock(&handle.fb_prot_mutex);
     pthread_join(handle.failure_detect_thread, NULL);
+    pthread_cond_destroy(&handle.fail_det_cond);
 #endif
     pthread_join(handle.calibration_thread, NULL);
     pthread_mutex_destroy(&handle.fb_prot_mutex);
@@ -536,15 +564,12 @@ close_stream:
     free(uc_info_rx);
     pthread_mutex_unlock(&adev->lock);
 exit:
+    pthread_mutex_lock(&handle.fb_prot_mutex);
     handle.state = (prev_state == PLAYBACK) ? PLAYBACK : IDLE;
-
 #ifdef ENABLE_CIRRUS_DETECTION
-    if (handle.state == PLAYBACK)
-        (void)pthread_create(&handle.failure_detect_thread,
-                    (const pthread_attr_t *) NULL,
-                    audio_extn_cirrus_failure_detect_thread,
-                    &handle);
+    pthread_cond_signal(&handle.fail_det_cond);
 #endif
+    pthread_mutex_unlock(&handle.fb_prot_mutex);
 
     ALOGV("%s: Exit", __func__);
 
@@ -636,6 +661,45 @@ exit:
 #endif
 
 #ifdef ENABLE_CIRRUS_DETECTION
+static int64_t cirrus_now_ns() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * Waits on fail_det_cond for up to wait_us, or until the playback state
+ * changes. Must be called with fb_prot_mutex held.
+ */
+static void cirrus_fail_det_wait_l(uint32_t wait_us) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += wait_us / 1000000;
+    ts.tv_nsec += (wait_us % 1000000) * 1000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+
+    while ((handle.state == PLAYBACK) && !handle.fail_det_exit) {
+        if (pthread_cond_timedwait(&handle.fail_det_cond,
+                                   &handle.fb_prot_mutex, &ts) == ETIMEDOUT)
+            break;
+    }
+    handle.fail_det_wakeups++;
+}
+
+/*
+ * Waits for the current playback session to end.
+ * Must be called with fb_prot_mutex held.
+ */
+static void cirrus_fail_det_wait_idle_l() {
+    while ((handle.state == PLAYBACK) && !handle.fail_det_exit)
+        pthread_cond_wait(&handle.fail_det_cond, &handle.fb_prot_mutex);
+}
+
 void *audio_extn_cirrus_failure_detect_thread() {
     struct audio_device *adev = handle.adev_handle;
     struct crus_sp_ioctl_header header;
@@ -650,17 +714,14 @@ void *audio_extn_cirrus_failure_detect_thread() {
     int ret = 0, dev_file = -1, out_cal0 = 0, out_cal1 = 0;
     int rL = 0, rR = 0, zL = 0, zR = 0, tL = 0, tR = 0;
     int rdL = 0, rdR = 0, tdL = 0, tdR = 0, ambL = 0, ambR = 0;
+    int prev_rL = 0, prev_rR = 0, prev_tdL = 0, prev_tdR = 0;
     bool left_cal_done = false, right_cal_done = false;
-    bool det_en = false;
+    bool cal_checked = false, det_en = false, fault = false, prev_fault = false;
+    bool have_prev = false, stable;
+    int64_t now_ns, last_read_ns = 0;
 
     ALOGI("%s: Entry", __func__);
 
-    ctl = mixer_get_ctl_by_name(adev->mixer, CRUS_SP_FAIL_DET_MIXER);
-    det_en = mixer_ctl_get_value(ctl, 0);
-
-    if (!det_en)
-        goto exit;
-
     dev_file = open(CRUS_SP_FILE, O_RDWR | O_NONBLOCK);
     if (dev_file < 0) {
         ALOGE("%s: Failed to open Cirrus Playback IOCTL (%d)",
@@ -680,112 +741,198 @@ void *audio_extn_cirrus_failure_detect_thread() {
     header.data_length = CRUS_PARAM_TEMP_MAX_LENGTH;
     header.data = buffer;
 
-    usleep(FAIL_DETECT_INIT_WAIT_US);
-
     pthread_mutex_lock(&handle.fb_prot_mutex);
-    ret = ioctl(dev_file, CRUS_SP_IOCTL_GET, &header);
-    pthread_mutex_unlock(&handle.fb_prot_mutex);
-    if (ret < 0) {
-        ALOGE("%s: Cirrus SP IOCTL failure (%d)",
-               __func__, ret);
-        goto exit;
-    }
-
-    zL = buffer[2] * amp_factor;
-    zR = buffer[4] * amp_factor;
-
-    ambL = buffer[10];
-    ambR = buffer[6];
-
-    out_cal0 = buffer[12];
-    out_cal1 = buffer[13];
+    handle.fail_det_start_ns = cirrus_now_ns();
 
-    left_cal_done = (out_cal0 == 2) && (out_cal1 == 2) &&
-                    (buffer[2] != CRUS_DEFAULT_CAL_L);
+    while (!handle.fail_det_exit) {
+        /* no wakeups at all while the speaker is not in use */
+        while ((handle.state != PLAYBACK) && !handle.fail_det_exit)
+            pthread_cond_wait(&handle.fail_det_cond, &handle.fb_prot_mutex);
+        if (handle.fail_det_exit)
+            break;
 
-    out_cal0 = buffer[14];
-    out_cal1 = buffer[15];
-
-    right_cal_done = (out_cal0 == 2) && (out_cal1 == 2) &&
-                     (buffer[4] != CRUS_DEFAULT_CAL_R);
-
-    if (left_cal_done) {
-        ALOGI("%s: L Speaker Impedance: %d.%08d ohms", __func__,
-              zL / r_scale_factor, abs(zL) % r_scale_factor);
-        ALOGI("%s: L Calibration Temperature: %d C", __func__, ambL);
-    } else
-        ALOGE("%s: Left speaker uncalibrated", __func__);
-
-    if (right_cal_done) {
-        ALOGI("%s: R Speaker Impedance: %d.%08d ohms", __func__,
-               zR / r_scale_factor, abs(zR) % r_scale_factor);
-        ALOGI("%s: R Calibration Temperature: %d C", __func__, ambR);
-    } else
-        ALOGE("%s: Right speaker uncalibrated", __func__);
-
-    if (!left_cal_done && !right_cal_done)
-        goto exit;
-
-    ALOGI("%s: Monitoring speaker impedance & temperature...", __func__);
-
-    while ((handle.state == PLAYBACK) && det_en) {
-        pthread_mutex_lock(&handle.fb_prot_mutex);
-        ret = ioctl(dev_file, CRUS_SP_IOCTL_GET, &header);
+        /* the mixer and the DSP are only accessed with fb_prot_mutex
+           released, so state changes are never held up behind them */
         pthread_mutex_unlock(&handle.fb_prot_mutex);
-        if (ret < 0) {
-            ALOGE("%s: Cirrus SP IOCTL failure (%d)",
-                  __func__, ret);
-            goto loop;
+        if (!ctl)
+            ctl = mixer_get_ctl_by_name(adev->mixer, CRUS_SP_FAIL_DET_MIXER);
+        det_en = ctl && mixer_ctl_get_value(ctl, 0);
+        pthread_mutex_lock(&handle.fb_prot_mutex);
+        if (!det_en) {
+            /* wait for the next playback session to check again */
+            cirrus_fail_det_wait_idle_l();
+            continue;
         }
 
-        rL = buffer[3];
-        rR = buffer[1];
-
-        zL = buffer[2];
-        zR = buffer[4];
-
-        if ((zL == 0) || (zR == 0))
-            goto loop;
-
-        tdL = (material * t_scale_factor * (rL-zL) / zL);
-        tdR = (material * t_scale_factor * (rR-zR) / zR);
-
-        rL *= amp_factor;
-        rR *= amp_factor;
-
-        zL *= amp_factor;
-        zR *= amp_factor;
-
-        tL = tdL + (ambL * t_scale_factor);
-        tR = tdR + (ambR * t_scale_factor);
-
-        rdL = abs(zL - rL);
-        rdR = abs(zR - rR);
-
-        if (left_cal_done && (rL != 0) && (rdL > r_err_range))
-            ALOGI("%s: Left speaker impedance out of range (%d.%08d ohms)",
-                  __func__, rL / r_scale_factor,
-                  abs(rL % r_scale_factor));
-
-        if (right_cal_done && (rR != 0) && (rdR > r_err_range))
-            ALOGI("%s: Right speaker impedance out of range (%d.%08d ohms)",
-                  __func__, rR / r_scale_factor,
-                  abs(rR % r_scale_factor));
-
-        if (left_cal_done && (rL != 0) && (tdL > t_err_range))
-            ALOGI("%s: Left speaker temperature out of range (%d.%05d C)",
-                  __func__, tL / t_scale_factor,
-                  abs(tL % t_scale_factor));
+        cirrus_fail_det_wait_l(FAIL_DETECT_INIT_WAIT_US);
+        if (handle.state != PLAYBACK)
+            continue;
+
+        if (!cal_checked) {
+            pthread_mutex_unlock(&handle.fb_prot_mutex);
+            ret = ioctl(dev_file, CRUS_SP_IOCTL_GET, &header);
+            pthread_mutex_lock(&handle.fb_prot_mutex);
+            if (ret < 0) {
+                ALOGE("%s: Cirrus SP IOCTL failure (%d)",
+                       __func__, ret);
+                /* retry in the next playback session */
+                cirrus_fail_det_wait_idle_l();
+                continue;
+            }
+            cal_checked = true;
+
+            zL = buffer[2] * amp_factor;
+            zR = buffer[4] * amp_factor;
+
+            ambL = buffer[10];
+            ambR = buffer[6];
+
+            out_cal0 = buffer[12];
+            out_cal1 = buffer[13];
+
+            left_cal_done = (out_cal0 == 2) && (out_cal1 == 2) &&
+                            (buffer[2] != CRUS_DEFAULT_CAL_L);
+
+            out_cal0 = buffer[14];
+            out_cal1 = buffer[15];
+
+            right_cal_done = (out_cal0 == 2) && (out_cal1 == 2) &&
+                             (buffer[4] != CRUS_DEFAULT_CAL_R);
+
+            if (left_cal_done) {
+                ALOGI("%s: L Speaker Impedance: %d.%08d ohms", __func__,
+                      zL / r_scale_factor, abs(zL) % r_scale_factor);
+                ALOGI("%s: L Calibration Temperature: %d C", __func__, ambL);
+            } else
+                ALOGE("%s: Left speaker uncalibrated", __func__);
+
+            if (right_cal_done) {
+                ALOGI("%s: R Speaker Impedance: %d.%08d ohms", __func__,
+                       zR / r_scale_factor, abs(zR) % r_scale_factor);
+                ALOGI("%s: R Calibration Temperature: %d C", __func__, ambR);
+            } else
+                ALOGE("%s: Right speaker uncalibrated", __func__);
+
+            if (!left_cal_done && !right_cal_done) {
+                /* nothing to monitor, check again next session in case
+                   the speakers got calibrated meanwhile */
+                cal_checked = false;
+                cirrus_fail_det_wait_idle_l();
+                continue;
+            }
+        }
 
-        if (right_cal_done && (rR != 0) && (tdR > t_err_range))
-            ALOGI("%s: Right speaker temperature out of range (%d.%05d C)",
-                  __func__, tR / t_scale_factor,
-                  abs(tR % t_scale_factor));
+        ALOGI("%s: Monitoring speaker impedance & temperature...", __func__);
+
+        handle.fail_det_interval_us = FAIL_DETECT_LOOP_WAIT_US;
+        have_prev = false;
+        prev_fault = false;
+        last_read_ns = 0;
+
+        while ((handle.state == PLAYBACK) && det_en && !handle.fail_det_exit) {
+            stable = false;
+            fault = false;
+
+            pthread_mutex_unlock(&handle.fb_prot_mutex);
+            ret = ioctl(dev_file, CRUS_SP_IOCTL_GET, &header);
+            now_ns = cirrus_now_ns();
+            pthread_mutex_lock(&handle.fb_prot_mutex);
+            if (ret < 0) {
+                ALOGE("%s: Cirrus SP IOCTL failure (%d)",
+                      __func__, ret);
+                goto loop;
+            }
+
+            rL = buffer[3];
+            rR = buffer[1];
+
+            zL = buffer[2];
+            zR = buffer[4];
+
+            if ((zL == 0) || (zR == 0))
+                goto loop;
+
+            tdL = (material * t_scale_factor * (rL-zL) / zL);
+            tdR = (material * t_scale_factor * (rR-zR) / zR);
+
+            rL *= amp_factor;
+            rR *= amp_factor;
+
+            zL *= amp_factor;
+            zR *= amp_factor;
+
+            tL = tdL + (ambL * t_scale_factor);
+            tR = tdR + (ambR * t_scale_factor);
+
+            rdL = abs(zL - rL);
+            rdR = abs(zR - rR);
+
+            if (left_cal_done && (rL != 0) && (rdL > r_err_range)) {
+                ALOGI("%s: Left speaker impedance out of range (%d.%08d ohms)",
+                      __func__, rL / r_scale_factor,
+                      abs(rL % r_scale_factor));
+                fault = true;
+            }
+
+            if (right_cal_done && (rR != 0) && (rdR > r_err_range)) {
+                ALOGI("%s: Right speaker impedance out of range (%d.%08d ohms)",
+                      __func__, rR / r_scale_factor,
+                      abs(rR % r_scale_factor));
+                fault = true;
+            }
+
+            if (left_cal_done && (rL != 0) && (tdL > t_err_range)) {
+                ALOGI("%s: Left speaker temperature out of range (%d.%05d C)",
+                      __func__, tL / t_scale_factor,
+                      abs(tL % t_scale_factor));
+                fault = true;
+            }
+
+            if (right_cal_done && (rR != 0) && (tdR > t_err_range)) {
+                ALOGI("%s: Right speaker temperature out of range (%d.%05d C)",
+                      __func__, tR / t_scale_factor,
+                      abs(tR % t_scale_factor));
+                fault = true;
+            }
+
+            /* a new fault happened at some point since the previous
+               reading, which bounds the detection latency */
+            if (fault && !prev_fault && last_read_ns) {
+                handle.fail_det_faults++;
+                handle.fail_det_latency_last_us = (now_ns - last_read_ns) / 1000;
+                if (handle.fail_det_latency_last_us > handle.fail_det_latency_max_us)
+                    handle.fail_det_latency_max_us = handle.fail_det_latency_last_us;
+            }
+
+            stable = have_prev && !fault &&
+                     (abs(rL - prev_rL) < r_err_range / FAIL_DETECT_STABLE_DIV) &&
+                     (abs(rR - prev_rR) < r_err_range / FAIL_DETECT_STABLE_DIV) &&
+                     (abs(tdL - prev_tdL) < t_err_range / FAIL_DETECT_STABLE_DIV) &&
+                     (abs(tdR - prev_tdR) < t_err_range / FAIL_DETECT_STABLE_DIV);
+
+            prev_rL = rL;
+            prev_rR = rR;
+            prev_tdL = tdL;
+            prev_tdR = tdR;
+            prev_fault = fault;
+            have_prev = true;
+            last_read_ns = now_ns;
 
 loop:
-        det_en = mixer_ctl_get_value(ctl, 0);
-        usleep(FAIL_DETECT_LOOP_WAIT_US);
+            if (stable) {
+                handle.fail_det_interval_us *= 2;
+                if (handle.fail_det_interval_us > FAIL_DETECT_MAX_LOOP_WAIT_US)
+                    handle.fail_det_interval_us = FAIL_DETECT_MAX_LOOP_WAIT_US;
+            } else {
+                handle.fail_det_interval_us = FAIL_DETECT_LOOP_WAIT_US;
+            }
+            pthread_mutex_unlock(&handle.fb_prot_mutex);
+            det_en = mixer_ctl_get_value(ctl, 0);
+            pthread_mutex_lock(&handle.fb_prot_mutex);
+            cirrus_fail_det_wait_l(handle.fail_det_interval_us);
+        }
     }
+    pthread_mutex_unlock(&handle.fb_prot_mutex);
 
 exit:
     if (dev_file >= 0)
@@ -857,15 +1004,10 @@ int audio_extn_spkr_prot_start_processing(snd_device_t snd_device) {
         goto exit;
     }
 
+    handle.state = PLAYBACK;
 #ifdef ENABLE_CIRRUS_DETECTION
-    if (handle.state == IDLE)
-        (void)pthread_create(&handle.failure_detect_thread,
-                    (const pthread_attr_t *) NULL,
-                    audio_extn_cirrus_failure_detect_thread,
-                    &handle);
+    pthread_cond_signal(&handle.fail_det_cond);
 #endif
-
-    handle.state = PLAYBACK;
 exit:
     if (ret) {
         handle.state = IDLE;
@@ -895,6 +1037,9 @@ void audio_extn_spkr_prot_stop_processing(snd_device_t snd_device) {
     pthread_mutex_lock(&handle.fb_prot_mutex);
 
     handle.state = IDLE;
+#ifdef ENABLE_CIRRUS_DETECTION
+    pthread_cond_signal(&handle.fail_det_cond);
+#endif
     uc_info_tx = get_usecase_from_list(adev, USECASE_AUDIO_SPKR_CALIB_TX);
 
     if (uc_info_tx) {
@@ -939,3 +1084,23 @@ int audio_extn_get_spkr_prot_snd_device(snd_device_t snd_device) {
 void audio_extn_spkr_prot_calib_cancel(__unused void *adev) {
     // FIXME: wait or cancel audio_extn_cirrus_run_calibration
 }
+
+void audio_extn_spkr_prot_dump(int fd __unused) {
+#ifdef ENABLE_CIRRUS_DETECTION
+    const bool locked = (pthread_mutex_trylock(&handle.fb_prot_mutex) == 0);
+    const int64_t elapsed_ns = cirrus_now_ns() - handle.fail_det_start_ns;
+
+    dprintf(fd, "  Cirrus failure detection:\n");
+    dprintf(fd, "    Wakeups: %llu (%.1f per hour)\n",
+            (unsigned long long)handle.fail_det_wakeups,
+            elapsed_ns > 0 ? handle.fail_det_wakeups * 3600e9 / elapsed_ns : 0.);
+    dprintf(fd, "    Poll interval ms: %u\n", handle.fail_det_interval_us / 1000);
+    dprintf(fd, "    Faults detected: %u\n", handle.fail_det_faults);
+    dprintf(fd, "    Detection latency ms: last %.1f max %.1f\n",
+            handle.fail_det_latency_last_us * 1e-3,
+            handle.fail_det_latency_max_us * 1e-3);
+
+    if (locked)
+        pthread_mutex_unlock(&handle.fb_prot_mutex);
+#endif
+}
@@ -246,6 +246,7 @@ static int32_t start_hfp(struct audio_device *adev,
     int32_t i, ret = 0;
     struct audio_usecase *uc_info;
     int32_t pcm_dev_rx_id, pcm_dev_tx_id, pcm_dev_asm_rx_id, pcm_dev_asm_tx_id;
+    snd_device_t out_snd_device = SND_DEVICE_NONE;
 
     ALOGD("%s: enter", __func__);
 
@@ -268,7 +269,10 @@ static int32_t start_hfp(struct audio_device *adev,
 
     audio_extn_tfa_98xx_set_mode_bt();
 
+    voice_trace_begin(adev, CALL_SETUP_TYPE_HFP, hfpmod.ucid);
     select_devices(adev, hfpmod.ucid);
+    voice_trace_phase(adev, CALL_SETUP_SELECT_DEVICES);
+    out_snd_device = uc_info->out_snd_device;
 
     pcm_dev_rx_id = platform_get_pcm_device_id(uc_info->id, PCM_PLAYBACK);
     pcm_dev_tx_id = platform_get_pcm_device_id(uc_info->id, PCM_CAPTURE);
@@ -285,58 +289,39 @@ static int32_t start_hfp(struct audio_device *adev,
     ALOGV("%s: HFP PCM devices (hfp rx tx: %d pcm rx tx: %d) for the usecase(%d)",
               __func__, pcm_dev_rx_id, pcm_dev_tx_id, uc_info->id);
 
-    ALOGV("%s: Opening PCM playback device card_id(%d) device_id(%d)",
-          __func__, adev->snd_card, pcm_dev_rx_id);
-    hfpmod.hfp_sco_rx = pcm_open(adev->snd_card,
-                                  pcm_dev_asm_rx_id,
-                                  PCM_OUT, &pcm_config_hfp);
-    if (hfpmod.hfp_sco_rx && !pcm_is_ready(hfpmod.hfp_sco_rx)) {
-        ALOGE("%s: %s", __func__, pcm_get_error(hfpmod.hfp_sco_rx));
+    /* SCO front ends first, the host PCMs only without an external amp */
+    struct pcm_open_req reqs[] = {
+        { adev->snd_card, pcm_dev_asm_rx_id, PCM_OUT, &pcm_config_hfp },
+        { adev->snd_card, pcm_dev_asm_tx_id, PCM_IN, &pcm_config_hfp },
+        { adev->snd_card, pcm_dev_rx_id, PCM_OUT, &pcm_config_hfp },
+        { adev->snd_card, pcm_dev_tx_id, PCM_IN, &pcm_config_hfp },
+    };
+    ret = audio_extn_utils_pcm_open_batch(reqs,
+            audio_extn_tfa_98xx_is_supported() ? 2 : ARRAY_SIZE(reqs));
+    voice_trace_phase(adev, CALL_SETUP_PCM_OPEN);
+    voice_trace_add(adev, CALL_SETUP_PCM_OPEN_RX, reqs[0].open_us);
+    voice_trace_add(adev, CALL_SETUP_PCM_OPEN_TX, reqs[1].open_us);
+    voice_trace_add(adev, CALL_SETUP_PCM_OPEN_HOST_RX, reqs[2].open_us);
+    voice_trace_add(adev, CALL_SETUP_PCM_OPEN_HOST_TX, reqs[3].open_us);
+    if (ret != 0) {
         ret = -EIO;
         goto exit;
     }
-    ALOGD("%s: Opening PCM capture device card_id(%d) device_id(%d)",
-          __func__, adev->snd_card, pcm_dev_tx_id);
+    hfpmod.hfp_sco_rx = reqs[0].pcm;
+    hfpmod.hfp_sco_tx = reqs[1].pcm;
+    hfpmod.hfp_pcm_rx = reqs[2].pcm;
+    hfpmod.hfp_pcm_tx = reqs[3].pcm;
 
-    if (audio_extn_tfa_98xx_is_supported() == false) {
-        hfpmod.hfp_pcm_rx = pcm_open(adev->snd_card,
-                                       pcm_dev_rx_id,
-                                       PCM_OUT, &pcm_config_hfp);
-        if (hfpmod.hfp_pcm_rx && !pcm_is_ready(hfpmod.hfp_pcm_rx)) {
-            ALOGE("%s: %s", __func__, pcm_get_error(hfpmod.hfp_pcm_rx));
-            ret = -EIO;
-            goto exit;
-        }
-    }
-    hfpmod.hfp_sco_tx = pcm_open(adev->snd_card,
-                                  pcm_dev_asm_tx_id,
-                                  PCM_IN, &pcm_config_hfp);
-    if (hfpmod.hfp_sco_tx && !pcm_is_ready(hfpmod.hfp_sco_tx)) {
-        ALOGE("%s: %s", __func__, pcm_get_error(hfpmod.hfp_sco_tx));
-        ret = -EIO;
-        goto exit;
-    }
-    ALOGV("%s: Opening PCM capture device card_id(%d) device_id(%d)",
-          __func__, adev->snd_card, pcm_dev_tx_id);
-
-    if (audio_extn_tfa_98xx_is_supported() == false) {
-        hfpmod.hfp_pcm_tx = pcm_open(adev->snd_card,
-                                       pcm_dev_tx_id,
-                                       PCM_IN, &pcm_config_hfp);
-        if (hfpmod.hfp_pcm_tx && !pcm_is_ready(hfpmod.hfp_pcm_tx)) {
-            ALOGE("%s: %s", __func__, pcm_get_error(hfpmod.hfp_pcm_tx));
-            ret = -EIO;
-            goto exit;
-        }
-    }
     pcm_start(hfpmod.hfp_sco_rx);
     pcm_start(hfpmod.hfp_sco_tx);
     if (audio_extn_tfa_98xx_is_supported() == false) {
         pcm_start(hfpmod.hfp_pcm_rx);
         pcm_start(hfpmod.hfp_pcm_tx);
     }
+    voice_trace_phase(adev, CALL_SETUP_PCM_START);
 
     audio_extn_tfa_98xx_enable_speaker();
+    voice_trace_phase(adev, CALL_SETUP_AMP);
 
     hfpmod.is_hfp_running = true;
     hfp_set_volume(adev, hfpmod.hfp_volume);
@@ -344,12 +329,15 @@ static int32_t start_hfp(struct audio_device *adev,
     /* Set mic volume by mute status, we don't provide set mic volume in phone app, only
     provide mute and unmute. */
     audio_extn_hfp_set_mic_mute(adev, adev->mic_muted);
+    voice_trace_phase(adev, CALL_SETUP_VOLUME);
+    voice_trace_end(adev, out_snd_device, 0);
 
     ALOGD("%s: exit: status(%d)", __func__, ret);
     return 0;
 
 exit:
     stop_hfp(adev);
+    voice_trace_end(adev, out_snd_device, ret);
     ALOGE("%s: Problem in HFP start: status(%d)", __func__, ret);
     return ret;
 }
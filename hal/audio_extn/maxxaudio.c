@@ -86,13 +86,16 @@ typedef enum MA_STREAM_TYPE {
     STREAM_MAX_TYPES,
 } ma_stream_type_t;
 
-typedef enum MA_CMD {
-    MA_CMD_VOL,
-    MA_CMD_SWAP_ENABLE,
-    MA_CMD_SWAP_DISABLE,
-    MA_CMD_ROTATE_ENABLE,
-    MA_CMD_ROTATE_DISABLE,
-} ma_cmd_t;
+/* calibration items, used as a dirty mask */
+typedef enum MA_CAL_ITEM {
+    MA_CAL_VOLUME_TABLE = 1 << 0,
+    MA_CAL_LR_SWAP      = 1 << 1,
+    MA_CAL_ORIENTATION  = 1 << 2,
+    MA_CAL_ALL          = MA_CAL_VOLUME_TABLE | MA_CAL_LR_SWAP | MA_CAL_ORIENTATION,
+} ma_cal_item_t;
+
+/* number of (app type, device) pairs for which the last applied values are kept */
+#define MA_APPLIED_CAL_ENTRIES 8
 
 typedef struct ma_audio_cal_version {
     unsigned int major;
@@ -115,6 +118,24 @@ struct ma_state {
     bool active;
 };
 
+/* calibration last applied to an app type and device */
+struct ma_applied_cal {
+    bool valid;
+    unsigned int app_type;
+    unsigned int device;
+    unsigned int valid_items; /* ma_cal_item_t mask of the values below known to be applied */
+    struct ma_state volume_table[STREAM_MAX_TYPES];
+    bool lr_swap;
+    int orientation;
+    uint32_t last_use;
+};
+
+struct ma_cal_stats {
+    uint32_t sent[3];     /* per item, indexed by bit position in ma_cal_item_t */
+    uint32_t skipped[3];
+    uint32_t errors;
+};
+
 typedef void *ma_audio_cal_handle_t;
 typedef int (*set_audio_cal_t)(const char *);
 
@@ -162,6 +183,9 @@ struct ma_platform_data {
     bool speaker_lr_swap;
     bool orientation_used;
     int dispaly_orientation;
+    struct ma_applied_cal applied[MA_APPLIED_CAL_ENTRIES];
+    uint32_t applied_use_count;
+    struct ma_cal_stats stats;
 };
 
 ma_audio_cal_handle_t g_ma_audio_cal_handle = NULL;
@@ -284,80 +308,152 @@ static void ma_cal_init(struct ma_audio_cal_settings *ma_cal)
     ma_cal->effect_scope_flag = EFFECTIVE_SCOPE_ALL;
 }
 
-static bool check_and_send_all_audio_cal(struct audio_device *adev, ma_cmd_t cmd)
+static const char *ma_cal_item_name(int bit)
 {
-    int i = 0;
-    bool ret = false;
-    float vol = 0;
-    struct listnode *node;
-    struct audio_usecase *usecase;
+    switch (1 << bit) {
+    case MA_CAL_VOLUME_TABLE: return "volume table";
+    case MA_CAL_LR_SWAP: return "lr swap";
+    case MA_CAL_ORIENTATION: return "orientation";
+    }
+    return "unknown";
+}
+
+// already hold lock
+static struct ma_applied_cal *get_applied_cal_l(unsigned int app_type, unsigned int device)
+{
+    struct ma_applied_cal *entry = NULL;
+    int i;
+
+    for (i = 0; i < MA_APPLIED_CAL_ENTRIES; i++) {
+        struct ma_applied_cal *cur = &my_data->applied[i];
+        if (cur->valid && cur->app_type == app_type && cur->device == device) {
+            entry = cur;
+            break;
+        }
+        // reuse the least recently used entry
+        if (entry == NULL || !cur->valid ||
+            (entry->valid && cur->last_use < entry->last_use))
+            entry = cur;
+    }
+    if (!entry->valid || entry->app_type != app_type || entry->device != device) {
+        memset(entry, 0, sizeof(*entry));
+        entry->valid = true;
+        entry->app_type = app_type;
+        entry->device = device;
+    }
+    entry->last_use = ++my_data->applied_use_count;
+    return entry;
+}
+
+static void ma_cal_item_done_l(ma_cal_item_t item, bool sent, bool ok)
+{
+    int bit = __builtin_ctz(item);
+
+    if (!sent)
+        my_data->stats.skipped[bit]++;
+    else if (ok)
+        my_data->stats.sent[bit]++;
+    else
+        my_data->stats.errors++;
+}
+
+/*
+ * Sends the dirty calibration items of a usecase, skipping the values already applied to its
+ * app type and device. lr swap and orientation are only applied on speaker, other devices get
+ * the neutral values. Already hold lock.
+ */
+static bool send_usecase_audio_cal_l(struct audio_usecase *usecase, unsigned int dirty)
+{
+    bool ret = true;
+    bool ok;
     struct ma_audio_cal_settings ma_cal;
+    struct ma_applied_cal *applied;
+    const bool speaker = usecase->stream.out->devices & AUDIO_DEVICE_OUT_SPEAKER;
 
     ma_cal_init(&ma_cal);
+    ma_cal.common.app_type = usecase->stream.out->app_type_cfg.app_type;
+    ma_cal.common.device = usecase->stream.out->devices;
+    applied = get_applied_cal_l(ma_cal.common.app_type, ma_cal.common.device);
+    ALOGV("%s: send usecase(%d) app_type(%d) device(%d) dirty(0x%x)",
+              __func__, usecase->id, ma_cal.common.app_type,
+              ma_cal.common.device, dirty);
+
+    if (dirty & MA_CAL_ORIENTATION) {
+        const int orientation = speaker ? my_data->dispaly_orientation : 0;
+        const bool send = !(applied->valid_items & MA_CAL_ORIENTATION) ||
+                          applied->orientation != orientation;
+        ok = true;
+        if (send) {
+            ok = ma_set_orientation_l(&ma_cal, orientation);
+            if (ok) {
+                ALOGV("ma_set_orientation_l %d returned with success.", orientation);
+                applied->orientation = orientation;
+                applied->valid_items |= MA_CAL_ORIENTATION;
+            } else {
+                ALOGE("ma_set_orientation_l %d returned with error.", orientation);
+                applied->valid_items &= ~MA_CAL_ORIENTATION;
+            }
+        }
+        ma_cal_item_done_l(MA_CAL_ORIENTATION, send, ok);
+        ret &= ok;
+    }
 
-    list_for_each(node, &adev->usecase_list) {
-        usecase = node_to_item(node, struct audio_usecase, list);
-        if (valid_usecase(usecase)) {
-            ma_cal.common.app_type = usecase->stream.out->app_type_cfg.app_type;
-            ma_cal.common.device = usecase->stream.out->devices;
-            ALOGV("%s: send usecase(%d) app_type(%d) device(%d)",
-                      __func__, usecase->id, ma_cal.common.app_type,
-                      ma_cal.common.device);
-
-            switch (cmd) {
-                case MA_CMD_VOL:
-                    ret = ma_set_volume_table_l(&ma_cal, STREAM_MAX_TYPES,
-                                                ma_cur_state_table);
-                    if (ret)
-                        ALOGV("ma_set_volume_table_l success");
-                    else
-                        ALOGE("ma_set_volume_table_l returned with error.");
-                    print_state_log();
-                    break;
-
-                case MA_CMD_SWAP_ENABLE:
-                    /* lr swap only enable for speaker path */
-                    if (ma_cal.common.device & AUDIO_DEVICE_OUT_SPEAKER) {
-                        ret = ma_set_lr_swap_l(&ma_cal, true);
-                        if (ret)
-                            ALOGV("ma_set_lr_swap_l enable returned with success.");
-                        else
-                            ALOGE("ma_set_lr_swap_l enable returned with error.");
-                    }
-                    break;
-
-                case MA_CMD_SWAP_DISABLE:
-                    ret = ma_set_lr_swap_l(&ma_cal, false);
-                    if (ret)
-                        ALOGV("ma_set_lr_swap_l disable returned with success.");
-                    else
-                        ALOGE("ma_set_lr_swap_l disable returned with error.");
-                    break;
-
-                case MA_CMD_ROTATE_ENABLE:
-                    if (ma_cal.common.device & AUDIO_DEVICE_OUT_SPEAKER) {
-                        ret = ma_set_orientation_l(&ma_cal, my_data->dispaly_orientation);
-                        if (ret)
-                            ALOGV("ma_set_orientation_l %d returned with success.",
-                                  my_data->dispaly_orientation);
-                        else
-                            ALOGE("ma_set_orientation_l %d returned with error.",
-                                  my_data->dispaly_orientation);
-                    }
-                    break;
-
-                case MA_CMD_ROTATE_DISABLE:
-                    ret = ma_set_orientation_l(&ma_cal, 0);
-                    if (ret)
-                        ALOGV("ma_set_orientation_l 0 returned with success.");
-                    else
-                        ALOGE("ma_set_orientation_l 0 returned with error.");
-                    break;
-
-                default:
-                    ALOGE("%s: unsupported cmd %d", __func__, cmd);
+    if (dirty & MA_CAL_LR_SWAP) {
+        const bool swap = speaker && my_data->speaker_lr_swap;
+        const bool send = !(applied->valid_items & MA_CAL_LR_SWAP) ||
+                          applied->lr_swap != swap;
+        ok = true;
+        if (send) {
+            ok = ma_set_lr_swap_l(&ma_cal, swap);
+            if (ok) {
+                ALOGV("ma_set_lr_swap_l %d returned with success.", swap);
+                applied->lr_swap = swap;
+                applied->valid_items |= MA_CAL_LR_SWAP;
+            } else {
+                ALOGE("ma_set_lr_swap_l %d returned with error.", swap);
+                applied->valid_items &= ~MA_CAL_LR_SWAP;
             }
         }
+        ma_cal_item_done_l(MA_CAL_LR_SWAP, send, ok);
+        ret &= ok;
+    }
+
+    if (dirty & MA_CAL_VOLUME_TABLE) {
+        const bool send = !(applied->valid_items & MA_CAL_VOLUME_TABLE) ||
+                          memcmp(applied->volume_table, ma_cur_state_table,
+                                 sizeof(ma_cur_state_table)) != 0;
+        ok = true;
+        if (send) {
+            ok = ma_set_volume_table_l(&ma_cal, STREAM_MAX_TYPES, ma_cur_state_table);
+            if (ok) {
+                ALOGV("ma_set_volume_table_l success");
+                memcpy(applied->volume_table, ma_cur_state_table,
+                       sizeof(ma_cur_state_table));
+                applied->valid_items |= MA_CAL_VOLUME_TABLE;
+            } else {
+                ALOGE("ma_set_volume_table_l returned with error.");
+                applied->valid_items &= ~MA_CAL_VOLUME_TABLE;
+            }
+            print_state_log();
+        }
+        ma_cal_item_done_l(MA_CAL_VOLUME_TABLE, send, ok);
+        ret &= ok;
+    }
+
+    return ret;
+}
+
+// already hold lock
+static bool check_and_send_all_audio_cal(struct audio_device *adev, unsigned int dirty)
+{
+    bool ret = false;
+    struct listnode *node;
+    struct audio_usecase *usecase;
+
+    list_for_each(node, &adev->usecase_list) {
+        usecase = node_to_item(node, struct audio_usecase, list);
+        if (valid_usecase(usecase))
+            ret = send_usecase_audio_cal_l(usecase, dirty);
     }
 
     return ret;
@@ -389,22 +485,6 @@ static bool find_sup_dev(char *name)
     return ret;
 }
 
-static void ma_set_swap_l(struct audio_device *adev, bool enable)
-{
-    if (enable)
-        check_and_send_all_audio_cal(adev, MA_CMD_SWAP_ENABLE);
-    else
-        check_and_send_all_audio_cal(adev, MA_CMD_SWAP_DISABLE);
-}
-
-static void ma_set_rotation_l(struct audio_device *adev, int orientation)
-{
-    if (orientation != 0)
-        check_and_send_all_audio_cal(adev, MA_CMD_ROTATE_ENABLE);
-    else
-        check_and_send_all_audio_cal(adev, MA_CMD_ROTATE_DISABLE);
-}
-
 static void ma_support_usb(bool enable, int card)
 {
     char path[128];
@@ -602,7 +682,8 @@ void audio_extn_ma_init(void *platform)
         goto error;
     }
 
-    /* init volume table */
+    /* init volume table, nothing is applied yet */
+    memset(my_data->applied, 0, sizeof(my_data->applied));
     for (i = 0; i < STREAM_MAX_TYPES; i++) {
         ma_cur_state_table[i].vol = 0.0;
         ma_cur_state_table[i].active = false;
@@ -673,7 +754,7 @@ bool audio_extn_ma_set_state(struct audio_device *adev, int stream_type,
         ma_cur_state_table[(ma_stream_type_t)stream_type].vol = vol;
         ma_cur_state_table[(ma_stream_type_t)stream_type].active = active;
 
-        ret = check_and_send_all_audio_cal(adev, MA_CMD_VOL);
+        ret = check_and_send_all_audio_cal(adev, MA_CAL_VOLUME_TABLE);
 
         pthread_mutex_unlock(&my_data->lock);
     }
@@ -683,10 +764,7 @@ bool audio_extn_ma_set_state(struct audio_device *adev, int stream_type,
 
 void audio_extn_ma_set_device(struct audio_usecase *usecase)
 {
-    int i = 0;
-    int u_index = -1;
-    float vol = 0;
-    struct ma_audio_cal_settings ma_cal;
+    struct ma_applied_cal *applied;
 
     if (!my_data) {
         ALOGV("%s: maxxaudio isn't initialized.", __func__);
@@ -698,40 +776,19 @@ void audio_extn_ma_set_device(struct audio_usecase *usecase)
         return;
     }
 
-    ma_cal_init(&ma_cal);
-
-    /* update audio_cal and send it */
-    ma_cal.common.app_type = usecase->stream.out->app_type_cfg.app_type;
-    ma_cal.common.device = usecase->stream.out->devices;
-    ALOGV("%s: send usecase(%d) app_type(%d) device(%d)",
-              __func__, usecase->id, ma_cal.common.app_type,
-              ma_cal.common.device);
-
     pthread_mutex_lock(&my_data->lock);
 
     if (is_active()) {
-
-        if (ma_cal.common.device & AUDIO_DEVICE_OUT_SPEAKER) {
-            if (my_data->orientation_used)
-                ma_set_rotation_l(usecase->stream.out->dev,
-                                  my_data->dispaly_orientation);
-            else
-                ma_set_swap_l(usecase->stream.out->dev, my_data->speaker_lr_swap);
-        } else {
-            if (my_data->orientation_used)
-                ma_set_rotation_l(usecase->stream.out->dev, 0);
-            else
-                ma_set_swap_l(usecase->stream.out->dev, false);
-        }
-
-        if (!ma_set_volume_table_l(&ma_cal,
-                                   STREAM_MAX_TYPES,
-                                   ma_cur_state_table))
-            ALOGE("ma_set_volume_table_l returned with error.");
-        else
-            ALOGV("ma_set_volume_table_l success");
-        print_state_log();
-
+        /* the route of this usecase is being enabled: the DSP does not hold its calibration
+         * anymore, so everything is sent again for it */
+        applied = get_applied_cal_l(usecase->stream.out->app_type_cfg.app_type,
+                                    usecase->stream.out->devices);
+        applied->valid_items = 0;
+
+        send_usecase_audio_cal_l(usecase,
+                                 MA_CAL_VOLUME_TABLE |
+                                 (my_data->orientation_used ? MA_CAL_ORIENTATION :
+                                                              MA_CAL_LR_SWAP));
     }
     pthread_mutex_unlock(&my_data->lock);
 }
@@ -764,10 +821,10 @@ void audio_extn_ma_set_parameters(struct audio_device *adev,
         }
         my_data->dispaly_orientation = val;
 
-        if (my_data->orientation_used)
-            ma_set_rotation_l(adev, my_data->dispaly_orientation);
-        else
-            ma_set_swap_l(adev, my_data->speaker_lr_swap);
+        pthread_mutex_lock(&my_data->lock);
+        check_and_send_all_audio_cal(adev, my_data->orientation_used ? MA_CAL_ORIENTATION :
+                                                                       MA_CAL_LR_SWAP);
+        pthread_mutex_unlock(&my_data->lock);
     }
 
     // check connect status
@@ -804,3 +861,27 @@ bool audio_extn_ma_supported_usb()
     ALOGV("%s: current support 0x%x", __func__, g_supported_dev);
     return (g_supported_dev & SUPPORTED_USB) ? true : false;
 }
+
+void audio_extn_ma_dump(int fd)
+{
+    int i;
+
+    if (!my_data)
+        return;
+
+    pthread_mutex_lock(&my_data->lock);
+    dprintf(fd, "  MaxxAudio calibration:\n");
+    for (i = 0; i < 3; i++)
+        dprintf(fd, "    %s: %u sent, %u skipped (already applied)\n",
+                ma_cal_item_name(i), my_data->stats.sent[i], my_data->stats.skipped[i]);
+    dprintf(fd, "    errors: %u\n", my_data->stats.errors);
+    for (i = 0; i < MA_APPLIED_CAL_ENTRIES; i++) {
+        struct ma_applied_cal *applied = &my_data->applied[i];
+        if (!applied->valid)
+            continue;
+        dprintf(fd, "    app_type %u device 0x%x: applied 0x%x lr_swap %d orientation %d\n",
+                applied->app_type, applied->device, applied->valid_items,
+                applied->lr_swap, applied->orientation);
+    }
+    pthread_mutex_unlock(&my_data->lock);
+}
@@ -24,6 +24,7 @@
 #define audio_extn_ma_set_device(usecase)                           (0)
 #define audio_extn_ma_set_parameters(adev, param)                   (0)
 #define audio_extn_ma_supported_usb()                               (false)
+#define audio_extn_ma_dump(fd)                                      (0)
 #else
 void audio_extn_ma_init(void *platform);
 void audio_extn_ma_deinit();
@@ -33,6 +34,7 @@ void audio_extn_ma_set_device(struct audio_usecase *usecase);
 void audio_extn_ma_set_parameters(struct audio_device *adev,
                                   struct str_parms *parms);
 bool audio_extn_ma_supported_usb();
+void audio_extn_ma_dump(int fd);
 #endif /* MAXXAUDIO_QDSP_ENABLED */
 
 #endif /* MAXXAUDIO_H_ */
@@ -24,9 +24,14 @@
    Each stream in audio_hal registers for a callback in
    adev_open_*_stream.
 
-   A thread is spawned to poll() on sound card state files in /proc.
-   On observing a sound card state change, this thread invokes the
-   callbacks registered.
+   A thread is spawned to poll() on sound card state files in /proc
+   and on a netlink kobject uevent socket. A uevent from the sound
+   subsystem triggers a re-read of all card state files, which covers
+   transitions whose proc notification is delayed or missed.
+   On observing a sound card state change, this thread queues the
+   event to the dispatch thread of that card which invokes the callbacks
+   registered, so a slow listener cannot delay detection of further
+   changes, nor the delivery of events for other cards.
 
    Callbacks are deregistered in adev_close_*_stream and adev_close
 */
@@ -36,9 +41,11 @@
 #include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/poll.h>
+#include <sys/socket.h>
 #include <pthread.h>
 #include <cutils/list.h>
 #include <cutils/hashmap.h>
+#include <cutils/uevent.h>
 #include <log/log.h>
 #include <cutils/str_parms.h>
 #include <ctype.h>
@@ -61,16 +68,30 @@
 
 #define AUDIO_PARAMETER_KEY_EXT_AUDIO_DEVICE "ext_audio_device"
 
+#define UEVENT_SOCKET_RCVBUF_SIZE (64 * 1024)
+#define UEVENT_MSG_LEN 2048
+#define UEVENT_SUBSYSTEM_SOUND "SUBSYSTEM=sound"
+
 typedef enum {
     audio_event_on,
     audio_event_off
 } audio_event_status;
 
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct listnode queue; // pending snd_mon_event_t
+    bool exit;
+    bool started;
+} dispatcher_t;
+
 typedef struct {
     int card;
     int fd;
     struct listnode node; // membership in sndcards list
     card_status_t status;
+    dispatcher_t dispatch; // events of this card only
 } sndcard_t;
 
 typedef struct {
@@ -80,6 +101,11 @@ typedef struct {
     struct listnode node; // membership in deviceevents list;
 } dev_event_t;
 
+typedef struct {
+    char * msg;
+    struct listnode node; // membership in dispatch queue
+} snd_mon_event_t;
+
 typedef void (* notifyfn)(const void * target, const char * msg);
 
 typedef struct {
@@ -91,7 +117,13 @@ typedef struct {
     unsigned int num_dev_events;
     pthread_t monitor_thread;
     int intpipe[2];
+    int uevent_fd;
+    dispatcher_t dev_dispatch; // device events
     Hashmap * listeners; // from stream * -> callback func
+    // read while callbacks run, so dispatchers of different cards run
+    // them concurrently; written by (de)registration, which thus waits
+    // for callbacks in flight
+    pthread_rwlock_t listeners_lock;
     bool initcheck;
 } sndmonitor_state_t;
 
@@ -353,7 +385,153 @@ static void free_dev_events()
     }
 }
 
-static int notify(const struct str_parms * params)
+static int uevent_init()
+{
+    int fd = uevent_open_socket(UEVENT_SOCKET_RCVBUF_SIZE, true);
+
+    if (fd < 0) {
+        // proc state nodes remain the primary source, not fatal
+        ALOGW("uevent socket open failed: %s", strerror(errno));
+        return -1;
+    }
+
+    if (fcntl(fd, F_SETFL, O_NONBLOCK) < 0) {
+        ALOGW("uevent socket set nonblock failed: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    sndmonitor.uevent_fd = fd;
+    return 0;
+}
+
+static void uevent_deinit()
+{
+    if (sndmonitor.uevent_fd >= 0) {
+        close(sndmonitor.uevent_fd);
+        sndmonitor.uevent_fd = -1;
+    }
+}
+
+static bool is_sound_uevent(const char * msg, ssize_t len)
+{
+    const char * end = msg + len;
+
+    // uevent payload is a series of NUL terminated KEY=value strings
+    while (msg < end) {
+        if (!strcmp(msg, UEVENT_SUBSYSTEM_SOUND))
+            return true;
+        msg += strlen(msg) + 1;
+    }
+    return false;
+}
+
+static int dispatch_enqueue(dispatcher_t * d, char * msg)
+{
+    snd_mon_event_t * e = (snd_mon_event_t *)calloc(sizeof(snd_mon_event_t), 1);
+
+    if (!e)
+        return -1;
+
+    e->msg = msg;
+    pthread_mutex_lock(&d->lock);
+    list_add_tail(&d->queue, &e->node);
+    pthread_cond_signal(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    return 0;
+}
+
+static void * dispatch_thread_loop(void * args)
+{
+    dispatcher_t * d = (dispatcher_t *)args;
+
+    ALOGV("Start dispatch threadLoop()");
+    pthread_mutex_lock(&d->lock);
+    while (1) {
+        while (!d->exit && list_empty(&d->queue))
+            pthread_cond_wait(&d->cond, &d->lock);
+
+        // pending events are delivered before exiting
+        if (list_empty(&d->queue))
+            break;
+
+        struct listnode * n = list_head(&d->queue);
+        snd_mon_event_t * e = node_to_item(n, snd_mon_event_t, node);
+        list_remove(n);
+        pthread_mutex_unlock(&d->lock);
+
+        if (sndmonitor.notify)
+            sndmonitor.notify(sndmonitor.target, e->msg);
+
+        free(e->msg);
+        free(e);
+        pthread_mutex_lock(&d->lock);
+    }
+    pthread_mutex_unlock(&d->lock);
+    return NULL;
+}
+
+static int dispatcher_start(dispatcher_t * d)
+{
+    list_init(&d->queue);
+    d->exit = false;
+    pthread_mutex_init(&d->lock, (const pthread_mutexattr_t *) NULL);
+    pthread_cond_init(&d->cond, (const pthread_condattr_t *) NULL);
+
+    if (pthread_create(&d->thread, (const pthread_attr_t *) NULL,
+                       dispatch_thread_loop, d)) {
+        pthread_cond_destroy(&d->cond);
+        pthread_mutex_destroy(&d->lock);
+        return -1;
+    }
+    d->started = true;
+    return 0;
+}
+
+static void dispatcher_stop(dispatcher_t * d)
+{
+    if (!d->started)
+        return;
+
+    pthread_mutex_lock(&d->lock);
+    d->exit = true;
+    pthread_cond_signal(&d->cond);
+    pthread_mutex_unlock(&d->lock);
+    pthread_join(d->thread, (void **) NULL);
+    pthread_cond_destroy(&d->cond);
+    pthread_mutex_destroy(&d->lock);
+    d->started = false;
+}
+
+static void dispatch_deinit()
+{
+    struct listnode *node;
+
+    list_for_each(node, &sndmonitor.cards) {
+        sndcard_t * s = node_to_item(node, sndcard_t, node);
+        dispatcher_stop(&s->dispatch);
+    }
+    dispatcher_stop(&sndmonitor.dev_dispatch);
+}
+
+static int dispatch_init()
+{
+    struct listnode *node;
+
+    if (dispatcher_start(&sndmonitor.dev_dispatch) < 0)
+        return -1;
+
+    list_for_each(node, &sndmonitor.cards) {
+        sndcard_t * s = node_to_item(node, sndcard_t, node);
+        if (dispatcher_start(&s->dispatch) < 0) {
+            dispatch_deinit();
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int notify(dispatcher_t * d, const struct str_parms * params)
 {
     if (!params)
         return -1;
@@ -363,11 +541,13 @@ static int notify(const struct str_parms * params)
     if (!str)
         return -1;
 
-    if (sndmonitor.notify)
-        sndmonitor.notify(sndmonitor.target, str);
-
     ALOGV("%s", str);
-    free(str);
+
+    // ownership of str is passed to the dispatch queue on success
+    if (dispatch_enqueue(d, str) < 0) {
+        free(str);
+        return -1;
+    }
     return 0;
 }
 
@@ -396,7 +576,7 @@ int on_dev_event(dev_event_t * dev_event)
     if (str_parms_add_str(params, AUDIO_PARAMETER_KEY_EXT_AUDIO_DEVICE, val) < 0)
         return -1;
 
-    int ret = notify(params);
+    int ret = notify(&sndmonitor.dev_dispatch, params);
     str_parms_destroy(params);
     return ret;
 }
@@ -449,16 +629,41 @@ bool on_sndcard_state_update(sndcard_t * s)
                           val) < 0)
         return -1;
 
-    int ret = notify(params);
+    int ret = notify(&s->dispatch, params);
     str_parms_destroy(params);
     return ret;
 }
 
+static void on_uevent(int fd)
+{
+    char msg[UEVENT_MSG_LEN + 2];
+    ssize_t n;
+    bool rescan = false;
+
+    // drain the socket, a burst of uevents needs a single rescan
+    while ((n = uevent_kernel_multicast_recv(fd, msg, UEVENT_MSG_LEN)) > 0) {
+        msg[n] = '\0';
+        msg[n+1] = '\0';
+        if (is_sound_uevent(msg, n))
+            rescan = true;
+    }
+
+    if (!rescan)
+        return;
+
+    struct listnode *node;
+    list_for_each(node, &sndmonitor.cards) {
+        sndcard_t * s = node_to_item(node, sndcard_t, node);
+        on_sndcard_state_update(s);
+    }
+}
+
 void * monitor_thread_loop(void * args __unused)
 {
     ALOGV("Start threadLoop()");
     unsigned int num_poll_fds = sndmonitor.num_cards +
-                                sndmonitor.num_dev_events + 1/*pipe*/;
+                                sndmonitor.num_dev_events + 1/*pipe*/ +
+                                1/*uevent*/;
     struct pollfd * pfd = (struct pollfd *)calloc(sizeof(struct pollfd),
                                                   num_poll_fds);
     if (!pfd)
@@ -467,7 +672,11 @@ void * monitor_thread_loop(void * args __unused)
     pfd[0].fd = sndmonitor.intpipe[0];
     pfd[0].events = POLLPRI|POLLIN;
 
-    int i=1;
+    // a negative fd is ignored by poll() if the socket is unavailable
+    pfd[1].fd = sndmonitor.uevent_fd;
+    pfd[1].events = POLLIN;
+
+    int i=2;
     struct listnode *node;
     list_for_each(node, &sndmonitor.cards) {
         sndcard_t * s = node_to_item(node, sndcard_t, node);
@@ -520,7 +729,15 @@ void * monitor_thread_loop(void * args __unused)
             pfd[0].fd *= -1;
         }
 
-        i=1;
+        if (READY_TO_READ(&pfd[1])) {
+            on_uevent(pfd[1].fd);
+        } else if (ERROR_IN_FD(&pfd[1])) {
+            // uevents are an auxiliary source, keep polling proc nodes
+            ALOGE("error in uevent poll fd 0x%x, disabling", pfd[1].revents);
+            pfd[1].fd = -1;
+        }
+
+        i=2;
         list_for_each(node, &sndmonitor.cards) {
             sndcard_t * s = node_to_item(node, sndcard_t, node);
             if (READY_TO_READ(&pfd[i]))
@@ -554,13 +771,14 @@ void * monitor_thread_loop(void * args __unused)
         }
     }
 
+    free(pfd);
     return NULL;
 }
 
 // ---- listener static APIs ---- //
 static int hashfn(void * key)
 {
-    return (int)key;
+    return (int)(intptr_t)key;
 }
 
 static bool hasheq(void * key1, void *key2)
@@ -585,9 +803,9 @@ static void snd_mon_update(const void * target __unused, const char * msg)
     if (!parms)
         return;
 
-    hashmapLock(sndmonitor.listeners);
+    pthread_rwlock_rdlock(&sndmonitor.listeners_lock);
     hashmapForEach(sndmonitor.listeners, snd_cb, parms);
-    hashmapUnlock(sndmonitor.listeners);
+    pthread_rwlock_unlock(&sndmonitor.listeners_lock);
 
     str_parms_destroy(parms);
 }
@@ -597,6 +815,7 @@ static int listeners_init()
     sndmonitor.listeners = hashmapCreate(5, hashfn, hasheq);
     if (!sndmonitor.listeners)
         return -1;
+    pthread_rwlock_init(&sndmonitor.listeners_lock, (const pthread_rwlockattr_t *) NULL);
     return 0;
 }
 
@@ -609,18 +828,18 @@ static int listeners_deinit()
 static int add_listener(void *stream, snd_mon_cb cb)
 {
     Hashmap * map = sndmonitor.listeners;
-    hashmapLock(map);
+    pthread_rwlock_wrlock(&sndmonitor.listeners_lock);
     hashmapPut(map, stream, cb);
-    hashmapUnlock(map);
+    pthread_rwlock_unlock(&sndmonitor.listeners_lock);
     return 0;
 }
 
 static int del_listener(void * stream)
 {
     Hashmap * map = sndmonitor.listeners;
-    hashmapLock(map);
+    pthread_rwlock_wrlock(&sndmonitor.listeners_lock);
     hashmapRemove(map, stream);
-    hashmapUnlock(map);
+    pthread_rwlock_unlock(&sndmonitor.listeners_lock);
     return 0;
 }
 
@@ -633,6 +852,8 @@ int audio_extn_snd_mon_deinit()
 
     write(sndmonitor.intpipe[1], "Q", 1);
     pthread_join(sndmonitor.monitor_thread, (void **) NULL);
+    dispatch_deinit();
+    uevent_deinit();
     free_dev_events();
     listeners_deinit();
     free_sndcards();
@@ -649,6 +870,7 @@ int audio_extn_snd_mon_init()
     sndmonitor.target = NULL; // unused for now
     list_init(&sndmonitor.cards);
     list_init(&sndmonitor.dev_events);
+    sndmonitor.uevent_fd = -1;
     sndmonitor.initcheck = false;
 
     if (pipe(sndmonitor.intpipe) < 0)
@@ -664,6 +886,11 @@ int audio_extn_snd_mon_init()
     enum_dev_events(); // failure here isn't fatal
 #endif
 
+    uevent_init(); // failure here isn't fatal
+
+    if (dispatch_init() < 0)
+        goto dispatch_error;
+
     int ret = pthread_create(&sndmonitor.monitor_thread,
                              (const pthread_attr_t *) NULL,
                              monitor_thread_loop, NULL);
@@ -675,6 +902,10 @@ int audio_extn_snd_mon_init()
     return 0;
 
 monitor_thread_create_error:
+    dispatch_deinit();
+dispatch_error:
+    uevent_deinit();
+    free_dev_events();
     listeners_deinit();
 listeners_error:
     free_sndcards();
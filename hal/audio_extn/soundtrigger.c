@@ -23,6 +23,7 @@
 #include <dlfcn.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <cutils/atomic.h>
 #include <log/log.h>
 #include "audio_hw.h"
 #include "audio_extn.h"
@@ -145,10 +146,28 @@ do {                                                                      \
  */
 const unsigned int sthal_prop_api_version = STHAL_PROP_API_CURRENT_VERSION;
 
+/*
+ * A session is resolved once when the hotword capture stream is opened and
+ * the stream keeps a reference to it, so LAB reads do not need st_dev->lock
+ * nor a list walk. If STHAL deregisters the session while a stream still
+ * refers to it, the entry is unlinked and marked stale, and freed when the
+ * last stream releases it.
+ */
 struct sound_trigger_info  {
     struct sound_trigger_session_info st_ses;
     bool lab_stopped;
     struct listnode list;
+    int refs;                    /* streams holding this session, st_dev->lock */
+    volatile int32_t stale;      /* deregistered by STHAL */
+
+    /* LAB handoff statistics, updated by the reader under the stream lock */
+    int64_t attach_ns;           /* stream resolved the session (detection) */
+    int64_t last_read_ns;
+    int64_t first_read_latency_ns;
+    uint64_t reads;
+    uint64_t bytes;
+    uint32_t errors;
+    uint32_t late_reads;         /* client gap long enough to risk a LAB overrun */
 };
 
 struct sound_trigger_audio_device {
@@ -162,6 +181,20 @@ struct sound_trigger_audio_device {
 
 static struct sound_trigger_audio_device *st_dev;
 
+static int64_t st_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void put_sound_trigger_info_l(struct sound_trigger_info *st_ses_info)
+{
+    if (--st_ses_info->refs == 0 && android_atomic_acquire_load(&st_ses_info->stale))
+        free(st_ses_info);
+}
+
 static struct sound_trigger_info *
 get_sound_trigger_info(int capture_handle)
 {
@@ -261,7 +294,10 @@ int audio_hw_call_back(sound_trigger_event_type_t event,
         ALOGV("%s: remove capture_handle %d pcm %p", __func__,
               st_ses_info->st_ses.capture_handle, st_ses_info->st_ses.pcm);
         list_remove(&st_ses_info->list);
-        free(st_ses_info);
+        if (st_ses_info->refs > 0)
+            android_atomic_release_store(1, &st_ses_info->stale);
+        else
+            free(st_ses_info);
         break;
     default:
         ALOGW("%s: Unknown event %d", __func__, event);
@@ -275,8 +311,14 @@ int audio_extn_sound_trigger_read(struct stream_in *in, void *buffer,
                        size_t bytes)
 {
     int ret = -1;
-    struct sound_trigger_info  *st_info = NULL;
+    struct sound_trigger_info  *st_info = in->st_ses;
     struct audio_event_info event;
+    const size_t frame_size =
+            audio_stream_in_frame_size((struct audio_stream_in *)in);
+    const int64_t bytes_per_sec = (int64_t)frame_size * in->config.rate;
+    const int64_t buffer_ns = bytes_per_sec ?
+            (int64_t)bytes * 1000000000LL / bytes_per_sec : 0;
+    int64_t start_ns = 0, now_ns;
 
     if (!st_dev)
        return ret;
@@ -288,14 +330,30 @@ int audio_extn_sound_trigger_read(struct stream_in *in, void *buffer,
     if (in->standby)
         in->standby = false;
 
-    pthread_mutex_lock(&st_dev->lock);
-    st_info = get_sound_trigger_info(in->capture_handle);
-    pthread_mutex_unlock(&st_dev->lock);
-    if (st_info) {
+    /* Session was resolved at open: hand the client buffer straight to
+       STHAL without looking it up or taking st_dev->lock */
+    if (st_info && !android_atomic_acquire_load(&st_info->stale)) {
+        start_ns = st_now_ns();
+        if (st_info->last_read_ns && buffer_ns &&
+            start_ns - st_info->last_read_ns > 2 * buffer_ns)
+            st_info->late_reads++;
+
         event.u.aud_info.ses_info = &st_info->st_ses;
         event.u.aud_info.buf = buffer;
         event.u.aud_info.num_bytes = bytes;
         ret = st_dev->st_callback(AUDIO_EVENT_READ_SAMPLES, &event);
+
+        now_ns = st_now_ns();
+        st_info->last_read_ns = now_ns;
+        if (ret) {
+            st_info->errors++;
+        } else {
+            if (st_info->reads++ == 0)
+                st_info->first_read_latency_ns = now_ns - st_info->attach_ns;
+            st_info->bytes += bytes;
+        }
+    } else if (st_info) {
+        ret = -ENETRESET;
     }
 
 exit:
@@ -303,9 +361,11 @@ exit:
         if (-ENETRESET == ret)
             in->is_st_session_active = false;
         memset(buffer, 0, bytes);
+        /* Pace the client at real time, minus what the failed read already took */
+        now_ns = start_ns ? st_now_ns() - start_ns : 0;
         ALOGV("%s: read failed status %d - sleep", __func__, ret);
-        usleep((bytes * 1000000) / (audio_stream_in_frame_size((struct audio_stream_in *)in) *
-                                   in->config.rate));
+        if (buffer_ns > now_ns)
+            usleep((buffer_ns - now_ns) / 1000);
     }
     return ret;
 }
@@ -318,10 +378,8 @@ void audio_extn_sound_trigger_stop_lab(struct stream_in *in)
     if (!st_dev || !in || !in->is_st_session_active)
        return;
 
-    pthread_mutex_lock(&st_dev->lock);
-    st_ses_info = get_sound_trigger_info(in->capture_handle);
-    pthread_mutex_unlock(&st_dev->lock);
-    if (st_ses_info) {
+    st_ses_info = in->st_ses;
+    if (st_ses_info && !android_atomic_acquire_load(&st_ses_info->stale)) {
         event.u.ses_info = st_ses_info->st_ses;
         ALOGV("%s: AUDIO_EVENT_STOP_LAB pcm %p", __func__, st_ses_info->st_ses.pcm);
         st_dev->st_callback(AUDIO_EVENT_STOP_LAB, &event);
@@ -349,6 +407,14 @@ void audio_extn_sound_trigger_check_and_get_session(struct stream_in *in)
             in->channel_mask = audio_channel_in_mask_from_count(in->config.channels);
             in->is_st_session = true;
             in->is_st_session_active = true;
+            if (in->st_ses != st_ses_info) {
+                /* drop a session left over from an earlier detection */
+                if (in->st_ses)
+                    put_sound_trigger_info_l(in->st_ses);
+                st_ses_info->refs++;
+                in->st_ses = st_ses_info;
+            }
+            st_ses_info->attach_ns = st_now_ns();
             ALOGV("%s: capture_handle %d is sound trigger", __func__, in->capture_handle);
             break;
         }
@@ -356,6 +422,37 @@ void audio_extn_sound_trigger_check_and_get_session(struct stream_in *in)
     pthread_mutex_unlock(&st_dev->lock);
 }
 
+void audio_extn_sound_trigger_release_session(struct stream_in *in)
+{
+    if (!st_dev || !in || !in->st_ses)
+       return;
+
+    pthread_mutex_lock(&st_dev->lock);
+    put_sound_trigger_info_l(in->st_ses);
+    in->st_ses = NULL;
+    pthread_mutex_unlock(&st_dev->lock);
+}
+
+void audio_extn_sound_trigger_dump(struct stream_in *in, int fd)
+{
+    struct sound_trigger_info *st_info;
+
+    if (!st_dev || !in || !in->st_ses)
+       return;
+
+    st_info = in->st_ses;
+    dprintf(fd, "      Sound trigger LAB: %s\n",
+            android_atomic_acquire_load(&st_info->stale) ? "deregistered" :
+            in->is_st_session_active ? "active" : "stopped");
+    dprintf(fd, "        Reads: %llu (%llu bytes), errors: %u, late reads: %u\n",
+            (unsigned long long)st_info->reads,
+            (unsigned long long)st_info->bytes,
+            st_info->errors, st_info->late_reads);
+    if (st_info->reads > 0)
+        dprintf(fd, "        First read latency ms: %.3f\n",
+                st_info->first_read_latency_ns * 1e-6);
+}
+
 void audio_extn_sound_trigger_update_device_status(snd_device_t snd_device,
                                      st_event_type_t event)
 {
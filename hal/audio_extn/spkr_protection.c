@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <dlfcn.h>
 #include <math.h>
+#include <cutils/atomic.h>
 #include <cutils/properties.h>
 #include "audio_extn.h"
 #include <linux/msm_audio_calibration.h>
@@ -76,6 +77,15 @@
 #define SPKR_PROCESSING_IN_PROGRESS 1
 #define SPKR_PROCESSING_IN_IDLE 0
 
+/*Speaker calibration state*/
+enum spkr_calib_state {
+    SPKR_CALIB_IDLE,
+    /*Calibration usecases and PCMs are held, adev->lock is released*/
+    SPKR_CALIB_RUNNING,
+    /*Calibration resources were released by the canceller*/
+    SPKR_CALIB_CANCELLED,
+};
+
 /*Modes of Speaker Protection*/
 enum speaker_protection_mode {
     SPKR_PROTECTION_DISABLED = -1,
@@ -91,10 +101,14 @@ struct speaker_prot_session {
     pthread_t spkr_calibration_thread;
     pthread_mutex_t spkr_prot_thermalsync_mutex;
     pthread_cond_t spkr_prot_thermalsync;
-    int cancel_spkr_calib;
+    enum spkr_calib_state calib_state;
+    /* calib_state == SPKR_CALIB_RUNNING, readable without mutex_spkr_prot */
+    volatile int32_t calib_running;
     pthread_cond_t spkr_calib_cancel;
-    pthread_mutex_t spkr_calib_cancelack_mutex;
-    pthread_cond_t spkr_calibcancel_ack;
+    struct audio_usecase *calib_uc_rx;
+    struct audio_usecase *calib_uc_tx;
+    unsigned int calib_cancel_count;
+    int64_t calib_cancel_max_us;
     pthread_t speaker_prot_threadid;
     void *thermal_handle;
     void *adev_handle;
@@ -135,28 +149,114 @@ static void spkr_prot_set_spkrstatus(bool enable)
    }
 }
 
+static int64_t spkr_prot_now_us()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// must be called with mutex_spkr_prot acquired
+static void spkr_calib_set_state_l(enum spkr_calib_state state)
+{
+    handle.calib_state = state;
+    android_atomic_release_store(state == SPKR_CALIB_RUNNING, &handle.calib_running);
+}
+
+// must be called with adev->lock and mutex_spkr_prot acquired
+static void spkr_calib_release_l(struct audio_device *adev)
+{
+    if (handle.pcm_rx)
+        pcm_close(handle.pcm_rx);
+    handle.pcm_rx = NULL;
+
+    if (handle.pcm_tx)
+        pcm_close(handle.pcm_tx);
+    handle.pcm_tx = NULL;
+
+    if (handle.calib_uc_rx) {
+        list_remove(&handle.calib_uc_rx->list);
+        disable_snd_device(adev, SND_DEVICE_OUT_SPEAKER_PROTECTED);
+        disable_audio_route(adev, handle.calib_uc_rx);
+        free(handle.calib_uc_rx);
+        handle.calib_uc_rx = NULL;
+    }
+    if (handle.calib_uc_tx) {
+        list_remove(&handle.calib_uc_tx->list);
+        disable_snd_device(adev, SND_DEVICE_IN_CAPTURE_VI_FEEDBACK);
+        disable_audio_route(adev, handle.calib_uc_tx);
+        free(handle.calib_uc_tx);
+        handle.calib_uc_tx = NULL;
+    }
+}
+
+/*
+ * Sleep for up to timeout_ms on the calibration thread.
+ * Returns true if the calibration was cancelled meanwhile.
+ */
+static bool spkr_calib_wait_cancelled(int timeout_ms)
+{
+    struct timespec ts;
+    bool cancelled;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += timeout_ms / 1000;
+    ts.tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&handle.mutex_spkr_prot);
+    while (handle.calib_state == SPKR_CALIB_RUNNING) {
+        if (pthread_cond_timedwait(&handle.spkr_calib_cancel,
+                                   &handle.mutex_spkr_prot, &ts) == ETIMEDOUT)
+            break;
+    }
+    cancelled = (handle.calib_state == SPKR_CALIB_CANCELLED);
+    pthread_mutex_unlock(&handle.mutex_spkr_prot);
+    return cancelled;
+}
+
+// must be called with adev->lock acquired
 void audio_extn_spkr_prot_calib_cancel(void *adev)
 {
     pthread_t threadid;
-    struct audio_usecase *uc_info;
-    int count = 0;
     threadid = pthread_self();
     ALOGV("%s: Entry", __func__);
     if (pthread_equal(handle.speaker_prot_threadid, threadid) || !adev) {
         ALOGV("%s: Calibration not in progress.. nothihg to cancel", __func__);
         return;
     }
-    uc_info = get_usecase_from_list(adev, USECASE_AUDIO_SPKR_CALIB_RX);
-    if (uc_info) {
-            pthread_mutex_lock(&handle.mutex_spkr_prot);
-            pthread_mutex_lock(&handle.spkr_calib_cancelack_mutex);
-            handle.cancel_spkr_calib = 1;
-            pthread_cond_signal(&handle.spkr_calib_cancel);
-            pthread_mutex_unlock(&handle.mutex_spkr_prot);
-            pthread_cond_wait(&handle.spkr_calibcancel_ack,
-            &handle.spkr_calib_cancelack_mutex);
-            pthread_mutex_unlock(&handle.spkr_calib_cancelack_mutex);
+    /*
+     * Only a calibration holding the speaker needs the lock below. This
+     * is also reached through enable_snd_device() from callers that hold
+     * mutex_spkr_prot, like audio_extn_spkr_prot_start_processing().
+     * Calibration only enters RUNNING with adev->lock held, so the flag
+     * cannot be set behind our back.
+     */
+    if (!android_atomic_acquire_load(&handle.calib_running))
+        return;
+    pthread_mutex_lock(&handle.mutex_spkr_prot);
+    if (handle.calib_state == SPKR_CALIB_RUNNING) {
+        const int64_t start_us = spkr_prot_now_us();
+        /* Release the calibration path here rather than waiting for the
+           calibration thread to unwind, so the cost to the routing path is
+           bounded by two pcm_close() and the route updates. The calibration
+           thread finishes its bookkeeping on its own afterwards. */
+        spkr_calib_release_l(adev);
+        spkr_calib_set_state_l(SPKR_CALIB_CANCELLED);
+        pthread_cond_signal(&handle.spkr_calib_cancel);
+
+        const int64_t latency_us = spkr_prot_now_us() - start_us;
+        handle.calib_cancel_count++;
+        if (latency_us > handle.calib_cancel_max_us)
+            handle.calib_cancel_max_us = latency_us;
+        ALOGD("%s: calibration cancelled in %lld us (count %u, max %lld us)",
+              __func__, (long long)latency_us, handle.calib_cancel_count,
+              (long long)handle.calib_cancel_max_us);
     }
+    pthread_mutex_unlock(&handle.mutex_spkr_prot);
     ALOGV("%s: Exit", __func__);
 }
 
@@ -292,17 +392,21 @@ error:
      return -EINVAL;
 }
 
-// must be called with adev->lock acquired
+/*
+ * Must be called with adev->lock acquired. The lock is released while the
+ * DSP calibrates and acquired again before returning. A playback start in
+ * the meantime cancels the calibration through
+ * audio_extn_spkr_prot_calib_cancel() without waiting for this thread.
+ */
 static int spkr_calibrate(int t0)
 {
     struct audio_device *adev = handle.adev_handle;
     struct audio_cal_info_spk_prot_cfg protCfg;
     struct audio_cal_info_msm_spk_prot_status status;
-    bool cleanup = false, disable_rx = false, disable_tx = false;
+    bool cancelled = false, tx_cal_set = false;
     int acdb_fd = -1;
     struct audio_usecase *uc_info_rx = NULL, *uc_info_tx = NULL;
     int32_t pcm_dev_rx_id = -1, pcm_dev_tx_id = -1;
-    struct timespec ts;
     int retry_duration;
     int app_type = 0;
 
@@ -330,16 +434,18 @@ static int spkr_calibrate(int t0)
             goto exit;
         }
     }
+    handle.pcm_rx = handle.pcm_tx = NULL;
     uc_info_rx = (struct audio_usecase *)calloc(1, sizeof(struct audio_usecase));
     if (!uc_info_rx) {
-        return -ENOMEM;
+        status.status = -ENOMEM;
+        goto exit;
     }
     uc_info_rx->id = USECASE_AUDIO_SPKR_CALIB_RX;
     uc_info_rx->type = PCM_PLAYBACK;
     uc_info_rx->in_snd_device = SND_DEVICE_NONE;
     uc_info_rx->stream.out = adev->primary_output;
     uc_info_rx->out_snd_device = SND_DEVICE_OUT_SPEAKER_PROTECTED;
-    disable_rx = true;
+    handle.calib_uc_rx = uc_info_rx;
     list_add_tail(&adev->usecase_list, &uc_info_rx->list);
     enable_snd_device(adev, SND_DEVICE_OUT_SPEAKER_PROTECTED);
     enable_audio_route(adev, uc_info_rx);
@@ -352,7 +458,6 @@ static int spkr_calibrate(int t0)
         status.status = -ENODEV;
         goto exit;
     }
-    handle.pcm_rx = handle.pcm_tx = NULL;
     handle.pcm_rx = pcm_open(adev->snd_card,
                              pcm_dev_rx_id,
                              PCM_OUT, &pcm_config_skr_prot);
@@ -372,7 +477,8 @@ static int spkr_calibrate(int t0)
     uc_info_tx->in_snd_device = SND_DEVICE_IN_CAPTURE_VI_FEEDBACK;
     uc_info_tx->out_snd_device = SND_DEVICE_NONE;
 
-    disable_tx = true;
+    handle.calib_uc_tx = uc_info_tx;
+    tx_cal_set = true;
     list_add_tail(&adev->usecase_list, &uc_info_tx->list);
     enable_snd_device(adev, SND_DEVICE_IN_CAPTURE_VI_FEEDBACK);
     enable_audio_route(adev, uc_info_tx);
@@ -402,85 +508,94 @@ static int spkr_calibrate(int t0)
         status.status = -EINVAL;
         goto exit;
     }
-    cleanup = true;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    ts.tv_sec += (SLEEP_AFTER_CALIB_START/1000);
-    ts.tv_nsec = 0;
+
     pthread_mutex_lock(&handle.mutex_spkr_prot);
+    spkr_calib_set_state_l(SPKR_CALIB_RUNNING);
+    pthread_mutex_unlock(&handle.mutex_spkr_prot);
+    /* from here on a cancel may release the calibration path at any time */
     pthread_mutex_unlock(&adev->lock);
 
-    (void)pthread_cond_timedwait(&handle.spkr_calib_cancel,
-                                 &handle.mutex_spkr_prot, &ts);
-    ALOGD("%s: Speaker calibration done", __func__);
-    pthread_mutex_lock(&handle.spkr_calib_cancelack_mutex);
-    if (handle.cancel_spkr_calib) {
+    status.status = -EINVAL;
+    if (spkr_calib_wait_cancelled(SLEEP_AFTER_CALIB_START)) {
         status.status = -EAGAIN;
-        goto exit;
+        goto relock;
     }
+    ALOGD("%s: Speaker calibration done", __func__);
 
-    if (acdb_fd >= 0) {
-        status.status = -EINVAL;
-        retry_duration = 0;
-        while (!get_spkr_prot_cal(acdb_fd, &status) &&
-               retry_duration < GET_SPKR_PROT_CAL_TIMEOUT_MSEC) {
-            if (!status.status) {
-                ALOGD("%s: spkr_prot_thread calib Success R0 %d %d",
-                 __func__, status.r0[SP_V2_SPKR_1], status.r0[SP_V2_SPKR_2]);
-                FILE *fp;
-
-                vi_feed_no_channels = vi_feed_get_channels(adev);
-                ALOGD("%s: vi_feed_no_channels %d", __func__, vi_feed_no_channels);
-                if (vi_feed_no_channels < 0) {
-                    ALOGE("%s: no of channels negative !!", __func__);
-                    /* limit the number of channels to 2*/
-                    vi_feed_no_channels = 2;
-                }
+    retry_duration = 0;
+    while (!get_spkr_prot_cal(acdb_fd, &status) &&
+           retry_duration < GET_SPKR_PROT_CAL_TIMEOUT_MSEC) {
+        if (!status.status) {
+            ALOGD("%s: spkr_prot_thread calib Success R0 %d %d",
+             __func__, status.r0[SP_V2_SPKR_1], status.r0[SP_V2_SPKR_2]);
+            FILE *fp;
+
+            vi_feed_no_channels = vi_feed_get_channels(adev);
+            ALOGD("%s: vi_feed_no_channels %d", __func__, vi_feed_no_channels);
+            if (vi_feed_no_channels < 0) {
+                ALOGE("%s: no of channels negative !!", __func__);
+                /* limit the number of channels to 2*/
+                vi_feed_no_channels = 2;
+            }
 
-                fp = fopen(CALIB_FILE,"wb");
-                if (!fp) {
-                    ALOGE("%s: spkr_prot_thread File open failed %s",
-                    __func__, strerror(errno));
-                    status.status = -ENODEV;
-                } else {
-                    int i;
-                    /* HAL for speaker protection is always calibrating for stereo usecase*/
-                    for (i = 0; i < vi_feed_no_channels; i++) {
-                        fwrite(&status.r0[i], sizeof(status.r0[i]), 1, fp);
-                        fwrite(&protCfg.t0[i], sizeof(protCfg.t0[i]), 1, fp);
-                    }
-                    fclose(fp);
-                }
-                break;
-            } else if (status.status == -EAGAIN) {
-                  ALOGD("%s: spkr_prot_thread try again", __func__);
-                  usleep(WAIT_FOR_GET_CALIB_STATUS * 1000);
-                  retry_duration += WAIT_FOR_GET_CALIB_STATUS;
+            fp = fopen(CALIB_FILE,"wb");
+            if (!fp) {
+                ALOGE("%s: spkr_prot_thread File open failed %s",
+                __func__, strerror(errno));
+                status.status = -ENODEV;
             } else {
-                ALOGE("%s: spkr_prot_thread get failed status %d",
-                __func__, status.status);
-                break;
+                int i;
+                /* HAL for speaker protection is always calibrating for stereo usecase*/
+                for (i = 0; i < vi_feed_no_channels; i++) {
+                    fwrite(&status.r0[i], sizeof(status.r0[i]), 1, fp);
+                    fwrite(&protCfg.t0[i], sizeof(protCfg.t0[i]), 1, fp);
+                }
+                fclose(fp);
             }
+            break;
+        } else if (status.status == -EAGAIN) {
+            ALOGD("%s: spkr_prot_thread try again", __func__);
+            if (spkr_calib_wait_cancelled(WAIT_FOR_GET_CALIB_STATUS))
+                break;
+            retry_duration += WAIT_FOR_GET_CALIB_STATUS;
+        } else {
+            ALOGE("%s: spkr_prot_thread get failed status %d",
+            __func__, status.status);
+            break;
         }
     }
 
+relock:
+    pthread_mutex_lock(&adev->lock);
+
 exit:
-    if (handle.pcm_rx)
-        pcm_close(handle.pcm_rx);
-    handle.pcm_rx = NULL;
+    pthread_mutex_lock(&handle.mutex_spkr_prot);
+    cancelled = (handle.calib_state == SPKR_CALIB_CANCELLED);
+    /* no-op if the canceller already released the calibration path */
+    spkr_calib_release_l(adev);
+    spkr_calib_set_state_l(SPKR_CALIB_IDLE);
+    pthread_mutex_unlock(&handle.mutex_spkr_prot);
 
-    if (handle.pcm_tx)
-        pcm_close(handle.pcm_tx);
-    handle.pcm_tx = NULL;
+    if (cancelled && status.status) {
+        ALOGD("%s: calibration cancelled", __func__);
+        status.status = -EAGAIN;
+    }
 
     /* Clear TX calibration to handset mic */
     if (platform_supports_app_type_cfg()) {
         ALOGD("%s: Platform supports APP type configuration, using V2\n", __func__);
-        if (uc_info_tx != NULL) {
-            ALOGD("%s: UC Info TX is not NULL, updating and sending calibration\n", __func__);
-            uc_info_tx->in_snd_device = SND_DEVICE_IN_HANDSET_MIC;
-            uc_info_tx->out_snd_device = SND_DEVICE_NONE;
+        if (tx_cal_set) {
+            struct audio_usecase uc_info_handset_mic;
+
+            ALOGD("%s: VI feedback calibration was set, sending handset mic calibration\n",
+                  __func__);
+            memset(&uc_info_handset_mic, 0, sizeof(uc_info_handset_mic));
+            uc_info_handset_mic.id = USECASE_AUDIO_SPKR_CALIB_TX;
+            uc_info_handset_mic.type = PCM_CAPTURE;
+            uc_info_handset_mic.in_snd_device = SND_DEVICE_IN_HANDSET_MIC;
+            uc_info_handset_mic.out_snd_device = SND_DEVICE_NONE;
             platform_get_default_app_type_v2(adev->platform, PCM_CAPTURE, &app_type);
-            platform_send_audio_calibration_v2(adev->platform, uc_info_tx,
+            platform_send_audio_calibration_v2(adev->platform, &uc_info_handset_mic,
                                                app_type, 8000);
         }
     } else {
@@ -504,32 +619,6 @@ exit:
     if (acdb_fd >= 0)
         close(acdb_fd);
 
-    if (!handle.cancel_spkr_calib && cleanup) {
-        pthread_mutex_unlock(&handle.spkr_calib_cancelack_mutex);
-        pthread_cond_wait(&handle.spkr_calib_cancel, &handle.mutex_spkr_prot);
-        pthread_mutex_lock(&handle.spkr_calib_cancelack_mutex);
-    }
-    if (disable_rx) {
-        list_remove(&uc_info_rx->list);
-        disable_snd_device(adev, SND_DEVICE_OUT_SPEAKER_PROTECTED);
-        disable_audio_route(adev, uc_info_rx);
-    }
-    if (disable_tx) {
-        list_remove(&uc_info_tx->list);
-        disable_snd_device(adev, SND_DEVICE_IN_CAPTURE_VI_FEEDBACK);
-        disable_audio_route(adev, uc_info_tx);
-    }
-    if (uc_info_rx) free(uc_info_rx);
-    if (uc_info_tx) free(uc_info_tx);
-    if (cleanup) {
-        if (handle.cancel_spkr_calib)
-            pthread_cond_signal(&handle.spkr_calibcancel_ack);
-        handle.cancel_spkr_calib = 0;
-        pthread_mutex_unlock(&handle.spkr_calib_cancelack_mutex);
-        pthread_mutex_unlock(&handle.mutex_spkr_prot);
-        pthread_mutex_lock(&adev->lock);
-    }
-
     return status.status;
 }
 
@@ -721,10 +810,9 @@ void audio_extn_spkr_prot_init(void *adev)
     handle.spkr_processing_state = SPKR_PROCESSING_IN_IDLE;
     handle.spkr_prot_t0 = -1;
     pthread_cond_init(&handle.spkr_prot_thermalsync, NULL);
+    handle.calib_state = SPKR_CALIB_IDLE;
     pthread_cond_init(&handle.spkr_calib_cancel, NULL);
-    pthread_cond_init(&handle.spkr_calibcancel_ack, NULL);
     pthread_mutex_init(&handle.mutex_spkr_prot, NULL);
-    pthread_mutex_init(&handle.spkr_calib_cancelack_mutex, NULL);
     pthread_mutex_init(&handle.spkr_prot_thermalsync_mutex, NULL);
     handle.thermal_handle = dlopen(THERMAL_CLIENT_LIBRARY_PATH,
             RTLD_NOW);
@@ -919,4 +1007,16 @@ bool audio_extn_spkr_prot_is_enabled()
 {
     return handle.spkr_prot_enable;
 }
+
+void audio_extn_spkr_prot_dump(int fd)
+{
+    if (!handle.spkr_prot_enable)
+        return;
+
+    const bool locked = (pthread_mutex_trylock(&handle.mutex_spkr_prot) == 0);
+    dprintf(fd, "  Speaker protection calibration cancels: %u (max %lld us)\n",
+            handle.calib_cancel_count, (long long)handle.calib_cancel_max_us);
+    if (locked)
+        pthread_mutex_unlock(&handle.mutex_spkr_prot);
+}
 #endif /*SPKR_PROT_ENABLED*/
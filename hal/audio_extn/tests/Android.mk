@@ -0,0 +1,59 @@
+LOCAL_PATH := $(call my-dir)
+
+# Host tests of the audio_extn modules against a fake tinyalsa/platform
+# backend. The fake headers in fake/ shadow the HAL private ones.
+include $(CLEAR_VARS)
+LOCAL_MODULE := audio_extn_spkr_prot_calib_test
+LOCAL_LICENSE_KINDS := SPDX-license-identifier-Apache-2.0
+LOCAL_LICENSE_CONDITIONS := notice
+LOCAL_MODULE_HOST_OS := linux
+LOCAL_GTEST := false
+LOCAL_SRC_FILES := spkr_prot_calib_test.c fake_audio_hw.c
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/fake $(LOCAL_PATH)
+LOCAL_CFLAGS := -Wall -Werror -Wno-unused-function -Wno-unused-variable
+LOCAL_STATIC_LIBRARIES := libcutils liblog
+LOCAL_LDLIBS := -lpthread -ldl -lm
+include $(BUILD_HOST_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := audio_extn_capture_share_test
+LOCAL_LICENSE_KINDS := SPDX-license-identifier-Apache-2.0
+LOCAL_LICENSE_CONDITIONS := notice
+LOCAL_MODULE_HOST_OS := linux
+LOCAL_GTEST := false
+LOCAL_SRC_FILES := capture_share_test.c fake_audio_hw.c
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/fake $(LOCAL_PATH)
+LOCAL_CFLAGS := -Wall -Werror -Wno-unused-function -Wno-unused-variable
+LOCAL_HEADER_LIBRARIES := libsystem_headers
+LOCAL_STATIC_LIBRARIES := libcutils liblog
+LOCAL_LDLIBS := -lpthread -ldl -lm
+include $(BUILD_HOST_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := audio_extn_sndmonitor_test
+LOCAL_LICENSE_KINDS := SPDX-license-identifier-Apache-2.0
+LOCAL_LICENSE_CONDITIONS := notice
+LOCAL_MODULE_HOST_OS := linux
+LOCAL_GTEST := false
+LOCAL_SRC_FILES := sndmonitor_test.c fake_audio_hw.c
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/fake $(LOCAL_PATH)
+LOCAL_CFLAGS := -Wall -Werror -Wno-unused-function -Wno-unused-variable \
+    -Wno-format-truncation
+LOCAL_STATIC_LIBRARIES := libcutils liblog
+LOCAL_LDLIBS := -lpthread -ldl -lm
+include $(BUILD_HOST_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := audio_extn_pcm_open_batch_test
+LOCAL_LICENSE_KINDS := SPDX-license-identifier-Apache-2.0
+LOCAL_LICENSE_CONDITIONS := notice
+LOCAL_MODULE_HOST_OS := linux
+LOCAL_GTEST := false
+LOCAL_SRC_FILES := pcm_open_batch_test.c fake_audio_hw.c
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/fake $(LOCAL_PATH)
+LOCAL_CFLAGS := -Wall -Werror -Wno-unused-function -Wno-unused-variable \
+    -Wno-unused-value -Wno-unused-but-set-variable -Wno-array-parameter \
+    -Wno-incompatible-pointer-types
+LOCAL_STATIC_LIBRARIES := libcutils liblog
+LOCAL_LDLIBS := -lpthread -ldl -lm
+include $(BUILD_HOST_NATIVE_TEST)
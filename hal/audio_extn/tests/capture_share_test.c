@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Shared capture session against the fake backend: streams of different
+ * formats and channel counts read one ramp through their own rings while
+ * the others attach and detach, a stream that stops reading overruns only
+ * its own ring, and a read error reaches every reader. The audio_hw.c
+ * glue is played by start_stream() and stop_stream(): the usecase is handed
+ * over when its owner stops, a stream rerouted by in_set_parameters()
+ * restarts into its own session, and a refused stream opens its own PCM.
+ * Meant to be run under ThreadSanitizer as well.
+ */
+
+#define CAPTURE_SHARE_ENABLED
+
+#include <unistd.h>
+
+#include "fake_audio_hw.h"
+
+#include "../capture_share.c"
+
+#define TEST_RATE 48000
+#define TEST_PERIOD_US 2000
+#define TEST_READS 300
+
+struct reader {
+    struct stream_in *in;
+    int reads;
+    int gaps;
+    int error;
+};
+
+static void init_stream(struct stream_in *in, unsigned int channels, audio_format_t format,
+                        unsigned int period_size)
+{
+    memset(in, 0, sizeof(*in));
+    pthread_mutex_init(&in->lock, NULL);
+    in->config.channels = channels;
+    in->config.rate = TEST_RATE;
+    in->config.period_size = period_size;
+    in->config.period_count = 2;
+    in->config.format = format == AUDIO_FORMAT_PCM_8_24_BIT ?
+            PCM_FORMAT_S24_LE : PCM_FORMAT_S16_LE;
+    in->format = format;
+    in->source = AUDIO_SOURCE_MIC;
+    in->device = AUDIO_DEVICE_IN_BUILTIN_MIC;
+    in->usecase = USECASE_AUDIO_RECORD;
+}
+
+/* checks channel 0 of every frame continues the fake ramp */
+static void *reader_thread(void *arg)
+{
+    struct reader *r = (struct reader *)arg;
+    struct stream_in *in = r->in;
+    const unsigned int channels = in->config.channels;
+    const bool is_8_24 = in->format == AUDIO_FORMAT_PCM_8_24_BIT;
+    const size_t frames = in->config.period_size;
+    const size_t bytes = frames * audio_stream_in_frame_size(&in->stream);
+    void *buf = malloc(bytes);
+    int last = -1;
+    size_t i;
+
+    for (r->reads = 0; r->reads < TEST_READS; r->reads++) {
+        pthread_mutex_lock(&in->lock);
+        r->error = audio_extn_capture_share_read(in, buf, bytes);
+        pthread_mutex_unlock(&in->lock);
+        if (r->error != 0)
+            break;
+        for (i = 0; i < frames; i++) {
+            int v = is_8_24 ? ((int32_t *)buf)[i * channels] >> 8 :
+                              ((int16_t *)buf)[i * channels];
+            if (last >= 0 && v != ((last + 2) & 0x7fff))
+                r->gaps++;
+            last = v;
+        }
+        in->frames_read += frames;
+    }
+    free(buf);
+    return NULL;
+}
+
+static void start_owner(struct stream_in *in, int priority)
+{
+    in->pcm = pcm_open(0, in->usecase, PCM_IN | PCM_MONOTONIC, &in->config);
+    EXPECT(audio_extn_capture_share_start(in, priority) == 0);
+    EXPECT(in->pcm == NULL && in->capture_share != NULL);
+}
+
+/* start_input_stream(): join the running session or open the PCM */
+static void start_stream(struct audio_device *adev, struct audio_usecase *uc,
+                         struct stream_in *in, int priority)
+{
+    if (audio_extn_capture_share_join(adev, in, priority) == 0) {
+        EXPECT(in->pcm == NULL && in->capture_share != NULL);
+        return;
+    }
+    EXPECT(in->capture_share == NULL);
+    uc->id = in->usecase;
+    uc->type = PCM_CAPTURE;
+    uc->stream.in = in;
+    list_add_tail(&adev->usecase_list, &uc->list);
+    start_owner(in, priority);
+}
+
+/*
+ * stop_shared_input_stream(): returns the stream the usecase was handed
+ * to, or NULL. The last reader of a session stops its usecase.
+ */
+static struct stream_in *stop_stream(struct audio_device *adev, struct stream_in *in)
+{
+    struct stream_in *owner;
+    struct listnode *node;
+
+    if (audio_extn_capture_share_leave(adev, in, &owner))
+        return owner;
+    EXPECT(owner == NULL && in->capture_share == NULL);
+    list_for_each(node, &adev->usecase_list) {
+        struct audio_usecase *uc = node_to_item(node, struct audio_usecase, list);
+        if (uc->stream.in == in) {
+            list_remove(&uc->list);
+            return NULL;
+        }
+    }
+    EXPECT(!"stopped stream holds no usecase");
+    return NULL;
+}
+
+static void test_fan_out(void)
+{
+    struct stream_in a, b, c;
+    struct reader ra = { .in = &a }, rb = { .in = &b };
+    pthread_t ta, tb;
+    int64_t frames, time;
+
+    fake_reset();
+    fake.read_period_us = TEST_PERIOD_US;
+
+    init_stream(&a, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    init_stream(&b, 1, AUDIO_FORMAT_PCM_8_24_BIT, 48);
+    init_stream(&c, 4, AUDIO_FORMAT_PCM_16_BIT, 96);
+    start_owner(&a, 5);
+    pthread_create(&ta, NULL, reader_thread, &ra);
+    usleep(20 * TEST_PERIOD_US);
+
+    /* a higher priority source or more channels need their own session */
+    EXPECT(audio_extn_capture_share_attach(&a, &b, 6) == -EINVAL);
+    EXPECT(audio_extn_capture_share_attach(&a, &c, 1) == -EINVAL);
+    EXPECT(audio_extn_capture_share_attach(&a, &b, 2) == 0);
+    EXPECT(b.pcm == NULL && b.capture_share != NULL);
+    pthread_create(&tb, NULL, reader_thread, &rb);
+
+    pthread_join(ta, NULL);
+    pthread_mutex_lock(&a.lock);
+    EXPECT(audio_extn_capture_share_get_position(&a, &frames, &time) == 0);
+    EXPECT(frames >= a.frames_read);
+    pthread_mutex_unlock(&a.lock);
+
+    /* the owner leaves, the session and the PCM stay with b */
+    EXPECT(audio_extn_capture_share_detach(&a) == &b);
+    EXPECT(fake.pcm_opened == 1);
+    pthread_join(tb, NULL);
+    EXPECT(audio_extn_capture_share_detach(&b) == NULL);
+    EXPECT(fake.pcm_opened == 0);
+
+    printf("fan out: a %d reads %d gaps, b %d reads %d gaps\n",
+           ra.reads, ra.gaps, rb.reads, rb.gaps);
+    EXPECT(ra.error == 0 && rb.error == 0);
+    EXPECT(ra.gaps == 0 && rb.gaps == 0);
+}
+
+static void test_overrun(void)
+{
+    struct stream_in a, b;
+    struct reader ra = { .in = &a };
+    pthread_t ta;
+    uint32_t lost;
+
+    fake_reset();
+    fake.read_period_us = TEST_PERIOD_US;
+
+    init_stream(&a, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    init_stream(&b, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    start_owner(&a, 5);
+    EXPECT(audio_extn_capture_share_attach(&a, &b, 5) == 0);
+
+    /* b never reads */
+    pthread_create(&ta, NULL, reader_thread, &ra);
+    pthread_join(ta, NULL);
+
+    pthread_mutex_lock(&b.lock);
+    lost = audio_extn_capture_share_get_frames_lost(&b);
+    pthread_mutex_unlock(&b.lock);
+    pthread_mutex_lock(&a.lock);
+    EXPECT(audio_extn_capture_share_get_frames_lost(&a) == 0);
+    pthread_mutex_unlock(&a.lock);
+
+    printf("overrun: a %d reads %d gaps, b lost %u frames\n", ra.reads, ra.gaps, lost);
+    EXPECT(ra.error == 0 && ra.gaps == 0);
+    EXPECT(lost > 0 && lost % b.config.period_size == 0);
+
+    EXPECT(audio_extn_capture_share_detach(&b) == &a);
+    EXPECT(audio_extn_capture_share_detach(&a) == NULL);
+    EXPECT(fake.pcm_opened == 0);
+}
+
+static void test_read_error(void)
+{
+    struct stream_in a, b;
+    struct reader ra = { .in = &a }, rb = { .in = &b };
+    pthread_t ta, tb;
+
+    fake_reset();
+    fake.read_period_us = TEST_PERIOD_US;
+
+    init_stream(&a, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    init_stream(&b, 1, AUDIO_FORMAT_PCM_16_BIT, 96);
+    start_owner(&a, 5);
+    EXPECT(audio_extn_capture_share_attach(&a, &b, 5) == 0);
+    pthread_create(&ta, NULL, reader_thread, &ra);
+    pthread_create(&tb, NULL, reader_thread, &rb);
+
+    usleep(20 * TEST_PERIOD_US);
+    __atomic_store_n(&fake.read_error, EIO, __ATOMIC_SEQ_CST);
+    pthread_join(ta, NULL);
+    pthread_join(tb, NULL);
+
+    printf("read error: a %d, b %d after %d and %d reads\n",
+           ra.error, rb.error, ra.reads, rb.reads);
+    EXPECT(ra.error == -EIO && rb.error == -EIO);
+    /* a failed session takes no new streams */
+    EXPECT(audio_extn_capture_share_detach(&a) == &b);
+    EXPECT(audio_extn_capture_share_attach(&b, &a, 5) == -EINVAL);
+    EXPECT(audio_extn_capture_share_detach(&b) == NULL);
+    EXPECT(fake.pcm_opened == 0);
+}
+
+static void test_hand_over(void)
+{
+    struct audio_device adev;
+    struct audio_usecase uc;
+    struct stream_in a, b, c;
+    struct reader rc = { .in = &c };
+    pthread_t tc;
+
+    fake_reset();
+    fake.read_period_us = TEST_PERIOD_US;
+    list_init(&adev.usecase_list);
+
+    init_stream(&a, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    init_stream(&b, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    init_stream(&c, 1, AUDIO_FORMAT_PCM_16_BIT, 96);
+    start_stream(&adev, &uc, &a, 5);
+    start_stream(&adev, NULL, &b, 2);
+    start_stream(&adev, NULL, &c, 4);
+    EXPECT(fake.pcm_open_total == 1);
+    pthread_create(&tc, NULL, reader_thread, &rc);
+    usleep(20 * TEST_PERIOD_US);
+
+    /* the owner leaves, the highest remaining priority takes the route */
+    EXPECT(stop_stream(&adev, &a) == &c);
+    EXPECT(uc.stream.in == &c);
+    EXPECT(fake.pcm_opened == 1);
+
+    /* a stream not holding the usecase changes nothing */
+    EXPECT(stop_stream(&adev, &b) == NULL);
+    EXPECT(uc.stream.in == &c);
+    EXPECT(fake.pcm_opened == 1);
+
+    pthread_join(tc, NULL);
+    EXPECT(stop_stream(&adev, &c) == NULL);
+    EXPECT(list_empty(&adev.usecase_list));
+    EXPECT(fake.pcm_opened == 0);
+
+    printf("hand over: c %d reads %d gaps\n", rc.reads, rc.gaps);
+    EXPECT(rc.error == 0 && rc.gaps == 0);
+}
+
+static void test_refused_attach(void)
+{
+    struct audio_device adev;
+    struct audio_usecase uc_a, uc_d, uc_e;
+    struct stream_in a, d, e, f;
+
+    fake_reset();
+    list_init(&adev.usecase_list);
+
+    init_stream(&a, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    init_stream(&d, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    init_stream(&e, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    init_stream(&f, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    start_stream(&adev, &uc_a, &a, 5);
+
+    /* the zoom and direction of the owner's mic are not changed for others */
+    d.zoom = 0.5f;
+    EXPECT(audio_extn_capture_share_join(&adev, &d, 5) == -EINVAL);
+    EXPECT(d.pcm == NULL && d.capture_share == NULL);
+    e.direction = 1;
+    EXPECT(audio_extn_capture_share_join(&adev, &e, 5) == -EINVAL);
+    EXPECT(e.pcm == NULL && e.capture_share == NULL);
+    EXPECT(fake.pcm_open_total == 1);
+
+    /* refused streams fall back to a PCM of their own */
+    start_stream(&adev, &uc_d, &d, 5);
+    start_stream(&adev, &uc_e, &e, 5);
+    EXPECT(fake.pcm_opened == 3);
+    start_stream(&adev, NULL, &f, 5);
+    EXPECT(fake.pcm_opened == 3);
+    EXPECT(f.capture_share->session == a.capture_share->session);
+
+    EXPECT(stop_stream(&adev, &f) == NULL);
+    EXPECT(stop_stream(&adev, &e) == NULL);
+    EXPECT(stop_stream(&adev, &d) == NULL);
+    EXPECT(stop_stream(&adev, &a) == NULL);
+    EXPECT(list_empty(&adev.usecase_list));
+    EXPECT(fake.pcm_opened == 0);
+}
+
+static void test_restart(void)
+{
+    struct audio_device adev;
+    struct audio_usecase uc_a, uc_c;
+    struct stream_in a, b, c;
+    struct reader rb = { .in = &b };
+    pthread_t tb;
+
+    fake_reset();
+    fake.read_period_us = TEST_PERIOD_US;
+    list_init(&adev.usecase_list);
+
+    init_stream(&a, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    init_stream(&b, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    init_stream(&c, 2, AUDIO_FORMAT_PCM_16_BIT, 96);
+    start_stream(&adev, &uc_a, &a, 5);
+    start_stream(&adev, NULL, &b, 5);
+    start_stream(&adev, NULL, &c, 5);
+    pthread_create(&tb, NULL, reader_thread, &rb);
+    usleep(20 * TEST_PERIOD_US);
+
+    /* c is routed to another mic, in_set_parameters() restarts it */
+    pthread_mutex_lock(&c.lock);
+    c.device = AUDIO_DEVICE_IN_BUILTIN_MIC | 0x100;
+    EXPECT(stop_stream(&adev, &c) == NULL);
+    start_stream(&adev, &uc_c, &c, 5);
+    pthread_mutex_unlock(&c.lock);
+    EXPECT(fake.pcm_opened == 2);
+    EXPECT(c.capture_share->session != a.capture_share->session);
+
+    /* the owner switches to a lower priority source, b takes the usecase */
+    pthread_mutex_lock(&a.lock);
+    a.source = AUDIO_SOURCE_VOICE_RECOGNITION;
+    EXPECT(stop_stream(&adev, &a) == &b);
+    start_stream(&adev, NULL, &a, 2);
+    pthread_mutex_unlock(&a.lock);
+    EXPECT(uc_a.stream.in == &b);
+    EXPECT(a.capture_share->session == b.capture_share->session);
+    EXPECT(fake.pcm_opened == 2);
+
+    pthread_join(tb, NULL);
+    printf("restart: b %d reads %d gaps\n", rb.reads, rb.gaps);
+    EXPECT(rb.error == 0 && rb.gaps == 0);
+
+    EXPECT(stop_stream(&adev, &c) == NULL);
+    EXPECT(stop_stream(&adev, &b) == &a);
+    EXPECT(stop_stream(&adev, &a) == NULL);
+    EXPECT(list_empty(&adev.usecase_list));
+    EXPECT(fake.pcm_opened == 0);
+}
+
+int main(void)
+{
+    test_fan_out();
+    test_overrun();
+    test_read_error();
+    test_hand_over();
+    test_refused_attach();
+    test_restart();
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,12 @@
+/* Host stand-in for hal/acdb.h, see fake/audio_hw.h */
+#ifndef FAKE_ACDB_H
+#define FAKE_ACDB_H
+
+struct str_parms;
+
+struct acdb_platform_data {
+    char *snd_card_name;
+};
+
+int acdb_set_parameters(void *platform, struct str_parms *parms);
+#endif
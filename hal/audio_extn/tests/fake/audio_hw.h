@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host stand-in for hal/audio_hw.h. It declares only what the audio_extn
+ * modules under test use, so they build without the platform, voice and
+ * kernel headers. The definitions live in fake_audio_hw.c.
+ */
+
+#ifndef FAKE_AUDIO_HW_H
+#define FAKE_AUDIO_HW_H
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <cutils/list.h>
+#include <tinyalsa/asoundlib.h>
+
+#ifndef __unused
+#define __unused __attribute__((unused))
+#endif
+
+typedef uint32_t audio_devices_t;
+typedef uint32_t audio_channel_mask_t;
+typedef uint32_t audio_format_t;
+typedef uint32_t audio_input_flags_t;
+typedef uint32_t audio_output_flags_t;
+typedef int audio_mode_t;
+typedef int audio_io_handle_t;
+typedef int audio_microphone_direction_t;
+
+#define AUDIO_SOURCE_MIC                    1
+#define AUDIO_SOURCE_VOICE_RECOGNITION      6
+#define AUDIO_SOURCE_VOICE_COMMUNICATION    7
+
+#define AUDIO_INPUT_FLAG_FAST               0x1
+#define AUDIO_INPUT_FLAG_HW_HOTWORD         0x2
+#define AUDIO_INPUT_FLAG_MMAP_NOIRQ         0x10
+#define AUDIO_INPUT_FLAG_VOIP_TX            0x20
+
+#define AUDIO_OUTPUT_FLAG_VOIP_RX           0x800
+
+#define AUDIO_FORMAT_PCM_16_BIT             0x1
+#define AUDIO_FORMAT_PCM_32_BIT             0x3
+#define AUDIO_FORMAT_PCM_8_24_BIT           0x4
+#define AUDIO_FORMAT_PCM_24_BIT_PACKED      0x6
+
+#define AUDIO_DEVICE_OUT_ALL_A2DP           0x380u
+#define AUDIO_DEVICE_IN_BUILTIN_MIC         0x80000004u
+
+static inline bool audio_is_usb_out_device(audio_devices_t device __unused)
+{
+    return false;
+}
+
+static inline bool audio_is_usb_in_device(audio_devices_t device __unused)
+{
+    return false;
+}
+
+static inline bool audio_is_linear_pcm(audio_format_t format __unused)
+{
+    return true;
+}
+
+typedef enum card_status_t {
+    CARD_STATUS_OFFLINE,
+    CARD_STATUS_ONLINE
+} card_status_t;
+
+typedef enum {
+    USECASE_INVALID = -1,
+    USECASE_AUDIO_RECORD = 0,
+    USECASE_AUDIO_RECORD_LOW_LATENCY,
+    USECASE_AUDIO_RECORD_VOIP,
+    USECASE_AUDIO_SPKR_CALIB_RX,
+    USECASE_AUDIO_SPKR_CALIB_TX,
+    USECASE_AUDIO_HFP_SCO,
+    USECASE_AUDIO_HFP_SCO_WB,
+    AUDIO_USECASE_MAX
+} audio_usecase_t;
+
+typedef enum {
+    SND_DEVICE_NONE = 0,
+    SND_DEVICE_OUT_SPEAKER,
+    SND_DEVICE_OUT_SPEAKER_PROTECTED,
+    SND_DEVICE_OUT_VOICE_SPEAKER,
+    SND_DEVICE_OUT_VOICE_SPEAKER_PROTECTED,
+    SND_DEVICE_IN_HANDSET_MIC,
+    SND_DEVICE_IN_CAPTURE_VI_FEEDBACK,
+    SND_DEVICE_MAX
+} snd_device_t;
+
+typedef enum usecase_type_t {
+    PCM_PLAYBACK,
+    PCM_CAPTURE,
+    VOICE_CALL,
+    PCM_HFP_CALL,
+    USECASE_TYPE_MAX
+} usecase_type_t;
+
+struct audio_stream_in {
+    int unused;
+};
+
+struct stream_app_type_cfg {
+    int sample_rate;
+    uint32_t bit_width;
+    const char *mode;
+    int app_type;
+    int gain[2];
+};
+
+struct stream_out {
+    audio_devices_t devices;
+    audio_output_flags_t flags;
+    audio_format_t format;
+    uint32_t sample_rate;
+    struct stream_app_type_cfg app_type_cfg;
+};
+
+struct share_client;
+
+struct stream_in {
+    struct audio_stream_in stream;
+    pthread_mutex_t lock;
+    struct pcm_config config;
+    struct pcm *pcm;
+    int standby;
+    int source;
+    int pcm_device_id;
+    audio_devices_t device;
+    audio_channel_mask_t channel_mask;
+    audio_usecase_t usecase;
+    bool enable_aec;
+    bool enable_ns;
+    int64_t frames_read;
+    audio_input_flags_t flags;
+    bool realtime;
+    audio_format_t format;
+    uint32_t sample_rate;
+    struct stream_app_type_cfg app_type_cfg;
+    float zoom;
+    audio_microphone_direction_t direction;
+    struct share_client *capture_share;
+};
+
+union stream_ptr {
+    struct stream_in *in;
+    struct stream_out *out;
+};
+
+struct audio_usecase {
+    struct listnode list;
+    audio_usecase_t id;
+    usecase_type_t type;
+    audio_devices_t devices;
+    snd_device_t out_snd_device;
+    snd_device_t in_snd_device;
+    union stream_ptr stream;
+};
+
+struct audio_device {
+    pthread_mutex_t lock;
+    struct mixer *mixer;
+    struct stream_out *primary_output;
+    struct listnode usecase_list;
+    struct audio_route *audio_route;
+    int snd_card;
+    void *platform;
+};
+
+/* 32 bit samples for 8_24, 16 bit otherwise */
+size_t audio_stream_in_frame_size(const struct audio_stream_in *stream);
+
+int enable_snd_device(struct audio_device *adev, snd_device_t snd_device);
+int disable_snd_device(struct audio_device *adev, snd_device_t snd_device);
+int enable_audio_route(struct audio_device *adev, struct audio_usecase *usecase);
+int disable_audio_route(struct audio_device *adev, struct audio_usecase *usecase);
+struct audio_usecase *get_usecase_from_list(const struct audio_device *adev,
+                                            audio_usecase_t uc_id);
+
+int audio_route_apply_and_update_path(struct audio_route *ar, const char *name);
+int audio_route_reset_and_update_path(struct audio_route *ar, const char *name);
+
+/* bionic has it, the host libc may not */
+size_t strlcpy(char *dst, const char *src, size_t size);
+
+#endif
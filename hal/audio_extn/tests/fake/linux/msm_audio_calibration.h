@@ -0,0 +1,76 @@
+/* Host stand-in for the speaker protection part of the msm calibration uapi */
+#ifndef FAKE_MSM_AUDIO_CALIBRATION_H
+#define FAKE_MSM_AUDIO_CALIBRATION_H
+
+#include <stdint.h>
+#include <sys/ioctl.h>
+
+#define AUDIO_SET_CALIBRATION           _IOWR('a', 203, void *)
+#define AUDIO_GET_CALIBRATION           _IOWR('a', 204, void *)
+
+#define VERSION_0_0                     0
+#define AFE_FB_SPKR_PROT_CAL_TYPE       17
+
+#define SP_V2_SPKR_1                    0
+#define SP_V2_SPKR_2                    1
+#define SP_V2_NUM_MAX_SPKR              2
+
+enum msm_spkr_prot_states {
+    MSM_SPKR_PROT_CALIBRATED,
+    MSM_SPKR_PROT_CALIBRATION_IN_PROGRESS,
+    MSM_SPKR_PROT_DISABLED,
+    MSM_SPKR_PROT_NOT_CALIBRATED,
+};
+
+struct audio_cal_header {
+    int32_t data_size;
+    int32_t version;
+    int32_t cal_type;
+    int32_t cal_type_size;
+};
+
+struct audio_cal_type_header {
+    int32_t version;
+    int32_t buffer_number;
+};
+
+struct audio_cal_data {
+    int32_t cal_size;
+    int32_t mem_handle;
+};
+
+struct audio_cal_info_spk_prot_cfg {
+    int32_t r0[SP_V2_NUM_MAX_SPKR];
+    int32_t t0[SP_V2_NUM_MAX_SPKR];
+    uint32_t quick_calib_flag;
+    uint32_t mode;
+};
+
+struct audio_cal_info_msm_spk_prot_status {
+    int32_t r0[SP_V2_NUM_MAX_SPKR];
+    int32_t status;
+};
+
+struct audio_cal_type_fb_spk_prot_cfg {
+    struct audio_cal_type_header cal_hdr;
+    struct audio_cal_data cal_data;
+    struct audio_cal_info_spk_prot_cfg cal_info;
+};
+
+struct audio_cal_fb_spk_prot_cfg {
+    struct audio_cal_header hdr;
+    struct audio_cal_type_fb_spk_prot_cfg cal_type;
+};
+
+struct audio_cal_type_fb_spk_prot_status {
+    struct audio_cal_type_header cal_hdr;
+    struct audio_cal_data cal_data;
+    struct audio_cal_info_msm_spk_prot_status cal_info;
+};
+
+struct audio_cal_fb_spk_prot_status {
+    struct audio_cal_header hdr;
+    struct audio_cal_type_fb_spk_prot_status cal_type;
+};
+
+#endif
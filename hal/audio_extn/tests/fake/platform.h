@@ -0,0 +1,11 @@
+/* Host stand-in for the platform headers, see fake/audio_hw.h */
+#ifndef FAKE_PLATFORM_H
+#define FAKE_PLATFORM_H
+#define SLIMBUS_0_RX 0
+#define DEFAULT_OUTPUT_SAMPLING_RATE 48000
+#define DEFAULT_INPUT_SAMPLING_RATE 48000
+#define HFP_ASM_RX_TX 24
+#define MIXER_PATH_MAX_LENGTH 100
+#define PLATFORM_INFO_XML_PATH "audio_platform_info.xml"
+#define PLATFORM_INFO_XML_BASE_STRING "audio_platform_info"
+#endif
@@ -0,0 +1,29 @@
+/* Host stand-in for hal/platform_api.h, see fake/audio_hw.h */
+#ifndef FAKE_PLATFORM_API_H
+#define FAKE_PLATFORM_API_H
+
+#define CODEC_BACKEND_DEFAULT_SAMPLE_RATE 48000
+
+struct str_parms;
+typedef int (*set_parameters_fn)(void *platform, struct str_parms *parms);
+
+int platform_get_pcm_device_id(audio_usecase_t usecase, int device_type);
+const char *platform_get_snd_device_name(snd_device_t snd_device);
+int platform_send_audio_calibration(void *platform, snd_device_t snd_device);
+int platform_send_audio_calibration_v2(void *platform, struct audio_usecase *usecase,
+                                       int app_type, int sample_rate);
+bool platform_supports_app_type_cfg();
+int platform_get_default_app_type_v2(void *platform, usecase_type_t type, int *app_type);
+int platform_set_snd_device_backend(snd_device_t snd_device, const char *backend,
+                                    const char *hw_interface);
+int platform_get_snd_device_acdb_id(snd_device_t snd_device);
+int platform_get_snd_device_backend_index(snd_device_t snd_device);
+void platform_check_and_update_copp_sample_rate(void *platform, snd_device_t snd_device,
+                                                unsigned int stream_sr, int *sample_rate);
+int platform_get_app_type_v2(void *platform, usecase_type_t type, const char *mode,
+                             int bw, int sr, int *app_type);
+int platform_can_split_snd_device(snd_device_t in_snd_device, int *num_devices,
+                                  snd_device_t *out_snd_devices);
+int platform_info_init(const char *filename, void *platform, bool do_full_parse,
+                       set_parameters_fn fn);
+#endif
@@ -0,0 +1,17 @@
+/* Host stand-in for libprocessgroup, threads keep their scheduling policy */
+#ifndef FAKE_PROCESSGROUP_SCHED_POLICY_H
+#define FAKE_PROCESSGROUP_SCHED_POLICY_H
+
+typedef enum {
+    SP_DEFAULT = -1,
+    SP_BACKGROUND = 0,
+    SP_FOREGROUND = 1,
+} SchedPolicy;
+
+static inline int set_sched_policy(int tid __attribute__((unused)),
+                                   SchedPolicy policy __attribute__((unused)))
+{
+    return 0;
+}
+
+#endif
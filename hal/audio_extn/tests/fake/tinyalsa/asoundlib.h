@@ -0,0 +1,60 @@
+/*
+ * Host stand-in for tinyalsa, backed by the fake PCMs and mixer in
+ * fake_audio_hw.c so tests can script reads, stalls and failures.
+ */
+#ifndef FAKE_TINYALSA_ASOUNDLIB_H
+#define FAKE_TINYALSA_ASOUNDLIB_H
+
+#include <limits.h>
+#include <stddef.h>
+#include <time.h>
+
+#define PCM_OUT         0x00000000
+#define PCM_IN          0x10000000
+#define PCM_MMAP        0x00000001
+#define PCM_NOIRQ       0x00000002
+#define PCM_MONOTONIC   0x00000008
+
+enum pcm_format {
+    PCM_FORMAT_S16_LE = 0,
+    PCM_FORMAT_S32_LE,
+    PCM_FORMAT_S8,
+    PCM_FORMAT_S24_LE,
+};
+
+struct pcm_config {
+    unsigned int channels;
+    unsigned int rate;
+    unsigned int period_size;
+    unsigned int period_count;
+    enum pcm_format format;
+    unsigned int start_threshold;
+    unsigned int stop_threshold;
+    unsigned int silence_threshold;
+    unsigned int avail_min;
+};
+
+struct pcm;
+struct mixer;
+struct mixer_ctl;
+
+struct pcm *pcm_open(unsigned int card, unsigned int device,
+                     unsigned int flags, struct pcm_config *config);
+int pcm_close(struct pcm *pcm);
+int pcm_is_ready(struct pcm *pcm);
+const char *pcm_get_error(struct pcm *pcm);
+int pcm_prepare(struct pcm *pcm);
+int pcm_start(struct pcm *pcm);
+int pcm_stop(struct pcm *pcm);
+int pcm_read(struct pcm *pcm, void *data, unsigned int count);
+unsigned int pcm_frames_to_bytes(struct pcm *pcm, unsigned int frames);
+int pcm_get_htimestamp(struct pcm *pcm, unsigned int *avail, struct timespec *tstamp);
+
+struct mixer *mixer_open(unsigned int card);
+void mixer_close(struct mixer *mixer);
+const char *mixer_get_name(struct mixer *mixer);
+struct mixer_ctl *mixer_get_ctl_by_name(struct mixer *mixer, const char *name);
+int mixer_ctl_get_value(struct mixer_ctl *ctl, unsigned int id);
+int mixer_ctl_set_array(struct mixer_ctl *ctl, const void *array, size_t count);
+
+#endif
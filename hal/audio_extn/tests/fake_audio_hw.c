@@ -0,0 +1,332 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fake_audio_hw.h"
+#include "platform_api.h"
+
+struct fake_backend fake;
+
+struct pcm {
+    unsigned int device;
+    unsigned int flags;
+    struct pcm_config config;
+    uint32_t frames;
+    volatile int stopped;
+};
+
+void fake_reset(void)
+{
+    memset(&fake, 0, sizeof(fake));
+}
+
+int64_t fake_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static unsigned int sample_bytes(const struct pcm_config *config)
+{
+    return config->format == PCM_FORMAT_S24_LE || config->format == PCM_FORMAT_S32_LE ? 4 : 2;
+}
+
+struct pcm *pcm_open(unsigned int card __unused, unsigned int device,
+                     unsigned int flags, struct pcm_config *config)
+{
+    struct pcm *pcm = calloc(1, sizeof(struct pcm));
+
+    if (fake.open_us)
+        usleep(fake.open_us);
+    pcm->device = device;
+    pcm->flags = flags;
+    pcm->config = *config;
+    __atomic_add_fetch(&fake.pcm_opened, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&fake.pcm_open_total, 1, __ATOMIC_SEQ_CST);
+    return pcm;
+}
+
+int pcm_close(struct pcm *pcm)
+{
+    if (pcm == NULL)
+        return 0;
+    if (fake.close_us)
+        usleep(fake.close_us);
+    __atomic_sub_fetch(&fake.pcm_opened, 1, __ATOMIC_SEQ_CST);
+    free(pcm);
+    return 0;
+}
+
+int pcm_is_ready(struct pcm *pcm)
+{
+    return pcm != NULL;
+}
+
+const char *pcm_get_error(struct pcm *pcm __unused)
+{
+    return "fake pcm error";
+}
+
+int pcm_prepare(struct pcm *pcm)
+{
+    if (fake.open_us)
+        usleep(fake.open_us);
+    if (pcm->device < 32 && (fake.prepare_fail_mask & (1u << pcm->device)))
+        return -EBUSY;
+    return 0;
+}
+
+int pcm_start(struct pcm *pcm __unused)
+{
+    return 0;
+}
+
+int pcm_stop(struct pcm *pcm)
+{
+    pcm->stopped = 1;
+    return 0;
+}
+
+int pcm_read(struct pcm *pcm, void *data, unsigned int count)
+{
+    const unsigned int channels = pcm->config.channels;
+    const unsigned int frames = count / (channels * sample_bytes(&pcm->config));
+    unsigned int i, c;
+
+    if (fake.read_period_us)
+        usleep(fake.read_period_us);
+    errno = __atomic_load_n(&fake.read_error, __ATOMIC_SEQ_CST);
+    if (errno)
+        return -1;
+    for (i = 0; i < frames; i++, pcm->frames++) {
+        for (c = 0; c < channels; c++) {
+            int v = (int)((pcm->frames * 2 + c) & 0x7fff);
+            if (sample_bytes(&pcm->config) == 4)
+                ((int32_t *)data)[i * channels + c] = v << 16;
+            else
+                ((int16_t *)data)[i * channels + c] = (int16_t)v;
+        }
+    }
+    return 0;
+}
+
+unsigned int pcm_frames_to_bytes(struct pcm *pcm, unsigned int frames)
+{
+    return frames * pcm->config.channels * sample_bytes(&pcm->config);
+}
+
+int pcm_get_htimestamp(struct pcm *pcm __unused, unsigned int *avail, struct timespec *tstamp)
+{
+    *avail = 0;
+    clock_gettime(CLOCK_MONOTONIC, tstamp);
+    return 0;
+}
+
+struct mixer *mixer_open(unsigned int card __unused)
+{
+    return NULL;
+}
+
+void mixer_close(struct mixer *mixer __unused)
+{
+}
+
+const char *mixer_get_name(struct mixer *mixer __unused)
+{
+    return "fake-snd-card";
+}
+
+struct mixer_ctl *mixer_get_ctl_by_name(struct mixer *mixer __unused, const char *name __unused)
+{
+    return NULL;
+}
+
+int mixer_ctl_get_value(struct mixer_ctl *ctl __unused, unsigned int id __unused)
+{
+    return -EINVAL;
+}
+
+int mixer_ctl_set_array(struct mixer_ctl *ctl __unused, const void *array __unused,
+                        size_t count __unused)
+{
+    return -EINVAL;
+}
+
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+
+    if (size) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+size_t audio_stream_in_frame_size(const struct audio_stream_in *stream)
+{
+    const struct stream_in *in = (const struct stream_in *)stream;
+
+    return in->config.channels * (in->format == AUDIO_FORMAT_PCM_8_24_BIT ? 4 : 2);
+}
+
+int enable_snd_device(struct audio_device *adev, snd_device_t snd_device)
+{
+    if (fake.enable_snd_device_hook)
+        fake.enable_snd_device_hook(adev, snd_device);
+    fake.snd_device_refs[snd_device]++;
+    return 0;
+}
+
+int disable_snd_device(struct audio_device *adev __unused, snd_device_t snd_device)
+{
+    fake.snd_device_refs[snd_device]--;
+    return 0;
+}
+
+int enable_audio_route(struct audio_device *adev __unused, struct audio_usecase *usecase __unused)
+{
+    return 0;
+}
+
+int disable_audio_route(struct audio_device *adev __unused, struct audio_usecase *usecase __unused)
+{
+    return 0;
+}
+
+struct audio_usecase *get_usecase_from_list(const struct audio_device *adev,
+                                            audio_usecase_t uc_id)
+{
+    struct listnode *node;
+
+    list_for_each(node, &adev->usecase_list) {
+        struct audio_usecase *usecase = node_to_item(node, struct audio_usecase, list);
+        if (usecase->id == uc_id)
+            return usecase;
+    }
+    return NULL;
+}
+
+int audio_route_apply_and_update_path(struct audio_route *ar __unused, const char *name __unused)
+{
+    return 0;
+}
+
+int audio_route_reset_and_update_path(struct audio_route *ar __unused, const char *name __unused)
+{
+    return 0;
+}
+
+int platform_get_pcm_device_id(audio_usecase_t usecase, int device_type __unused)
+{
+    return usecase;
+}
+
+const char *platform_get_snd_device_name(snd_device_t snd_device __unused)
+{
+    return "fake";
+}
+
+int platform_send_audio_calibration(void *platform __unused, snd_device_t snd_device __unused)
+{
+    return 0;
+}
+
+int platform_send_audio_calibration_v2(void *platform __unused,
+                                       struct audio_usecase *usecase __unused,
+                                       int app_type __unused, int sample_rate __unused)
+{
+    return 0;
+}
+
+bool platform_supports_app_type_cfg()
+{
+    return true;
+}
+
+int platform_get_default_app_type_v2(void *platform __unused, usecase_type_t type __unused,
+                                     int *app_type)
+{
+    *app_type = 0;
+    return 0;
+}
+
+int platform_set_snd_device_backend(snd_device_t snd_device __unused,
+                                    const char *backend __unused,
+                                    const char *hw_interface __unused)
+{
+    return 0;
+}
+
+int platform_get_snd_device_acdb_id(snd_device_t snd_device __unused)
+{
+    return 0;
+}
+
+int platform_get_snd_device_backend_index(snd_device_t snd_device __unused)
+{
+    return 0;
+}
+
+void platform_check_and_update_copp_sample_rate(void *platform __unused,
+                                                snd_device_t snd_device __unused,
+                                                unsigned int stream_sr, int *sample_rate)
+{
+    *sample_rate = stream_sr;
+}
+
+int platform_get_app_type_v2(void *platform __unused, usecase_type_t type __unused,
+                             const char *mode __unused, int bw __unused, int sr __unused,
+                             int *app_type)
+{
+    *app_type = 0;
+    return 0;
+}
+
+int platform_can_split_snd_device(snd_device_t in_snd_device __unused,
+                                  int *num_devices __unused,
+                                  snd_device_t *out_snd_devices __unused)
+{
+    return -EINVAL;
+}
+
+int platform_info_init(const char *filename __unused, void *platform __unused,
+                       bool do_full_parse __unused, set_parameters_fn fn __unused)
+{
+    return -ENOENT;
+}
+
+int acdb_set_parameters(void *platform __unused, struct str_parms *parms __unused)
+{
+    return 0;
+}
+
+void audio_extn_set_snd_card_split(const char *in_snd_card_name __unused)
+{
+}
+
+struct snd_card_split *audio_extn_get_snd_card_split()
+{
+    return NULL;
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FAKE_AUDIO_HW_TEST_H
+#define FAKE_AUDIO_HW_TEST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "audio_hw.h"
+
+/*
+ * Controls and counters of the fake backend. Capture PCMs produce a ramp:
+ * sample c of frame n is (2 * n + c) & 0x7fff, left justified in 32 bits
+ * for S24_LE.
+ */
+struct fake_backend {
+    int pcm_opened;             /* PCMs currently open */
+    int pcm_open_total;         /* pcm_open calls since reset */
+    unsigned int read_period_us;/* time a capture pcm_read blocks */
+    int read_error;             /* errno for capture reads, 0 for none */
+    unsigned int close_us;      /* time pcm_close blocks */
+    unsigned int open_us;       /* time pcm_open and pcm_prepare each block */
+    uint32_t prepare_fail_mask; /* devices whose pcm_prepare fails, bit n for device n */
+    int snd_device_refs[SND_DEVICE_MAX];
+    /* called by enable_snd_device() before the refcount is taken */
+    void (*enable_snd_device_hook)(struct audio_device *adev, snd_device_t snd_device);
+};
+
+extern struct fake_backend fake;
+
+void fake_reset(void);
+int64_t fake_now_us(void);
+
+#define EXPECT(cond) do {                                                     \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                          \
+        }                                                                     \
+    } while (0)
+
+#endif
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Opens batches of PCMs against a fake backend whose pcm_open and
+ * pcm_prepare each block for a while. The batch must take about as long as
+ * its slowest open rather than the sum of all of them, and a PCM that fails
+ * to prepare must leave none of the batch open.
+ */
+
+#include <unistd.h>
+
+#include "fake_audio_hw.h"
+
+#include "../utils.c"
+
+#define TEST_OPEN_US (20 * 1000)
+#define TEST_PCMS 4
+#define TEST_ROUNDS 5
+
+static struct pcm_config test_config = {
+    .channels = 2,
+    .rate = 48000,
+    .period_size = 240,
+    .period_count = 2,
+    .format = PCM_FORMAT_S16_LE,
+};
+
+static void init_reqs(struct pcm_open_req *reqs, int count)
+{
+    int i;
+
+    memset(reqs, 0, count * sizeof(*reqs));
+    for (i = 0; i < count; i++) {
+        reqs[i].device = i;
+        reqs[i].flags = i & 1 ? PCM_IN : PCM_OUT;
+        reqs[i].config = &test_config;
+        reqs[i].status = 1;
+    }
+}
+
+static void close_reqs(struct pcm_open_req *reqs, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++) {
+        pcm_close(reqs[i].pcm);
+        reqs[i].pcm = NULL;
+    }
+}
+
+static void test_batch_time(void)
+{
+    struct pcm_open_req reqs[TEST_PCMS];
+    int64_t start_us, seq_us = 0, batch_us = 0;
+    int round, i;
+
+    fake_reset();
+    fake.open_us = TEST_OPEN_US;
+
+    for (round = 0; round < TEST_ROUNDS; round++) {
+        /* the loop the callers ran before the batch */
+        init_reqs(reqs, TEST_PCMS);
+        start_us = fake_now_us();
+        for (i = 0; i < TEST_PCMS; i++)
+            pcm_open_req_run(&reqs[i]);
+        seq_us += fake_now_us() - start_us;
+        for (i = 0; i < TEST_PCMS; i++)
+            EXPECT(reqs[i].status == 0 && reqs[i].pcm != NULL);
+        close_reqs(reqs, TEST_PCMS);
+
+        init_reqs(reqs, TEST_PCMS);
+        start_us = fake_now_us();
+        EXPECT(audio_extn_utils_pcm_open_batch(reqs, TEST_PCMS) == 0);
+        batch_us += fake_now_us() - start_us;
+        EXPECT(fake.pcm_opened == TEST_PCMS);
+        for (i = 0; i < TEST_PCMS; i++) {
+            EXPECT(reqs[i].status == 0 && reqs[i].pcm != NULL);
+            EXPECT(reqs[i].open_us >= 2 * TEST_OPEN_US);
+        }
+        close_reqs(reqs, TEST_PCMS);
+        EXPECT(fake.pcm_opened == 0);
+    }
+
+    printf("%d PCMs: sequential %lld us, batched %lld us per batch\n", TEST_PCMS,
+           (long long)(seq_us / TEST_ROUNDS), (long long)(batch_us / TEST_ROUNDS));
+    EXPECT(batch_us < seq_us);
+}
+
+static void test_rollback(void)
+{
+    struct pcm_open_req reqs[TEST_PCMS];
+    int failing, i;
+
+    for (failing = 0; failing < TEST_PCMS; failing++) {
+        fake_reset();
+        fake.open_us = TEST_OPEN_US / 4;
+        fake.prepare_fail_mask = 1u << failing;
+
+        init_reqs(reqs, TEST_PCMS);
+        EXPECT(audio_extn_utils_pcm_open_batch(reqs, TEST_PCMS) == -EIO);
+        for (i = 0; i < TEST_PCMS; i++) {
+            EXPECT(reqs[i].pcm == NULL);
+            EXPECT(reqs[i].status == (i == failing ? -EIO : 0));
+        }
+        EXPECT(fake.pcm_open_total == TEST_PCMS);
+        EXPECT(fake.pcm_opened == 0);
+    }
+}
+
+static void test_single(void)
+{
+    struct pcm_open_req req;
+
+    fake_reset();
+    EXPECT(audio_extn_utils_pcm_open_batch(NULL, 1) == -EINVAL);
+    EXPECT(audio_extn_utils_pcm_open_batch(&req, 0) == -EINVAL);
+
+    /* a batch of one runs on the caller */
+    init_reqs(&req, 1);
+    EXPECT(audio_extn_utils_pcm_open_batch(&req, 1) == 0);
+    EXPECT(req.pcm != NULL && fake.pcm_opened == 1);
+    close_reqs(&req, 1);
+}
+
+int main(void)
+{
+    test_single();
+    test_batch_time();
+    test_rollback();
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Feeds synthetic kobject uevents to the sound card monitor. The /proc
+ * card nodes are files in a temporary directory and the netlink socket
+ * is one end of a datagram socket pair. A listener blocked on an event
+ * of card 0 must not hold back the events of card 1.
+ */
+
+#define SND_MONITOR_ENABLED
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fake_audio_hw.h"
+
+static char fake_root[64];
+static int uevent_sock[2];
+
+static const char *fake_path(const char *path, char *buf, size_t len)
+{
+    if (strncmp(path, "/proc/", 6) != 0)
+        return path;
+    snprintf(buf, len, "%s%s", fake_root, path);
+    return buf;
+}
+
+static int fake_open(const char *path, int flags, ...)
+{
+    char buf[256];
+
+    return open(fake_path(path, buf, sizeof(buf)), flags);
+}
+
+static FILE *fake_fopen(const char *path, const char *mode)
+{
+    char buf[256];
+
+    return fopen(fake_path(path, buf, sizeof(buf)), mode);
+}
+
+static int fake_access(const char *path, int mode)
+{
+    char buf[256];
+
+    return access(fake_path(path, buf, sizeof(buf)), mode);
+}
+
+static int fake_uevent_open_socket(int buf_sz __unused, bool passcred __unused)
+{
+    return uevent_sock[0];
+}
+
+static ssize_t fake_uevent_recv(int socket, void *buffer, size_t length)
+{
+    return recv(socket, buffer, length, 0);
+}
+
+#define open fake_open
+#define fopen fake_fopen
+#define access fake_access
+#define uevent_open_socket fake_uevent_open_socket
+#define uevent_kernel_multicast_recv fake_uevent_recv
+#include "../sndmonitor.c"
+#undef uevent_kernel_multicast_recv
+#undef uevent_open_socket
+#undef access
+#undef fopen
+#undef open
+
+#define TEST_CARDS 2
+/* far below the time card 0's listener stays blocked */
+#define MAX_DELIVERY_US (200 * 1000)
+#define BLOCK_US (1000 * 1000)
+
+static const char sound_uevent[] =
+        "change@/devices/platform/soc/sound/card0\0ACTION=change\0"
+        "DEVPATH=/devices/platform/soc/sound/card0\0SUBSYSTEM=sound\0";
+static const char net_uevent[] =
+        "change@/devices/virtual/net/wlan0\0ACTION=change\0SUBSYSTEM=net\0";
+
+static pthread_mutex_t test_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t test_cond = PTHREAD_COND_INITIALIZER;
+static int events[TEST_CARDS];
+static card_status_t last_status[TEST_CARDS];
+static int64_t event_us[TEST_CARDS];
+static bool card0_blocked;
+static bool card0_release;
+
+static void set_card_state(int card, const char *state)
+{
+    char path[128];
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "%s/proc/asound/card%d/state", fake_root, card);
+    fp = fopen(path, "w");
+    EXPECT(fp != NULL);
+    fputs(state, fp);
+    fclose(fp);
+}
+
+static void send_uevent(const char *msg, size_t len)
+{
+    EXPECT(send(uevent_sock[1], msg, len, 0) == (ssize_t)len);
+}
+
+static void setup_fake_proc(void)
+{
+    char path[128];
+    FILE *fp;
+    int card;
+
+    strcpy(fake_root, "/tmp/sndmonitor_testXXXXXX");
+    EXPECT(mkdtemp(fake_root) != NULL);
+    snprintf(path, sizeof(path), "%s/proc", fake_root);
+    mkdir(path, 0700);
+    snprintf(path, sizeof(path), "%s/proc/asound", fake_root);
+    mkdir(path, 0700);
+
+    snprintf(path, sizeof(path), "%s/proc/asound/cards", fake_root);
+    fp = fopen(path, "w");
+    EXPECT(fp != NULL);
+    for (card = 0; card < TEST_CARDS; card++) {
+        fprintf(fp, " %d [msmfakesnd%d    ]: msm-fake - msm-fake-snd-card%d\n", card, card, card);
+        fprintf(fp, "                      msm-fake-snd-card%d\n", card);
+    }
+    fclose(fp);
+
+    for (card = 0; card < TEST_CARDS; card++) {
+        snprintf(path, sizeof(path), "%s/proc/asound/card%d", fake_root, card);
+        mkdir(path, 0700);
+        set_card_state(card, "ONLINE");
+    }
+}
+
+static void cleanup_fake_proc(void)
+{
+    char cmd[128];
+
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", fake_root);
+    system(cmd);
+}
+
+static void listener(void *stream __unused, struct str_parms *parms)
+{
+    char value[32];
+    int card;
+
+    if (str_parms_get_str(parms, "SND_CARD_STATUS", value, sizeof(value)) < 0)
+        return;
+    card = atoi(value);
+    EXPECT(card >= 0 && card < TEST_CARDS);
+
+    pthread_mutex_lock(&test_lock);
+    events[card]++;
+    last_status[card] = strstr(value, "OFFLINE") ? CARD_STATUS_OFFLINE : CARD_STATUS_ONLINE;
+    event_us[card] = fake_now_us();
+    pthread_cond_broadcast(&test_cond);
+    /* a stream callback stuck on adev->lock */
+    if (card == 0 && last_status[card] == CARD_STATUS_OFFLINE) {
+        card0_blocked = true;
+        while (!card0_release)
+            pthread_cond_wait(&test_cond, &test_lock);
+        card0_blocked = false;
+    }
+    pthread_mutex_unlock(&test_lock);
+}
+
+static bool wait_events(int card, int count, int64_t timeout_us)
+{
+    const int64_t deadline = fake_now_us() + timeout_us;
+    bool reached;
+
+    pthread_mutex_lock(&test_lock);
+    while (events[card] < count && fake_now_us() < deadline) {
+        pthread_mutex_unlock(&test_lock);
+        usleep(1000);
+        pthread_mutex_lock(&test_lock);
+    }
+    reached = events[card] >= count;
+    pthread_mutex_unlock(&test_lock);
+    return reached;
+}
+
+static void test_uevent_filter(void)
+{
+    static const char sound_last[] = "remove@/devices/virtual/sound/timer\0SUBSYSTEM=sound\0";
+    static const char prefix_only[] = "add@/devices/x\0SUBSYSTEM=soundwire\0";
+
+    EXPECT(is_sound_uevent(sound_uevent, sizeof(sound_uevent)));
+    EXPECT(is_sound_uevent(sound_last, sizeof(sound_last)));
+    EXPECT(!is_sound_uevent(net_uevent, sizeof(net_uevent)));
+    EXPECT(!is_sound_uevent(prefix_only, sizeof(prefix_only)));
+}
+
+int main(void)
+{
+    static int stream;
+    int64_t start_us;
+
+    test_uevent_filter();
+
+    setup_fake_proc();
+    EXPECT(socketpair(AF_UNIX, SOCK_DGRAM, 0, uevent_sock) == 0);
+    EXPECT(audio_extn_snd_mon_init() == 0);
+    EXPECT(sndmonitor.num_cards == TEST_CARDS);
+    EXPECT(audio_extn_snd_mon_register_listener(&stream, listener) == 0);
+
+    /* card 0 goes down, its listener blocks */
+    set_card_state(0, "OFFLINE");
+    send_uevent(sound_uevent, sizeof(sound_uevent));
+    EXPECT(wait_events(0, 1, MAX_DELIVERY_US));
+    EXPECT(last_status[0] == CARD_STATUS_OFFLINE);
+
+    /* card 1 is still reported while card 0's listener is stuck */
+    start_us = fake_now_us();
+    set_card_state(1, "OFFLINE");
+    send_uevent(sound_uevent, sizeof(sound_uevent));
+    EXPECT(wait_events(1, 1, MAX_DELIVERY_US));
+    pthread_mutex_lock(&test_lock);
+    EXPECT(card0_blocked);
+    EXPECT(last_status[1] == CARD_STATUS_OFFLINE);
+    printf("card 1 offline delivered after %lld us with card 0 blocked\n",
+           (long long)(event_us[1] - start_us));
+    pthread_mutex_unlock(&test_lock);
+
+    /* uevents of other subsystems do not rescan the cards */
+    set_card_state(1, "ONLINE");
+    send_uevent(net_uevent, sizeof(net_uevent));
+    EXPECT(!wait_events(1, 2, 50 * 1000));
+    send_uevent(sound_uevent, sizeof(sound_uevent));
+    EXPECT(wait_events(1, 2, MAX_DELIVERY_US));
+    EXPECT(last_status[1] == CARD_STATUS_ONLINE);
+
+    /* card 0 comes back, queued behind its blocked listener */
+    set_card_state(0, "ONLINE");
+    send_uevent(sound_uevent, sizeof(sound_uevent));
+    usleep(50 * 1000);
+    pthread_mutex_lock(&test_lock);
+    EXPECT(events[0] == 1);
+    card0_release = true;
+    pthread_cond_broadcast(&test_cond);
+    pthread_mutex_unlock(&test_lock);
+    EXPECT(wait_events(0, 2, BLOCK_US));
+    EXPECT(last_status[0] == CARD_STATUS_ONLINE);
+
+    EXPECT(audio_extn_snd_mon_unregister_listener(&stream) == 0);
+    EXPECT(audio_extn_snd_mon_deinit() == 0);
+    close(uevent_sock[1]);
+    cleanup_fake_proc();
+
+    printf("PASS\n");
+    return 0;
+}
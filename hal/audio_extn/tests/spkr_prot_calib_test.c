@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures how long a playback start waits on a running speaker calibration.
+ * spkr_calibrate() runs against the fake backend on a separate thread, the
+ * main thread then takes adev->lock and cancels like select_devices() does.
+ * The fake enable_snd_device() cancels the calibration like the real one,
+ * so a speaker start that routes the VI feedback path goes through the
+ * cancel with mutex_spkr_prot held.
+ */
+
+#define SPKR_PROT_ENABLED
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "fake_audio_hw.h"
+
+static int fake_cal_open(const char *path __unused, int flags __unused, ...)
+{
+    return open("/dev/null", O_RDWR);
+}
+
+static int fake_cal_ioctl(int fd __unused, unsigned long request __unused, ...)
+{
+    return 0;
+}
+
+#define open fake_cal_open
+#define ioctl fake_cal_ioctl
+#include "../spkr_protection.c"
+#undef ioctl
+#undef open
+
+/* upper bound for the cancel, far below SLEEP_AFTER_CALIB_START */
+#define MAX_CANCEL_LATENCY_US (50 * 1000)
+#define MAX_UNWIND_US (500 * 1000)
+/* a deadlock fails the test instead of hanging it */
+#define WATCHDOG_SEC 5
+
+static struct audio_device adev;
+static int calib_status;
+static int64_t calib_done_us;
+
+static void *calib_thread(void *arg __unused)
+{
+    pthread_mutex_lock(&adev.lock);
+    calib_status = spkr_calibrate(SAFE_SPKR_TEMP_Q6);
+    pthread_mutex_unlock(&adev.lock);
+    calib_done_us = fake_now_us();
+    return NULL;
+}
+
+static enum spkr_calib_state calib_state(void)
+{
+    enum spkr_calib_state state;
+
+    pthread_mutex_lock(&handle.mutex_spkr_prot);
+    state = handle.calib_state;
+    pthread_mutex_unlock(&handle.mutex_spkr_prot);
+    return state;
+}
+
+/* what enable_snd_device() in audio_hw.c does before routing a device */
+static void cancel_on_enable(struct audio_device *dev, snd_device_t snd_device __unused)
+{
+    audio_extn_spkr_prot_calib_cancel(dev);
+}
+
+static void start_calibration(pthread_t *thread)
+{
+    fake_reset();
+    fake.close_us = 1000;
+    fake.enable_snd_device_hook = cancel_on_enable;
+    pthread_mutex_lock(&handle.mutex_spkr_prot);
+    spkr_calib_set_state_l(SPKR_CALIB_IDLE);
+    pthread_mutex_unlock(&handle.mutex_spkr_prot);
+
+    pthread_create(thread, NULL, calib_thread, NULL);
+    while (calib_state() != SPKR_CALIB_RUNNING)
+        usleep(1000);
+    EXPECT(fake.pcm_opened == 2);
+}
+
+static void test_cancel_latency(void)
+{
+    pthread_t thread;
+    int64_t start_us, cancel_us;
+    int run;
+
+    for (run = 0; run < 3; run++) {
+        start_calibration(&thread);
+
+        start_us = fake_now_us();
+        pthread_mutex_lock(&adev.lock);
+        audio_extn_spkr_prot_calib_cancel(&adev);
+        EXPECT(list_empty(&adev.usecase_list));
+        EXPECT(fake.pcm_opened == 0);
+        pthread_mutex_unlock(&adev.lock);
+        cancel_us = fake_now_us() - start_us;
+
+        pthread_join(thread, NULL);
+        printf("run %d: cancel %lld us, calibration thread done after %lld us\n",
+               run, (long long)cancel_us, (long long)(calib_done_us - start_us));
+
+        EXPECT(cancel_us < MAX_CANCEL_LATENCY_US);
+        EXPECT(calib_done_us - start_us < MAX_UNWIND_US);
+        EXPECT(calib_status == -EAGAIN);
+        EXPECT(handle.calib_state == SPKR_CALIB_IDLE);
+        EXPECT(handle.calib_uc_rx == NULL && handle.calib_uc_tx == NULL);
+        EXPECT(fake.snd_device_refs[SND_DEVICE_OUT_SPEAKER_PROTECTED] == 0);
+        EXPECT(fake.snd_device_refs[SND_DEVICE_IN_CAPTURE_VI_FEEDBACK] == 0);
+    }
+    EXPECT(handle.calib_cancel_count == 3);
+    EXPECT(handle.calib_cancel_max_us < MAX_CANCEL_LATENCY_US);
+}
+
+/* a speaker playback starting over a running calibration, like select_devices() */
+static void test_start_processing(void)
+{
+    pthread_t thread;
+
+    start_calibration(&thread);
+
+    alarm(WATCHDOG_SEC);
+    pthread_mutex_lock(&adev.lock);
+    enable_snd_device(&adev, SND_DEVICE_OUT_SPEAKER);
+    EXPECT(fake.pcm_opened == 0);
+    EXPECT(audio_extn_spkr_prot_start_processing(SND_DEVICE_OUT_SPEAKER) == 0);
+    EXPECT(handle.spkr_processing_state == SPKR_PROCESSING_IN_PROGRESS);
+    EXPECT(fake.snd_device_refs[SND_DEVICE_IN_CAPTURE_VI_FEEDBACK] == 1);
+    EXPECT(fake.pcm_opened == 1);
+    pthread_mutex_unlock(&adev.lock);
+    pthread_join(thread, NULL);
+    EXPECT(calib_status == -EAGAIN);
+
+    pthread_mutex_lock(&adev.lock);
+    audio_extn_spkr_prot_stop_processing(SND_DEVICE_OUT_SPEAKER);
+    disable_snd_device(&adev, SND_DEVICE_OUT_SPEAKER);
+    pthread_mutex_unlock(&adev.lock);
+    alarm(0);
+
+    EXPECT(handle.spkr_processing_state == SPKR_PROCESSING_IN_IDLE);
+    EXPECT(fake.snd_device_refs[SND_DEVICE_IN_CAPTURE_VI_FEEDBACK] == 0);
+    EXPECT(fake.pcm_opened == 0);
+    EXPECT(list_empty(&adev.usecase_list));
+    printf("start processing over a running calibration: ok\n");
+}
+
+int main(void)
+{
+    pthread_mutex_init(&adev.lock, NULL);
+    list_init(&adev.usecase_list);
+    handle.adev_handle = &adev;
+    pthread_mutex_init(&handle.mutex_spkr_prot, NULL);
+    pthread_cond_init(&handle.spkr_calib_cancel, NULL);
+
+    test_cancel_latency();
+    test_start_processing();
+
+    printf("PASS\n");
+    return 0;
+}
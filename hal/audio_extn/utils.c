@@ -18,6 +18,8 @@
 //#define LOG_NDEBUG 0
 
 #include <errno.h>
+#include <pthread.h>
+#include <time.h>
 #include <cutils/properties.h>
 #include <cutils/config_utils.h>
 #include <stdlib.h>
@@ -35,6 +37,31 @@
 
 #define MAX_LENGTH_MIXER_CONTROL_IN_INT 128
 
+/*
+ * Front ends of a voice or HFP session are independent, so their open and
+ * prepare ioctls are issued concurrently. The calling thread works on the
+ * batch too; the pool only needs to cover the remaining PCMs.
+ */
+#define PCM_OPEN_WORKERS 3
+
+static struct {
+    pthread_once_t once;
+    pthread_mutex_t batch_lock;     /* one batch at a time */
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    struct pcm_open_req *reqs;
+    int count;
+    int next;                       /* next request to claim */
+    int pending;                    /* requests not completed yet */
+} pcm_open_pool = {
+    .once = PTHREAD_ONCE_INIT,
+    .batch_lock = PTHREAD_MUTEX_INITIALIZER,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work_cond = PTHREAD_COND_INITIALIZER,
+    .done_cond = PTHREAD_COND_INITIALIZER,
+};
+
 static int set_stream_app_type_mixer_ctrl(struct audio_device *adev,
                                           int pcm_device_id, int app_type,
                                           int acdb_dev_id, int sample_rate,
@@ -627,3 +654,113 @@ done:
 
     return snd_card_num;
 }
+
+static void pcm_open_req_run(struct pcm_open_req *req)
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    req->status = 0;
+    req->pcm = pcm_open(req->card, req->device, req->flags, req->config);
+    if (req->pcm == NULL) {
+        req->status = -ENOMEM;
+    } else if (!pcm_is_ready(req->pcm)) {
+        ALOGE("%s: device %u: %s", __func__, req->device, pcm_get_error(req->pcm));
+        req->status = -EIO;
+    } else if (pcm_prepare(req->pcm) < 0) {
+        ALOGE("%s: device %u prepare: %s", __func__, req->device,
+              pcm_get_error(req->pcm));
+        req->status = -EIO;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    req->open_us = (end.tv_sec - start.tv_sec) * 1000000 +
+                   (end.tv_nsec - start.tv_nsec) / 1000;
+}
+
+/* Claims and runs requests of the current batch, called with the pool lock */
+static void pcm_open_pool_drain_l()
+{
+    while (pcm_open_pool.reqs && pcm_open_pool.next < pcm_open_pool.count) {
+        struct pcm_open_req *req = &pcm_open_pool.reqs[pcm_open_pool.next++];
+
+        pthread_mutex_unlock(&pcm_open_pool.lock);
+        pcm_open_req_run(req);
+        pthread_mutex_lock(&pcm_open_pool.lock);
+        if (--pcm_open_pool.pending == 0)
+            pthread_cond_signal(&pcm_open_pool.done_cond);
+    }
+}
+
+static void *pcm_open_worker_loop(void *context __unused)
+{
+    pthread_mutex_lock(&pcm_open_pool.lock);
+    while (1) {
+        while (!pcm_open_pool.reqs || pcm_open_pool.next >= pcm_open_pool.count)
+            pthread_cond_wait(&pcm_open_pool.work_cond, &pcm_open_pool.lock);
+        pcm_open_pool_drain_l();
+    }
+    return NULL;
+}
+
+static void pcm_open_pool_init()
+{
+    pthread_attr_t attr;
+    pthread_t thread;
+    int i;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for (i = 0; i < PCM_OPEN_WORKERS; i++) {
+        /* Missing workers only reduce concurrency, the caller drains the rest */
+        if (pthread_create(&thread, &attr, pcm_open_worker_loop, NULL)) {
+            ALOGW("%s: could only start %d workers", __func__, i);
+            break;
+        }
+    }
+    pthread_attr_destroy(&attr);
+}
+
+/*
+ * Opens and prepares all PCMs in reqs concurrently. Either all of them are
+ * left open, or on any failure all are closed, set to NULL and the first
+ * error is returned.
+ */
+int audio_extn_utils_pcm_open_batch(struct pcm_open_req *reqs, int count)
+{
+    int i, ret = 0;
+
+    if (reqs == NULL || count <= 0)
+        return -EINVAL;
+
+    if (count > 1)
+        pthread_once(&pcm_open_pool.once, pcm_open_pool_init);
+
+    pthread_mutex_lock(&pcm_open_pool.batch_lock);
+    pthread_mutex_lock(&pcm_open_pool.lock);
+    pcm_open_pool.reqs = reqs;
+    pcm_open_pool.count = count;
+    pcm_open_pool.next = 0;
+    pcm_open_pool.pending = count;
+    if (count > 1)
+        pthread_cond_broadcast(&pcm_open_pool.work_cond);
+    pcm_open_pool_drain_l();
+    while (pcm_open_pool.pending > 0)
+        pthread_cond_wait(&pcm_open_pool.done_cond, &pcm_open_pool.lock);
+    pcm_open_pool.reqs = NULL;
+    pthread_mutex_unlock(&pcm_open_pool.lock);
+    pthread_mutex_unlock(&pcm_open_pool.batch_lock);
+
+    for (i = 0; i < count; i++) {
+        if (reqs[i].status && !ret)
+            ret = reqs[i].status;
+    }
+    if (ret) {
+        for (i = 0; i < count; i++) {
+            if (reqs[i].pcm) {
+                pcm_close(reqs[i].pcm);
+                reqs[i].pcm = NULL;
+            }
+        }
+    }
+    return ret;
+}
@@ -519,6 +519,83 @@ bool audio_hw_send_gain_dep_calibration(int level) {
     return ret_val;
 }
 
+/*
+ * Called with adev lock held from every sndmonitor listener on OFFLINE.
+ * Listeners run in no particular order, so the first one of an SSR
+ * records the active voice calls. Stream usecases are not recorded, each
+ * stream goes to standby and restarts on its next read or write.
+ */
+static void ssr_snapshot_usecases_l(struct audio_device *adev)
+{
+    struct ssr_recovery *ssr = &adev->ssr;
+    struct listnode *node;
+
+    if (ssr->snapshot_valid)
+        return;
+
+    ssr->num_usecases = 0;
+    list_for_each(node, &adev->usecase_list) {
+        struct audio_usecase *usecase = node_to_item(node, struct audio_usecase, list);
+        if (usecase->type != VOICE_CALL)
+            continue;
+        if (ssr->num_usecases >= SSR_RECOVERY_MAX_USECASES) {
+            ALOGW("%s: too many active usecases, snapshot truncated", __func__);
+            break;
+        }
+        struct ssr_usecase_snapshot *snap = &ssr->usecases[ssr->num_usecases++];
+        snap->id = usecase->id;
+    }
+    ssr->offline_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+    ssr->snapshot_valid = true;
+    ALOGD("%s: %u voice usecases recorded", __func__, ssr->num_usecases);
+}
+
+/*
+ * Called with adev lock held when the sound card comes back ONLINE, before
+ * adev->card_status is updated. Streams cannot restart until this returns,
+ * so the global DSP state is restored once instead of per stream.
+ */
+static void ssr_restore_l(struct audio_device *adev)
+{
+    struct ssr_recovery *ssr = &adev->ssr;
+    const int64_t start_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+    unsigned int restored = 0;
+    unsigned int i;
+
+    platform_snd_card_update(adev->platform, CARD_STATUS_ONLINE);
+    send_gain_dep_calibration_l();
+
+    /*
+     * Voice call usecases are not owned by a stream and stay in the
+     * usecase list across SSR. Their PCMs and CVD session are gone, so
+     * tear down and bring up each call while holding the lock.
+     */
+    for (i = 0; ssr->snapshot_valid && i < ssr->num_usecases; i++) {
+        struct ssr_usecase_snapshot *snap = &ssr->usecases[i];
+
+        if (get_usecase_from_list(adev, snap->id) == NULL ||
+            adev->current_call_output == NULL)
+            continue;
+
+        voice_stop_usecase(adev, snap->id);
+        if (voice_start_usecase(adev, snap->id) == 0)
+            restored++;
+        else
+            ALOGE("%s: failed to restore %s", __func__, use_case_table[snap->id]);
+    }
+
+    const int64_t end_ns = systemTime(SYSTEM_TIME_MONOTONIC);
+    ssr->last_restore_ns = end_ns - start_ns;
+    ssr->last_offline_duration_ns = ssr->snapshot_valid ? start_ns - ssr->offline_ns : 0;
+    ssr->last_num_restored = restored;
+    ssr->count++;
+    simple_stats_log(&ssr->restore_ms, ssr->last_restore_ns * 1e-6);
+    ssr->snapshot_valid = false;
+
+    ALOGD("%s: restored %u voice usecases in %lld us", __func__, restored,
+          (long long)(ssr->last_restore_ns / 1000));
+}
+
 #ifdef MAXXAUDIO_QDSP_ENABLED
 bool audio_hw_send_ma_parameter(int stream_type, float vol, bool active)
 {
@@ -1913,6 +1990,23 @@ static int stop_input_stream(struct stream_in *in)
     return ret;
 }
 
+/*
+ * Called with adev lock held for a stream reading from a shared capture
+ * session. The usecase stays up while other streams are attached, and is
+ * handed to the one with the highest priority if this stream held it.
+ */
+static int stop_shared_input_stream(struct stream_in *in)
+{
+    struct audio_device *adev = in->dev;
+    struct stream_in *owner;
+
+    if (!audio_extn_capture_share_leave(adev, in, &owner))
+        return stop_input_stream(in);
+    if (owner != NULL)
+        select_devices(adev, owner->usecase);
+    return 0;
+}
+
 int start_input_stream(struct stream_in *in)
 {
     /* 1. Enable output device and stream routing controls */
@@ -1939,6 +2033,13 @@ int start_input_stream(struct stream_in *in)
     else
         ALOGV("%s: usecase(%d)", __func__, in->usecase);
 
+    /* Join the capture session already running for this usecase, if any */
+    if (audio_extn_capture_share_join(adev, in, source_priority(in->source)) == 0) {
+        register_in_stream(in);
+        ALOGV("%s: exit: attached to shared capture", __func__);
+        return 0;
+    }
+
     in->pcm_device_id = platform_get_pcm_device_id(in->usecase, PCM_CAPTURE);
     if (in->pcm_device_id < 0) {
         ALOGE("%s: Could not find PCM device id for the usecase(%d)",
@@ -2022,6 +2123,7 @@ int start_input_stream(struct stream_in *in)
                 goto error_open;
             }
         }
+        audio_extn_capture_share_start(in, source_priority(in->source));
     }
     register_in_stream(in);
     check_and_enable_effect(adev);
@@ -3466,6 +3568,8 @@ static void out_snd_mon_cb(void * stream, struct str_parms * parms)
 
     pthread_mutex_lock(&adev->lock);
     bool valid_cb = (card == adev->snd_card);
+    if (valid_cb && status == CARD_STATUS_OFFLINE)
+        ssr_snapshot_usecases_l(adev);
     pthread_mutex_unlock(&adev->lock);
 
     if (!valid_cb)
@@ -4241,7 +4345,10 @@ static int in_standby(struct audio_stream *stream)
             adev->enable_voicerx = false;
 
         if (do_stop) {
-            status = stop_input_stream(in);
+            if (in->capture_share)
+                status = stop_shared_input_stream(in);
+            else
+                status = stop_input_stream(in);
         }
 
         pthread_mutex_unlock(&adev->lock);
@@ -4269,6 +4376,12 @@ static int in_dump(const struct audio_stream *stream, int fd)
         dprintf(fd, "      Start latency ms: %s\n", buffer);
     }
 
+    if (in->is_st_session)
+        audio_extn_sound_trigger_dump(in, fd);
+
+    if (locked && in->capture_share)
+        audio_extn_capture_share_dump(in, fd);
+
     if (locked) {
         pthread_mutex_unlock(&in->lock);
     }
@@ -4288,6 +4401,7 @@ static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
     char value[32];
     int ret, val = 0;
     int status = 0;
+    bool restart_shared = false;
 
     ALOGV("%s: enter: kvpairs=%s", __func__, kvpairs);
     parms = str_parms_create_str(kvpairs);
@@ -4302,6 +4416,9 @@ static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
         /* no audio source uses val == 0 */
         if ((in->source != val) && (val != 0)) {
             in->source = val;
+            /* the session was joined at the priority of the old source */
+            if (in->capture_share)
+                restart_shared = true;
         }
     }
 
@@ -4330,12 +4447,31 @@ static int in_set_parameters(struct audio_stream *stream, const char *kvpairs)
                         adev->adm_on_routing_change(adev->adm_data,
                                                     in->capture_handle);
                     }
-                    select_devices(adev, in->usecase);
+                    if (in->capture_share)
+                        restart_shared = true;
+                    else
+                        select_devices(adev, in->usecase);
                 }
             }
         }
     }
 
+    /*
+     * A shared session keeps the device and source of the stream that
+     * opened it. Leave it and start again, which joins a matching session
+     * or opens the PCM for the new route.
+     */
+    if (restart_shared && !in->standby) {
+        ALOGV("%s: restart shared capture", __func__);
+        if (adev->adm_deregister_stream)
+            adev->adm_deregister_stream(adev->adm_data, in->capture_handle);
+        stop_shared_input_stream(in);
+        if (start_input_stream(in) != 0) {
+            ALOGE("%s: restart failed, input goes to standby", __func__);
+            in->standby = true;
+        }
+    }
+
     pthread_mutex_unlock(&adev->lock);
     pthread_mutex_unlock(&in->lock);
 
@@ -4421,6 +4557,8 @@ static void in_snd_mon_cb(void * stream, struct str_parms * parms)
 
     pthread_mutex_lock(&adev->lock);
     bool valid_cb = (card == adev->snd_card);
+    if (valid_cb && status == CARD_STATUS_OFFLINE)
+        ssr_snapshot_usecases_l(adev);
     pthread_mutex_unlock(&adev->lock);
 
     if (!valid_cb)
@@ -4489,12 +4627,14 @@ static ssize_t in_read(struct audio_stream_in *stream, void *buffer,
     error_code = ERROR_CODE_READ;
 
     //what's the duration requested by the client?
-    long ns = pcm_bytes_to_frames(in->pcm, bytes)*1000000000LL/
-                                                in->config.rate;
+    long ns = frames*1000000000LL/in->config.rate;
     request_in_focus(in, ns);
 
     bool use_mmap = is_mmap_usecase(in->usecase) || in->realtime;
-    if (in->pcm) {
+    if (in->capture_share) {
+        /* converted to the stream format by the shared session */
+        ret = audio_extn_capture_share_read(in, buffer, bytes);
+    } else if (in->pcm) {
         if (use_mmap) {
             ret = pcm_mmap_read(in->pcm, buffer, bytes);
         } else {
@@ -4550,9 +4690,16 @@ exit:
     return bytes;
 }
 
-static uint32_t in_get_input_frames_lost(struct audio_stream_in *stream __unused)
+static uint32_t in_get_input_frames_lost(struct audio_stream_in *stream)
 {
-    return 0;
+    struct stream_in *in = (struct stream_in *)stream;
+    uint32_t frames_lost = 0;
+
+    lock_input_stream(in);
+    if (in->capture_share)
+        frames_lost = audio_extn_capture_share_get_frames_lost(in);
+    pthread_mutex_unlock(&in->lock);
+    return frames_lost;
 }
 
 static int in_get_capture_position(const struct audio_stream_in *stream,
@@ -4573,7 +4720,11 @@ static int in_get_capture_position(const struct audio_stream_in *stream,
                  "%s stream in standby but pcm not NULL for non ST session", __func__);
         goto exit;
     }
-    if (in->pcm) {
+    if (in->capture_share) {
+        ret = audio_extn_capture_share_get_position(in, frames, time);
+        if (ret == 0)
+            *time -= platform_capture_latency(in) * 1000LL;
+    } else if (in->pcm) {
         struct timespec timestamp;
         unsigned int avail;
         if (pcm_get_htimestamp(in->pcm, &avail, &timestamp) == 0) {
@@ -5861,6 +6012,7 @@ static int adev_set_mode(struct audio_hw_device *dev, audio_mode_t mode)
     if (adev->mode != mode) {
         ALOGD("%s: mode %d", __func__, (int)mode);
         adev->mode = mode;
+        voice_trace_set_mode(adev, mode);
         if ((mode == AUDIO_MODE_NORMAL || mode == AUDIO_MODE_IN_COMMUNICATION) &&
                 voice_is_in_call(adev)) {
             voice_stop_call(adev);
@@ -6261,6 +6413,7 @@ static void adev_close_input_stream(struct audio_hw_device *dev __unused,
     // between the callback and close_stream
     audio_extn_snd_mon_unregister_listener(stream);
     in_standby(&stream->common);
+    audio_extn_sound_trigger_release_session(in);
 
     error_log_destroy(in->error_log);
     in->error_log = NULL;
@@ -6273,8 +6426,34 @@ static void adev_close_input_stream(struct audio_hw_device *dev __unused,
     return;
 }
 
-static int adev_dump(const audio_hw_device_t *device __unused, int fd __unused)
+static int adev_dump(const audio_hw_device_t *device __unused, int fd)
 {
+    // We try to get the lock for consistency,
+    // but it isn't necessary for these variables.
+    const bool locked = (pthread_mutex_trylock(&adev->lock) == 0);
+    struct ssr_recovery *ssr = &adev->ssr;
+
+    dprintf(fd, "  SSR recoveries: %u\n", ssr->count);
+    if (ssr->count > 0) {
+        char buffer[256]; // for statistics formatting
+        dprintf(fd, "    Last offline duration ms: %.3f\n",
+                ssr->last_offline_duration_ns * 1e-6);
+        dprintf(fd, "    Last restore pass ms: %.3f (%u voice calls restored)\n",
+                ssr->last_restore_ns * 1e-6, ssr->last_num_restored);
+        simple_stats_to_string(&ssr->restore_ms, buffer, sizeof(buffer));
+        dprintf(fd, "    Restore pass ms: %s\n", buffer);
+    }
+
+    voice_trace_dump(adev, fd);
+
+    if (locked) {
+        pthread_mutex_unlock(&adev->lock);
+    }
+
+    audio_extn_spkr_prot_dump(fd);
+    audio_extn_ma_dump(fd);
+    if (adev->visualizer_dump != NULL)
+        adev->visualizer_dump(fd);
     return 0;
 }
 
@@ -6476,8 +6655,18 @@ static void adev_snd_mon_cb(void * stream __unused, struct str_parms * parms)
     bool valid_cb = (card == adev->snd_card);
     if (valid_cb) {
         if (adev->card_status != status) {
+            if (status == CARD_STATUS_OFFLINE) {
+                ssr_snapshot_usecases_l(adev);
+                platform_snd_card_update(adev->platform, status);
+            } else {
+                ssr_restore_l(adev);
+            }
+            /* effect libraries cache mixer controls of the card */
+            if (adev->offload_effects_set_card_status != NULL)
+                adev->offload_effects_set_card_status(card, status);
+            if (adev->visualizer_set_card_status != NULL)
+                adev->visualizer_set_card_status(card, status);
             adev->card_status = status;
-            platform_snd_card_update(adev->platform, status);
         }
     }
     pthread_mutex_unlock(&adev->lock);
@@ -6640,6 +6829,12 @@ static int adev_open(const hw_module_t *module, const char *name,
         adev->visualizer_stop_output =
                     (int (*)(audio_io_handle_t, int))dlsym(adev->visualizer_lib,
                                                     "visualizer_hal_stop_output");
+        adev->visualizer_set_card_status =
+                    (int (*)(int, int))dlsym(adev->visualizer_lib,
+                                                    "visualizer_hal_set_card_status");
+        adev->visualizer_dump =
+                    (int (*)(int))dlsym(adev->visualizer_lib,
+                                                    "visualizer_hal_dump");
     }
 
     adev->offload_effects_lib = dlopen(OFFLOAD_EFFECTS_BUNDLE_LIBRARY_PATH, RTLD_NOW);
@@ -6655,6 +6850,9 @@ static int adev_open(const hw_module_t *module, const char *name,
         adev->offload_effects_stop_output =
                     (int (*)(audio_io_handle_t, int))dlsym(adev->offload_effects_lib,
                                      "offload_effects_bundle_hal_stop_output");
+        adev->offload_effects_set_card_status =
+                    (int (*)(int, int))dlsym(adev->offload_effects_lib,
+                                     "offload_effects_bundle_hal_set_card_status");
     }
 
     adev->adm_lib = dlopen(ADM_LIBRARY_PATH, RTLD_NOW);
@@ -274,6 +274,9 @@ struct stream_out {
     simple_stats_t start_latency_ms;
 };
 
+struct sound_trigger_info;
+struct share_client;
+
 struct stream_in {
     struct audio_stream_in stream;
     pthread_mutex_t lock; /* see note below on mutex acquisition order */
@@ -302,6 +305,8 @@ struct stream_in {
     audio_input_flags_t flags;
     bool is_st_session;
     bool is_st_session_active;
+    struct sound_trigger_info *st_ses; /* sound trigger session resolved at open */
+    struct share_client *capture_share; /* shared capture session client, in->pcm is NULL while set */
     bool realtime;
     int af_period_multiplier;
     struct audio_device *dev;
@@ -347,6 +352,26 @@ struct audio_usecase {
     union stream_ptr stream;
 };
 
+#define SSR_RECOVERY_MAX_USECASES 16
+
+/* voice call usecase recorded when the sound card goes offline */
+struct ssr_usecase_snapshot {
+    audio_usecase_t id;
+};
+
+struct ssr_recovery {
+    bool snapshot_valid; /* set by the first OFFLINE callback of an SSR */
+    unsigned int num_usecases;
+    struct ssr_usecase_snapshot usecases[SSR_RECOVERY_MAX_USECASES];
+    int64_t offline_ns;
+
+    unsigned int count; /* completed recoveries */
+    unsigned int last_num_restored;
+    int64_t last_offline_duration_ns;
+    int64_t last_restore_ns; /* duration of the batched restore pass */
+    simple_stats_t restore_ms;
+};
+
 typedef void* (*adm_init_t)();
 typedef void (*adm_deinit_t)(void *);
 typedef void (*adm_register_output_stream_t)(void *, audio_io_handle_t, audio_output_flags_t);
@@ -390,10 +415,13 @@ struct audio_device {
     void *extspk;
 
     card_status_t card_status;
+    struct ssr_recovery ssr;
 
     void *visualizer_lib;
     int (*visualizer_start_output)(audio_io_handle_t, int, int, int);
     int (*visualizer_stop_output)(audio_io_handle_t, int);
+    int (*visualizer_set_card_status)(int, int);
+    int (*visualizer_dump)(int);
 
     /* The pcm_params use_case_table is loaded by adev_verify_devices() upon
      * calling adev_open().
@@ -405,6 +433,7 @@ struct audio_device {
     void *offload_effects_lib;
     int (*offload_effects_start_output)(audio_io_handle_t, int);
     int (*offload_effects_stop_output)(audio_io_handle_t, int);
+    int (*offload_effects_set_card_status)(int, int);
 
     void *adm_data;
     void *adm_lib;
@@ -21,6 +21,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <math.h>
+#include <time.h>
 #include <log/log.h>
 #include <cutils/str_parms.h>
 
@@ -29,6 +30,7 @@
 #include "voice_extn/voice_extn.h"
 #include "platform.h"
 #include "platform_api.h"
+#include "audio_extn.h"
 #include "audio_extn/tfa_98xx.h"
 
 struct pcm_config pcm_config_voice_call = {
@@ -39,6 +41,28 @@ struct pcm_config pcm_config_voice_call = {
     .format = PCM_FORMAT_S16_LE,
 };
 
+static const char * const call_setup_phase_names[CALL_SETUP_PHASE_COUNT] = {
+    [CALL_SETUP_SELECT_DEVICES] = "select_devices",
+    [CALL_SETUP_PCM_OPEN] = "pcm_open",
+    [CALL_SETUP_PCM_OPEN_TX] = "pcm_open_tx",
+    [CALL_SETUP_PCM_OPEN_RX] = "pcm_open_rx",
+    [CALL_SETUP_PCM_OPEN_HOST_TX] = "pcm_open_host_tx",
+    [CALL_SETUP_PCM_OPEN_HOST_RX] = "pcm_open_host_rx",
+    [CALL_SETUP_PCM_START] = "pcm_start",
+    [CALL_SETUP_AMP] = "amp",
+    [CALL_SETUP_SIDETONE] = "sidetone",
+    [CALL_SETUP_VOLUME] = "volume",
+    [CALL_SETUP_CALL_START] = "call_start",
+};
+
+static int64_t voice_trace_now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 static struct voice_session *voice_get_session_from_use_case(struct audio_device *adev,
                               audio_usecase_t usecase_id)
 {
@@ -160,6 +184,7 @@ int voice_start_usecase(struct audio_device *adev, audio_usecase_t usecase_id)
     int pcm_dev_rx_id, pcm_dev_tx_id;
     struct voice_session *session = NULL;
     struct pcm_config voice_config = pcm_config_voice_call;
+    snd_device_t out_snd_device = SND_DEVICE_NONE;
 
     ALOGD("%s: enter usecase:%s", __func__, use_case_table[usecase_id]);
 
@@ -175,7 +200,10 @@ int voice_start_usecase(struct audio_device *adev, audio_usecase_t usecase_id)
 
     list_add_tail(&adev->usecase_list, &uc_info->list);
 
+    voice_trace_begin(adev, CALL_SETUP_TYPE_VOICE, usecase_id);
     select_devices(adev, usecase_id);
+    voice_trace_phase(adev, CALL_SETUP_SELECT_DEVICES);
+    out_snd_device = uc_info->out_snd_device;
 
     pcm_dev_rx_id = platform_get_pcm_device_id(uc_info->id, PCM_PLAYBACK);
     pcm_dev_tx_id = platform_get_pcm_device_id(uc_info->id, PCM_CAPTURE);
@@ -187,27 +215,22 @@ int voice_start_usecase(struct audio_device *adev, audio_usecase_t usecase_id)
         goto error_start_voice;
     }
 
-    ALOGV("%s: Opening PCM capture device card_id(%d) device_id(%d)",
-          __func__, adev->snd_card, pcm_dev_tx_id);
-    session->pcm_tx = pcm_open(adev->snd_card,
-                               pcm_dev_tx_id,
-                               PCM_IN, &voice_config);
-    if (session->pcm_tx && !pcm_is_ready(session->pcm_tx)) {
-        ALOGE("%s: %s", __func__, pcm_get_error(session->pcm_tx));
-        ret = -EIO;
-        goto error_start_voice;
-    }
-
-    ALOGV("%s: Opening PCM playback device card_id(%d) device_id(%d)",
-          __func__, adev->snd_card, pcm_dev_rx_id);
-    session->pcm_rx = pcm_open(adev->snd_card,
-                               pcm_dev_rx_id,
-                               PCM_OUT, &voice_config);
-    if (session->pcm_rx && !pcm_is_ready(session->pcm_rx)) {
-        ALOGE("%s: %s", __func__, pcm_get_error(session->pcm_rx));
+    ALOGV("%s: Opening PCM devices card_id(%d) rx(%d) tx(%d)",
+          __func__, adev->snd_card, pcm_dev_rx_id, pcm_dev_tx_id);
+    struct pcm_open_req reqs[] = {
+        { adev->snd_card, pcm_dev_tx_id, PCM_IN, &voice_config },
+        { adev->snd_card, pcm_dev_rx_id, PCM_OUT, &voice_config },
+    };
+    ret = audio_extn_utils_pcm_open_batch(reqs, ARRAY_SIZE(reqs));
+    voice_trace_phase(adev, CALL_SETUP_PCM_OPEN);
+    voice_trace_add(adev, CALL_SETUP_PCM_OPEN_TX, reqs[0].open_us);
+    voice_trace_add(adev, CALL_SETUP_PCM_OPEN_RX, reqs[1].open_us);
+    if (ret != 0) {
         ret = -EIO;
         goto error_start_voice;
     }
+    session->pcm_tx = reqs[0].pcm;
+    session->pcm_rx = reqs[1].pcm;
 
     if (adev->mic_break_enabled)
         platform_set_mic_break_det(adev->platform, true);
@@ -217,18 +240,23 @@ int voice_start_usecase(struct audio_device *adev, audio_usecase_t usecase_id)
         goto error_start_voice;
 
     ret = pcm_start(session->pcm_rx);
+    voice_trace_phase(adev, CALL_SETUP_PCM_START);
     if (ret != 0)
         goto error_start_voice;
 
     audio_extn_tfa_98xx_enable_speaker();
+    voice_trace_phase(adev, CALL_SETUP_AMP);
 
     /* Enable sidetone only when no calls are already active */
     if (!voice_is_call_state_active(adev))
         voice_set_sidetone(adev, uc_info->out_snd_device, true);
+    voice_trace_phase(adev, CALL_SETUP_SIDETONE);
 
     voice_set_volume(adev, adev->voice.volume);
+    voice_trace_phase(adev, CALL_SETUP_VOLUME);
 
     ret = platform_start_voice_call(adev->platform, session->vsid);
+    voice_trace_phase(adev, CALL_SETUP_CALL_START);
     if (ret < 0) {
         ALOGE("%s: platform_start_voice_call error %d\n", __func__, ret);
         goto error_start_voice;
@@ -241,6 +269,7 @@ error_start_voice:
     voice_stop_usecase(adev, usecase_id);
 
 done:
+    voice_trace_end(adev, out_snd_device, ret);
     ALOGD("%s: exit: status(%d)", __func__, ret);
     return ret;
 }
@@ -560,24 +589,181 @@ void voice_init(struct audio_device *adev)
         adev->voice.session[i].vsid = VOICE_VSID;
     }
 
+    adev->voice.setup_trace.magic = CALL_SETUP_TRACE_MAGIC;
+    adev->voice.setup_trace.record_size = sizeof(struct call_setup_record);
+
     voice_extn_init(adev);
 }
 
+void voice_trace_set_mode(struct audio_device *adev, audio_mode_t mode)
+{
+    if (mode == AUDIO_MODE_IN_CALL)
+        adev->voice.setup_trace.mode_ns = voice_trace_now_ns();
+}
+
+void voice_trace_begin(struct audio_device *adev, int type,
+                       audio_usecase_t usecase_id)
+{
+    struct call_setup_trace *trace = &adev->voice.setup_trace;
+    struct call_setup_record *rec =
+            &trace->records[trace->count % CALL_SETUP_TRACE_ENTRIES];
+    const int64_t now = voice_trace_now_ns();
+
+    memset(rec, 0, sizeof(*rec));
+    rec->start_ns = now;
+    rec->type = type;
+    rec->usecase = usecase_id;
+    /* Only a voice call is set up in response to the mode change */
+    if (type == CALL_SETUP_TYPE_VOICE && trace->mode_ns) {
+        rec->mode_to_start_us = (now - trace->mode_ns) / 1000;
+        trace->mode_ns = 0;
+    }
+    trace->mark_ns = now;
+    trace->cur = rec;
+}
+
+void voice_trace_phase(struct audio_device *adev, int phase)
+{
+    struct call_setup_trace *trace = &adev->voice.setup_trace;
+    const int64_t now = voice_trace_now_ns();
+
+    if (!trace->cur || phase < 0 || phase >= CALL_SETUP_PHASE_COUNT)
+        return;
+    trace->cur->phase_us[phase] += (now - trace->mark_ns) / 1000;
+    trace->mark_ns = now;
+}
+
+/* Records time of a step that overlaps a phase, without moving the mark */
+void voice_trace_add(struct audio_device *adev, int phase, uint32_t us)
+{
+    struct call_setup_trace *trace = &adev->voice.setup_trace;
+
+    if (!trace->cur || phase < 0 || phase >= CALL_SETUP_PHASE_COUNT)
+        return;
+    trace->cur->phase_us[phase] += us;
+}
+
+void voice_trace_end(struct audio_device *adev, snd_device_t out_snd_device,
+                     int status)
+{
+    struct call_setup_trace *trace = &adev->voice.setup_trace;
+    struct call_setup_record *rec = trace->cur;
+
+    if (!rec)
+        return;
+    rec->total_us = (voice_trace_now_ns() - rec->start_ns) / 1000;
+    rec->status = status;
+    rec->out_snd_device = out_snd_device;
+    trace->cur = NULL;
+    trace->count++;
+
+    ALOGD("%s: %s setup of usecase %d took %u us (status %d)", __func__,
+          rec->type == CALL_SETUP_TYPE_HFP ? "HFP" : "voice",
+          rec->usecase, rec->total_us, status);
+}
+
+void voice_trace_dump(struct audio_device *adev, int fd)
+{
+    const struct call_setup_trace *trace = &adev->voice.setup_trace;
+    const uint32_t n = trace->count < CALL_SETUP_TRACE_ENTRIES ?
+            trace->count : CALL_SETUP_TRACE_ENTRIES;
+    const uint8_t *p;
+    size_t i, len;
+    uint32_t r;
+    int ph;
+
+    dprintf(fd, "  Call setups: %u\n", trace->count);
+    if (n == 0)
+        return;
+
+    /* Oldest first */
+    for (r = trace->count - n; r != trace->count; r++) {
+        const struct call_setup_record *rec =
+                &trace->records[r % CALL_SETUP_TRACE_ENTRIES];
+
+        dprintf(fd, "    #%u %s usecase %d device %u status %d: total %u us",
+                r, rec->type == CALL_SETUP_TYPE_HFP ? "hfp" : "voice",
+                rec->usecase, rec->out_snd_device, rec->status, rec->total_us);
+        if (rec->mode_to_start_us)
+            dprintf(fd, ", %u us after set_mode", rec->mode_to_start_us);
+        dprintf(fd, "\n     ");
+        for (ph = 0; ph < CALL_SETUP_PHASE_COUNT; ph++) {
+            if (rec->phase_us[ph])
+                dprintf(fd, " %s=%u", call_setup_phase_names[ph], rec->phase_us[ph]);
+        }
+        dprintf(fd, "\n");
+    }
+
+    /* Raw ring for offline tools: magic, record size, count, then the records */
+    dprintf(fd, "    Binary (hex):");
+    p = (const uint8_t *)trace;
+    len = 3 * sizeof(uint32_t);
+    for (i = 0; i < len; i++)
+        dprintf(fd, "%s%02x", i % 32 ? "" : "\n      ", p[i]);
+    p = (const uint8_t *)trace->records;
+    len = sizeof(trace->records);
+    for (i = 0; i < len; i++)
+        dprintf(fd, "%s%02x", i % 32 ? "" : "\n      ", p[i]);
+    dprintf(fd, "\n");
+}
+
+/*
+ * All voice sessions follow the call output, so they resolve to the same sound
+ * devices. Only the first session goes through select_devices(), which does
+ * the in-call device switch sequence and moves usecases sharing the backends.
+ * The other sessions are then aligned to its devices in the same pass and the
+ * amplifier is updated once, instead of re-running the full switch per VSID.
+ */
 void voice_update_devices_for_all_voice_usecases(struct audio_device *adev)
 {
     struct listnode *node;
     struct audio_usecase *usecase;
+    struct audio_usecase *lead = NULL;
+    int num_aligned = 0;
 
     list_for_each(node, &adev->usecase_list) {
         usecase = node_to_item(node, struct audio_usecase, list);
         if (usecase->type == VOICE_CALL) {
-            ALOGV("%s: updating device for usecase:%s", __func__,
-                  use_case_table[usecase->id]);
             usecase->stream.out = adev->current_call_output;
-            select_devices(adev, usecase->id);
-            audio_extn_tfa_98xx_update();
+            if (lead == NULL)
+                lead = usecase;
         }
     }
-}
+    if (lead == NULL)
+        return;
 
+    ALOGV("%s: updating device for usecase:%s", __func__,
+          use_case_table[lead->id]);
+    select_devices(adev, lead->id);
 
+    list_for_each(node, &adev->usecase_list) {
+        usecase = node_to_item(node, struct audio_usecase, list);
+        if (usecase->type != VOICE_CALL || usecase == lead)
+            continue;
+
+        usecase->devices = lead->devices;
+        if (usecase->out_snd_device == lead->out_snd_device &&
+            usecase->in_snd_device == lead->in_snd_device)
+            continue;
+
+        ALOGV("%s: aligning usecase:%s to devices of %s", __func__,
+              use_case_table[usecase->id], use_case_table[lead->id]);
+        disable_audio_route(adev, usecase);
+        if (usecase->out_snd_device != SND_DEVICE_NONE)
+            disable_snd_device(adev, usecase->out_snd_device);
+        if (usecase->in_snd_device != SND_DEVICE_NONE)
+            disable_snd_device(adev, usecase->in_snd_device);
+
+        if (lead->out_snd_device != SND_DEVICE_NONE)
+            enable_snd_device(adev, lead->out_snd_device);
+        if (lead->in_snd_device != SND_DEVICE_NONE)
+            enable_snd_device(adev, lead->in_snd_device);
+        usecase->out_snd_device = lead->out_snd_device;
+        usecase->in_snd_device = lead->in_snd_device;
+        enable_audio_route(adev, usecase);
+        num_aligned++;
+    }
+
+    audio_extn_tfa_98xx_update();
+    ALOGV("%s: %d other voice usecases aligned", __func__, num_aligned);
+}
@@ -54,6 +54,56 @@ struct voice_session {
     uint32_t vsid;
 };
 
+/*
+ * Phases of a voice or HFP call setup timed by the call setup tracer.
+ * PCMs are opened as one concurrent batch: CALL_SETUP_PCM_OPEN is the wall
+ * time of the batch, the per-PCM entries overlap it.
+ */
+enum {
+    CALL_SETUP_SELECT_DEVICES,
+    CALL_SETUP_PCM_OPEN,
+    CALL_SETUP_PCM_OPEN_TX,      /* voice TX or HFP SCO TX */
+    CALL_SETUP_PCM_OPEN_RX,      /* voice RX or HFP SCO RX */
+    CALL_SETUP_PCM_OPEN_HOST_TX, /* HFP PCM TX */
+    CALL_SETUP_PCM_OPEN_HOST_RX, /* HFP PCM RX */
+    CALL_SETUP_PCM_START,
+    CALL_SETUP_AMP,
+    CALL_SETUP_SIDETONE,
+    CALL_SETUP_VOLUME,
+    CALL_SETUP_CALL_START,       /* platform_start_voice_call (CSD/CVD) */
+    CALL_SETUP_PHASE_COUNT,
+};
+
+enum {
+    CALL_SETUP_TYPE_VOICE,
+    CALL_SETUP_TYPE_HFP,
+};
+
+#define CALL_SETUP_TRACE_ENTRIES 8
+#define CALL_SETUP_TRACE_MAGIC   0x43535432 /* "CST2" */
+
+/* Fixed layout record, dumped as is in the binary ring */
+struct call_setup_record {
+    int64_t start_ns;            /* CLOCK_MONOTONIC at voice_start_usecase/start_hfp */
+    uint32_t mode_to_start_us;   /* since adev_set_mode(IN_CALL), 0 if unknown */
+    uint32_t total_us;
+    uint32_t phase_us[CALL_SETUP_PHASE_COUNT];
+    int32_t usecase;
+    int32_t status;
+    uint16_t type;
+    uint16_t out_snd_device;
+};
+
+struct call_setup_trace {
+    uint32_t magic;
+    uint32_t record_size;
+    uint32_t count;              /* total setups traced, head is count % ENTRIES */
+    int64_t mode_ns;             /* last transition to AUDIO_MODE_IN_CALL */
+    int64_t mark_ns;
+    struct call_setup_record *cur;
+    struct call_setup_record records[CALL_SETUP_TRACE_ENTRIES];
+};
+
 struct voice {
     struct voice_session session[MAX_VOICE_SESSIONS];
     int tty_mode;
@@ -61,6 +111,7 @@ struct voice {
     bool mic_mute;
     float volume;
     bool in_call;
+    struct call_setup_trace setup_trace;
 };
 
 enum {
@@ -97,4 +148,14 @@ void voice_set_sidetone(struct audio_device *adev,
 bool voice_is_call_state_active(struct audio_device *adev);
 void voice_set_device_mute_flag (struct audio_device *adev, bool state);
 
+/* Call setup tracer, all called with adev->lock held */
+void voice_trace_set_mode(struct audio_device *adev, audio_mode_t mode);
+void voice_trace_begin(struct audio_device *adev, int type,
+                       audio_usecase_t usecase_id);
+void voice_trace_phase(struct audio_device *adev, int phase);
+void voice_trace_add(struct audio_device *adev, int phase, uint32_t us);
+void voice_trace_end(struct audio_device *adev, snd_device_t out_snd_device,
+                     int status);
+void voice_trace_dump(struct audio_device *adev, int fd);
+
 #endif //VOICE_H
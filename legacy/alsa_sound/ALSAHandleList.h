@@ -0,0 +1,148 @@
+/* ALSAHandleList.h
+ **
+ ** Copyright (C) 2026 The LineageOS Project
+ **
+ ** Licensed under the Apache License, Version 2.0 (the "License");
+ ** you may not use this file except in compliance with the License.
+ ** You may obtain a copy of the License at
+ **
+ **     http://www.apache.org/licenses/LICENSE-2.0
+ **
+ ** Unless required by applicable law or agreed to in writing, software
+ ** distributed under the License is distributed on an "AS IS" BASIS,
+ ** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ ** See the License for the specific language governing permissions and
+ ** limitations under the License.
+ */
+
+// Included by AudioHardwareALSA.h once alsa_handle_t is defined, and by
+// the host test with a reduced alsa_handle_t.
+
+#ifndef ANDROID_ALSA_HANDLE_LIST_H
+#define ANDROID_ALSA_HANDLE_LIST_H
+
+// Use case classes routing looks up directly, a verb and its modifier
+// fall into the same class.
+enum {
+    HANDLE_CLASS_NONE = -1,
+    HANDLE_CLASS_VOICE,
+    HANDLE_CLASS_VOLTE,
+    HANDLE_CLASS_LPA,
+    HANDLE_CLASS_FM,
+    HANDLE_CLASS_VOIP,
+    HANDLE_CLASS_COUNT
+};
+
+static inline int handleClass(int useCaseId)
+{
+    switch (useCaseId) {
+    case SND_UCM_ID_VERB_VOICECALL:
+    case SND_UCM_ID_MOD_PLAY_VOICE:
+        return HANDLE_CLASS_VOICE;
+    case SND_UCM_ID_VERB_VOLTE:
+    case SND_UCM_ID_MOD_PLAY_VOLTE:
+        return HANDLE_CLASS_VOLTE;
+    case SND_UCM_ID_VERB_HIFI_LOW_POWER:
+    case SND_UCM_ID_MOD_PLAY_LPA:
+        return HANDLE_CLASS_LPA;
+    case SND_UCM_ID_VERB_DIGITAL_RADIO:
+    case SND_UCM_ID_MOD_PLAY_FM:
+        return HANDLE_CLASS_FM;
+    case SND_UCM_ID_VERB_IP_VOICECALL:
+    case SND_UCM_ID_MOD_PLAY_VOIP:
+        return HANDLE_CLASS_VOIP;
+    default:
+        return HANDLE_CLASS_NONE;
+    }
+}
+
+/*
+ * The open handles, oldest first. Next to the list it remembers the
+ * oldest handle of each use case class, so routing finds the voice,
+ * LPA, FM and VoIP handles without walking the list and comparing
+ * names. List nodes never move, the pointers stay valid until the
+ * handle is erased. A stream may switch between the verb and the
+ * modifier of its class while it is listed, find() copes with a handle
+ * that left its class since it was added.
+ */
+class ALSAHandleList : public List < alsa_handle_t >
+{
+public:
+    ALSAHandleList()
+    {
+        memset(mClass, 0, sizeof(mClass));
+    }
+
+    void push_back(const alsa_handle_t &handle)
+    {
+        List < alsa_handle_t >::push_back(handle);
+        alsa_handle_t *added = last();
+        int cls = handleClass(added->useCaseId);
+        if (cls != HANDLE_CLASS_NONE && find(cls) == NULL)
+            mClass[cls] = added;
+    }
+
+    iterator erase(iterator pos)
+    {
+        alsa_handle_t *handle = &(*pos);
+        iterator next = List < alsa_handle_t >::erase(pos);
+        for (int cls = 0; cls < HANDLE_CLASS_COUNT; cls++) {
+            if (mClass[cls] == handle)
+                mClass[cls] = scan(cls);
+        }
+        return next;
+    }
+
+    // erases the node holding handle, returns false if it is not listed
+    bool erase(alsa_handle_t *handle)
+    {
+        for (iterator it = begin(); it != end(); ++it) {
+            if (&(*it) == handle) {
+                erase(it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void clear()
+    {
+        List < alsa_handle_t >::clear();
+        memset(mClass, 0, sizeof(mClass));
+    }
+
+    // oldest handle of a use case class, the one the list walks used to
+    // stop at. NULL when none is open or cls is not a class.
+    alsa_handle_t *find(int cls)
+    {
+        if (cls < 0 || cls >= HANDLE_CLASS_COUNT)
+            return NULL;
+        alsa_handle_t *handle = mClass[cls];
+        if (handle && handleClass(handle->useCaseId) != cls)
+            mClass[cls] = handle = scan(cls);
+        return handle;
+    }
+
+    // newest handle, NULL when the list is empty
+    alsa_handle_t *last()
+    {
+        if (empty())
+            return NULL;
+        iterator it = end();
+        return &(*--it);
+    }
+
+private:
+    alsa_handle_t *mClass[HANDLE_CLASS_COUNT];
+
+    alsa_handle_t *scan(int cls)
+    {
+        for (iterator it = begin(); it != end(); ++it) {
+            if (handleClass(it->useCaseId) == cls)
+                return &(*it);
+        }
+        return NULL;
+    }
+};
+
+#endif // ANDROID_ALSA_HANDLE_LIST_H
@@ -0,0 +1,170 @@
+/* ALSAPeriodWriter.cpp
+
+Copyright (C) 2026 The LineageOS Project
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The LineageOS Project nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
+
+#define LOG_TAG "ALSAPeriodWriter"
+//#define LOG_NDEBUG 0
+#include <utils/Log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ALSAPeriodWriter.h"
+
+extern "C" {
+   #include <sound/asound.h>
+   #include "alsa_audio.h"
+}
+
+namespace android_audio_legacy
+{
+using android::NO_ERROR;
+
+ALSAPeriodWriter::ALSAPeriodWriter() :
+    mFrames(0),
+    mStaging(NULL),
+    mStagingSize(0),
+    mStagingBytes(0),
+    mWriteCount(0),
+    mPcmWriteCount(0),
+    mMaxPcmWrites(0)
+{
+}
+
+ALSAPeriodWriter::~ALSAPeriodWriter()
+{
+    free(mStaging);
+}
+
+bool ALSAPeriodWriter::reserve(size_t size)
+{
+    char *staging = (char *)realloc(mStaging, size);
+
+    if (staging == NULL) {
+        ALOGE("write:: cannot allocate %zu byte staging buffer", size);
+        return false;
+    }
+    mStaging = staging;
+    mStagingSize = size;
+    mStagingBytes = 0;
+    return true;
+}
+
+void ALSAPeriodWriter::reset()
+{
+    // less than a period of tail, not worth a padded write before closing
+    mStagingBytes = 0;
+    mFrames = 0;
+}
+
+ssize_t ALSAPeriodWriter::write(Sink *sink, const void *buffer, size_t bytes,
+                                size_t frameSize, bool packets)
+{
+    size_t period_size = sink->writePeriodSize();
+    size_t sent = 0;
+    uint32_t calls = 0;
+    struct pcm *pcm;
+    int n;
+
+    if (!period_size ||
+        (!packets && mStagingSize < period_size && !reserve(period_size)))
+        return bytes;
+
+    while ((pcm = sink->writePcm()) != NULL && sent < bytes) {
+        char *data;
+        size_t chunk;
+
+        if (packets) {
+            // every period is one codec packet, keep them apart
+            data = (char *)buffer + sent;
+            chunk = period_size;
+            if (chunk > bytes - sent)
+                chunk = bytes - sent;
+        } else if (mStagingBytes || bytes - sent < period_size) {
+            // complete the period started by an earlier write, or keep
+            // a tail shorter than a period for the next one
+            size_t copy = period_size - mStagingBytes;
+            if (copy > bytes - sent)
+                copy = bytes - sent;
+            memcpy(mStaging + mStagingBytes, (char *)buffer + sent, copy);
+            mStagingBytes += copy;
+            sent += copy;
+            if (mStagingBytes < period_size)
+                break;
+            data = mStaging;
+            chunk = period_size;
+        } else {
+            // all whole periods left in one WRITEI_FRAMES
+            data = (char *)buffer + sent;
+            chunk = ((bytes - sent) / period_size) * period_size;
+        }
+
+        n = pcm_write(pcm, data, chunk);
+        calls++;
+        if (n < 0) {
+            if (sink->recover(n) != NO_ERROR)
+                return bytes;
+            if (sink->writePeriodSize() != period_size) {
+                period_size = sink->writePeriodSize();
+                mStagingBytes = 0;
+                if (!period_size ||
+                    (!packets && mStagingSize < period_size && !reserve(period_size)))
+                    return bytes;
+            }
+            continue;
+        }
+
+        if (data == mStaging)
+            mStagingBytes = 0;
+        else
+            sent += chunk;
+        if (frameSize)
+            mFrames += chunk / frameSize;
+    }
+
+    mWriteCount++;
+    mPcmWriteCount += calls;
+    if (calls > mMaxPcmWrites)
+        mMaxPcmWrites = calls;
+
+    // nothing to write to, drop the buffer like a failed open does
+    if (!sent)
+        return bytes;
+    return sent < bytes ? sent : bytes;
+}
+
+void ALSAPeriodWriter::dump(int fd) const
+{
+    dprintf(fd, "  writes %u, pcm_write calls %u (%.2f per write, max %u)\n",
+            mWriteCount, mPcmWriteCount,
+            mWriteCount ? (float)mPcmWriteCount / mWriteCount : 0.0f, mMaxPcmWrites);
+    dprintf(fd, "  staged %zu of %zu bytes\n", mStagingBytes, mStagingSize);
+}
+
+};        // namespace android_audio_legacy
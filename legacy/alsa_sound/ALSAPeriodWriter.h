@@ -0,0 +1,97 @@
+/* ALSAPeriodWriter.h
+
+Copyright (C) 2026 The LineageOS Project
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The LineageOS Project nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
+
+#ifndef ANDROID_ALSA_PERIOD_WRITER_H
+#define ANDROID_ALSA_PERIOD_WRITER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <utils/Errors.h>
+
+struct pcm;
+
+namespace android_audio_legacy
+{
+using android::status_t;
+
+/*
+ * Turns the buffers of an output stream into whole-period pcm_write()
+ * calls. A tail shorter than a period is staged and completed by the
+ * next write instead of going out as a short write. Packet streams
+ * (VoIP) send every period on its own and stage nothing.
+ */
+class ALSAPeriodWriter
+{
+public:
+    // the device end of the stream
+    class Sink
+    {
+    public:
+        virtual struct pcm *writePcm() = 0;     // NULL when closed
+        virtual size_t      writePeriodSize() = 0;
+        // reopen after pcm_write() failed, the period size may change
+        virtual status_t    recover(int err) = 0;
+
+    protected:
+        virtual             ~Sink() {}
+    };
+
+                        ALSAPeriodWriter();
+                        ~ALSAPeriodWriter();
+
+    bool                reserve(size_t size);
+    // drops the staged tail and the frame count, on standby
+    void                reset();
+
+    // returns how much of bytes was consumed, the staged tail included
+    ssize_t             write(Sink *sink, const void *buffer, size_t bytes,
+                              size_t frameSize, bool packets);
+
+    uint32_t            frames() const { return mFrames; }
+    void                dump(int fd) const;
+
+private:
+    friend class ALSAPeriodWriterTest;
+
+    uint32_t            mFrames;
+
+    // tail of a write that did not fill a period, sent with the next one
+    char               *mStaging;
+    size_t              mStagingSize;
+    size_t              mStagingBytes;
+
+    // write() calls and the pcm_write() calls they took
+    uint32_t            mWriteCount;
+    uint32_t            mPcmWriteCount;
+    uint32_t            mMaxPcmWrites;
+};
+
+};        // namespace android_audio_legacy
+
+#endif    // ANDROID_ALSA_PERIOD_WRITER_H
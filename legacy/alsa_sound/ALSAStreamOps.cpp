@@ -55,8 +55,8 @@ ALSAStreamOps::~ALSAStreamOps()
 {
     Mutex::Autolock autoLock(mParent->mLock);
 
-    if((!strcmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) ||
-       (!strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP))) {
+    if((mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+       (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP)) {
         if((mParent->mVoipStreamCount)) {
             mParent->mVoipStreamCount--;
             if(mParent->mVoipStreamCount > 0) {
@@ -249,8 +249,8 @@ String8 ALSAStreamOps::getParameters(const String8& keys)
 #ifdef QCOM_VOIP_ENABLED
         key = String8(AudioParameter::keyVoipCheck);
         if (param.get(key, value) == NO_ERROR) {
-            if((!strncmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL, strlen(SND_USE_CASE_VERB_IP_VOICECALL))) ||
-               (!strncmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP, strlen(SND_USE_CASE_MOD_PLAY_VOIP))))
+            if((mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+               (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP))
                 param.addInt(key, true);
             else
                 param.addInt(key, false);
@@ -348,8 +348,8 @@ uint32_t ALSAStreamOps::channels() const
 void ALSAStreamOps::close()
 {
     ALOGD("close");
-    if((!strncmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL, strlen(SND_USE_CASE_VERB_IP_VOICECALL))) ||
-       (!strncmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP, strlen(SND_USE_CASE_MOD_PLAY_VOIP)))) {
+    if((mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+       (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP)) {
        mParent->mVoipBitRate = 0;
        mParent->mVoipStreamCount = 0;
     }
@@ -26,9 +26,12 @@ LOCAL_SRC_FILES := \
   AudioHardwareALSA.cpp 	\
   AudioStreamOutALSA.cpp 	\
   AudioStreamInALSA.cpp 	\
+  AudioSurroundPipeline.cpp \
   ALSAStreamOps.cpp		\
+  ALSAPeriodWriter.cpp \
   audio_hw_hal.cpp \
   AudioUsbALSA.cpp \
+  AudioUsbBridge.cpp \
   AudioUtil.cpp
 
 LOCAL_STATIC_LIBRARIES := \
@@ -138,4 +141,6 @@ LOCAL_NOTICE_FILE:= $(LOCAL_PATH)/NOTICE
 LOCAL_MODULE_TAGS := optional
 
   include $(BUILD_SHARED_LIBRARY)
+
+include $(LOCAL_PATH)/tests/Android.mk
 endif
@@ -216,8 +216,8 @@ AudioHardwareALSA::~AudioHardwareALSA()
     for(ALSAHandleList::iterator it = mDeviceList.begin();
             it != mDeviceList.end(); ++it) {
         it->useCase[0] = 0;
-        mDeviceList.erase(it);
     }
+    mDeviceList.clear();
 #ifdef QCOM_ACDB_ENABLED
      if (acdb_deallocate == NULL) {
         ALOGE("dlsym: Error:%s Loading acdb_deallocate_ACDB", dlerror());
@@ -637,9 +637,8 @@ void AudioHardwareALSA::doRouting(int device)
                 //USB unplugged
                 device &= ~ AudioSystem::DEVICE_OUT_PROXY;
                 device &= ~ AudioSystem::DEVICE_IN_PROXY;
-                ALSAHandleList::iterator it = mDeviceList.end();
-                it--;
-                mALSADevice->route(&(*it), (uint32_t)device, newMode);
+                if (mDeviceList.last())
+                    mALSADevice->route(mDeviceList.last(), (uint32_t)device, newMode);
                 ALOGD("USB UNPLUGGED, setting musbPlaybackState to 0");
                 musbPlaybackState = 0;
                 musbRecordingState = 0;
@@ -648,39 +647,30 @@ void AudioHardwareALSA::doRouting(int device)
         } else if((device & AudioSystem::DEVICE_OUT_ANLG_DOCK_HEADSET)||
                   (device & AudioSystem::DEVICE_OUT_DGTL_DOCK_HEADSET)){
                     ALOGD("Routing everything to prox now");
-                    ALSAHandleList::iterator it = mDeviceList.end();
-                    it--;
-                    mALSADevice->route(&(*it), AudioSystem::DEVICE_OUT_PROXY,
-                                       newMode);
-                    for(it = mDeviceList.begin(); it != mDeviceList.end(); ++it) {
-                         if((!strcmp(it->useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER)) ||
-                            (!strcmp(it->useCase, SND_USE_CASE_MOD_PLAY_LPA))) {
-                                 ALOGV("doRouting: LPA device switch to proxy");
-                                 startUsbPlaybackIfNotStarted();
-                                 musbPlaybackState |= USBPLAYBACKBIT_LPA;
-                                 break;
-                         } else if((!strcmp(it->useCase, SND_USE_CASE_VERB_VOICECALL)) ||
-                                   (!strcmp(it->useCase, SND_USE_CASE_MOD_PLAY_VOICE))) {
-                                    ALOGV("doRouting: VOICE device switch to proxy");
-                                    startUsbRecordingIfNotStarted();
-                                    startUsbPlaybackIfNotStarted();
-                                    musbPlaybackState |= USBPLAYBACKBIT_VOICECALL;
-                                    musbRecordingState |= USBPLAYBACKBIT_VOICECALL;
-                                    break;
-                        }else if((!strcmp(it->useCase, SND_USE_CASE_VERB_DIGITAL_RADIO)) ||
-                                 (!strcmp(it->useCase, SND_USE_CASE_MOD_PLAY_FM))) {
-                                    ALOGV("doRouting: FM device switch to proxy");
-                                    startUsbPlaybackIfNotStarted();
-                                    musbPlaybackState |= USBPLAYBACKBIT_FM;
-                                    break;
-                         }
+                    if (mDeviceList.last())
+                        mALSADevice->route(mDeviceList.last(), AudioSystem::DEVICE_OUT_PROXY,
+                                           newMode);
+                    if (mDeviceList.find(HANDLE_CLASS_LPA)) {
+                        ALOGV("doRouting: LPA device switch to proxy");
+                        startUsbPlaybackIfNotStarted();
+                        musbPlaybackState |= USBPLAYBACKBIT_LPA;
+                    }
+                    if (mDeviceList.find(HANDLE_CLASS_VOICE)) {
+                        ALOGV("doRouting: VOICE device switch to proxy");
+                        startUsbRecordingIfNotStarted();
+                        startUsbPlaybackIfNotStarted();
+                        musbPlaybackState |= USBPLAYBACKBIT_VOICECALL;
+                        musbRecordingState |= USBPLAYBACKBIT_VOICECALL;
+                    }
+                    if (mDeviceList.find(HANDLE_CLASS_FM)) {
+                        ALOGV("doRouting: FM device switch to proxy");
+                        startUsbPlaybackIfNotStarted();
+                        musbPlaybackState |= USBPLAYBACKBIT_FM;
                     }
         } else
 #endif
-        {
-             ALSAHandleList::iterator it = mDeviceList.end();
-             it--;
-             mALSADevice->route(&(*it), (uint32_t)device, newMode);
+        if (mDeviceList.last()) {
+             mALSADevice->route(mDeviceList.last(), (uint32_t)device, newMode);
         }
     }
     mCurDevice = device;
@@ -746,14 +736,10 @@ AudioHardwareALSA::openOutputStream(uint32_t devices,
     if((devices == AudioSystem::DEVICE_OUT_DIRECTOUTPUT) &&
        ((*sampleRate == VOIP_SAMPLING_RATE_8K) || (*sampleRate == VOIP_SAMPLING_RATE_16K))) {
         bool voipstream_active = false;
-        for(it = mDeviceList.begin();
-            it != mDeviceList.end(); ++it) {
-                if((!strcmp(it->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) ||
-                   (!strcmp(it->useCase, SND_USE_CASE_MOD_PLAY_VOIP))) {
-                    ALOGD("openOutput:  it->rxHandle %d it->handle %d",it->rxHandle,it->handle);
-                    voipstream_active = true;
-                    break;
-                }
+        alsa_handle_t *voip = mDeviceList.find(HANDLE_CLASS_VOIP);
+        if (voip) {
+            ALOGD("openOutput:  voip->rxHandle %d voip->handle %d",voip->rxHandle,voip->handle);
+            voipstream_active = true;
         }
       if(voipstream_active == false) {
          mVoipStreamCount = 0;
@@ -788,14 +774,15 @@ AudioHardwareALSA::openOutputStream(uint32_t devices,
           char *use_case;
           snd_use_case_get(mUcMgr, "_verb", (const char **)&use_case);
           if ((use_case == NULL) || (!strcmp(use_case, SND_USE_CASE_VERB_INACTIVE))) {
-              strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_IP_VOICECALL, sizeof(alsa_handle.useCase));
+              setUseCase(&alsa_handle, SND_USE_CASE_VERB_IP_VOICECALL);
           } else {
-              strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_PLAY_VOIP, sizeof(alsa_handle.useCase));
+              setUseCase(&alsa_handle, SND_USE_CASE_MOD_PLAY_VOIP);
           }
           free(use_case);
           mDeviceList.push_back(alsa_handle);
           it = mDeviceList.end();
           it--;
+          voip = &(*it);
           ALOGV("openoutput: mALSADevice->route useCase %s mCurDevice %d mVoipStreamCount %d mode %d", it->useCase,mCurDevice,mVoipStreamCount, mode());
           if((mCurDevice & AudioSystem::DEVICE_OUT_ANLG_DOCK_HEADSET)||
              (mCurDevice & AudioSystem::DEVICE_OUT_DGTL_DOCK_HEADSET)||
@@ -813,10 +800,10 @@ AudioHardwareALSA::openOutputStream(uint32_t devices,
           } else{
               mALSADevice->route(&(*it), mCurDevice, AudioSystem::MODE_IN_COMMUNICATION);
           }
-          if(!strcmp(it->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) {
-              snd_use_case_set(mUcMgr, "_verb", SND_USE_CASE_VERB_IP_VOICECALL);
+          if(it->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) {
+              snd_use_case_set_id(mUcMgr, SND_UCM_SET_VERB, SND_UCM_ID_VERB_IP_VOICECALL);
           } else {
-              snd_use_case_set(mUcMgr, "_enamod", SND_USE_CASE_MOD_PLAY_VOIP);
+              snd_use_case_set_id(mUcMgr, SND_UCM_SET_ENAMOD, SND_UCM_ID_MOD_PLAY_VOIP);
           }
           err = mALSADevice->startVoipCall(&(*it));
           if (err) {
@@ -824,7 +811,7 @@ AudioHardwareALSA::openOutputStream(uint32_t devices,
               return NULL;
           }
       }
-      out = new AudioStreamOutALSA(this, &(*it));
+      out = new AudioStreamOutALSA(this, voip);
       err = out->set(format, channels, sampleRate, devices);
       if(err == NO_ERROR) {
           mVoipStreamCount++;   //increment VoipstreamCount only if success
@@ -879,9 +866,9 @@ AudioHardwareALSA::openOutputStream(uint32_t devices,
         char *use_case;
         snd_use_case_get(mUcMgr, "_verb", (const char **)&use_case);
         if ((use_case == NULL) || (!strcmp(use_case, SND_USE_CASE_VERB_INACTIVE))) {
-            strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_HIFI2 , sizeof(alsa_handle.useCase));
+            setUseCase(&alsa_handle, SND_USE_CASE_VERB_HIFI2);
         } else {
-            strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_PLAY_MUSIC2, sizeof(alsa_handle.useCase));
+            setUseCase(&alsa_handle, SND_USE_CASE_MOD_PLAY_MUSIC2);
         }
         free(use_case);
         mDeviceList.push_back(alsa_handle);
@@ -889,10 +876,10 @@ AudioHardwareALSA::openOutputStream(uint32_t devices,
         it--;
         ALOGD("it->useCase %s", it->useCase);
         mALSADevice->route(&(*it), devices, mode());
-        if(!strcmp(it->useCase, SND_USE_CASE_VERB_HIFI2)) {
-            snd_use_case_set(mUcMgr, "_verb", SND_USE_CASE_VERB_HIFI2 );
+        if(it->useCaseId == SND_UCM_ID_VERB_HIFI2) {
+            snd_use_case_set_id(mUcMgr, SND_UCM_SET_VERB, SND_UCM_ID_VERB_HIFI2);
         } else {
-            snd_use_case_set(mUcMgr, "_enamod", SND_USE_CASE_MOD_PLAY_MUSIC2);
+            snd_use_case_set_id(mUcMgr, SND_UCM_SET_ENAMOD, SND_UCM_ID_MOD_PLAY_MUSIC2);
         }
         ALOGD("channels: %d", AudioSystem::popCount(*channels));
         err = mALSADevice->open(&(*it));
@@ -933,18 +920,18 @@ AudioHardwareALSA::openOutputStream(uint32_t devices,
       ALOGD("openOutputStream: DeepBuffer Output");
           alsa_handle.isDeepbufferOutput = true;
           if ((use_case == NULL) || (!strcmp(use_case, SND_USE_CASE_VERB_INACTIVE))) {
-               strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_HIFI, sizeof(alsa_handle.useCase));
+               setUseCase(&alsa_handle, SND_USE_CASE_VERB_HIFI);
           } else {
-               strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_PLAY_MUSIC, sizeof(alsa_handle.useCase));
+               setUseCase(&alsa_handle, SND_USE_CASE_MOD_PLAY_MUSIC);
           }
       } else {
       ALOGD("openOutputStream: Lowlatency Output");
           alsa_handle.bufferSize = PLAYBACK_LOW_LATENCY_BUFFER_SIZE;
           alsa_handle.latency = PLAYBACK_LOW_LATENCY_MEASURED;
           if ((use_case == NULL) || (!strcmp(use_case, SND_USE_CASE_VERB_INACTIVE))) {
-               strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC, sizeof(alsa_handle.useCase));
+               setUseCase(&alsa_handle, SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC);
           } else {
-               strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC, sizeof(alsa_handle.useCase));
+               setUseCase(&alsa_handle, SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC);
           }
       }
       free(use_case);
@@ -961,16 +948,16 @@ AudioHardwareALSA::openOutputStream(uint32_t devices,
 #endif
       mALSADevice->route(&(*it), devices, mode());
       if (flag & AUDIO_OUTPUT_FLAG_DEEP_BUFFER) {
-          if(!strcmp(it->useCase, SND_USE_CASE_VERB_HIFI)) {
-             snd_use_case_set(mUcMgr, "_verb", SND_USE_CASE_VERB_HIFI);
+          if(it->useCaseId == SND_UCM_ID_VERB_HIFI) {
+             snd_use_case_set_id(mUcMgr, SND_UCM_SET_VERB, SND_UCM_ID_VERB_HIFI);
           } else {
-             snd_use_case_set(mUcMgr, "_enamod", SND_USE_CASE_MOD_PLAY_MUSIC);
+             snd_use_case_set_id(mUcMgr, SND_UCM_SET_ENAMOD, SND_UCM_ID_MOD_PLAY_MUSIC);
           }
       } else {
-          if(!strcmp(it->useCase, SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC)) {
-             snd_use_case_set(mUcMgr, "_verb", SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC);
+          if(it->useCaseId == SND_UCM_ID_VERB_HIFI_LOWLATENCY_MUSIC) {
+             snd_use_case_set_id(mUcMgr, SND_UCM_SET_VERB, SND_UCM_ID_VERB_HIFI_LOWLATENCY_MUSIC);
           } else {
-             snd_use_case_set(mUcMgr, "_enamod", SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC);
+             snd_use_case_set_id(mUcMgr, SND_UCM_SET_ENAMOD, SND_UCM_ID_MOD_PLAY_LOWLATENCY_MUSIC);
           }
       }
       err = mALSADevice->open(&(*it));
@@ -1028,16 +1015,16 @@ AudioHardwareALSA::openOutputSession(uint32_t devices,
     if(sessionId == TUNNEL_SESSION_ID) {
         snd_use_case_get(mUcMgr, "_verb", (const char **)&use_case);
         if ((use_case == NULL) || (!strcmp(use_case, SND_USE_CASE_VERB_INACTIVE))) {
-            strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_HIFI_TUNNEL, sizeof(alsa_handle.useCase));
+            setUseCase(&alsa_handle, SND_USE_CASE_VERB_HIFI_TUNNEL);
         } else {
-            strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_PLAY_TUNNEL, sizeof(alsa_handle.useCase));
+            setUseCase(&alsa_handle, SND_USE_CASE_MOD_PLAY_TUNNEL);
         }
     } else {
         snd_use_case_get(mUcMgr, "_verb", (const char **)&use_case);
         if ((use_case == NULL) || (!strcmp(use_case, SND_USE_CASE_VERB_INACTIVE))) {
-            strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER, sizeof(alsa_handle.useCase));
+            setUseCase(&alsa_handle, SND_USE_CASE_VERB_HIFI_LOW_POWER);
         } else {
-            strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_PLAY_LPA, sizeof(alsa_handle.useCase));
+            setUseCase(&alsa_handle, SND_USE_CASE_MOD_PLAY_LPA);
         }
     }
     free(use_case);
@@ -1061,17 +1048,17 @@ AudioHardwareALSA::openOutputSession(uint32_t devices,
         mALSADevice->route(&(*it), devices, mode());
     }
     if(sessionId == TUNNEL_SESSION_ID) {
-        if(!strcmp(it->useCase, SND_USE_CASE_VERB_HIFI_TUNNEL)) {
-            snd_use_case_set(mUcMgr, "_verb", SND_USE_CASE_VERB_HIFI_TUNNEL);
+        if(it->useCaseId == SND_UCM_ID_VERB_HIFI_TUNNEL) {
+            snd_use_case_set_id(mUcMgr, SND_UCM_SET_VERB, SND_UCM_ID_VERB_HIFI_TUNNEL);
         } else {
-            snd_use_case_set(mUcMgr, "_enamod", SND_USE_CASE_MOD_PLAY_TUNNEL);
+            snd_use_case_set_id(mUcMgr, SND_UCM_SET_ENAMOD, SND_UCM_ID_MOD_PLAY_TUNNEL);
         }
     }
     else {
-        if(!strcmp(it->useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER)) {
-            snd_use_case_set(mUcMgr, "_verb", SND_USE_CASE_VERB_HIFI_LOW_POWER);
+        if(it->useCaseId == SND_UCM_ID_VERB_HIFI_LOW_POWER) {
+            snd_use_case_set_id(mUcMgr, SND_UCM_SET_VERB, SND_UCM_ID_VERB_HIFI_LOW_POWER);
         } else {
-            snd_use_case_set(mUcMgr, "_enamod", SND_USE_CASE_MOD_PLAY_LPA);
+            snd_use_case_set_id(mUcMgr, SND_UCM_SET_ENAMOD, SND_UCM_ID_MOD_PLAY_LPA);
         }
     }
     err = mALSADevice->open(&(*it));
@@ -1114,14 +1101,10 @@ AudioHardwareALSA::openInputStream(uint32_t devices,
     if((devices == AudioSystem::DEVICE_IN_COMMUNICATION) &&
        ((*sampleRate == VOIP_SAMPLING_RATE_8K) || (*sampleRate == VOIP_SAMPLING_RATE_16K))) {
         bool voipstream_active = false;
-        for(it = mDeviceList.begin();
-            it != mDeviceList.end(); ++it) {
-                if((!strcmp(it->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) ||
-                   (!strcmp(it->useCase, SND_USE_CASE_MOD_PLAY_VOIP))) {
-                    ALOGD("openInput:  it->rxHandle %p it->handle %p",it->rxHandle,it->handle);
-                    voipstream_active = true;
-                    break;
-                }
+        alsa_handle_t *voip = mDeviceList.find(HANDLE_CLASS_VOIP);
+        if (voip) {
+            ALOGD("openInput:  voip->rxHandle %p voip->handle %p",voip->rxHandle,voip->handle);
+            voipstream_active = true;
         }
         if(voipstream_active == false) {
            mVoipStreamCount = 0;
@@ -1155,14 +1138,15 @@ AudioHardwareALSA::openInputStream(uint32_t devices,
           mALSADevice->setVoipConfig(getVoipMode(*format), mVoipBitRate);
            snd_use_case_get(mUcMgr, "_verb", (const char **)&use_case);
            if ((use_case != NULL) && (strcmp(use_case, SND_USE_CASE_VERB_INACTIVE))) {
-                strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_PLAY_VOIP, sizeof(alsa_handle.useCase));
+                setUseCase(&alsa_handle, SND_USE_CASE_MOD_PLAY_VOIP);
            } else {
-                strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_IP_VOICECALL, sizeof(alsa_handle.useCase));
+                setUseCase(&alsa_handle, SND_USE_CASE_VERB_IP_VOICECALL);
            }
            free(use_case);
            mDeviceList.push_back(alsa_handle);
            it = mDeviceList.end();
            it--;
+           voip = &(*it);
            ALOGD("mCurrDevice: %d", mCurDevice);
 #ifdef QCOM_USBAUDIO_ENABLED
            if((mCurDevice == AudioSystem::DEVICE_OUT_ANLG_DOCK_HEADSET)||
@@ -1180,10 +1164,10 @@ AudioHardwareALSA::openInputStream(uint32_t devices,
            {
                mALSADevice->route(&(*it),mCurDevice, AudioSystem::MODE_IN_COMMUNICATION);
            }
-           if(!strcmp(it->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) {
-               snd_use_case_set(mUcMgr, "_verb", SND_USE_CASE_VERB_IP_VOICECALL);
+           if(it->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) {
+               snd_use_case_set_id(mUcMgr, SND_UCM_SET_VERB, SND_UCM_ID_VERB_IP_VOICECALL);
            } else {
-               snd_use_case_set(mUcMgr, "_enamod", SND_USE_CASE_MOD_PLAY_VOIP);
+               snd_use_case_set_id(mUcMgr, SND_UCM_SET_ENAMOD, SND_UCM_ID_MOD_PLAY_VOIP);
            }
            if(sampleRate) {
                it->sampleRate = *sampleRate;
@@ -1196,7 +1180,7 @@ AudioHardwareALSA::openInputStream(uint32_t devices,
                return NULL;
            }
         }
-        in = new AudioStreamInALSA(this, &(*it), acoustics);
+        in = new AudioStreamInALSA(this, voip, acoustics);
         err = in->set(format, channels, sampleRate, devices);
         if(err == NO_ERROR) {
             mVoipStreamCount++;   //increment VoipstreamCount only if success
@@ -1230,35 +1214,31 @@ AudioHardwareALSA::openInputStream(uint32_t devices,
                     (*channels & AudioSystem::CHANNEL_IN_VOICE_DNLINK)) {
                     if (mFusion3Platform) {
                         mALSADevice->setVocRecMode(INCALL_REC_STEREO);
-                        strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_CAPTURE_VOICE,
-                                sizeof(alsa_handle.useCase));
+                        setUseCase(&alsa_handle, SND_USE_CASE_MOD_CAPTURE_VOICE);
                     } else {
-                        strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_CAPTURE_VOICE_UL_DL,
-                                sizeof(alsa_handle.useCase));
+                        setUseCase(&alsa_handle, SND_USE_CASE_MOD_CAPTURE_VOICE_UL_DL);
                     }
                 } else if (*channels & AudioSystem::CHANNEL_IN_VOICE_DNLINK) {
                     if (mFusion3Platform) {
                         mALSADevice->setVocRecMode(INCALL_REC_MONO);
-                        strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_CAPTURE_VOICE,
-                                sizeof(alsa_handle.useCase));
+                        setUseCase(&alsa_handle, SND_USE_CASE_MOD_CAPTURE_VOICE);
                     } else {
-                        strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_CAPTURE_VOICE_DL,
-                                sizeof(alsa_handle.useCase));
+                        setUseCase(&alsa_handle, SND_USE_CASE_MOD_CAPTURE_VOICE_DL);
                     }
                 }
 #ifdef QCOM_FM_ENABLED
             } else if((devices == AudioSystem::DEVICE_IN_FM_RX)) {
-                strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_CAPTURE_FM, sizeof(alsa_handle.useCase));
+                setUseCase(&alsa_handle, SND_USE_CASE_MOD_CAPTURE_FM);
             } else if(devices == AudioSystem::DEVICE_IN_FM_RX_A2DP) {
-                strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_CAPTURE_A2DP_FM, sizeof(alsa_handle.useCase));
+                setUseCase(&alsa_handle, SND_USE_CASE_MOD_CAPTURE_A2DP_FM);
 #endif
             } else {
         char value[128];
         property_get("persist.audio.lowlatency.rec",value,"0");
                 if (!strcmp("true", value)) {
-                    strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_CAPTURE_LOWLATENCY_MUSIC, sizeof(alsa_handle.useCase));
+                    setUseCase(&alsa_handle, SND_USE_CASE_MOD_CAPTURE_LOWLATENCY_MUSIC);
                 } else {
-                    strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_CAPTURE_MUSIC, sizeof(alsa_handle.useCase));
+                    setUseCase(&alsa_handle, SND_USE_CASE_MOD_CAPTURE_MUSIC);
                 }
             }
         } else {
@@ -1270,35 +1250,31 @@ AudioHardwareALSA::openInputStream(uint32_t devices,
                     (*channels & AudioSystem::CHANNEL_IN_VOICE_DNLINK)) {
                     if (mFusion3Platform) {
                         mALSADevice->setVocRecMode(INCALL_REC_STEREO);
-                        strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_INCALL_REC,
-                                sizeof(alsa_handle.useCase));
+                        setUseCase(&alsa_handle, SND_USE_CASE_VERB_INCALL_REC);
                     } else {
-                        strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_UL_DL_REC,
-                                sizeof(alsa_handle.useCase));
+                        setUseCase(&alsa_handle, SND_USE_CASE_VERB_UL_DL_REC);
                     }
                 } else if (*channels & AudioSystem::CHANNEL_IN_VOICE_DNLINK) {
                     if (mFusion3Platform) {
                         mALSADevice->setVocRecMode(INCALL_REC_MONO);
-                        strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_INCALL_REC,
-                                sizeof(alsa_handle.useCase));
+                        setUseCase(&alsa_handle, SND_USE_CASE_VERB_INCALL_REC);
                     } else {
-                       strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_DL_REC,
-                               sizeof(alsa_handle.useCase));
+                       setUseCase(&alsa_handle, SND_USE_CASE_VERB_DL_REC);
                     }
                 }
 #ifdef QCOM_FM_ENABLED
             } else if(devices == AudioSystem::DEVICE_IN_FM_RX) {
-                strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_FM_REC, sizeof(alsa_handle.useCase));
+                setUseCase(&alsa_handle, SND_USE_CASE_VERB_FM_REC);
             } else if (devices == AudioSystem::DEVICE_IN_FM_RX_A2DP) {
-                strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_FM_A2DP_REC, sizeof(alsa_handle.useCase));
+                setUseCase(&alsa_handle, SND_USE_CASE_VERB_FM_A2DP_REC);
 #endif
             } else {
                 char value[128];
                 property_get("persist.audio.lowlatency.rec",value,"0");
                 if (!strcmp("true", value)) {
-                    strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_HIFI_LOWLATENCY_REC, sizeof(alsa_handle.useCase));
+                    setUseCase(&alsa_handle, SND_USE_CASE_VERB_HIFI_LOWLATENCY_REC);
                 } else {
-                    strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_HIFI_REC, sizeof(alsa_handle.useCase));
+                    setUseCase(&alsa_handle, SND_USE_CASE_VERB_HIFI_REC);
                 }
             }
         }
@@ -1345,24 +1321,24 @@ AudioHardwareALSA::openInputStream(uint32_t devices,
                 mALSADevice->route(&(*it), devices, mode());
             }
         }
-        if(!strcmp(it->useCase, SND_USE_CASE_VERB_HIFI_REC) ||
-           !strcmp(it->useCase, SND_USE_CASE_VERB_HIFI_LOWLATENCY_REC) ||
+        if((it->useCaseId == SND_UCM_ID_VERB_HIFI_REC) ||
+           (it->useCaseId == SND_UCM_ID_VERB_HIFI_LOWLATENCY_REC) ||
 #ifdef QCOM_FM_ENABLED
-           !strcmp(it->useCase, SND_USE_CASE_VERB_FM_REC) ||
-           !strcmp(it->useCase, SND_USE_CASE_VERB_FM_A2DP_REC) ||
+           (it->useCaseId == SND_UCM_ID_VERB_FM_REC) ||
+           (it->useCaseId == SND_UCM_ID_VERB_FM_A2DP_REC) ||
 #endif
-           !strcmp(it->useCase, SND_USE_CASE_VERB_DL_REC) ||
-           !strcmp(it->useCase, SND_USE_CASE_VERB_UL_DL_REC) ||
-           !strcmp(it->useCase, SND_USE_CASE_VERB_INCALL_REC)) {
-            snd_use_case_set(mUcMgr, "_verb", it->useCase);
+           (it->useCaseId == SND_UCM_ID_VERB_DL_REC) ||
+           (it->useCaseId == SND_UCM_ID_VERB_UL_DL_REC) ||
+           (it->useCaseId == SND_UCM_ID_VERB_INCALL_REC)) {
+            snd_use_case_set_id(mUcMgr, SND_UCM_SET_VERB, it->useCaseId);
         } else {
-            snd_use_case_set(mUcMgr, "_enamod", it->useCase);
+            snd_use_case_set_id(mUcMgr, SND_UCM_SET_ENAMOD, it->useCaseId);
         }
         if(sampleRate) {
             it->sampleRate = *sampleRate;
         }
-        if (!strncmp(it->useCase, SND_USE_CASE_VERB_HIFI_REC, strlen(SND_USE_CASE_VERB_HIFI_REC))
-            || !strncmp(it->useCase, SND_USE_CASE_MOD_CAPTURE_MUSIC, strlen(SND_USE_CASE_MOD_CAPTURE_MUSIC))) {
+        if ((it->useCaseId == SND_UCM_ID_VERB_HIFI_REC)
+            || (it->useCaseId == SND_UCM_ID_MOD_CAPTURE_MUSIC)) {
             ALOGV("OpenInoutStream: Use larger buffer size for 5.1(%s) recording ", it->useCase);
             it->bufferSize = getInputBufferSize(it->sampleRate,*format,it->channels);
         }
@@ -1404,6 +1380,11 @@ status_t AudioHardwareALSA::getMicMute(bool *state)
 
 status_t AudioHardwareALSA::dump(int fd, const Vector<String16>& args)
 {
+#ifdef QCOM_USBAUDIO_ENABLED
+    if (mAudioUsbALSA != NULL) {
+        mAudioUsbALSA->dump(fd);
+    }
+#endif
     return NO_ERROR;
 }
 
@@ -1438,9 +1419,9 @@ int newMode = mode();
         ALOGV("Start FM");
         snd_use_case_get(mUcMgr, "_verb", (const char **)&use_case);
         if ((use_case == NULL) || (!strcmp(use_case, SND_USE_CASE_VERB_INACTIVE))) {
-            strlcpy(alsa_handle.useCase, SND_USE_CASE_VERB_DIGITAL_RADIO, sizeof(alsa_handle.useCase));
+            setUseCase(&alsa_handle, SND_USE_CASE_VERB_DIGITAL_RADIO);
         } else {
-            strlcpy(alsa_handle.useCase, SND_USE_CASE_MOD_PLAY_FM, sizeof(alsa_handle.useCase));
+            setUseCase(&alsa_handle, SND_USE_CASE_MOD_PLAY_FM);
         }
         free(use_case);
 
@@ -1468,10 +1449,10 @@ int newMode = mode();
             ALOGD("Routing to proxy for FM case");
         }
         mALSADevice->route(&(*it), (uint32_t)device, newMode);
-        if(!strcmp(it->useCase, SND_USE_CASE_VERB_DIGITAL_RADIO)) {
-            snd_use_case_set(mUcMgr, "_verb", SND_USE_CASE_VERB_DIGITAL_RADIO);
+        if(it->useCaseId == SND_UCM_ID_VERB_DIGITAL_RADIO) {
+            snd_use_case_set_id(mUcMgr, SND_UCM_SET_VERB, SND_UCM_ID_VERB_DIGITAL_RADIO);
         } else {
-            snd_use_case_set(mUcMgr, "_enamod", SND_USE_CASE_MOD_PLAY_FM);
+            snd_use_case_set_id(mUcMgr, SND_UCM_SET_ENAMOD, SND_UCM_ID_MOD_PLAY_FM);
         }
         mALSADevice->startFm(&(*it));
         if((device & AudioSystem::DEVICE_OUT_ANLG_DOCK_HEADSET)||
@@ -1483,15 +1464,11 @@ int newMode = mode();
     } else if (!(device & AudioSystem::DEVICE_OUT_FM) && mIsFmActive == 1) {
         //i Stop FM Radio
         ALOGV("Stop FM");
-        for(ALSAHandleList::iterator it = mDeviceList.begin();
-            it != mDeviceList.end(); ++it) {
-            if((!strcmp(it->useCase, SND_USE_CASE_VERB_DIGITAL_RADIO)) ||
-              (!strcmp(it->useCase, SND_USE_CASE_MOD_PLAY_FM))) {
-                mALSADevice->close(&(*it));
-                //mALSADevice->route(&(*it), (uint32_t)device, newMode);
-                mDeviceList.erase(it);
-                break;
-            }
+        alsa_handle_t *fm = mDeviceList.find(HANDLE_CLASS_FM);
+        if (fm) {
+            mALSADevice->close(fm);
+            //mALSADevice->route(fm, (uint32_t)device, newMode);
+            mDeviceList.erase(fm);
         }
         mIsFmActive = 0;
         musbPlaybackState &= ~USBPLAYBACKBIT_FM;
@@ -1505,16 +1482,13 @@ int newMode = mode();
 
 void AudioHardwareALSA::disableVoiceCall(char* verb, char* modifier, int mode, int device)
 {
-    for(ALSAHandleList::iterator it = mDeviceList.begin();
-         it != mDeviceList.end(); ++it) {
-        if((!strcmp(it->useCase, verb)) ||
-           (!strcmp(it->useCase, modifier))) {
-            ALOGV("Disabling voice call");
-            mALSADevice->close(&(*it));
-            mALSADevice->route(&(*it), (uint32_t)device, mode);
-            mDeviceList.erase(it);
-            break;
-        }
+    alsa_handle_t *handle = mDeviceList.find(handleClass(snd_use_case_get_id(NULL, verb)));
+
+    if (handle) {
+        ALOGV("Disabling voice call");
+        mALSADevice->close(handle);
+        mALSADevice->route(handle, (uint32_t)device, mode);
+        mDeviceList.erase(handle);
     }
 #ifdef QCOM_USBAUDIO_ENABLED
    if(musbPlaybackState & USBPLAYBACKBIT_VOICECALL) {
@@ -1532,11 +1506,13 @@ void AudioHardwareALSA::enableVoiceCall(char* verb, char* modifier, int mode, in
 unsigned long bufferSize = DEFAULT_VOICE_BUFFER_SIZE;
 alsa_handle_t alsa_handle;
 char *use_case;
+bool is_verb;
     snd_use_case_get(mUcMgr, "_verb", (const char **)&use_case);
-    if ((use_case == NULL) || (!strcmp(use_case, SND_USE_CASE_VERB_INACTIVE))) {
-        strlcpy(alsa_handle.useCase, verb, sizeof(alsa_handle.useCase));
+    is_verb = (use_case == NULL) || (!strcmp(use_case, SND_USE_CASE_VERB_INACTIVE));
+    if (is_verb) {
+        setUseCase(&alsa_handle, verb);
     } else {
-        strlcpy(alsa_handle.useCase, modifier, sizeof(alsa_handle.useCase));
+        setUseCase(&alsa_handle, modifier);
     }
     free(use_case);
 
@@ -1564,10 +1540,10 @@ char *use_case;
     }
 #endif
     mALSADevice->route(&(*it), (uint32_t)device, mode);
-    if (!strcmp(it->useCase, verb)) {
-        snd_use_case_set(mUcMgr, "_verb", verb);
+    if (is_verb) {
+        snd_use_case_set_id(mUcMgr, SND_UCM_SET_VERB, it->useCaseId);
     } else {
-        snd_use_case_set(mUcMgr, "_enamod", modifier);
+        snd_use_case_set_id(mUcMgr, SND_UCM_SET_ENAMOD, it->useCaseId);
     }
     mALSADevice->startVoiceCall(&(*it));
 #ifdef QCOM_USBAUDIO_ENABLED
@@ -1604,39 +1580,23 @@ int csCallState = mCallState&0xF;
             mCSCallActive = CS_ACTIVE;
         } else if (mCSCallActive == CS_HOLD) {
              ALOGD("doRouting: Resume voice call from hold state");
-             ALSAHandleList::iterator vt_it;
-             for(vt_it = mDeviceList.begin();
-                 vt_it != mDeviceList.end(); ++vt_it) {
-                 if((!strncmp(vt_it->useCase, SND_USE_CASE_VERB_VOICECALL,
-                     strlen(SND_USE_CASE_VERB_VOICECALL))) ||
-                     (!strncmp(vt_it->useCase, SND_USE_CASE_MOD_PLAY_VOICE,
-                     strlen(SND_USE_CASE_MOD_PLAY_VOICE)))) {
-                     alsa_handle_t *handle = (alsa_handle_t *)(&(*vt_it));
-                     mCSCallActive = CS_ACTIVE;
-                     if(ioctl((int)handle->handle->fd,SNDRV_PCM_IOCTL_PAUSE,0)<0)
-                                   ALOGE("VoLTE resume failed");
-                     break;
-                 }
+             alsa_handle_t *handle = mDeviceList.find(HANDLE_CLASS_VOICE);
+             if (handle) {
+                 mCSCallActive = CS_ACTIVE;
+                 if(ioctl((int)handle->handle->fd,SNDRV_PCM_IOCTL_PAUSE,0)<0)
+                               ALOGE("VoLTE resume failed");
              }
         }
     break;
     case CS_HOLD:
         if (mCSCallActive == CS_ACTIVE) {
             ALOGD("doRouting: Voice call going to Hold");
-             ALSAHandleList::iterator vt_it;
-             for(vt_it = mDeviceList.begin();
-                 vt_it != mDeviceList.end(); ++vt_it) {
-                 if((!strncmp(vt_it->useCase, SND_USE_CASE_VERB_VOICECALL,
-                     strlen(SND_USE_CASE_VERB_VOICECALL))) ||
-                     (!strncmp(vt_it->useCase, SND_USE_CASE_MOD_PLAY_VOICE,
-                         strlen(SND_USE_CASE_MOD_PLAY_VOICE)))) {
-                         mCSCallActive = CS_HOLD;
-                         alsa_handle_t *handle = (alsa_handle_t *)(&(*vt_it));
-                         if(ioctl((int)handle->handle->fd,SNDRV_PCM_IOCTL_PAUSE,1)<0)
-                                   ALOGE("Voice pause failed");
-                         break;
-                }
-            }
+             alsa_handle_t *handle = mDeviceList.find(HANDLE_CLASS_VOICE);
+             if (handle) {
+                 mCSCallActive = CS_HOLD;
+                 if(ioctl((int)handle->handle->fd,SNDRV_PCM_IOCTL_PAUSE,1)<0)
+                               ALOGE("Voice pause failed");
+             }
         }
     break;
     }
@@ -1665,39 +1625,23 @@ switch (volteCallState) {
             mVolteCallActive = IMS_ACTIVE;
         } else if (mVolteCallActive == IMS_HOLD) {
              ALOGD("doRouting: Resume IMS call from hold state");
-             ALSAHandleList::iterator vt_it;
-             for(vt_it = mDeviceList.begin();
-                 vt_it != mDeviceList.end(); ++vt_it) {
-                 if((!strncmp(vt_it->useCase, SND_USE_CASE_VERB_VOLTE,
-                     strlen(SND_USE_CASE_VERB_VOLTE))) ||
-                     (!strncmp(vt_it->useCase, SND_USE_CASE_MOD_PLAY_VOLTE,
-                     strlen(SND_USE_CASE_MOD_PLAY_VOLTE)))) {
-                     alsa_handle_t *handle = (alsa_handle_t *)(&(*vt_it));
-                     mVolteCallActive = IMS_ACTIVE;
-                     if(ioctl((int)handle->handle->fd,SNDRV_PCM_IOCTL_PAUSE,0)<0)
-                                   ALOGE("VoLTE resume failed");
-                     break;
-                 }
+             alsa_handle_t *handle = mDeviceList.find(HANDLE_CLASS_VOLTE);
+             if (handle) {
+                 mVolteCallActive = IMS_ACTIVE;
+                 if(ioctl((int)handle->handle->fd,SNDRV_PCM_IOCTL_PAUSE,0)<0)
+                               ALOGE("VoLTE resume failed");
              }
         }
     break;
     case IMS_HOLD:
         if (mVolteCallActive == IMS_ACTIVE) {
              ALOGD("doRouting: IMS ACTIVE going to HOLD");
-             ALSAHandleList::iterator vt_it;
-             for(vt_it = mDeviceList.begin();
-                 vt_it != mDeviceList.end(); ++vt_it) {
-                 if((!strncmp(vt_it->useCase, SND_USE_CASE_VERB_VOLTE,
-                     strlen(SND_USE_CASE_VERB_VOLTE))) ||
-                     (!strncmp(vt_it->useCase, SND_USE_CASE_MOD_PLAY_VOLTE,
-                         strlen(SND_USE_CASE_MOD_PLAY_VOLTE)))) {
-                          mVolteCallActive = IMS_HOLD;
-                         alsa_handle_t *handle = (alsa_handle_t *)(&(*vt_it));
-                         if(ioctl((int)handle->handle->fd,SNDRV_PCM_IOCTL_PAUSE,1)<0)
-                                   ALOGE("VoLTE Pause failed");
-                    break;
-                }
-            }
+             alsa_handle_t *handle = mDeviceList.find(HANDLE_CLASS_VOLTE);
+             if (handle) {
+                 mVolteCallActive = IMS_HOLD;
+                 if(ioctl((int)handle->handle->fd,SNDRV_PCM_IOCTL_PAUSE,1)<0)
+                               ALOGE("VoLTE Pause failed");
+             }
         }
     break;
     }
@@ -34,6 +34,10 @@
 #ifdef QCOM_USBAUDIO_ENABLED
 #include <AudioUsbALSA.h>
 #endif
+#ifdef QCOM_SSR_ENABLED
+#include "AudioSurroundPipeline.h"
+#endif
+#include "ALSAPeriodWriter.h"
 
 extern "C" {
    #include <sound/asound.h>
@@ -134,14 +138,6 @@ static int USBRECBIT_FM = (1 << 3);
 #define DEVICE_HEADSET "Headset"
 #define DEVICE_HEADPHONES "Headphones"
 
-#ifdef QCOM_SSR_ENABLED
-#define COEFF_ARRAY_SIZE          4
-#define FILT_SIZE                 ((512+1)* 6)    /* # ((FFT bins)/2+1)*numOutputs */
-#define SSR_FRAME_SIZE            512
-#define SSR_INPUT_FRAME_SIZE      (SSR_FRAME_SIZE * 4)
-#define SSR_OUTPUT_FRAME_SIZE     (SSR_FRAME_SIZE * 6)
-#endif
-
 #define MODE_CALL_KEY  "CALL_KEY"
 
 struct alsa_device_t;
@@ -167,6 +163,7 @@ struct alsa_handle_t {
     alsa_device_t *     module;
     uint32_t            devices;
     char                useCase[MAX_STR_LEN];
+    int                 useCaseId;       // snd_use_case_get_id() of useCase
     struct pcm *        handle;
     snd_pcm_format_t    format;
     uint32_t            channels;
@@ -180,10 +177,18 @@ struct alsa_handle_t {
     snd_use_case_mgr_t  *ucMgr;
 };
 
-typedef List < alsa_handle_t > ALSAHandleList;
+// Set the use case name of a handle together with its interned id, so
+// the stream paths can compare ids instead of names.
+static inline void setUseCase(alsa_handle_t *handle, const char *useCase)
+{
+    strlcpy(handle->useCase, useCase, sizeof(handle->useCase));
+    handle->useCaseId = snd_use_case_get_id(NULL, useCase);
+}
+
+#include "ALSAHandleList.h"
 
 struct use_case_t {
-    char                useCase[MAX_STR_LEN];
+    int                 useCaseId;
 };
 
 typedef List < use_case_t > ALSAUseCaseList;
@@ -289,7 +294,8 @@ protected:
 
 // ----------------------------------------------------------------------------
 
-class AudioStreamOutALSA : public AudioStreamOut, public ALSAStreamOps
+class AudioStreamOutALSA : public AudioStreamOut, public ALSAStreamOps,
+                           private ALSAPeriodWriter::Sink
 {
 public:
     AudioStreamOutALSA(AudioHardwareALSA *parent, alsa_handle_t *handle);
@@ -337,7 +343,12 @@ public:
     status_t            close();
 
 private:
-    uint32_t            mFrameCount;
+    ALSAPeriodWriter    mWriter;
+    uint32_t            mRecoveryCount;
+
+    virtual struct pcm *writePcm();
+    virtual size_t      writePeriodSize();
+    virtual status_t    recover(int err);
 
 protected:
     AudioHardwareALSA *     mParent;
@@ -424,19 +435,7 @@ private:
     AudioSystem::audio_in_acoustics mAcoustics;
 
 #ifdef QCOM_SSR_ENABLED
-    // Function to read coefficients from files.
-    status_t            readCoeffsFromFile();
-
-    FILE                *mFp_4ch;
-    FILE                *mFp_6ch;
-    int16_t             **mRealCoeffs;
-    int16_t             **mImagCoeffs;
-    void                *mSurroundObj;
-
-    int16_t             *mSurroundInputBuffer;
-    int16_t             *mSurroundOutputBuffer;
-    int                 mSurroundInputBufferIdx;
-    int                 mSurroundOutputBufferIdx;
+    AudioSurroundPipeline *mSurround;
 #endif
 
 protected:
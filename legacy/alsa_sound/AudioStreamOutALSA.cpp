@@ -53,8 +53,11 @@ static const int DEFAULT_SAMPLE_RATE = ALSA_DEFAULT_SAMPLE_RATE;
 AudioStreamOutALSA::AudioStreamOutALSA(AudioHardwareALSA *parent, alsa_handle_t *handle) :
     ALSAStreamOps(parent, handle),
     mParent(parent),
-    mFrameCount(0)
+    mRecoveryCount(0)
 {
+    // sized for the requested period so that write() does not allocate
+    if (handle->bufferSize)
+        mWriter.reserve(handle->bufferSize);
 }
 
 AudioStreamOutALSA::~AudioStreamOutALSA()
@@ -84,23 +87,22 @@ status_t AudioStreamOutALSA::setVolume(float left, float right)
     }
     vol = lrint((volume * 0x2000)+0.5);
 
-    if(!strcmp(mHandle->useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER) ||
-       !strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_LPA)) {
+    if((mHandle->useCaseId == SND_UCM_ID_VERB_HIFI_LOW_POWER) ||
+       (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_LPA)) {
         ALOGV("setLpaVolume(%f)\n", volume);
         ALOGV("Setting LPA volume to %d (available range is 0 to 100)\n", vol);
         mHandle->module->setLpaVolume(vol);
         return status;
     }
-    else if(!strcmp(mHandle->useCase, SND_USE_CASE_VERB_HIFI_TUNNEL) ||
-            !strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_TUNNEL)) {
+    else if((mHandle->useCaseId == SND_UCM_ID_VERB_HIFI_TUNNEL) ||
+            (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_TUNNEL)) {
         ALOGV("setCompressedVolume(%f)\n", volume);
         ALOGV("Setting Compressed volume to %d (available range is 0 to 100)\n", vol);
         mHandle->module->setCompressedVolume(vol);
         return status;
     }
-    else if(!strncmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL,
-            sizeof(mHandle->useCase)) || !strncmp(mHandle->useCase,
-            SND_USE_CASE_MOD_PLAY_VOIP, sizeof(mHandle->useCase))) {
+    else if((mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+            (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP)) {
         ALOGV("Avoid Software volume by returning success\n");
         return status;
     }
@@ -109,56 +111,44 @@ status_t AudioStreamOutALSA::setVolume(float left, float right)
 
 ssize_t AudioStreamOutALSA::write(const void *buffer, size_t bytes)
 {
-    int period_size;
     char *use_case;
 
     ALOGV("write:: buffer %p, bytes %d", buffer, bytes);
 
-    snd_pcm_sframes_t n = 0;
-    size_t            sent = 0;
     status_t          err;
-
-    int write_pending = bytes;
+    bool              voip;
 
     if((mHandle->handle == NULL) && (mHandle->rxHandle == NULL) &&
-         (strcmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) &&
-         (strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP))) {
+         (mHandle->useCaseId != SND_UCM_ID_VERB_IP_VOICECALL) &&
+         (mHandle->useCaseId != SND_UCM_ID_MOD_PLAY_VOIP)) {
         mParent->mLock.lock();
 
         ALOGD("mHandle->useCase: %s", mHandle->useCase);
         snd_use_case_get(mHandle->ucMgr, "_verb", (const char **)&use_case);
         if ((use_case == NULL) || (!strcmp(use_case, SND_USE_CASE_VERB_INACTIVE))) {
-            if(!strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP)){
-                strlcpy(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL,
-                        sizeof(SND_USE_CASE_VERB_IP_VOICECALL));
-            } else if(!strcmp(mHandle->useCase,SND_USE_CASE_MOD_PLAY_MUSIC2)) {
-                strlcpy(mHandle->useCase, SND_USE_CASE_VERB_HIFI2,
-                        sizeof(SND_USE_CASE_MOD_PLAY_MUSIC2));
-            } else if (!strcmp(mHandle->useCase,SND_USE_CASE_MOD_PLAY_MUSIC)){
-                strlcpy(mHandle->useCase, SND_USE_CASE_VERB_HIFI,
-                        sizeof(SND_USE_CASE_MOD_PLAY_MUSIC));
-            } else if(!strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC)) {
-                strlcpy(mHandle->useCase, SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC,
-                        sizeof(SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC));
+            if(mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP){
+                setUseCase(mHandle, SND_USE_CASE_VERB_IP_VOICECALL);
+            } else if(mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_MUSIC2) {
+                setUseCase(mHandle, SND_USE_CASE_VERB_HIFI2);
+            } else if (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_MUSIC){
+                setUseCase(mHandle, SND_USE_CASE_VERB_HIFI);
+            } else if(mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_LOWLATENCY_MUSIC) {
+                setUseCase(mHandle, SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC);
             }
         } else {
-            if(!strcmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL)){
-                strlcpy(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP,
-                        sizeof(SND_USE_CASE_MOD_PLAY_VOIP));
-            } else if(!strcmp(mHandle->useCase,SND_USE_CASE_VERB_HIFI2)) {
-                strlcpy(mHandle->useCase, SND_USE_CASE_MOD_PLAY_MUSIC2,
-                        sizeof(SND_USE_CASE_MOD_PLAY_MUSIC2));
-            } else if (!strcmp(mHandle->useCase,SND_USE_CASE_VERB_HIFI)){
-                strlcpy(mHandle->useCase, SND_USE_CASE_MOD_PLAY_MUSIC,
-                        sizeof(SND_USE_CASE_MOD_PLAY_MUSIC));
-            } else if(!strcmp(mHandle->useCase, SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC)) {
-                strlcpy(mHandle->useCase, SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC,
-                        sizeof(SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC));
+            if(mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL){
+                setUseCase(mHandle, SND_USE_CASE_MOD_PLAY_VOIP);
+            } else if(mHandle->useCaseId == SND_UCM_ID_VERB_HIFI2) {
+                setUseCase(mHandle, SND_USE_CASE_MOD_PLAY_MUSIC2);
+            } else if (mHandle->useCaseId == SND_UCM_ID_VERB_HIFI){
+                setUseCase(mHandle, SND_USE_CASE_MOD_PLAY_MUSIC);
+            } else if(mHandle->useCaseId == SND_UCM_ID_VERB_HIFI_LOWLATENCY_MUSIC) {
+                setUseCase(mHandle, SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC);
             }
         }
         free(use_case);
-        if((!strcmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) ||
-           (!strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP))) {
+        if((mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+           (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP)) {
 #ifdef QCOM_USBAUDIO_ENABLED
             if((mDevices & AudioSystem::DEVICE_OUT_ANLG_DOCK_HEADSET)||
                   (mDevices & AudioSystem::DEVICE_OUT_DGTL_DOCK_HEADSET)||
@@ -180,16 +170,16 @@ ssize_t AudioStreamOutALSA::write(const void *buffer, size_t bytes)
         } else {
             mHandle->module->route(mHandle, mDevices , mParent->mode());
         }
-        if (!strcmp(mHandle->useCase, SND_USE_CASE_VERB_HIFI) ||
-            !strcmp(mHandle->useCase, SND_USE_CASE_VERB_HIFI2) ||
-            !strcmp(mHandle->useCase, SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC) ||
-            !strcmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) {
-            snd_use_case_set(mHandle->ucMgr, "_verb", mHandle->useCase);
+        if ((mHandle->useCaseId == SND_UCM_ID_VERB_HIFI) ||
+            (mHandle->useCaseId == SND_UCM_ID_VERB_HIFI2) ||
+            (mHandle->useCaseId == SND_UCM_ID_VERB_HIFI_LOWLATENCY_MUSIC) ||
+            (mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL)) {
+            snd_use_case_set_id(mHandle->ucMgr, SND_UCM_SET_VERB, mHandle->useCaseId);
         } else {
-            snd_use_case_set(mHandle->ucMgr, "_enamod", mHandle->useCase);
+            snd_use_case_set_id(mHandle->ucMgr, SND_UCM_SET_ENAMOD, mHandle->useCaseId);
         }
-        if((!strcmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) ||
-          (!strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP))) {
+        if((mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+          (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP)) {
              err = mHandle->module->startVoipCall(mHandle);
         }
         else
@@ -202,8 +192,8 @@ ssize_t AudioStreamOutALSA::write(const void *buffer, size_t bytes)
 #ifdef QCOM_USBAUDIO_ENABLED
         if((mHandle->devices == AudioSystem::DEVICE_IN_ANLG_DOCK_HEADSET)||
                (mHandle->devices == AudioSystem::DEVICE_OUT_ANLG_DOCK_HEADSET)){
-            if((!strcmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) ||
-               (!strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP))) {
+            if((mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+               (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP)) {
                 mParent->musbPlaybackState |= USBPLAYBACKBIT_VOIPCALL;
             } else {
                 mParent->startUsbPlaybackIfNotStarted();
@@ -222,8 +212,8 @@ ssize_t AudioStreamOutALSA::write(const void *buffer, size_t bytes)
         mParent->mLock.lock();
         mParent->startUsbPlaybackIfNotStarted();
         ALOGV("Starting playback on USB");
-        if(!strcmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL) ||
-           !strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP)) {
+        if((mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+           (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP)) {
             ALOGD("Setting VOIPCALL bit here, musbPlaybackState %d", mParent->musbPlaybackState);
             mParent->musbPlaybackState |= USBPLAYBACKBIT_VOIPCALL;
         }else{
@@ -234,56 +224,59 @@ ssize_t AudioStreamOutALSA::write(const void *buffer, size_t bytes)
     }
 #endif
 
-    period_size = mHandle->periodSize;
-    do {
-        if (write_pending < period_size) {
-            write_pending = period_size;
-        }
-        if((mParent->mVoipStreamCount) && (mHandle->rxHandle != 0)) {
-            n = pcm_write(mHandle->rxHandle,
-                     (char *)buffer + sent,
-                      period_size);
-        } else if (mHandle->handle != 0){
-            n = pcm_write(mHandle->handle,
-                     (char *)buffer + sent,
-                      period_size);
-        }
-        if (n < 0) {
-            mParent->mLock.lock();
-            if (mHandle->handle != NULL) {
-                ALOGE("pcm_write returned error %d, trying to recover\n", n);
-                pcm_close(mHandle->handle);
-                mHandle->handle = NULL;
-                if((!strncmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL, strlen(SND_USE_CASE_VERB_IP_VOICECALL))) ||
-                  (!strncmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP, strlen(SND_USE_CASE_MOD_PLAY_VOIP)))) {
-                     pcm_close(mHandle->rxHandle);
-                     mHandle->rxHandle = NULL;
-                     mHandle->module->startVoipCall(mHandle);
-                }
-                else
-                    mHandle->module->open(mHandle);
-                if(mHandle->handle == NULL) {
-                   ALOGE("write:: device re-open failed");
-                   mParent->mLock.unlock();
-                   return bytes;
-                }
-            }
-            mParent->mLock.unlock();
-            continue;
-        }
-        else {
-            mFrameCount += n;
-            sent += static_cast<ssize_t>((period_size));
-            write_pending -= period_size;
-        }
+    // every VoIP period is one codec packet
+    voip = (mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+           (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP);
+    return mWriter.write(this, buffer, bytes, mHandle->channels * sizeof(int16_t), voip);
+}
+
+struct pcm *AudioStreamOutALSA::writePcm()
+{
+    if (mParent->mVoipStreamCount && mHandle->rxHandle)
+        return mHandle->rxHandle;
+    return mHandle->handle;
+}
 
-    } while ((mHandle->handle||(mHandle->rxHandle && mParent->mVoipStreamCount)) && sent < bytes);
+size_t AudioStreamOutALSA::writePeriodSize()
+{
+    return mHandle->periodSize;
+}
+
+/*
+ * Reopen the device after pcm_write() failed. Returns an error only when
+ * the device cannot be opened again.
+ */
+status_t AudioStreamOutALSA::recover(int err)
+{
+    Mutex::Autolock autoLock(mParent->mLock);
 
-    return sent;
+    mRecoveryCount++;
+    if (mHandle->handle == NULL)
+        return NO_ERROR;
+
+    ALOGE("pcm_write returned error %d, trying to recover\n", err);
+    pcm_close(mHandle->handle);
+    mHandle->handle = NULL;
+    if((mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+      (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP)) {
+         pcm_close(mHandle->rxHandle);
+         mHandle->rxHandle = NULL;
+         mHandle->module->startVoipCall(mHandle);
+    }
+    else
+        mHandle->module->open(mHandle);
+    if(mHandle->handle == NULL) {
+       ALOGE("write:: device re-open failed");
+       return NO_INIT;
+    }
+    return NO_ERROR;
 }
 
 status_t AudioStreamOutALSA::dump(int fd, const Vector<String16>& args)
 {
+    dprintf(fd, "AudioStreamOutALSA %s\n", mHandle->useCase);
+    mWriter.dump(fd);
+    dprintf(fd, "  recoveries %u\n", mRecoveryCount);
     return NO_ERROR;
 }
 
@@ -299,8 +292,8 @@ status_t AudioStreamOutALSA::close()
     Mutex::Autolock autoLock(mParent->mLock);
 
     ALOGV("close");
-    if((!strcmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) ||
-        (!strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP))) {
+    if((mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+        (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP)) {
          if((mParent->mVoipStreamCount)) {
 #ifdef QCOM_USBAUDIO_ENABLED
              if(mParent->mVoipStreamCount == 1) {
@@ -317,8 +310,8 @@ status_t AudioStreamOutALSA::close()
          mParent->mVoipStreamCount = 0;
     }
 #ifdef QCOM_USBAUDIO_ENABLED
-      else if((!strcmp(mHandle->useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER)) ||
-              (!strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_LPA))) {
+      else if((mHandle->useCaseId == SND_UCM_ID_VERB_HIFI_LOW_POWER) ||
+              (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_LPA)) {
         mParent->musbPlaybackState &= ~USBPLAYBACKBIT_LPA;
     } else {
         mParent->musbPlaybackState &= ~USBPLAYBACKBIT_MUSIC;
@@ -338,14 +331,14 @@ status_t AudioStreamOutALSA::standby()
 
     ALOGV("standby");
 
-    if((!strcmp(mHandle->useCase, SND_USE_CASE_VERB_IP_VOICECALL)) ||
-      (!strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_VOIP))) {
+    if((mHandle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL) ||
+      (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP)) {
         return NO_ERROR;
     }
 
 #ifdef QCOM_USBAUDIO_ENABLED
-    if((!strcmp(mHandle->useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER)) ||
-        (!strcmp(mHandle->useCase, SND_USE_CASE_MOD_PLAY_LPA))) {
+    if((mHandle->useCaseId == SND_UCM_ID_VERB_HIFI_LOW_POWER) ||
+        (mHandle->useCaseId == SND_UCM_ID_MOD_PLAY_LPA)) {
         ALOGV("Deregistering LPA bit");
         mParent->musbPlaybackState &= ~USBPLAYBACKBIT_LPA;
     } else {
@@ -360,7 +353,7 @@ status_t AudioStreamOutALSA::standby()
     mParent->closeUsbPlaybackIfNothingActive();
 #endif
 
-    mFrameCount = 0;
+    mWriter.reset();
 
     return NO_ERROR;
 }
@@ -377,7 +370,7 @@ uint32_t AudioStreamOutALSA::latency() const
 // the output has exited standby
 status_t AudioStreamOutALSA::getRenderPosition(uint32_t *dspFrames)
 {
-    *dspFrames = mFrameCount;
+    *dspFrames = mWriter.frames();
     return NO_ERROR;
 }
 
@@ -0,0 +1,418 @@
+/* AudioSurroundPipeline.cpp
+
+Copyright (C) 2026 The LineageOS Project
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The LineageOS Project nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
+
+#define LOG_TAG "AudioSurroundPipeline"
+//#define LOG_NDEBUG 0
+#include <utils/Log.h>
+#include <cutils/properties.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "AudioSurroundPipeline.h"
+#include "AudioUtil.h"
+
+#ifdef QCOM_SSR_ENABLED
+extern "C" {
+#include <sound/asound.h>
+#include "alsa_audio.h"
+#include "surround_filters_interface.h"
+}
+
+#define SURROUND_FILE_1R "/system/etc/surround_sound/filter1r.pcm"
+#define SURROUND_FILE_2R "/system/etc/surround_sound/filter2r.pcm"
+#define SURROUND_FILE_3R "/system/etc/surround_sound/filter3r.pcm"
+#define SURROUND_FILE_4R "/system/etc/surround_sound/filter4r.pcm"
+
+#define SURROUND_FILE_1I "/system/etc/surround_sound/filter1i.pcm"
+#define SURROUND_FILE_2I "/system/etc/surround_sound/filter2i.pcm"
+#define SURROUND_FILE_3I "/system/etc/surround_sound/filter3i.pcm"
+#define SURROUND_FILE_4I "/system/etc/surround_sound/filter4i.pcm"
+
+// subwoofer channel assignment: default as first microphone input channel
+#define SURROUND_SUBWOOFER  0
+// frequency upper bound for subwoofer: frequency=(low_freq-1)/FFT_SIZE*samplingRate
+#define SURROUND_LOW_FREQ   4
+// frequency upper bound for spatial processing: frequency=(high_freq-1)/FFT_SIZE*samplingRate
+#define SURROUND_HIGH_FREQ  100
+
+#define SURROUND_RING_MASK  (SURROUND_RING_BLOCKS - 1)
+
+namespace android_audio_legacy
+{
+using android::NO_ERROR;
+using android::NO_MEMORY;
+using android::NO_INIT;
+using android::NAME_NOT_FOUND;
+using android::ALREADY_EXISTS;
+
+// Use AAC/DTS channel mapping as default channel mapping: C,FL,FR,Ls,Rs,LFE
+static const int chanMap[] = { 1, 2, 4, 3, 0, 5 };
+
+static const char *const sCoeffFiles[2][COEFF_ARRAY_SIZE] = {
+    { SURROUND_FILE_1R, SURROUND_FILE_2R, SURROUND_FILE_3R, SURROUND_FILE_4R },
+    { SURROUND_FILE_1I, SURROUND_FILE_2I, SURROUND_FILE_3I, SURROUND_FILE_4I },
+};
+
+// real and imaginary coefficients, mapped on first use and kept for the
+// life of the process
+static Mutex sCoeffLock;
+static Word16 *sCoeffs[2][COEFF_ARRAY_SIZE];
+static bool sCoeffsLoaded;
+
+static Word16 *mapCoeffFile(const char *path)
+{
+    struct stat st;
+    void *addr;
+    int fd;
+
+    fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        ALOGE("Cannot open filter co-efficient file %s", path);
+        return NULL;
+    }
+    if (fstat(fd, &st) || st.st_size < (off_t) (FILT_SIZE * sizeof(Word16))) {
+        ALOGE("Filter co-efficient file %s is shorter than %d bytes", path,
+              (int) (FILT_SIZE * sizeof(Word16)));
+        ::close(fd);
+        return NULL;
+    }
+    addr = mmap(NULL, FILT_SIZE * sizeof(Word16), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        ALOGE("Cannot map filter co-efficient file %s: %s", path, strerror(errno));
+        return NULL;
+    }
+    return (Word16 *) addr;
+}
+
+AudioSurroundPipeline::AudioSurroundPipeline() :
+    mFilter(NULL),
+    mIn(NULL),
+    mOut(NULL),
+    mInRear(0),
+    mOutRear(0),
+    mOutFront(0),
+    mOutOffset(0),
+    mDump4ch(NULL),
+    mDump6ch(NULL),
+    mThreaded(false),
+    mExit(false),
+    mBlocks(0),
+    mWaits(0),
+    mMaxFilterUs(0)
+{
+}
+
+AudioSurroundPipeline::~AudioSurroundPipeline()
+{
+    if (mThreaded) {
+        mLock.lock();
+        mExit = true;
+        mWorkCond.signal();
+        mLock.unlock();
+        pthread_join(mThread, NULL);
+        mThreaded = false;
+    }
+    release();
+}
+
+status_t AudioSurroundPipeline::loadCoeffs()
+{
+    Mutex::Autolock autoLock(sCoeffLock);
+
+    if (sCoeffsLoaded)
+        return NO_ERROR;
+
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < COEFF_ARRAY_SIZE; j++) {
+            sCoeffs[i][j] = mapCoeffFile(sCoeffFiles[i][j]);
+            if (sCoeffs[i][j] == NULL)
+                goto fail;
+        }
+    }
+    ALOGV("loadCoeffs: all filter files mapped");
+    sCoeffsLoaded = true;
+    return NO_ERROR;
+
+fail:
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < COEFF_ARRAY_SIZE; j++) {
+            if (sCoeffs[i][j]) {
+                munmap(sCoeffs[i][j], FILT_SIZE * sizeof(Word16));
+                sCoeffs[i][j] = NULL;
+            }
+        }
+    }
+    return NAME_NOT_FOUND;
+}
+
+status_t AudioSurroundPipeline::init()
+{
+    char value[PROPERTY_VALUE_MAX];
+    int ret;
+
+    if (mFilter) {
+        ALOGE("ola filter library is already initialized");
+        return ALREADY_EXISTS;
+    }
+
+    if (loadCoeffs() != NO_ERROR) {
+        ALOGE("Error while loading coeffs from file");
+        return NAME_NOT_FOUND;
+    }
+
+    mIn = (int16_t *) calloc(SURROUND_RING_BLOCKS * SSR_INPUT_FRAME_SIZE, sizeof(int16_t));
+    mOut = (int16_t *) calloc(SURROUND_RING_BLOCKS * SSR_OUTPUT_FRAME_SIZE, sizeof(int16_t));
+    if (!mIn || !mOut) {
+        ALOGE("Memory allocation failure for the surround sound rings");
+        release();
+        return NO_MEMORY;
+    }
+
+    //calculate the size of data to allocate for mFilter
+    ret = surround_filters_init(NULL, 6, 4, sCoeffs[0], sCoeffs[1],
+                                SURROUND_SUBWOOFER, SURROUND_LOW_FREQ,
+                                SURROUND_HIGH_FREQ, NULL);
+    if (ret <= 0) {
+        ALOGE("surround_filters_init(NULL) failed with ret: %d", ret);
+        release();
+        return NO_INIT;
+    }
+
+    ALOGV("Allocating surround filter size is %d", ret);
+    mFilter = calloc(1, ret);
+    if (!mFilter) {
+        ALOGE("Allocating surround filter failed");
+        release();
+        return NO_MEMORY;
+    }
+    ret = surround_filters_init(mFilter, 6, 4, sCoeffs[0], sCoeffs[1],
+                                SURROUND_SUBWOOFER, SURROUND_LOW_FREQ,
+                                SURROUND_HIGH_FREQ, NULL);
+    if (ret) {
+        ALOGE("surround_filters_init failed with ret: %d", ret);
+        release();
+        return NO_INIT;
+    }
+    (void) surround_filters_set_channel_map(mFilter, chanMap);
+
+    property_get("ssr.pcmdump", value, "0");
+    if (!strncmp("true", value, sizeof("true"))) {
+        //Remember to change file system permission of data(e.g. chmod 777 data/),
+        //otherwise, fopen may fail.
+        mDump4ch = fopen("/data/4ch_ssr.pcm", "wb");
+        mDump6ch = fopen("/data/6ch_ssr.pcm", "wb");
+        if (!mDump4ch || !mDump6ch)
+            ALOGE("4ch or 6ch dump open failed: 4ch:%p 6ch:%p", mDump4ch, mDump6ch);
+    }
+
+    property_get("ssr.filter_thread", value, "0");
+    if (!strncmp("true", value, sizeof("true"))) {
+        mExit = false;
+        if (pthread_create(&mThread, NULL, workerThreadWrapper, this))
+            ALOGW("Cannot start the surround filter thread, filtering in read()");
+        else
+            mThreaded = true;
+    }
+
+    return NO_ERROR;
+}
+
+void AudioSurroundPipeline::release()
+{
+    if (mFilter) {
+        surround_filters_release(mFilter);
+        free(mFilter);
+        mFilter = NULL;
+    }
+    free(mIn);
+    mIn = NULL;
+    free(mOut);
+    mOut = NULL;
+    if (mDump4ch) {
+        fclose(mDump4ch);
+        mDump4ch = NULL;
+    }
+    if (mDump6ch) {
+        fclose(mDump6ch);
+        mDump6ch = NULL;
+    }
+}
+
+int16_t *AudioSurroundPipeline::inBlock(uint32_t block) const
+{
+    return mIn + (block & SURROUND_RING_MASK) * SSR_INPUT_FRAME_SIZE;
+}
+
+int16_t *AudioSurroundPipeline::outBlock(uint32_t block) const
+{
+    return mOut + (block & SURROUND_RING_MASK) * SSR_OUTPUT_FRAME_SIZE;
+}
+
+// returns the time the filter took in us
+uint32_t AudioSurroundPipeline::filter(uint32_t block)
+{
+    int16_t *in = inBlock(block);
+    int16_t *out = outBlock(block);
+    int64_t start, elapsed;
+
+    if (mDump4ch)
+        fwrite(in, sizeof(int16_t), SSR_INPUT_FRAME_SIZE, mDump4ch);
+
+    //apply ssr libs to conver 4ch to 6ch
+    start = AudioUtil::nowUs();
+    surround_filters_intl_process(mFilter, out, in);
+    elapsed = AudioUtil::nowUs() - start;
+
+    if (mDump6ch)
+        fwrite(out, sizeof(int16_t), SSR_OUTPUT_FRAME_SIZE, mDump6ch);
+
+    return (uint32_t) elapsed;
+}
+
+void AudioSurroundPipeline::countBlock(uint32_t filterUs)
+{
+    mBlocks++;
+    if (filterUs > mMaxFilterUs)
+        mMaxFilterUs = filterUs;
+}
+
+void *AudioSurroundPipeline::workerThreadWrapper(void *me)
+{
+    static_cast<AudioSurroundPipeline *>(me)->workerLoop();
+    return NULL;
+}
+
+void AudioSurroundPipeline::workerLoop()
+{
+    androidSetThreadPriority(gettid(), ANDROID_PRIORITY_AUDIO);
+
+    Mutex::Autolock autoLock(mLock);
+    while (!mExit) {
+        if (mOutRear == mInRear) {
+            mWorkCond.wait(mLock);
+            continue;
+        }
+        uint32_t block = mOutRear;
+        mLock.unlock();
+        uint32_t filterUs = filter(block);
+        mLock.lock();
+        countBlock(filterUs);
+        mOutRear++;
+        mDoneCond.signal();
+    }
+}
+
+ssize_t AudioSurroundPipeline::read(struct pcm *pcm, void *buffer, size_t bytes)
+{
+    size_t samples = bytes / sizeof(int16_t);
+    size_t copied = 0;
+    uint32_t ready;
+    int n;
+
+    while (copied < samples) {
+        mLock.lock();
+        ready = mOutRear;
+        mLock.unlock();
+
+        if (mOutFront != ready) {
+            // hand out what is left of the oldest filtered block
+            size_t count = SSR_OUTPUT_FRAME_SIZE - mOutOffset;
+            if (count > samples - copied)
+                count = samples - copied;
+            memcpy((int16_t *) buffer + copied, outBlock(mOutFront) + mOutOffset,
+                   count * sizeof(int16_t));
+            copied += count;
+            mOutOffset += count;
+            if (mOutOffset == SSR_OUTPUT_FRAME_SIZE) {
+                mOutOffset = 0;
+                mOutFront++;
+            }
+            continue;
+        }
+
+        // Read the next block while the worker, if any, filters the
+        // previous one. Block mInRear is free in both rings once it is
+        // less than a ring behind mOutFront.
+        if (mInRear - mOutFront < SURROUND_RING_BLOCKS && mInRear - ready < 2) {
+            n = pcm_read(pcm, inBlock(mInRear), SSR_INPUT_FRAME_SIZE * sizeof(int16_t));
+            ALOGV("pcm_read() returned n = %d block:%u", n, mInRear);
+            if (n < 0)
+                return static_cast<ssize_t>(n);
+            if (mThreaded) {
+                mLock.lock();
+                mInRear++;
+                mWorkCond.signal();
+                mLock.unlock();
+            } else {
+                countBlock(filter(mInRear));
+                mInRear++;
+                mOutRear++;
+            }
+            continue;
+        }
+
+        mLock.lock();
+        while (mOutRear == ready) {
+            mWaits++;
+            mDoneCond.wait(mLock);
+        }
+        mLock.unlock();
+    }
+
+    return copied * sizeof(int16_t);
+}
+
+void AudioSurroundPipeline::reset()
+{
+    Mutex::Autolock autoLock(mLock);
+
+    while (mOutRear != mInRear)
+        mDoneCond.wait(mLock);
+    mInRear = 0;
+    mOutRear = 0;
+    mOutFront = 0;
+    mOutOffset = 0;
+}
+
+void AudioSurroundPipeline::dump(int fd) const
+{
+    dprintf(fd, "  surround sound: %s, %u blocks filtered, max %u us\n",
+            mThreaded ? "filter thread" : "inline", mBlocks, mMaxFilterUs);
+    dprintf(fd, "    waits for the filter thread %u\n", mWaits);
+}
+
+};        // namespace android_audio_legacy
+#endif    // QCOM_SSR_ENABLED
@@ -0,0 +1,127 @@
+/* AudioSurroundPipeline.h
+
+Copyright (C) 2026 The LineageOS Project
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The LineageOS Project nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
+
+#ifndef ANDROID_AUDIO_SURROUND_PIPELINE_H
+#define ANDROID_AUDIO_SURROUND_PIPELINE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <utils/Errors.h>
+#include <utils/threads.h>
+
+struct pcm;
+
+namespace android_audio_legacy
+{
+using android::status_t;
+using android::Mutex;
+using android::Condition;
+
+#define COEFF_ARRAY_SIZE          4
+#define FILT_SIZE                 ((512+1)* 6)    /* # ((FFT bins)/2+1)*numOutputs */
+#define SSR_FRAME_SIZE            512
+#define SSR_INPUT_FRAME_SIZE      (SSR_FRAME_SIZE * 4)
+#define SSR_OUTPUT_FRAME_SIZE     (SSR_FRAME_SIZE * 6)
+
+// filter frames held between the pcm and the caller, power of two
+#define SURROUND_RING_BLOCKS 4
+
+/*
+ * Turns the 4 mic capture of the surround sound record path into 5.1.
+ * Input and output are kept in rings of whole filter frames that share
+ * one block index: input block k is filtered into output block k, so
+ * neither side ever shifts leftover samples and the filter always works
+ * in place on a contiguous block. The pcm is read exactly one filter
+ * frame at a time. Optionally a worker thread runs the filter, which
+ * lets read() sit in pcm_read() for the next frame while the previous
+ * one is being processed, at the cost of one frame of latency.
+ *
+ * The filter coefficients are mapped read-only once per process and
+ * shared by every pipeline.
+ */
+class AudioSurroundPipeline
+{
+public:
+    AudioSurroundPipeline();
+    ~AudioSurroundPipeline();
+
+    // filters on a worker thread when ssr.filter_thread is true
+    status_t init();
+
+    // Fills buffer with 6 channel samples, reading the 4 channel pcm as
+    // needed. Returns the bytes copied or the pcm_read() error.
+    ssize_t read(struct pcm *pcm, void *buffer, size_t bytes);
+
+    // drops everything buffered, the next read() starts from the pcm
+    void reset();
+
+    void dump(int fd) const;
+
+private:
+    friend class AudioSurroundPipelineTest;
+
+    void *mFilter;
+    int16_t *mIn;
+    int16_t *mOut;
+
+    // free running block counters, mOutFront <= mOutRear <= mInRear
+    uint32_t mInRear;       // blocks read from the pcm
+    uint32_t mOutRear;      // blocks filtered
+    uint32_t mOutFront;     // blocks handed out completely
+    uint32_t mOutOffset;    // samples handed out of block mOutFront
+
+    FILE *mDump4ch;
+    FILE *mDump6ch;
+
+    bool mThreaded;
+    bool mExit;
+    pthread_t mThread;
+    Mutex mLock;
+    Condition mWorkCond;    // input queued or exit
+    Condition mDoneCond;    // block filtered
+
+    // statistics, under mLock when the worker filters
+    uint32_t mBlocks;
+    uint32_t mWaits;        // read() waited for the worker
+    uint32_t mMaxFilterUs;
+
+    static status_t loadCoeffs();
+    static void *workerThreadWrapper(void *me);
+    void workerLoop();
+    uint32_t filter(uint32_t block);
+    void countBlock(uint32_t filterUs);
+    int16_t *inBlock(uint32_t block) const;
+    int16_t *outBlock(uint32_t block) const;
+    void release();
+};
+
+};        // namespace android_audio_legacy
+#endif    // ANDROID_AUDIO_SURROUND_PIPELINE_H
@@ -39,13 +39,15 @@ IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
 #include <hardware/audio.h>
 #include <utils/threads.h>
 
+#include "AudioUsbBridge.h"
+
 #define DEFAULT_BUFFER_SIZE   2048
-#define POLL_TIMEOUT   3000
 #define DEFAULT_CHANNEL_MODE  2
 #define CHANNEL_MODE_ONE  1
 #define PROXY_DEFAULT_SAMPLING_RATE 48000
 #define SIGNAL_EVENT_TIMEOUT 1
 #define SIGNAL_EVENT_KILLTHREAD 2
+#define POLL_TIMEOUT   3000
 
 #define BUFFSIZE 1000000
 
@@ -68,37 +70,20 @@ class AudioUsbALSA;
 class AudioUsbALSA
 {
 private:
-    int mproxypfdPlayback;
-    int musbpfdPlayback;
-    int mnfdsPlayback;
-    int mnfdsRecording;
-    int mtimeOut;
-    int mtimeOutRecording;
-    struct pcm *mproxyRecordingHandle;
-    struct pcm *musbRecordingHandle;
-    struct pcm *mproxyPlaybackHandle;
-    struct pcm *musbPlaybackHandle;
-    u_int8_t *mdstUsb_addr;
-    u_int8_t *msrcProxy_addr;
     bool mkillPlayBackThread;
     bool mkillRecordingThread;
+    bool mPlaybackThreadActive;
+    bool mRecordingThreadActive;
     pthread_t mPlaybackUsb;
     pthread_t mRecordingUsb;
     snd_use_case_mgr_t *mUcMgr;
 
+    // proxy <-> USB transfer, each runs on its thread until stopped
+    AudioUsbBridge mPlaybackBridge;
+    AudioUsbBridge mRecordingBridge;
+
     //Helper functions
     struct pcm * configureDevice(unsigned flags, char* hw, int sampleRate, int channelCount, int periodSize, bool playback);
-    status_t syncPtr(struct pcm *handle, bool *killThread);
-
-    //playback
-    void pollForProxyData();
-    void pollForUsbData();
-
-    //recording
-    void pollForUsbDataForRecording();
-    void pollForProxyDataForRecording();
-
-    status_t startDevice(pcm *handle, bool *killThread);
 
     void PlaybackThreadEntry();
     static void *PlaybackThreadWrapper(void *me);
@@ -106,6 +91,9 @@ private:
     void RecordingThreadEntry();
     static void *RecordingThreadWrapper(void *me);
 
+    void joinPlaybackThread();
+    void joinRecordingThread();
+
     status_t setHardwareParams(pcm *local_handle, uint32_t sampleRate, uint32_t channels, int periodSize);
 
     status_t setSoftwareParams(pcm *pcm, bool playback);
@@ -137,6 +125,8 @@ public:
 
     //Capture
     void startRecording();
+
+    void dump(int fd);
 };
 
 };        // namespace android_audio_legacy
@@ -0,0 +1,587 @@
+/* AudioUsbBridge.cpp
+
+Copyright (C) 2026 The LineageOS Project
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The LineageOS Project nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
+
+#define LOG_TAG "AudioUsbBridge"
+//#define LOG_NDEBUG 0
+#include <utils/Log.h>
+#include <utils/threads.h>
+#include <cutils/atomic.h>
+
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <sched.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AudioUsbBridge.h"
+#include "AudioUtil.h"
+
+// weight of each sink period in the fill level average
+#define FILL_AVG_WEIGHT (1.0f / 32)
+// loop gains, ppm per frame of fill error and ppm per frame and period
+#define DRIFT_KP 1.0f
+#define DRIFT_KI 0.002f
+
+#define Q32_ONE (1ULL << 32)
+
+// mIdleTimeoutMs once the source gave up waiting
+#define IDLE_TIMEOUT_EXPIRED (-2)
+
+namespace android_audio_legacy
+{
+
+AudioUsbBridge::AudioUsbBridge(const char *name)
+{
+    mName = name;
+    mStopFd = eventfd(0, EFD_NONBLOCK);
+    mIdleFd = eventfd(0, EFD_NONBLOCK);
+    mRunning = 0;
+    mStopping = 0;
+    mIdleTimeoutMs = TIMEOUT_INFINITE;
+    mChannels = 0;
+    mRing = NULL;
+    mHistory = NULL;
+    mRingFrames = 0;
+    mRingMask = 0;
+    mRingRear = 0;
+    mRingFront = 0;
+    mPushTime = 0;
+    mRate = 0;
+    mTargetFrames = 0;
+    mPrev = NULL;
+    mCur = NULL;
+    mFrac = Q32_ONE;
+    mPrimed = false;
+    mFillAvg = 0;
+    mIntegral = 0;
+    mStep = Q32_ONE;
+    memset(&mSource, 0, sizeof(mSource));
+    memset(&mSink, 0, sizeof(mSink));
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+AudioUsbBridge::~AudioUsbBridge()
+{
+    if (mStopFd >= 0)
+        close(mStopFd);
+    if (mIdleFd >= 0)
+        close(mIdleFd);
+}
+
+void AudioUsbBridge::stop()
+{
+    uint64_t u = 1;
+
+    android_atomic_release_store(1, &mStopping);
+    write(mStopFd, &u, sizeof(u));
+}
+
+void AudioUsbBridge::reset()
+{
+    uint64_t u;
+
+    read(mStopFd, &u, sizeof(u));
+    read(mIdleFd, &u, sizeof(u));
+    android_atomic_release_store(TIMEOUT_INFINITE, &mIdleTimeoutMs);
+    android_atomic_release_store(0, &mStopping);
+}
+
+bool AudioUsbBridge::setIdleTimeout(int timeoutMs)
+{
+    uint64_t u = 1;
+    int32_t old;
+
+    do {
+        old = android_atomic_acquire_load(&mIdleTimeoutMs);
+        if (old == IDLE_TIMEOUT_EXPIRED)
+            return false;
+    } while (android_atomic_cmpxchg(old, timeoutMs, &mIdleTimeoutMs));
+    write(mIdleFd, &u, sizeof(u));
+    return true;
+}
+
+bool AudioUsbBridge::isRunning() const
+{
+    return android_atomic_acquire_load(&mRunning) != 0;
+}
+
+void AudioUsbBridge::getStats(Stats *stats) const
+{
+    Mutex::Autolock autoLock(mStatsLock);
+
+    memcpy(stats, &mStats, sizeof(*stats));
+}
+
+void AudioUsbBridge::dump(int fd) const
+{
+    Stats s;
+
+    getStats(&s);
+    dprintf(fd, "  %s: %s\n", mName, isRunning() ? "running" : "stopped");
+    dprintf(fd, "    fill %u frames, target %u, min %u, max %u\n",
+            s.fillFrames, s.targetFrames, s.fillMin, s.fillMax);
+    dprintf(fd, "    drift correction %d ppm\n", s.driftPpm);
+    dprintf(fd, "    xruns: source %u, sink %u\n", s.sourceXruns, s.sinkXruns);
+    dprintf(fd, "    overflow %u frames, underflows %u, periods %u\n",
+            s.overflowFrames, s.underflows, s.periods);
+}
+
+void AudioUsbBridge::setRealtime(const char *name)
+{
+    struct sched_param param;
+
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = USB_BRIDGE_RT_PRIORITY;
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) {
+        ALOGW("%s: SCHED_FIFO not permitted, using urgent audio priority", name);
+        androidSetThreadPriority(gettid(), ANDROID_PRIORITY_URGENT_AUDIO);
+    }
+}
+
+void AudioUsbBridge::setupEndpoint(Endpoint *ep, struct pcm *pcm, bool source)
+{
+    ep->pcm = pcm;
+    ep->frameSize = pcm_frame_size(pcm);
+    ep->periodFrames = pcm->period_size / ep->frameSize;
+    ep->bufferFrames = pcm->buffer_size / ep->frameSize;
+    ep->pfd[0].fd = pcm->fd;
+    ep->pfd[0].events = (pcm->flags & PCM_IN) ? POLLIN : POLLOUT;
+    ep->pfd[1].fd = mStopFd;
+    ep->pfd[1].events = POLLIN;
+    ep->pfd[2].fd = mIdleFd;
+    ep->pfd[2].events = POLLIN;
+    // only the source watches for the idle timeout
+    ep->nfds = source ? 3 : 2;
+}
+
+/*
+ * The pointers from the last transfer are used as long as they show a
+ * period, the driver is only asked again before waiting. The idle
+ * timeout restarts with every wait, so it only expires once the source
+ * delivered nothing for that long.
+ */
+long AudioUsbBridge::waitForAvail(Endpoint *ep)
+{
+    long avail = pcm_avail(ep->pcm);
+    int timeout, ret;
+    uint64_t u;
+
+    while (avail < (long) ep->periodFrames) {
+        if (android_atomic_acquire_load(&mStopping))
+            return -ECANCELED;
+        avail = pcm_mmap_avail(ep->pcm);
+        if (avail < 0 || avail >= (long) ep->periodFrames)
+            break;
+        timeout = (ep->nfds > 2) ?
+                  android_atomic_acquire_load(&mIdleTimeoutMs) : TIMEOUT_INFINITE;
+        ret = poll(ep->pfd, ep->nfds, timeout);
+        if (ret < 0 && errno != EINTR)
+            return -errno;
+        // a timeout changed meanwhile is picked up by the next wait
+        if (ret == 0 &&
+            !android_atomic_cmpxchg(timeout, IDLE_TIMEOUT_EXPIRED, &mIdleTimeoutMs))
+            return -ETIMEDOUT;
+        if (ep->pfd[0].revents & POLLNVAL)
+            return -EBADF;
+        if ((ep->nfds > 2) && (ep->pfd[2].revents & POLLIN))
+            read(mIdleFd, &u, sizeof(u));
+    }
+    return avail;
+}
+
+int AudioUsbBridge::restart(Endpoint *ep)
+{
+    int err;
+
+    err = pcm_prepare(ep->pcm);
+    if (err)
+        return err;
+    if (ep->pcm->flags & PCM_IN) {
+        if (ioctl(ep->pcm->fd, SNDRV_PCM_IOCTL_START))
+            return -errno;
+        ep->pcm->start = 1;
+    }
+    return 0;
+}
+
+/* Source thread only. Frames that do not fit are dropped. */
+void AudioUsbBridge::push(const int16_t *in, unsigned frames)
+{
+    uint32_t rear = mRingRear;
+    uint32_t front = android_atomic_acquire_load(&mRingFront);
+    uint32_t space = mRingFrames - (rear - front);
+    uint32_t offset, count, dropped = 0;
+
+    if (frames > space) {
+        dropped = frames - space;
+        frames = space;
+    }
+    offset = rear & mRingMask;
+    count = mRingFrames - offset;
+    if (count > frames)
+        count = frames;
+    memcpy(mRing + offset * mChannels, in, count * mSource.frameSize);
+    memcpy(mRing, in + count * mChannels, (frames - count) * mSource.frameSize);
+    mStatsLock.lock();
+    mStats.overflowFrames += dropped;
+    mPushTime = AudioUtil::nowUs();
+    mStatsLock.unlock();
+    android_atomic_release_store(rear + frames, &mRingRear);
+}
+
+void *AudioUsbBridge::sourceThreadWrapper(void *me)
+{
+    static_cast<AudioUsbBridge *>(me)->sourceLoop();
+    return NULL;
+}
+
+void AudioUsbBridge::sourceLoop()
+{
+    Endpoint *ep = &mSource;
+    unsigned offset, frames;
+    void *area;
+    long avail;
+    int err = 0;
+
+    setRealtime(mName);
+    if (!ep->pcm->start)
+        err = restart(ep);
+
+    while (!err && !android_atomic_acquire_load(&mStopping)) {
+        if (!ep->pcm->running) {
+            err = restart(ep);
+            if (err)
+                break;
+        }
+        avail = waitForAvail(ep);
+        if (avail == -EPIPE) {
+            countStat(&mStats.sourceXruns);
+            continue;
+        }
+        if (avail < 0) {
+            err = avail;
+            break;
+        }
+
+        frames = ep->periodFrames;
+        pcm_mmap_begin(ep->pcm, &area, &offset, &frames);
+        push((int16_t *) area + offset * mChannels, frames);
+        err = pcm_mmap_commit(ep->pcm, frames);
+        if (err == -EPIPE) {
+            countStat(&mStats.sourceXruns);
+            err = 0;
+        }
+    }
+    if (err == -ETIMEDOUT)
+        ALOGD("%s: idle timeout, stopping", mName);
+    else if (err && err != -ECANCELED)
+        ALOGE("%s: source failed with %d", mName, err);
+    stop();
+}
+
+/* Bump one of the counters in mStats, from either thread. */
+void AudioUsbBridge::countStat(uint32_t *counter)
+{
+    Mutex::Autolock autoLock(mStatsLock);
+
+    (*counter)++;
+}
+
+/*
+ * The source delivers whole periods, so the ring fill seen at each sink
+ * period jumps by up to a source period depending on where the two
+ * period clocks happen to line up, and that phase slides with the very
+ * drift being measured. Count what the source has captured since its
+ * last push as well to get a level that moves smoothly.
+ */
+uint32_t AudioUsbBridge::fillLevel(uint32_t fill)
+{
+    int64_t elapsed;
+    uint64_t pending;
+
+    mStatsLock.lock();
+    elapsed = AudioUtil::nowUs() - mPushTime;
+    mStatsLock.unlock();
+
+    if (elapsed <= 0)
+        return fill;
+    pending = (uint64_t) elapsed * mRate / 1000000;
+    if (pending > mSource.periodFrames)
+        pending = mSource.periodFrames;
+    return fill + (uint32_t) pending;
+}
+
+/*
+ * Steer the resampling ratio so that the averaged fill level stays at
+ * the target: a fuller ring means the source clock runs faster than the
+ * sink's and more input is consumed per output frame.
+ */
+int32_t AudioUsbBridge::updateDrift(uint32_t fill)
+{
+    float error, ppm;
+
+    mFillAvg += ((float) fill - mFillAvg) * FILL_AVG_WEIGHT;
+    error = mFillAvg - mTargetFrames;
+
+    mIntegral += error * DRIFT_KI;
+    if (mIntegral > USB_BRIDGE_MAX_DRIFT_PPM)
+        mIntegral = USB_BRIDGE_MAX_DRIFT_PPM;
+    else if (mIntegral < -USB_BRIDGE_MAX_DRIFT_PPM)
+        mIntegral = -USB_BRIDGE_MAX_DRIFT_PPM;
+
+    ppm = error * DRIFT_KP + mIntegral;
+    if (ppm > USB_BRIDGE_MAX_DRIFT_PPM)
+        ppm = USB_BRIDGE_MAX_DRIFT_PPM;
+    else if (ppm < -USB_BRIDGE_MAX_DRIFT_PPM)
+        ppm = -USB_BRIDGE_MAX_DRIFT_PPM;
+
+    mStep = (uint64_t) ((1.0 + ppm / 1000000.0) * Q32_ONE);
+    return (int32_t) ppm;
+}
+
+/* Input frames resample() consumes to produce outFrames. */
+uint32_t AudioUsbBridge::inputFrames(unsigned outFrames) const
+{
+    if (!outFrames)
+        return 0;
+    return (uint32_t) ((mFrac + (outFrames - 1) * mStep) >> 32);
+}
+
+uint32_t AudioUsbBridge::resample(int16_t *out, unsigned outFrames, uint32_t front)
+{
+    unsigned c;
+
+    while (outFrames--) {
+        while (mFrac >= Q32_ONE) {
+            int16_t *tmp = mPrev;
+
+            mPrev = mCur;
+            mCur = tmp;
+            memcpy(mCur, mRing + (front++ & mRingMask) * mChannels,
+                   mChannels * sizeof(int16_t));
+            mFrac -= Q32_ONE;
+        }
+        int32_t frac = (int32_t) (mFrac >> 17);
+        for (c = 0; c < mChannels; c++)
+            *out++ = mPrev[c] + (((mCur[c] - mPrev[c]) * frac) >> 15);
+        mFrac += mStep;
+    }
+    return front;
+}
+
+/*
+ * Write one sink period, resampled from the ring once it holds the
+ * target fill and silence until then or after it ran dry.
+ */
+int AudioUsbBridge::writePeriod()
+{
+    Endpoint *ep = &mSink;
+    uint32_t front = mRingFront;
+    uint32_t fill = android_atomic_acquire_load(&mRingRear) - front;
+    unsigned remaining = ep->periodFrames;
+    unsigned offset, frames;
+    bool underflow = false;
+    int32_t ppm = 0;
+    void *area;
+    int err;
+
+    if (!mPrimed && fill >= mTargetFrames) {
+        mPrimed = true;
+        mFillAvg = fillLevel(fill);
+    }
+    if (mPrimed) {
+        ppm = updateDrift(fillLevel(fill));
+        if (fill < inputFrames(ep->periodFrames)) {
+            underflow = true;
+            mPrimed = false;
+        }
+    }
+
+    mStatsLock.lock();
+    if (underflow)
+        mStats.underflows++;
+    if (mPrimed || underflow)
+        mStats.driftPpm = ppm;
+    mStats.fillFrames = fill;
+    if (fill < mStats.fillMin)
+        mStats.fillMin = fill;
+    if (fill > mStats.fillMax)
+        mStats.fillMax = fill;
+    mStatsLock.unlock();
+
+    while (remaining) {
+        frames = remaining;
+        pcm_mmap_begin(ep->pcm, &area, &offset, &frames);
+        if (!frames)
+            break;
+        if (mPrimed)
+            front = resample((int16_t *) area + offset * mChannels, frames, front);
+        else
+            memset((int16_t *) area + offset * mChannels, 0, frames * ep->frameSize);
+        err = pcm_mmap_commit(ep->pcm, frames);
+        if (err)
+            return err;
+        remaining -= frames;
+    }
+    if (mPrimed)
+        android_atomic_release_store(front, &mRingFront);
+    countStat(&mStats.periods);
+
+    // start_threshold may be out of reach, start once the buffer is full
+    if (!ep->pcm->start && pcm_avail(ep->pcm) <= (long) ep->periodFrames) {
+        if (ioctl(ep->pcm->fd, SNDRV_PCM_IOCTL_START))
+            return -errno;
+        ep->pcm->start = 1;
+    }
+    return 0;
+}
+
+void AudioUsbBridge::sinkLoop()
+{
+    Endpoint *ep = &mSink;
+    long avail;
+    int err = 0;
+
+    while (!android_atomic_acquire_load(&mStopping)) {
+        if (!ep->pcm->running) {
+            err = restart(ep);
+            if (err)
+                break;
+        }
+        avail = waitForAvail(ep);
+        if (avail == -EPIPE) {
+            countStat(&mStats.sinkXruns);
+            continue;
+        }
+        if (avail < 0) {
+            err = avail;
+            break;
+        }
+        err = writePeriod();
+        if (err == -EPIPE) {
+            ep->pcm->running = 0;
+            ep->pcm->start = 0;
+            countStat(&mStats.sinkXruns);
+            err = 0;
+        } else if (err) {
+            break;
+        }
+    }
+    if (err && err != -ECANCELED)
+        ALOGE("%s: sink failed with %d", mName, err);
+}
+
+status_t AudioUsbBridge::run(struct pcm *source, struct pcm *sink, unsigned rate)
+{
+    pthread_t sourceThread;
+    uint32_t target, ringFrames;
+    status_t status = NO_ERROR;
+
+    setupEndpoint(&mSource, source, true);
+    setupEndpoint(&mSink, sink, false);
+    if (!(source->flags & PCM_IN) || (sink->flags & PCM_IN) ||
+        mSource.frameSize != mSink.frameSize) {
+        ALOGE("%s: endpoints do not match", mName);
+        status = BAD_VALUE;
+        goto out_close;
+    }
+    mChannels = mSource.frameSize / sizeof(int16_t);
+    mRate = rate;
+
+    /*
+     * The level the loop steers counts the source period in flight, so
+     * right before a push the ring holds the target less a source period.
+     * Keep a sink period and one more of margin on top of that, the ring
+     * leaves room for a few more.
+     */
+    target = mSource.periodFrames + 2 * mSink.periodFrames;
+    for (ringFrames = 1; ringFrames < 4 * target; ringFrames <<= 1)
+        ;
+    mRing = (int16_t *) calloc(ringFrames, mSource.frameSize);
+    mHistory = (int16_t *) calloc(2 * mChannels, sizeof(int16_t));
+    if (!mRing || !mHistory) {
+        ALOGE("%s: cannot allocate %u frame ring", mName, ringFrames);
+        status = NO_MEMORY;
+        goto out_free;
+    }
+    mPrev = mHistory;
+    mCur = mHistory + mChannels;
+    mRingFrames = ringFrames;
+    mRingMask = ringFrames - 1;
+    mRingRear = 0;
+    mRingFront = 0;
+    mTargetFrames = target;
+    mFrac = Q32_ONE;
+    mPrimed = false;
+    mFillAvg = 0;
+    mIntegral = 0;
+    mStep = Q32_ONE;
+    mStatsLock.lock();
+    mPushTime = AudioUtil::nowUs();
+    memset(&mStats, 0, sizeof(mStats));
+    mStats.targetFrames = target;
+    mStats.fillMin = ringFrames;
+    mStatsLock.unlock();
+
+    ALOGD("%s: periods %u/%u frames, ring %u, target %u", mName,
+          mSource.periodFrames, mSink.periodFrames, ringFrames, target);
+
+    android_atomic_release_store(1, &mRunning);
+    if (pthread_create(&sourceThread, NULL, sourceThreadWrapper, this)) {
+        ALOGE("%s: cannot create source thread", mName);
+        status = UNKNOWN_ERROR;
+    } else {
+        setRealtime(mName);
+        sinkLoop();
+        stop();
+        pthread_join(sourceThread, NULL);
+    }
+    android_atomic_release_store(0, &mRunning);
+
+    ALOGD("%s: stopped, xruns %u/%u, underflows %u, drift %d ppm", mName,
+          mStats.sourceXruns, mStats.sinkXruns, mStats.underflows,
+          mStats.driftPpm);
+out_free:
+    free(mRing);
+    free(mHistory);
+    mRing = NULL;
+    mHistory = NULL;
+    mPrev = NULL;
+    mCur = NULL;
+out_close:
+    pcm_close(source);
+    pcm_close(sink);
+    return status;
+}
+
+};        // namespace android_audio_legacy
@@ -0,0 +1,175 @@
+/* AudioUsbBridge.h
+
+Copyright (C) 2026 The LineageOS Project
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The LineageOS Project nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
+
+#ifndef ANDROID_AUDIO_USB_BRIDGE_H
+#define ANDROID_AUDIO_USB_BRIDGE_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/poll.h>
+#include <utils/Errors.h>
+#include <utils/threads.h>
+
+extern "C" {
+   #include <sound/asound.h>
+   #include "alsa_audio.h"
+}
+
+namespace android_audio_legacy
+{
+using android::status_t;
+using android::Mutex;
+
+// largest correction the drift loop may apply, USB clocks are specified
+// to +-500 ppm and the DSP side adds its own error
+#define USB_BRIDGE_MAX_DRIFT_PPM 2000
+#define USB_BRIDGE_RT_PRIORITY   2
+
+/*
+ * Moves audio between two mmap pcm endpoints that run off different
+ * clocks, the USB device and the proxy port. The source and the sink
+ * are serviced by their own thread and only share a single producer,
+ * single consumer ring, so neither blocks on the other's device. The
+ * sink side reads the ring through a linear resampler whose ratio is
+ * steered by the averaged ring fill level, which absorbs the slow drift
+ * between the clocks instead of running into periodic xruns. Each pass
+ * of either thread moves at most one period and does not allocate.
+ */
+class AudioUsbBridge
+{
+public:
+    struct Stats {
+        uint32_t sourceXruns;
+        uint32_t sinkXruns;
+        uint32_t overflowFrames;    // dropped, ring full
+        uint32_t underflows;        // sink periods padded with silence
+        uint32_t periods;           // sink periods written
+        uint32_t fillFrames;        // ring fill at the last sink period
+        uint32_t fillMin;
+        uint32_t fillMax;
+        uint32_t targetFrames;
+        int32_t  driftPpm;          // correction currently applied
+    };
+
+    AudioUsbBridge(const char *name);
+    ~AudioUsbBridge();
+
+    /*
+     * Runs the bridge on the calling thread until stop() is called or an
+     * endpoint fails. Both handles must be mmap'ed and prepared, run at
+     * the nominal rate given and have the same frame size. They are
+     * closed before returning.
+     */
+    status_t run(struct pcm *source, struct pcm *sink, unsigned rate);
+
+    // asynchronous, run() returns once both sides have noticed
+    void stop();
+    // clears an earlier stop() and idle timeout, call before starting
+    // the thread for run()
+    void reset();
+    // make run() return once the source delivered nothing for timeoutMs,
+    // TIMEOUT_INFINITE to keep running. False if an earlier timeout
+    // already expired and run() is returning.
+    bool setIdleTimeout(int timeoutMs);
+    bool isRunning() const;
+
+    void getStats(Stats *stats) const;
+    void dump(int fd) const;
+
+private:
+    // drives the ring and the drift loop with simulated endpoints
+    friend class AudioUsbBridgeDriftTest;
+
+    struct Endpoint {
+        struct pcm *pcm;
+        unsigned frameSize;
+        unsigned periodFrames;
+        unsigned bufferFrames;
+        struct pollfd pfd[3];
+        int nfds;
+    };
+
+    const char *mName;
+    int mStopFd;
+    int mIdleFd;                    // wakes the source when the timeout changes
+    volatile int32_t mRunning;
+    volatile int32_t mStopping;
+    volatile int32_t mIdleTimeoutMs;
+
+    Endpoint mSource;
+    Endpoint mSink;
+    unsigned mChannels;
+
+    // ring of interleaved S16 frames, indices run freely and are masked
+    int16_t *mRing;
+    uint32_t mRingFrames;
+    uint32_t mRingMask;
+    volatile int32_t mRingRear;     // written by the source thread
+    volatile int32_t mRingFront;    // written by the sink thread
+    unsigned mRate;
+    uint32_t mTargetFrames;
+
+    // resampler, interpolates between mPrev and mCur at mFrac (Q32),
+    // both point into mHistory
+    int16_t *mHistory;
+    int16_t *mPrev;
+    int16_t *mCur;
+    uint64_t mFrac;
+    bool mPrimed;
+
+    // drift loop
+    float mFillAvg;
+    float mIntegral;
+    uint64_t mStep;                 // input frames per output frame, Q32
+
+    // guards mStats and mPushTime, which both threads update and dump()
+    // reads
+    mutable Mutex mStatsLock;
+    Stats mStats;
+    int64_t mPushTime;              // usec of the last push, for the fill estimate
+
+    static void *sourceThreadWrapper(void *me);
+    void sourceLoop();
+    void sinkLoop();
+
+    void setupEndpoint(Endpoint *ep, struct pcm *pcm, bool source);
+    long waitForAvail(Endpoint *ep);
+    int restart(Endpoint *ep);
+    void push(const int16_t *in, unsigned frames);
+    uint32_t fillLevel(uint32_t fill);
+    int32_t updateDrift(uint32_t fill);
+    uint32_t inputFrames(unsigned outFrames) const;
+    uint32_t resample(int16_t *out, unsigned outFrames, uint32_t front);
+    int writePeriod();
+    void countStat(uint32_t *counter);
+    static void setRealtime(const char *name);
+};
+
+};        // namespace android_audio_legacy
+#endif    // ANDROID_AUDIO_USB_BRIDGE_H
@@ -18,9 +18,17 @@
 #define LOG_TAG "AudioUtil"
 //#define LOG_NDEBUG 0
 #include <utils/Log.h>
+#include <time.h>
 
 #include "AudioUtil.h"
 
+int64_t AudioUtil::nowUs() {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
 int AudioUtil::printFormatFromEDID(unsigned char format) {
     switch (format) {
     case LPCM:
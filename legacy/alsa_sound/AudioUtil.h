@@ -18,6 +18,8 @@
 #ifndef ALSA_SOUND_AUDIO_UTIL_H
 #define ALSA_SOUND_AUDIO_UTIL_H
 
+#include <stdint.h>
+
 #define BIT(nr)     (1UL << (nr))
 #define MAX_EDID_BLOCKS 10
 #define MAX_SHORT_AUDIO_DESC_CNT        30
@@ -60,6 +62,9 @@ public:
     //Parses EDID audio block when if HDMI is connected to determine audio sink capabilities.
     static bool getHDMIAudioSinkCaps(EDID_AUDIO_INFO*);
 
+    //CLOCK_MONOTONIC in microseconds, for timing intervals.
+    static int64_t nowUs();
+
 private:
     static int printFormatFromEDID(unsigned char format);
     static int getSamplingFrequencyFromEDID(unsigned char byte);
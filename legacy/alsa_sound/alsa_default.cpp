@@ -197,7 +197,7 @@ static const int DEFAULT_SAMPLE_RATE = ALSA_DEFAULT_SAMPLE_RATE;
 static void switchDevice(alsa_handle_t *handle, uint32_t devices, uint32_t mode);
 static char *getUCMDevice(uint32_t devices, int input, char *rxDevice);
 static void disableDevice(alsa_handle_t *handle);
-int getUseCaseType(const char *useCase);
+int getUseCaseType(int useCaseId);
 
 static int callMode = AudioSystem::MODE_NORMAL;
 // ----------------------------------------------------------------------------
@@ -281,8 +281,8 @@ status_t setHardwareParams(alsa_handle_t *handle)
 
 #ifdef QCOM_SSR_ENABLED
     if (channels == 6) {
-        if (!strncmp(handle->useCase, SND_USE_CASE_VERB_HIFI_REC, strlen(SND_USE_CASE_VERB_HIFI_REC))
-            || !strncmp(handle->useCase, SND_USE_CASE_MOD_CAPTURE_MUSIC, strlen(SND_USE_CASE_MOD_CAPTURE_MUSIC))) {
+        if ((handle->useCaseId == SND_UCM_ID_VERB_HIFI_REC)
+            || (handle->useCaseId == SND_UCM_ID_MOD_CAPTURE_MUSIC)) {
             ALOGV("HWParams: Use 4 channels in kernel for 5.1(%s) recording ", handle->useCase);
             channels = 4;
         }
@@ -331,8 +331,8 @@ status_t setHardwareParams(alsa_handle_t *handle)
     handle->handle->rate = handle->sampleRate;
     handle->handle->channels = handle->channels;
     handle->periodSize = handle->handle->period_size;
-    if (strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI_REC) &&
-        strcmp(handle->useCase, SND_USE_CASE_MOD_CAPTURE_MUSIC) &&
+    if ((handle->useCaseId != SND_UCM_ID_VERB_HIFI_REC) &&
+        (handle->useCaseId != SND_UCM_ID_MOD_CAPTURE_MUSIC) &&
         (6 != handle->channels)) {
         //Do not update buffersize for 5.1 recording
         handle->bufferSize = handle->handle->period_size;
@@ -357,8 +357,8 @@ status_t setSoftwareParams(alsa_handle_t *handle)
 
 #ifdef QCOM_SSR_ENABLED
     if (channels == 6) {
-        if (!strncmp(handle->useCase, SND_USE_CASE_VERB_HIFI_REC, strlen(SND_USE_CASE_VERB_HIFI_REC))
-            || !strncmp(handle->useCase, SND_USE_CASE_MOD_CAPTURE_MUSIC, strlen(SND_USE_CASE_MOD_CAPTURE_MUSIC))) {
+        if ((handle->useCaseId == SND_UCM_ID_VERB_HIFI_REC)
+            || (handle->useCaseId == SND_UCM_ID_MOD_CAPTURE_MUSIC)) {
             ALOGV("SWParams: Use 4 channels in kernel for 5.1(%s) recording ", handle->useCase);
             channels = 4;
         }
@@ -368,8 +368,8 @@ status_t setSoftwareParams(alsa_handle_t *handle)
     // Get the current software parameters
     params->tstamp_mode = SNDRV_PCM_TSTAMP_NONE;
     params->period_step = 1;
-    if(((!strcmp(handle->useCase,SND_USE_CASE_MOD_PLAY_VOIP)) ||
-        (!strcmp(handle->useCase,SND_USE_CASE_VERB_IP_VOICECALL)))){
+    if(((handle->useCaseId == SND_UCM_ID_MOD_PLAY_VOIP) ||
+        (handle->useCaseId == SND_UCM_ID_VERB_IP_VOICECALL))){
           ALOGV("setparam:  start & stop threshold for Voip ");
           params->avail_min = handle->channels - 1 ? periodSize/4 : periodSize/2;
           params->start_threshold = periodSize/2;
@@ -396,7 +396,7 @@ void switchDevice(alsa_handle_t *handle, uint32_t devices, uint32_t mode)
     unsigned usecase_type = 0;
     bool inCallDevSwitch = false;
     char *rxDevice, *txDevice, ident[70], *use_case = NULL;
-    int err = 0, index, mods_size;
+    int err = 0, index, mods_size, use_case_id = SND_UCM_ID_VERB_INACTIVE, mod_id;
     int rx_dev_id, tx_dev_id;
     ALOGD("%s: device %d mode:%d", __FUNCTION__, devices, mode);
 
@@ -453,8 +453,8 @@ void switchDevice(alsa_handle_t *handle, uint32_t devices, uint32_t mode)
     }
 #ifdef QCOM_SSR_ENABLED
     if ((devices & AudioSystem::DEVICE_IN_BUILTIN_MIC) && ( 6 == handle->channels)) {
-        if (!strncmp(handle->useCase, SND_USE_CASE_VERB_HIFI_REC, strlen(SND_USE_CASE_VERB_HIFI_REC))
-            || !strncmp(handle->useCase, SND_USE_CASE_MOD_CAPTURE_MUSIC, strlen(SND_USE_CASE_MOD_CAPTURE_MUSIC))) {
+        if ((handle->useCaseId == SND_UCM_ID_VERB_HIFI_REC)
+            || (handle->useCaseId == SND_UCM_ID_MOD_CAPTURE_MUSIC)) {
             ALOGV(" switchDevice , use ssr devices for channels:%d usecase:%s",handle->channels,handle->useCase);
             s_set_flags(SSRQMIC_FLAG);
         }
@@ -487,27 +487,29 @@ void switchDevice(alsa_handle_t *handle, uint32_t devices, uint32_t mode)
 #endif
 
     snd_use_case_get(handle->ucMgr, "_verb", (const char **)&use_case);
+    if (use_case != NULL)
+        use_case_id = snd_use_case_get_id(handle->ucMgr, use_case);
     mods_size = snd_use_case_get_list(handle->ucMgr, "_enamods", &mods_list);
     if (rxDevice != NULL) {
         if ((strncmp(curRxUCMDevice, "None", 4)) &&
             ((strncmp(rxDevice, curRxUCMDevice, MAX_STR_LEN)) || (inCallDevSwitch == true))) {
-            if ((use_case != NULL) && (strncmp(use_case, SND_USE_CASE_VERB_INACTIVE,
-                strlen(SND_USE_CASE_VERB_INACTIVE)))) {
-                usecase_type = getUseCaseType(use_case);
+            if ((use_case != NULL) && (use_case_id != SND_UCM_ID_VERB_INACTIVE)) {
+                usecase_type = getUseCaseType(use_case_id);
                 if (usecase_type & USECASE_TYPE_RX) {
                     ALOGD("Deroute use case %s type is %d\n", use_case, usecase_type);
-                    strlcpy(useCaseNode.useCase, use_case, MAX_STR_LEN);
-                    snd_use_case_set(handle->ucMgr, "_verb", SND_USE_CASE_VERB_INACTIVE);
+                    useCaseNode.useCaseId = use_case_id;
+                    snd_use_case_set_id(handle->ucMgr, SND_UCM_SET_VERB, SND_UCM_ID_VERB_INACTIVE);
                     mUseCaseList.push_front(useCaseNode);
                 }
             }
             if (mods_size) {
                 for(index = 0; index < mods_size; index++) {
-                    usecase_type = getUseCaseType(mods_list[index]);
+                    mod_id = snd_use_case_get_id(handle->ucMgr, mods_list[index]);
+                    usecase_type = getUseCaseType(mod_id);
                     if (usecase_type & USECASE_TYPE_RX) {
                         ALOGD("Deroute use case %s type is %d\n", mods_list[index], usecase_type);
-                        strlcpy(useCaseNode.useCase, mods_list[index], MAX_STR_LEN);
-                        snd_use_case_set(handle->ucMgr, "_dismod", mods_list[index]);
+                        useCaseNode.useCaseId = mod_id;
+                        snd_use_case_set_id(handle->ucMgr, SND_UCM_SET_DISMOD, mod_id);
                         mUseCaseList.push_back(useCaseNode);
                     }
                 }
@@ -518,23 +520,23 @@ void switchDevice(alsa_handle_t *handle, uint32_t devices, uint32_t mode)
     if (txDevice != NULL) {
         if ((strncmp(curTxUCMDevice, "None", 4)) &&
             ((strncmp(txDevice, curTxUCMDevice, MAX_STR_LEN)) || (inCallDevSwitch == true))) {
-            if ((use_case != NULL) && (strncmp(use_case, SND_USE_CASE_VERB_INACTIVE,
-                strlen(SND_USE_CASE_VERB_INACTIVE)))) {
-                usecase_type = getUseCaseType(use_case);
+            if ((use_case != NULL) && (use_case_id != SND_UCM_ID_VERB_INACTIVE)) {
+                usecase_type = getUseCaseType(use_case_id);
                 if ((usecase_type & USECASE_TYPE_TX) && (!(usecase_type & USECASE_TYPE_RX))) {
                     ALOGD("Deroute use case %s type is %d\n", use_case, usecase_type);
-                    strlcpy(useCaseNode.useCase, use_case, MAX_STR_LEN);
-                    snd_use_case_set(handle->ucMgr, "_verb", SND_USE_CASE_VERB_INACTIVE);
+                    useCaseNode.useCaseId = use_case_id;
+                    snd_use_case_set_id(handle->ucMgr, SND_UCM_SET_VERB, SND_UCM_ID_VERB_INACTIVE);
                     mUseCaseList.push_front(useCaseNode);
                 }
             }
             if (mods_size) {
                 for(index = 0; index < mods_size; index++) {
-                    usecase_type = getUseCaseType(mods_list[index]);
+                    mod_id = snd_use_case_get_id(handle->ucMgr, mods_list[index]);
+                    usecase_type = getUseCaseType(mod_id);
                     if ((usecase_type & USECASE_TYPE_TX) && (!(usecase_type & USECASE_TYPE_RX))) {
                         ALOGD("Deroute use case %s type is %d\n", mods_list[index], usecase_type);
-                        strlcpy(useCaseNode.useCase, mods_list[index], MAX_STR_LEN);
-                        snd_use_case_set(handle->ucMgr, "_dismod", mods_list[index]);
+                        useCaseNode.useCaseId = mod_id;
+                        snd_use_case_set_id(handle->ucMgr, SND_UCM_SET_DISMOD, mod_id);
                         mUseCaseList.push_back(useCaseNode);
                     }
                 }
@@ -557,12 +559,12 @@ void switchDevice(alsa_handle_t *handle, uint32_t devices, uint32_t mode)
        strlcpy(curTxUCMDevice, txDevice, sizeof(curTxUCMDevice));
     }
     for(ALSAUseCaseList::iterator it = mUseCaseList.begin(); it != mUseCaseList.end(); ++it) {
-        ALOGD("Route use case %s\n", it->useCase);
-        if ((use_case != NULL) && (strncmp(use_case, SND_USE_CASE_VERB_INACTIVE,
-            strlen(SND_USE_CASE_VERB_INACTIVE))) && (!strncmp(use_case, it->useCase, MAX_UC_LEN))) {
-            snd_use_case_set(handle->ucMgr, "_verb", it->useCase);
+        ALOGD("Route use case %s\n", snd_use_case_get_name(handle->ucMgr, it->useCaseId));
+        if ((use_case != NULL) && (use_case_id != SND_UCM_ID_VERB_INACTIVE) &&
+            (use_case_id == it->useCaseId)) {
+            snd_use_case_set_id(handle->ucMgr, SND_UCM_SET_VERB, it->useCaseId);
         } else {
-            snd_use_case_set(handle->ucMgr, "_enamod", it->useCase);
+            snd_use_case_set_id(handle->ucMgr, SND_UCM_SET_ENAMOD, it->useCaseId);
         }
     }
     if (!mUseCaseList.empty())
@@ -640,8 +642,8 @@ static status_t s_open(alsa_handle_t *handle)
         }
     }
     /* No need to call s_close for LPA as pcm device open and close is handled by LPAPlayer in stagefright */
-    if((!strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER)) || (!strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_LPA))
-    ||(!strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI_TUNNEL)) || (!strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_TUNNEL))) {
+    if((handle->useCaseId == SND_UCM_ID_VERB_HIFI_LOW_POWER) || (handle->useCaseId == SND_UCM_ID_MOD_PLAY_LPA)
+    ||(handle->useCaseId == SND_UCM_ID_VERB_HIFI_TUNNEL) || (handle->useCaseId == SND_UCM_ID_MOD_PLAY_TUNNEL)) {
         ALOGV("s_open: Opening LPA /Tunnel playback");
         return NO_ERROR;
     }
@@ -656,19 +658,19 @@ static status_t s_open(alsa_handle_t *handle)
     // The PCM stream is opened in blocking mode, per ALSA defaults.  The
     // AudioFlinger seems to assume blocking mode too, so asynchronous mode
     // should not be used.
-    if ((!strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER)) ||
-        (!strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_LPA)) ||
-        (!strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI_TUNNEL)) ||
-        (!strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_TUNNEL))) {
+    if ((handle->useCaseId == SND_UCM_ID_VERB_HIFI_LOW_POWER) ||
+        (handle->useCaseId == SND_UCM_ID_MOD_PLAY_LPA) ||
+        (handle->useCaseId == SND_UCM_ID_VERB_HIFI_TUNNEL) ||
+        (handle->useCaseId == SND_UCM_ID_MOD_PLAY_TUNNEL)) {
         ALOGV("LPA/tunnel use case");
         flags |= PCM_MMAP;
         flags |= DEBUG_ON;
-    } else if ((!strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI)) ||
-        (!strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI2)) ||
-        (!strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC)) ||
-        (!strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC)) ||
-        (!strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_MUSIC2)) ||
-        (!strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_MUSIC))) {
+    } else if ((handle->useCaseId == SND_UCM_ID_VERB_HIFI) ||
+        (handle->useCaseId == SND_UCM_ID_VERB_HIFI2) ||
+        (handle->useCaseId == SND_UCM_ID_VERB_HIFI_LOWLATENCY_MUSIC) ||
+        (handle->useCaseId == SND_UCM_ID_MOD_PLAY_LOWLATENCY_MUSIC) ||
+        (handle->useCaseId == SND_UCM_ID_MOD_PLAY_MUSIC2) ||
+        (handle->useCaseId == SND_UCM_ID_MOD_PLAY_MUSIC)) {
         ALOGV("Music case");
         flags = PCM_OUT;
     } else {
@@ -681,8 +683,8 @@ static status_t s_open(alsa_handle_t *handle)
         flags |= PCM_QUAD;
     } else if (handle->channels == 6 ) {
 #ifdef QCOM_SSR_ENABLED
-        if (!strncmp(handle->useCase, SND_USE_CASE_VERB_HIFI_REC, strlen(SND_USE_CASE_VERB_HIFI_REC))
-            || !strncmp(handle->useCase, SND_USE_CASE_MOD_CAPTURE_MUSIC, strlen(SND_USE_CASE_MOD_CAPTURE_MUSIC))) {
+        if ((handle->useCaseId == SND_UCM_ID_VERB_HIFI_REC)
+            || (handle->useCaseId == SND_UCM_ID_MOD_CAPTURE_MUSIC)) {
             flags |= PCM_QUAD;
         } else {
             flags |= PCM_5POINT1;
@@ -1095,8 +1097,8 @@ static status_t s_close(alsa_handle_t *handle)
     handle->rxHandle = 0;
     ALOGV("s_close: handle %p h %p", handle, h);
     if (h) {
-        if ((!strcmp(handle->useCase, SND_USE_CASE_VERB_VOICECALL) ||
-             !strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_VOICE)) &&
+        if (((handle->useCaseId == SND_UCM_ID_VERB_VOICECALL) ||
+             (handle->useCaseId == SND_UCM_ID_MOD_PLAY_VOICE)) &&
             platform_is_Fusion3()) {
 #ifdef QCOM_CSDCLIENT_ENABLED
             if (csd_stop_voice == NULL) {
@@ -1128,10 +1130,10 @@ static status_t s_close(alsa_handle_t *handle)
         }
 
         disableDevice(handle);
-    } else if((!strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER)) ||
-              (!strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_LPA)) ||
-              (!strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI_TUNNEL)) ||
-              (!strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_TUNNEL))){
+    } else if((handle->useCaseId == SND_UCM_ID_VERB_HIFI_LOW_POWER) ||
+              (handle->useCaseId == SND_UCM_ID_MOD_PLAY_LPA) ||
+              (handle->useCaseId == SND_UCM_ID_VERB_HIFI_TUNNEL) ||
+              (handle->useCaseId == SND_UCM_ID_MOD_PLAY_TUNNEL)){
         disableDevice(handle);
     }
 
@@ -1169,10 +1171,10 @@ static status_t s_standby(alsa_handle_t *handle)
             ALOGE("s_standby: pcm_close failed for handle with err %d", err);
         }
         disableDevice(handle);
-    } else if((!strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER)) ||
-              (!strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_LPA)) ||
-              (!strcmp(handle->useCase, SND_USE_CASE_VERB_HIFI_TUNNEL)) ||
-              (!strcmp(handle->useCase, SND_USE_CASE_MOD_PLAY_TUNNEL))) {
+    } else if((handle->useCaseId == SND_UCM_ID_VERB_HIFI_LOW_POWER) ||
+              (handle->useCaseId == SND_UCM_ID_MOD_PLAY_LPA) ||
+              (handle->useCaseId == SND_UCM_ID_VERB_HIFI_TUNNEL) ||
+              (handle->useCaseId == SND_UCM_ID_MOD_PLAY_TUNNEL)) {
         disableDevice(handle);
     }
 
@@ -1189,82 +1191,47 @@ static status_t s_route(alsa_handle_t *handle, uint32_t devices, int mode)
     return status;
 }
 
-int getUseCaseType(const char *useCase)
+int getUseCaseType(int useCaseId)
 {
-    ALOGD("use case is %s\n", useCase);
-    if (!strncmp(useCase, SND_USE_CASE_VERB_HIFI,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_HIFI)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_HIFI2,
-            MAX_LEN(useCase, SND_USE_CASE_VERB_HIFI2)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_HIFI_LOW_POWER)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_HIFI_TUNNEL,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_HIFI_TUNNEL)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_HIFI2,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_HIFI2)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_DIGITAL_RADIO,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_DIGITAL_RADIO)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_PLAY_MUSIC,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_PLAY_MUSIC)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_PLAY_MUSIC2,
-            MAX_LEN(useCase, SND_USE_CASE_MOD_PLAY_MUSIC2)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_PLAY_MUSIC2,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_PLAY_MUSIC2)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_PLAY_LPA,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_PLAY_LPA)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_PLAY_TUNNEL,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_PLAY_TUNNEL)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_PLAY_FM,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_PLAY_FM))) {
+    ALOGD("use case id is %d\n", useCaseId);
+    switch (useCaseId) {
+    case SND_UCM_ID_VERB_HIFI:
+    case SND_UCM_ID_VERB_HIFI2:
+    case SND_UCM_ID_VERB_HIFI_LOWLATENCY_MUSIC:
+    case SND_UCM_ID_VERB_HIFI_LOW_POWER:
+    case SND_UCM_ID_VERB_HIFI_TUNNEL:
+    case SND_UCM_ID_VERB_DIGITAL_RADIO:
+    case SND_UCM_ID_MOD_PLAY_MUSIC:
+    case SND_UCM_ID_MOD_PLAY_MUSIC2:
+    case SND_UCM_ID_MOD_PLAY_LOWLATENCY_MUSIC:
+    case SND_UCM_ID_MOD_PLAY_LPA:
+    case SND_UCM_ID_MOD_PLAY_TUNNEL:
+    case SND_UCM_ID_MOD_PLAY_FM:
         return USECASE_TYPE_RX;
-    } else if (!strncmp(useCase, SND_USE_CASE_VERB_HIFI_REC,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_HIFI_REC)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_HIFI_LOWLATENCY_REC,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_HIFI_LOWLATENCY_REC)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_FM_REC,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_FM_REC)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_FM_A2DP_REC,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_FM_A2DP_REC)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_CAPTURE_MUSIC,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_CAPTURE_MUSIC)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_CAPTURE_LOWLATENCY_MUSIC,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_CAPTURE_LOWLATENCY_MUSIC)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_CAPTURE_FM,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_CAPTURE_FM)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_CAPTURE_A2DP_FM,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_CAPTURE_A2DP_FM))) {
+    case SND_UCM_ID_VERB_HIFI_REC:
+    case SND_UCM_ID_VERB_HIFI_LOWLATENCY_REC:
+    case SND_UCM_ID_VERB_FM_REC:
+    case SND_UCM_ID_VERB_FM_A2DP_REC:
+    case SND_UCM_ID_MOD_CAPTURE_MUSIC:
+    case SND_UCM_ID_MOD_CAPTURE_LOWLATENCY_MUSIC:
+    case SND_UCM_ID_MOD_CAPTURE_FM:
+    case SND_UCM_ID_MOD_CAPTURE_A2DP_FM:
         return USECASE_TYPE_TX;
-    } else if (!strncmp(useCase, SND_USE_CASE_VERB_VOICECALL,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_VOICECALL)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_IP_VOICECALL,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_IP_VOICECALL)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_DL_REC,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_DL_REC)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_UL_DL_REC,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_UL_DL_REC)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_INCALL_REC,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_INCALL_REC)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_PLAY_VOICE,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_PLAY_VOICE)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_PLAY_VOIP,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_PLAY_VOIP)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_CAPTURE_VOICE_DL,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_CAPTURE_VOICE_DL)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_CAPTURE_VOICE_UL_DL,
-            MAX_LEN(useCase,SND_USE_CASE_MOD_CAPTURE_VOICE_UL_DL)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_CAPTURE_VOICE,
-            MAX_LEN(useCase, SND_USE_CASE_MOD_CAPTURE_VOICE)) ||
-        !strncmp(useCase, SND_USE_CASE_VERB_VOLTE,
-            MAX_LEN(useCase,SND_USE_CASE_VERB_VOLTE)) ||
-        !strncmp(useCase, SND_USE_CASE_MOD_PLAY_VOLTE,
-            MAX_LEN(useCase, SND_USE_CASE_MOD_PLAY_VOLTE))) {
+    case SND_UCM_ID_VERB_VOICECALL:
+    case SND_UCM_ID_VERB_IP_VOICECALL:
+    case SND_UCM_ID_VERB_DL_REC:
+    case SND_UCM_ID_VERB_UL_DL_REC:
+    case SND_UCM_ID_VERB_INCALL_REC:
+    case SND_UCM_ID_MOD_PLAY_VOICE:
+    case SND_UCM_ID_MOD_PLAY_VOIP:
+    case SND_UCM_ID_MOD_CAPTURE_VOICE_DL:
+    case SND_UCM_ID_MOD_CAPTURE_VOICE_UL_DL:
+    case SND_UCM_ID_MOD_CAPTURE_VOICE:
+    case SND_UCM_ID_VERB_VOLTE:
+    case SND_UCM_ID_MOD_PLAY_VOLTE:
         return (USECASE_TYPE_RX | USECASE_TYPE_TX);
-    } else {
-        ALOGE("unknown use case %s\n", useCase);
+    default:
+        ALOGE("unknown use case id %d\n", useCaseId);
         return 0;
     }
 }
@@ -1273,27 +1240,28 @@ static void disableDevice(alsa_handle_t *handle)
 {
     unsigned usecase_type = 0;
     int i, mods_size;
+    int useCaseId;
     char *useCase;
     const char **mods_list;
 
     snd_use_case_get(handle->ucMgr, "_verb", (const char **)&useCase);
     if (useCase != NULL) {
-        if (!strncmp(useCase, handle->useCase, MAX_UC_LEN)) {
-            snd_use_case_set(handle->ucMgr, "_verb", SND_USE_CASE_VERB_INACTIVE);
+        if (snd_use_case_get_id(handle->ucMgr, useCase) == handle->useCaseId) {
+            snd_use_case_set_id(handle->ucMgr, SND_UCM_SET_VERB, SND_UCM_ID_VERB_INACTIVE);
         } else {
-            snd_use_case_set(handle->ucMgr, "_dismod", handle->useCase);
+            snd_use_case_set_id(handle->ucMgr, SND_UCM_SET_DISMOD, handle->useCaseId);
         }
         free(useCase);
         snd_use_case_get(handle->ucMgr, "_verb", (const char **)&useCase);
-        if (strncmp(useCase, SND_USE_CASE_VERB_INACTIVE,
-               strlen(SND_USE_CASE_VERB_INACTIVE)))
-            usecase_type |= getUseCaseType(useCase);
+        useCaseId = snd_use_case_get_id(handle->ucMgr, useCase);
+        if (useCaseId != SND_UCM_ID_VERB_INACTIVE)
+            usecase_type |= getUseCaseType(useCaseId);
         mods_size = snd_use_case_get_list(handle->ucMgr, "_enamods", &mods_list);
         ALOGV("Number of modifiers %d\n", mods_size);
         if (mods_size) {
             for(i = 0; i < mods_size; i++) {
                 ALOGV("index %d modifier %s\n", i, mods_list[i]);
-                usecase_type |= getUseCaseType(mods_list[i]);
+                usecase_type |= getUseCaseType(snd_use_case_get_id(handle->ucMgr, mods_list[i]));
             }
         }
         ALOGV("usecase_type is %d\n", usecase_type);
@@ -0,0 +1,62 @@
+LOCAL_PATH := $(call my-dir)
+
+# Host test of the USB bridge drift loop with simulated endpoints
+include $(CLEAR_VARS)
+LOCAL_MODULE := usb_bridge_drift_test
+LOCAL_LICENSE_KINDS := SPDX-license-identifier-BSD
+LOCAL_LICENSE_CONDITIONS := notice
+LOCAL_MODULE_HOST_OS := linux
+LOCAL_GTEST := false
+LOCAL_SRC_FILES := \
+    usb_bridge_drift_test.cpp \
+    ../AudioUsbBridge.cpp \
+    ../../libalsa-intf/alsa_pcm.c
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/.. $(LOCAL_PATH)/../../libalsa-intf
+LOCAL_CFLAGS := -DANDROID -D_GNU_SOURCE
+LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+LOCAL_LDLIBS := -lpthread -lm
+include $(BUILD_HOST_NATIVE_TEST)
+
+# Host test and benchmark of the use case class index of ALSAHandleList
+include $(CLEAR_VARS)
+LOCAL_MODULE := alsa_handle_list_test
+LOCAL_LICENSE_KINDS := SPDX-license-identifier-BSD
+LOCAL_LICENSE_CONDITIONS := notice
+LOCAL_MODULE_HOST_OS := linux
+LOCAL_GTEST := false
+LOCAL_SRC_FILES := alsa_handle_list_test.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/.. $(LOCAL_PATH)/../../libalsa-intf
+LOCAL_CFLAGS := -DANDROID -D_GNU_SOURCE
+LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+include $(BUILD_HOST_NATIVE_TEST)
+
+# Host test of the surround sound block rings with a fake pcm and filter
+include $(CLEAR_VARS)
+LOCAL_MODULE := surround_pipeline_test
+LOCAL_LICENSE_KINDS := SPDX-license-identifier-BSD
+LOCAL_LICENSE_CONDITIONS := notice
+LOCAL_MODULE_HOST_OS := linux
+LOCAL_GTEST := false
+LOCAL_SRC_FILES := \
+    surround_pipeline_test.cpp \
+    ../AudioSurroundPipeline.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/fake $(LOCAL_PATH)/.. $(LOCAL_PATH)/../../libalsa-intf
+LOCAL_CFLAGS := -DANDROID -D_GNU_SOURCE -DQCOM_SSR_ENABLED
+LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+LOCAL_LDLIBS := -lpthread
+include $(BUILD_HOST_NATIVE_TEST)
+
+# Host test of the period aggregation of output writes with a fake pcm_write
+include $(CLEAR_VARS)
+LOCAL_MODULE := alsa_period_writer_test
+LOCAL_LICENSE_KINDS := SPDX-license-identifier-BSD
+LOCAL_LICENSE_CONDITIONS := notice
+LOCAL_MODULE_HOST_OS := linux
+LOCAL_GTEST := false
+LOCAL_SRC_FILES := \
+    period_writer_test.cpp \
+    ../ALSAPeriodWriter.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/.. $(LOCAL_PATH)/../../libalsa-intf
+LOCAL_CFLAGS := -DANDROID -D_GNU_SOURCE
+LOCAL_STATIC_LIBRARIES := libutils libcutils liblog
+include $(BUILD_HOST_NATIVE_TEST)
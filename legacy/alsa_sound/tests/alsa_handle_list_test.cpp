@@ -0,0 +1,231 @@
+/* alsa_handle_list_test.cpp
+
+Copyright (C) 2026 The LineageOS Project
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The LineageOS Project nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
+
+
+/*
+ * Checks the use case class index of ALSAHandleList against the list
+ * itself: the oldest handle of a class is found, erasing it falls back to
+ * the next one, and a handle that changed its use case in place is
+ * rescanned. Then times find() against the name compares doRouting()
+ * walked the list with before the index.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <utils/List.h>
+
+extern "C" {
+#include "msm8960_use_cases.h"
+}
+
+#define EXPECT(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+using android::List;
+
+// the fields of the HAL handle the list looks at
+struct alsa_handle_t {
+    char useCase[MAX_STR_LEN];
+    int  useCaseId;
+};
+
+#include "ALSAHandleList.h"
+
+#define BENCH_ROUNDS        200000
+#define BENCH_MAX_HANDLES   64
+
+// keeps the compiler from hoisting the lookups out of the timed loops
+#define BENCH_CLOBBER() asm volatile("" : : : "memory")
+
+// setUseCase() without the UCM lookup
+static void setUseCase(alsa_handle_t *handle, const char *useCase, int useCaseId)
+{
+    snprintf(handle->useCase, sizeof(handle->useCase), "%s", useCase);
+    handle->useCaseId = useCaseId;
+}
+
+static alsa_handle_t *add(ALSAHandleList &list, const char *useCase, int useCaseId)
+{
+    alsa_handle_t handle;
+
+    memset(&handle, 0, sizeof(handle));
+    setUseCase(&handle, useCase, useCaseId);
+    list.push_back(handle);
+    return list.last();
+}
+
+static void testClasses()
+{
+    ALSAHandleList list;
+
+    EXPECT(list.last() == NULL);
+    EXPECT(list.find(HANDLE_CLASS_VOICE) == NULL);
+
+    alsa_handle_t *hifi = add(list, SND_USE_CASE_VERB_HIFI, SND_UCM_ID_VERB_HIFI);
+    alsa_handle_t *voice = add(list, SND_USE_CASE_VERB_VOICECALL, SND_UCM_ID_VERB_VOICECALL);
+    alsa_handle_t *fm = add(list, SND_USE_CASE_MOD_PLAY_FM, SND_UCM_ID_MOD_PLAY_FM);
+    alsa_handle_t *voiceMod = add(list, SND_USE_CASE_MOD_PLAY_VOICE, SND_UCM_ID_MOD_PLAY_VOICE);
+    alsa_handle_t *lpa = add(list, SND_USE_CASE_VERB_HIFI_LOW_POWER, SND_UCM_ID_VERB_HIFI_LOW_POWER);
+
+    EXPECT(list.last() == lpa);
+    EXPECT(list.find(HANDLE_CLASS_VOICE) == voice);
+    EXPECT(list.find(HANDLE_CLASS_FM) == fm);
+    EXPECT(list.find(HANDLE_CLASS_LPA) == lpa);
+    EXPECT(list.find(HANDLE_CLASS_VOLTE) == NULL);
+    EXPECT(list.find(HANDLE_CLASS_VOIP) == NULL);
+    EXPECT(list.find(HANDLE_CLASS_NONE) == NULL);
+    EXPECT(list.find(HANDLE_CLASS_COUNT) == NULL);
+    EXPECT(handleClass(hifi->useCaseId) == HANDLE_CLASS_NONE);
+
+    // the oldest handle of a class wins, erasing it falls back to the next
+    EXPECT(list.erase(voice));
+    EXPECT(!list.erase(voice));
+    EXPECT(list.find(HANDLE_CLASS_VOICE) == voiceMod);
+
+    // a handle switching between the verb and the modifier stays found
+    setUseCase(voiceMod, SND_USE_CASE_VERB_VOICECALL, SND_UCM_ID_VERB_VOICECALL);
+    EXPECT(list.find(HANDLE_CLASS_VOICE) == voiceMod);
+
+    // one leaving its class is rescanned
+    alsa_handle_t *voice2 = add(list, SND_USE_CASE_MOD_PLAY_VOICE, SND_UCM_ID_MOD_PLAY_VOICE);
+    setUseCase(voiceMod, SND_USE_CASE_VERB_HIFI, SND_UCM_ID_VERB_HIFI);
+    EXPECT(list.find(HANDLE_CLASS_VOICE) == voice2);
+    setUseCase(voice2, SND_USE_CASE_VERB_HIFI, SND_UCM_ID_VERB_HIFI);
+    EXPECT(list.find(HANDLE_CLASS_VOICE) == NULL);
+
+    // erasing by iterator updates the index as well
+    for (ALSAHandleList::iterator it = list.begin(); it != list.end(); ) {
+        if (&(*it) == fm)
+            it = list.erase(it);
+        else
+            ++it;
+    }
+    EXPECT(list.find(HANDLE_CLASS_FM) == NULL);
+    EXPECT(list.find(HANDLE_CLASS_LPA) == lpa);
+
+    list.clear();
+    EXPECT(list.last() == NULL);
+    EXPECT(list.find(HANDLE_CLASS_LPA) == NULL);
+}
+
+static int64_t nowNs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// the walk doRouting() did before the list was indexed
+static alsa_handle_t *walk(ALSAHandleList &list)
+{
+    for (ALSAHandleList::iterator it = list.begin(); it != list.end(); ++it) {
+        if (!strcmp(it->useCase, SND_USE_CASE_VERB_HIFI_LOW_POWER) ||
+            !strcmp(it->useCase, SND_USE_CASE_MOD_PLAY_LPA) ||
+            !strcmp(it->useCase, SND_USE_CASE_VERB_VOICECALL) ||
+            !strcmp(it->useCase, SND_USE_CASE_MOD_PLAY_VOICE) ||
+            !strcmp(it->useCase, SND_USE_CASE_VERB_DIGITAL_RADIO) ||
+            !strcmp(it->useCase, SND_USE_CASE_MOD_PLAY_FM))
+            return &(*it);
+    }
+    return NULL;
+}
+
+static alsa_handle_t *findFirst(ALSAHandleList &list)
+{
+    alsa_handle_t *handle = list.find(HANDLE_CLASS_LPA);
+
+    if (handle == NULL)
+        handle = list.find(HANDLE_CLASS_VOICE);
+    if (handle == NULL)
+        handle = list.find(HANDLE_CLASS_FM);
+    return handle;
+}
+
+static void benchRouting()
+{
+    static const struct {
+        const char *name;
+        int id;
+    } sPlayback[] = {
+        { SND_USE_CASE_VERB_HIFI, SND_UCM_ID_VERB_HIFI },
+        { SND_USE_CASE_MOD_PLAY_MUSIC, SND_UCM_ID_MOD_PLAY_MUSIC },
+        { SND_USE_CASE_MOD_CAPTURE_MUSIC, SND_UCM_ID_MOD_CAPTURE_MUSIC },
+        { SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC, SND_UCM_ID_VERB_HIFI_LOWLATENCY_MUSIC },
+        { SND_USE_CASE_VERB_HIFI2, SND_UCM_ID_VERB_HIFI2 },
+    };
+    const int kinds = sizeof(sPlayback) / sizeof(sPlayback[0]);
+    double walkNs = 0, findNs = 0;
+
+    for (int count = 4; count <= BENCH_MAX_HANDLES; count *= 2) {
+        ALSAHandleList list;
+        alsa_handle_t *found = NULL;
+        int64_t start;
+
+        // the handle routing looks for is the newest one, the worst case
+        for (int i = 0; i < count - 1; i++)
+            add(list, sPlayback[i % kinds].name, sPlayback[i % kinds].id);
+        alsa_handle_t *lpa = add(list, SND_USE_CASE_MOD_PLAY_LPA, SND_UCM_ID_MOD_PLAY_LPA);
+
+        start = nowNs();
+        for (int r = 0; r < BENCH_ROUNDS; r++) {
+            found = walk(list);
+            BENCH_CLOBBER();
+        }
+        walkNs = (double)(nowNs() - start) / BENCH_ROUNDS;
+        EXPECT(found == lpa);
+
+        start = nowNs();
+        for (int r = 0; r < BENCH_ROUNDS; r++) {
+            found = findFirst(list);
+            BENCH_CLOBBER();
+        }
+        findNs = (double)(nowNs() - start) / BENCH_ROUNDS;
+        EXPECT(found == lpa);
+
+        printf("%2d handles: list walk %.1f ns, find() %.1f ns\n", count, walkNs, findNs);
+    }
+    EXPECT(findNs < walkNs);
+}
+
+int main()
+{
+    testClasses();
+    benchRouting();
+
+    printf("PASS\n");
+    return 0;
+}
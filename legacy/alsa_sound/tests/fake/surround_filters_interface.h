@@ -0,0 +1,15 @@
+/* Host stand-in for the surround sound filter library interface. The
+ * functions are defined by the test that links AudioSurroundPipeline. */
+#ifndef FAKE_SURROUND_FILTERS_INTERFACE_H
+#define FAKE_SURROUND_FILTERS_INTERFACE_H
+
+typedef short Word16;
+
+int surround_filters_init(void *filter, int numOutChannels, int numInChannels,
+                          Word16 **realCoeffs, Word16 **imagCoeffs, int subwoofer,
+                          int lowFreq, int highFreq, void *profiler);
+void surround_filters_release(void *filter);
+int surround_filters_set_channel_map(void *filter, const int *chanMap);
+void surround_filters_intl_process(void *filter, Word16 *out, Word16 *in);
+
+#endif
@@ -0,0 +1,301 @@
+/* period_writer_test.cpp
+
+Copyright (C) 2026 The LineageOS Project
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The LineageOS Project nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
+
+
+/*
+ * Runs the write() loop of AudioStreamOutALSA against a fake pcm_write()
+ * that records every transfer. Buffers that do not line up with the
+ * period must reach the pcm in whole periods and in order, with the tail
+ * carried to the next write and counted as consumed. VoIP packets must
+ * go out one period at a time, and a failed pcm_write() must be retried
+ * after the stream recovers.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "ALSAPeriodWriter.h"
+
+extern "C" {
+#include <sound/asound.h>
+#include "alsa_audio.h"
+}
+
+#define EXPECT(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+#define TEST_FRAME_SIZE  4      // 16 bit stereo
+#define TEST_PERIOD      (240 * TEST_FRAME_SIZE)
+#define TEST_PACKET      (160 * 2)
+
+static struct pcm sPcm;
+static std::vector<unsigned char> sWritten;     // what reached the pcm
+static std::vector<unsigned> sTransfers;        // size of each pcm_write()
+static int sFailWrites;                         // pcm_write() calls left to fail
+
+extern "C" int pcm_write(struct pcm *pcm, void *data, unsigned count)
+{
+    const unsigned char *bytes = (const unsigned char *) data;
+
+    EXPECT(pcm == &sPcm);
+    if (sFailWrites) {
+        sFailWrites--;
+        return -EPIPE;
+    }
+    sTransfers.push_back(count);
+    sWritten.insert(sWritten.end(), bytes, bytes + count);
+    return 0;
+}
+
+namespace android_audio_legacy
+{
+
+class TestSink : public ALSAPeriodWriter::Sink
+{
+public:
+    TestSink(size_t periodSize) :
+        open(true), periodSize(periodSize), recoveredPeriodSize(periodSize),
+        recoverError(android::NO_ERROR), recoveries(0) {}
+
+    virtual struct pcm *writePcm() { return open ? &sPcm : NULL; }
+    virtual size_t      writePeriodSize() { return periodSize; }
+    virtual status_t    recover(int err)
+    {
+        EXPECT(err == -EPIPE);
+        recoveries++;
+        periodSize = recoveredPeriodSize;
+        return recoverError;
+    }
+
+    bool                open;
+    size_t              periodSize;
+    size_t              recoveredPeriodSize;
+    status_t            recoverError;
+    int                 recoveries;
+};
+
+class ALSAPeriodWriterTest
+{
+public:
+    static void testTailCarry();
+    static void testStagedTail();
+    static void testPackets();
+    static void testRecover();
+
+private:
+    static void fill(std::vector<unsigned char> &buf, size_t offset)
+    {
+        for (size_t i = 0; i < buf.size(); i++)
+            buf[i] = (unsigned char) ((offset + i) * 7 + ((offset + i) >> 8));
+    }
+
+    static void clear()
+    {
+        sWritten.clear();
+        sTransfers.clear();
+        sFailWrites = 0;
+    }
+};
+
+// buffer sizes AudioFlinger hands a deep buffer or a resampled track
+static const size_t sWriteSizes[] = {
+    100, 700, 1000, 37, TEST_PERIOD, 3 * TEST_PERIOD + 1, TEST_PERIOD - 1, 1, 4096, 2,
+};
+
+void ALSAPeriodWriterTest::testTailCarry()
+{
+    ALSAPeriodWriter writer;
+    TestSink sink(TEST_PERIOD);
+    std::vector<unsigned char> input;
+    size_t total = 0;
+
+    clear();
+    for (size_t w = 0; w < sizeof(sWriteSizes) / sizeof(sWriteSizes[0]); w++) {
+        std::vector<unsigned char> buf(sWriteSizes[w]);
+        size_t transfers = sTransfers.size();
+
+        fill(buf, total);
+        input.insert(input.end(), buf.begin(), buf.end());
+        total += buf.size();
+
+        EXPECT(writer.write(&sink, &buf[0], buf.size(), TEST_FRAME_SIZE, false) ==
+               (ssize_t) buf.size());
+        // at most the staged period and one run of whole periods
+        EXPECT(sTransfers.size() - transfers <= 2);
+        EXPECT(writer.mStagingBytes == total % TEST_PERIOD);
+        EXPECT(sWritten.size() == total - total % TEST_PERIOD);
+    }
+
+    for (size_t i = 0; i < sTransfers.size(); i++)
+        EXPECT(sTransfers[i] && sTransfers[i] % TEST_PERIOD == 0);
+    EXPECT(memcmp(&sWritten[0], &input[0], sWritten.size()) == 0);
+    EXPECT(writer.frames() == sWritten.size() / TEST_FRAME_SIZE);
+    EXPECT(writer.mWriteCount == sizeof(sWriteSizes) / sizeof(sWriteSizes[0]));
+    EXPECT(writer.mPcmWriteCount == sTransfers.size());
+
+    // standby drops the tail, the next write starts a new period
+    writer.reset();
+    EXPECT(writer.mStagingBytes == 0 && writer.frames() == 0);
+}
+
+void ALSAPeriodWriterTest::testStagedTail()
+{
+    ALSAPeriodWriter writer;
+    TestSink sink(TEST_PERIOD);
+    std::vector<unsigned char> buf(TEST_PERIOD);
+
+    clear();
+    fill(buf, 0);
+
+    // a staged tail counts as written, or AudioFlinger would send it again
+    EXPECT(writer.write(&sink, &buf[0], 100, TEST_FRAME_SIZE, false) == 100);
+    EXPECT(sTransfers.empty() && writer.mStagingBytes == 100);
+    EXPECT(writer.frames() == 0);
+
+    // completing the period sends it and stages the rest
+    EXPECT(writer.write(&sink, &buf[100], TEST_PERIOD - 100, TEST_FRAME_SIZE, false) ==
+           TEST_PERIOD - 100);
+    EXPECT(sTransfers.size() == 1 && sTransfers[0] == TEST_PERIOD);
+    EXPECT(memcmp(&sWritten[0], &buf[0], TEST_PERIOD) == 0);
+    EXPECT(writer.mStagingBytes == 0);
+    EXPECT(writer.frames() == TEST_PERIOD / TEST_FRAME_SIZE);
+
+    // nothing to write to, the buffer is dropped and not staged
+    sink.open = false;
+    EXPECT(writer.write(&sink, &buf[0], 100, TEST_FRAME_SIZE, false) == 100);
+    EXPECT(writer.mStagingBytes == 0 && sTransfers.size() == 1);
+
+    // nor is anything staged without a period size
+    sink.open = true;
+    sink.periodSize = 0;
+    EXPECT(writer.write(&sink, &buf[0], 100, TEST_FRAME_SIZE, false) == 100);
+    EXPECT(writer.mStagingBytes == 0 && sTransfers.size() == 1);
+}
+
+void ALSAPeriodWriterTest::testPackets()
+{
+    ALSAPeriodWriter writer;
+    TestSink sink(TEST_PACKET);
+    std::vector<unsigned char> buf(3 * TEST_PACKET + 40);
+
+    clear();
+    fill(buf, 0);
+
+    EXPECT(writer.write(&sink, &buf[0], buf.size(), 2, true) == (ssize_t) buf.size());
+    EXPECT(sTransfers.size() == 4);
+    for (size_t i = 0; i < sTransfers.size(); i++)
+        EXPECT(sTransfers[i] <= TEST_PACKET);
+    EXPECT(sTransfers[3] == 40);
+    EXPECT(sWritten == buf);
+    // packets are never held back
+    EXPECT(writer.mStaging == NULL && writer.mStagingBytes == 0);
+    EXPECT(writer.frames() == buf.size() / 2);
+
+    // one packet at a time is one transfer each
+    clear();
+    EXPECT(writer.write(&sink, &buf[0], TEST_PACKET, 2, true) == TEST_PACKET);
+    EXPECT(sTransfers.size() == 1 && sTransfers[0] == TEST_PACKET);
+}
+
+void ALSAPeriodWriterTest::testRecover()
+{
+    std::vector<unsigned char> buf(2 * TEST_PERIOD + 100);
+
+    fill(buf, 0);
+
+    // the periods that failed go out again after the recovery
+    {
+        ALSAPeriodWriter writer;
+        TestSink sink(TEST_PERIOD);
+
+        clear();
+        sFailWrites = 1;
+        EXPECT(writer.write(&sink, &buf[0], buf.size(), TEST_FRAME_SIZE, false) ==
+               (ssize_t) buf.size());
+        EXPECT(sink.recoveries == 1);
+        EXPECT(sWritten.size() == 2 * TEST_PERIOD);
+        EXPECT(memcmp(&sWritten[0], &buf[0], sWritten.size()) == 0);
+        EXPECT(writer.mStagingBytes == 100);
+        EXPECT(writer.mPcmWriteCount == 2);
+    }
+
+    // a reopen with another period size drops the staged tail
+    {
+        ALSAPeriodWriter writer;
+        TestSink sink(TEST_PERIOD);
+
+        clear();
+        EXPECT(writer.write(&sink, &buf[0], 100, TEST_FRAME_SIZE, false) == 100);
+        sFailWrites = 1;
+        sink.recoveredPeriodSize = 2 * TEST_PERIOD;
+        EXPECT(writer.write(&sink, &buf[100], buf.size() - 100, TEST_FRAME_SIZE, false) ==
+               (ssize_t) (buf.size() - 100));
+        EXPECT(sink.recoveries == 1);
+        EXPECT(writer.mStagingSize >= 2 * TEST_PERIOD);
+        // the rest no longer fills a period and waits for the next write
+        EXPECT(sTransfers.empty());
+        EXPECT(writer.mStagingBytes == buf.size() - TEST_PERIOD);
+        EXPECT(memcmp(writer.mStaging, &buf[TEST_PERIOD], writer.mStagingBytes) == 0);
+    }
+
+    // the device does not come back, the buffer is dropped
+    {
+        ALSAPeriodWriter writer;
+        TestSink sink(TEST_PERIOD);
+
+        clear();
+        sFailWrites = 1;
+        sink.recoverError = android::NO_INIT;
+        EXPECT(writer.write(&sink, &buf[0], buf.size(), TEST_FRAME_SIZE, false) ==
+               (ssize_t) buf.size());
+        EXPECT(sink.recoveries == 1 && sTransfers.empty());
+    }
+}
+
+};        // namespace android_audio_legacy
+
+using android_audio_legacy::ALSAPeriodWriterTest;
+
+int main()
+{
+    ALSAPeriodWriterTest::testTailCarry();
+    ALSAPeriodWriterTest::testStagedTail();
+    ALSAPeriodWriterTest::testPackets();
+    ALSAPeriodWriterTest::testRecover();
+
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,289 @@
+/* surround_pipeline_test.cpp
+
+Copyright (C) 2026 The LineageOS Project
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The LineageOS Project nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
+
+
+/*
+ * Runs AudioSurroundPipeline against a fake pcm that produces a ramp and
+ * a fake filter that maps it to 6 channels in a known way, inline and
+ * with the filter thread. Every read must continue the ramp exactly, in
+ * chunks that do not line up with the filter frames, while the block
+ * counters stay within one ring. reset() must drop what is buffered.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "AudioSurroundPipeline.h"
+#include "AudioUtil.h"
+
+extern "C" {
+#include <sound/asound.h>
+#include "alsa_audio.h"
+#include "surround_filters_interface.h"
+}
+
+#define EXPECT(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+#define TEST_BLOCKS         200
+#define TEST_SLOW_FILTER_US 2000
+
+static int64_t sPcmFrames;      // frames the fake pcm produced
+static int sPcmError;           // returned by pcm_read() instead of data
+static unsigned int sFilterUs;  // time the fake filter takes
+
+int64_t AudioUtil::nowUs()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int16_t rampSample(int64_t frame, unsigned int channel)
+{
+    return (int16_t) ((frame * 4 + channel) & 0x7fff);
+}
+
+// what the fake filter makes of the ramp
+static int16_t surroundSample(int64_t frame, unsigned int channel)
+{
+    return rampSample(frame, channel & 3) ^ (channel >> 2);
+}
+
+extern "C" int pcm_read(struct pcm *pcm, void *data, unsigned count)
+{
+    int16_t *in = (int16_t *) data;
+
+    EXPECT(pcm != NULL);
+    EXPECT(count == SSR_INPUT_FRAME_SIZE * sizeof(int16_t));
+    if (sPcmError)
+        return sPcmError;
+    for (int f = 0; f < SSR_FRAME_SIZE; f++, sPcmFrames++) {
+        for (int c = 0; c < 4; c++)
+            in[f * 4 + c] = rampSample(sPcmFrames, c);
+    }
+    return 0;
+}
+
+extern "C" int surround_filters_init(void *filter, int numOutChannels, int numInChannels,
+                                     Word16 **realCoeffs, Word16 **imagCoeffs, int subwoofer,
+                                     int lowFreq, int highFreq, void *profiler)
+{
+    return filter ? 0 : (int) sizeof(int);
+}
+
+extern "C" void surround_filters_release(void *filter)
+{
+}
+
+extern "C" int surround_filters_set_channel_map(void *filter, const int *chanMap)
+{
+    return 0;
+}
+
+extern "C" void surround_filters_intl_process(void *filter, Word16 *out, Word16 *in)
+{
+    if (sFilterUs)
+        usleep(sFilterUs);
+    for (int f = 0; f < SSR_FRAME_SIZE; f++) {
+        for (int c = 0; c < 6; c++)
+            out[f * 6 + c] = in[f * 4 + (c & 3)] ^ (c >> 2);
+    }
+}
+
+namespace android_audio_legacy
+{
+
+class AudioSurroundPipelineTest
+{
+public:
+    static void run(bool threaded, unsigned int filterUs);
+    static void reset(bool threaded);
+    static void readError();
+
+private:
+    static void start(AudioSurroundPipeline &pipeline, bool threaded);
+    static void checkCounters(AudioSurroundPipeline &pipeline);
+    static void readChecked(AudioSurroundPipeline &pipeline, size_t samples,
+                            int64_t *frame, unsigned int *channel);
+};
+
+static struct pcm *const sPcm = (struct pcm *) &sPcmFrames;
+
+// what init() sets up, without the coefficient files and properties
+void AudioSurroundPipelineTest::start(AudioSurroundPipeline &pipeline, bool threaded)
+{
+    pipeline.mIn = (int16_t *) calloc(SURROUND_RING_BLOCKS * SSR_INPUT_FRAME_SIZE,
+                                      sizeof(int16_t));
+    pipeline.mOut = (int16_t *) calloc(SURROUND_RING_BLOCKS * SSR_OUTPUT_FRAME_SIZE,
+                                       sizeof(int16_t));
+    pipeline.mFilter = calloc(1, surround_filters_init(NULL, 6, 4, NULL, NULL, 0, 0, 0, NULL));
+    EXPECT(pipeline.mIn != NULL && pipeline.mOut != NULL && pipeline.mFilter != NULL);
+    if (threaded) {
+        EXPECT(pthread_create(&pipeline.mThread, NULL,
+                              AudioSurroundPipeline::workerThreadWrapper, &pipeline) == 0);
+        pipeline.mThreaded = true;
+    }
+}
+
+void AudioSurroundPipelineTest::checkCounters(AudioSurroundPipeline &pipeline)
+{
+    pipeline.mLock.lock();
+    EXPECT(pipeline.mOutRear - pipeline.mOutFront <= pipeline.mInRear - pipeline.mOutFront);
+    EXPECT(pipeline.mInRear - pipeline.mOutFront <= SURROUND_RING_BLOCKS);
+    EXPECT(pipeline.mOutOffset < SSR_OUTPUT_FRAME_SIZE);
+    pipeline.mLock.unlock();
+}
+
+// reads samples and checks they continue the filtered ramp at frame/channel
+void AudioSurroundPipelineTest::readChecked(AudioSurroundPipeline &pipeline, size_t samples,
+                                            int64_t *frame, unsigned int *channel)
+{
+    int16_t *buf = (int16_t *) malloc(samples * sizeof(int16_t));
+
+    EXPECT(buf != NULL);
+    EXPECT(pipeline.read(sPcm, buf, samples * sizeof(int16_t)) ==
+           (ssize_t) (samples * sizeof(int16_t)));
+    for (size_t i = 0; i < samples; i++) {
+        EXPECT(buf[i] == surroundSample(*frame, *channel));
+        if (++*channel == 6) {
+            *channel = 0;
+            ++*frame;
+        }
+    }
+    free(buf);
+    checkCounters(pipeline);
+}
+
+void AudioSurroundPipelineTest::run(bool threaded, unsigned int filterUs)
+{
+    // none of them a multiple of the filter frame
+    static const size_t chunks[] = { 6, 1000, 2 * SSR_OUTPUT_FRAME_SIZE + 6, 4800, 1 };
+    const size_t total = (size_t) TEST_BLOCKS * SSR_OUTPUT_FRAME_SIZE;
+    AudioSurroundPipeline pipeline;
+    int64_t frame = 0;
+    unsigned int channel = 0;
+    size_t done = 0;
+
+    sPcmFrames = 0;
+    sPcmError = 0;
+    sFilterUs = filterUs;
+    start(pipeline, threaded);
+
+    for (int i = 0; done < total; i++) {
+        size_t samples = chunks[i % (sizeof(chunks) / sizeof(chunks[0]))];
+        if (samples > total - done)
+            samples = total - done;
+        readChecked(pipeline, samples, &frame, &channel);
+        done += samples;
+    }
+    EXPECT(frame == (int64_t) TEST_BLOCKS * SSR_FRAME_SIZE);
+
+    pipeline.mLock.lock();
+    printf("%s, filter %u us: %u blocks filtered, %u blocks read ahead, %u waits\n",
+           threaded ? "filter thread" : "inline", filterUs, pipeline.mBlocks,
+           pipeline.mInRear - pipeline.mOutFront, pipeline.mWaits);
+    EXPECT(pipeline.mOutFront == TEST_BLOCKS);
+    EXPECT(pipeline.mInRear <= TEST_BLOCKS + 1);
+    if (!threaded)
+        EXPECT(pipeline.mWaits == 0 && pipeline.mBlocks == TEST_BLOCKS);
+    else if (filterUs)
+        EXPECT(pipeline.mWaits > 0);
+    pipeline.mLock.unlock();
+}
+
+void AudioSurroundPipelineTest::reset(bool threaded)
+{
+    AudioSurroundPipeline pipeline;
+    int64_t frame = 0;
+    unsigned int channel = 0;
+
+    sPcmFrames = 0;
+    sPcmError = 0;
+    sFilterUs = threaded ? TEST_SLOW_FILTER_US : 0;
+    start(pipeline, threaded);
+
+    // stop halfway into a block, with the next one possibly read ahead
+    readChecked(pipeline, SSR_OUTPUT_FRAME_SIZE + SSR_OUTPUT_FRAME_SIZE / 2, &frame, &channel);
+    pipeline.reset();
+    EXPECT(pipeline.mInRear == 0 && pipeline.mOutRear == 0);
+    EXPECT(pipeline.mOutFront == 0 && pipeline.mOutOffset == 0);
+
+    // the buffered rest is dropped, reading resumes at the pcm
+    frame = sPcmFrames;
+    channel = 0;
+    readChecked(pipeline, 3 * SSR_OUTPUT_FRAME_SIZE, &frame, &channel);
+}
+
+void AudioSurroundPipelineTest::readError()
+{
+    AudioSurroundPipeline pipeline;
+    int16_t buf[6];
+    int64_t frame = 0;
+    unsigned int channel = 0;
+
+    sPcmFrames = 0;
+    sPcmError = -EIO;
+    sFilterUs = 0;
+    start(pipeline, false);
+
+    EXPECT(pipeline.read(sPcm, buf, sizeof(buf)) == -EIO);
+    checkCounters(pipeline);
+    EXPECT(pipeline.mInRear == 0);
+
+    // the failed block is read again
+    sPcmError = 0;
+    readChecked(pipeline, 2 * SSR_OUTPUT_FRAME_SIZE, &frame, &channel);
+}
+
+};        // namespace android_audio_legacy
+
+using android_audio_legacy::AudioSurroundPipelineTest;
+
+int main()
+{
+    AudioSurroundPipelineTest::run(false, 0);
+    AudioSurroundPipelineTest::run(true, 0);
+    AudioSurroundPipelineTest::run(true, TEST_SLOW_FILTER_US);
+    AudioSurroundPipelineTest::reset(false);
+    AudioSurroundPipelineTest::reset(true);
+    AudioSurroundPipelineTest::readError();
+
+    printf("PASS\n");
+    return 0;
+}
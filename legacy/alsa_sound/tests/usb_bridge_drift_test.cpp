@@ -0,0 +1,189 @@
+/* usb_bridge_drift_test.cpp
+
+Copyright (C) 2026 The LineageOS Project
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are
+met:
+    * Redistributions of source code must retain the above copyright
+      notice, this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above
+      copyright notice, this list of conditions and the following
+      disclaimer in the documentation and/or other materials provided
+      with the distribution.
+    * Neither the name of The LineageOS Project nor the names of its
+      contributors may be used to endorse or promote products derived
+      from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.*/
+
+/*
+ * Runs the ring and the drift loop of AudioUsbBridge against a simulated
+ * proxy source and USB sink whose clocks are offset by a fixed amount,
+ * and checks that the loop settles on the offset without over- or
+ * underflowing the ring. Time is simulated, AudioUtil::nowUs() follows
+ * the sink clock.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "AudioUsbBridge.h"
+#include "AudioUtil.h"
+
+#define EXPECT(cond) do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+#define SIM_RATE            48000
+#define SIM_CHANNELS        2
+#define SIM_FRAME_SIZE      (SIM_CHANNELS * sizeof(int16_t))
+#define SIM_SOURCE_PERIOD   768
+#define SIM_SINK_PERIOD     512
+#define SIM_SINK_PERIODS    4
+#define SIM_STEP            16      // sink frames per simulation step
+#define SIM_SECONDS         600
+#define SIM_SETTLE_SECONDS  300
+#define SIM_MAX_ERROR_PPM   20
+
+static int64_t sSimFrames;
+
+int64_t AudioUtil::nowUs()
+{
+    return sSimFrames * 1000000 / SIM_RATE;
+}
+
+namespace android_audio_legacy
+{
+
+class AudioUsbBridgeDriftTest
+{
+public:
+    static void run(double driftPpm);
+};
+
+void AudioUsbBridgeDriftTest::run(double driftPpm)
+{
+    static uint8_t sinkBuf[SIM_SINK_PERIODS * SIM_SINK_PERIOD * SIM_FRAME_SIZE];
+    int16_t in[SIM_SOURCE_PERIOD * SIM_CHANNELS];
+    struct snd_pcm_sw_params sw;
+    struct snd_pcm_sync_ptr syncPtr;
+    struct snd_pcm_mmap_status status;
+    struct snd_pcm_mmap_control control;
+    struct pcm source, sink;
+    AudioUsbBridge bridge("sim");
+    double sourceFrames = 0, phase = 0;
+    int32_t minPpm = INT32_MAX, maxPpm = INT32_MIN;
+    uint32_t target, ringFrames;
+    int i;
+
+    memset(&sw, 0, sizeof(sw));
+    memset(&syncPtr, 0, sizeof(syncPtr));
+    memset(&status, 0, sizeof(status));
+    memset(&control, 0, sizeof(control));
+    memset(&source, 0, sizeof(source));
+    memset(&sink, 0, sizeof(sink));
+    sw.boundary = 1u << 30;
+    sw.start_threshold = 1u << 29;
+    status.state = SNDRV_PCM_STATE_RUNNING;
+
+    // the source is only pushed into the ring, the sink is a real mmap buffer
+    source.flags = PCM_IN | PCM_MMAP;
+    source.period_size = SIM_SOURCE_PERIOD * SIM_FRAME_SIZE;
+    source.buffer_size = 4 * source.period_size;
+    sink.flags = PCM_OUT | PCM_MMAP;
+    sink.period_size = SIM_SINK_PERIOD * SIM_FRAME_SIZE;
+    sink.buffer_size = sizeof(sinkBuf);
+    sink.addr = sinkBuf;
+    sink.sw_p = &sw;
+    sink.sync_ptr = &syncPtr;
+    sink.mmap_status = &status;
+    sink.mmap_control = &control;
+    sink.running = 1;
+    sink.start = 1;
+
+    // same sizing as AudioUsbBridge::run()
+    bridge.setupEndpoint(&bridge.mSource, &source, true);
+    bridge.setupEndpoint(&bridge.mSink, &sink, false);
+    bridge.mChannels = SIM_CHANNELS;
+    bridge.mRate = SIM_RATE;
+    target = SIM_SOURCE_PERIOD + 2 * SIM_SINK_PERIOD;
+    for (ringFrames = 1; ringFrames < 4 * target; ringFrames <<= 1)
+        ;
+    bridge.mRing = (int16_t *) calloc(ringFrames, SIM_FRAME_SIZE);
+    bridge.mHistory = (int16_t *) calloc(2 * SIM_CHANNELS, sizeof(int16_t));
+    EXPECT(bridge.mRing != NULL && bridge.mHistory != NULL);
+    bridge.mPrev = bridge.mHistory;
+    bridge.mCur = bridge.mHistory + SIM_CHANNELS;
+    bridge.mRingFrames = ringFrames;
+    bridge.mRingMask = ringFrames - 1;
+    bridge.mTargetFrames = target;
+    bridge.mStats.targetFrames = target;
+    bridge.mStats.fillMin = ringFrames;
+
+    for (sSimFrames = 0; sSimFrames < (int64_t) SIM_SECONDS * SIM_RATE;
+         sSimFrames += SIM_STEP) {
+        sourceFrames += SIM_STEP * (1 + driftPpm / 1000000);
+        while (sourceFrames >= SIM_SOURCE_PERIOD) {
+            for (i = 0; i < SIM_SOURCE_PERIOD; i++) {
+                in[2 * i] = in[2 * i + 1] = (int16_t) (10000 * sin(phase));
+                phase += 2 * M_PI * 1000 / SIM_RATE;
+            }
+            bridge.push(in, SIM_SOURCE_PERIOD);
+            sourceFrames -= SIM_SOURCE_PERIOD;
+        }
+        status.hw_ptr += SIM_STEP;
+        syncPtr.s.status.hw_ptr = status.hw_ptr;
+        while (pcm_avail(&sink) >= SIM_SINK_PERIOD)
+            EXPECT(bridge.writePeriod() == 0);
+
+        if (sSimFrames > (int64_t) SIM_SETTLE_SECONDS * SIM_RATE) {
+            if (bridge.mStats.driftPpm < minPpm)
+                minPpm = bridge.mStats.driftPpm;
+            if (bridge.mStats.driftPpm > maxPpm)
+                maxPpm = bridge.mStats.driftPpm;
+        }
+    }
+
+    printf("offset %+.0f ppm: correction %d..%d ppm, fill %u..%u, "
+           "underflows %u, overflow %u frames\n", driftPpm, minPpm, maxPpm,
+           bridge.mStats.fillMin, bridge.mStats.fillMax,
+           bridge.mStats.underflows, bridge.mStats.overflowFrames);
+    EXPECT(fabs(minPpm - driftPpm) <= SIM_MAX_ERROR_PPM);
+    EXPECT(fabs(maxPpm - driftPpm) <= SIM_MAX_ERROR_PPM);
+    EXPECT(bridge.mStats.underflows == 0);
+    EXPECT(bridge.mStats.overflowFrames == 0);
+
+    free(bridge.mRing);
+    free(bridge.mHistory);
+    bridge.mRing = NULL;
+    bridge.mHistory = NULL;
+}
+
+};        // namespace android_audio_legacy
+
+int main()
+{
+    static const double offsets[] = { 0, 300, -450, 1500 };
+    unsigned i;
+
+    for (i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++)
+        android_audio_legacy::AudioUsbBridgeDriftTest::run(offsets[i]);
+    printf("PASS\n");
+    return 0;
+}
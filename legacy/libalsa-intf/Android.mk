@@ -5,7 +5,7 @@ ifeq ($(strip $(BOARD_USES_ALSA_AUDIO)),true)
 
 include $(CLEAR_VARS)
 #LOCAL_SRC_FILES:= aplay.c alsa_pcm.c alsa_mixer.c
-LOCAL_SRC_FILES:= aplay.c
+LOCAL_SRC_FILES:= aplay.c alsa_bench.c
 LOCAL_MODULE:= aplay
 LOCAL_LICENSE_KINDS:= SPDX-license-identifier-Apache-2.0 SPDX-license-identifier-BSD SPDX-license-identifier-LGPL
 LOCAL_LICENSE_CONDITIONS:= notice restricted
@@ -15,7 +15,7 @@ include $(BUILD_EXECUTABLE)
 
 include $(CLEAR_VARS)
 #LOCAL_SRC_FILES:= arec.c alsa_pcm.c
-LOCAL_SRC_FILES:= arec.c
+LOCAL_SRC_FILES:= arec.c alsa_bench.c
 LOCAL_MODULE:= arec
 LOCAL_LICENSE_KINDS:= SPDX-license-identifier-Apache-2.0 SPDX-license-identifier-BSD SPDX-license-identifier-LGPL
 LOCAL_LICENSE_CONDITIONS:= notice restricted
@@ -41,6 +41,52 @@ LOCAL_SHARED_LIBRARIES:= libc libcutils libalsa-intf
 LOCAL_MODULE_TAGS:= debug
 include $(BUILD_EXECUTABLE)
 
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES:= alsaucm_compile.c
+LOCAL_MODULE:= alsaucm_compile
+LOCAL_LICENSE_KINDS:= SPDX-license-identifier-Apache-2.0 SPDX-license-identifier-BSD SPDX-license-identifier-LGPL
+LOCAL_LICENSE_CONDITIONS:= notice restricted
+LOCAL_SHARED_LIBRARIES:= libc libcutils libalsa-intf
+LOCAL_MODULE_TAGS:= debug
+include $(BUILD_EXECUTABLE)
+
+# Host build of the UCM compiler, to generate images from the text
+# configs while building the system image
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES:= alsaucm_compile.c alsa_mixer.c alsa_pcm.c alsa_ucm.c
+LOCAL_MODULE:= alsaucm_compile
+LOCAL_MODULE_HOST_OS:= linux
+LOCAL_LICENSE_KINDS:= SPDX-license-identifier-Apache-2.0 SPDX-license-identifier-BSD SPDX-license-identifier-LGPL
+LOCAL_LICENSE_CONDITIONS:= notice restricted
+LOCAL_CFLAGS := -DANDROID -D_GNU_SOURCE -DCONFIG_DIR=\"/system/etc/snd_soc_msm/\"
+LOCAL_STATIC_LIBRARIES:= libcutils liblog
+LOCAL_LDLIBS:= -lpthread -ldl
+include $(BUILD_HOST_EXECUTABLE)
+
+# Compiled UCM images, installed next to the text configs. A device sets
+# BOARD_ALSA_UCM_CONFIG_DIR to the directory of the configs it copies to
+# /system/etc/snd_soc_msm/, lists its cards in BOARD_ALSA_UCM_IMAGE_CARDS
+# and adds <card>.bin to PRODUCT_PACKAGES.
+ifneq ($(strip $(BOARD_ALSA_UCM_IMAGE_CARDS)),)
+ALSA_UCM_COMPILE := $(HOST_OUT_EXECUTABLES)/alsaucm_compile$(HOST_EXECUTABLE_SUFFIX)
+
+define alsa-ucm-image
+include $$(CLEAR_VARS)
+LOCAL_MODULE := $(1).bin
+LOCAL_MODULE_CLASS := ETC
+LOCAL_MODULE_PATH := $$(TARGET_OUT_ETC)/snd_soc_msm
+LOCAL_LICENSE_KINDS:= SPDX-license-identifier-Apache-2.0 SPDX-license-identifier-BSD SPDX-license-identifier-LGPL
+LOCAL_LICENSE_CONDITIONS:= notice restricted
+include $$(BUILD_SYSTEM)/base_rules.mk
+$$(LOCAL_BUILT_MODULE): PRIVATE_CARD := $(1)
+$$(LOCAL_BUILT_MODULE): $$(ALSA_UCM_COMPILE) $$(wildcard $$(BOARD_ALSA_UCM_CONFIG_DIR)/*)
+	@mkdir -p $$(dir $$@)
+	$$(hide) $$(ALSA_UCM_COMPILE) $$(PRIVATE_CARD) $$(BOARD_ALSA_UCM_CONFIG_DIR) $$@
+endef
+
+$(foreach card,$(BOARD_ALSA_UCM_IMAGE_CARDS),$(eval $(call alsa-ucm-image,$(card))))
+endif
+
 include $(CLEAR_VARS)
 LOCAL_COPY_HEADERS_TO   := mm-audio/libalsa-intf
 LOCAL_COPY_HEADERS      := alsa_audio.h
@@ -39,6 +39,9 @@ struct pcm {
     struct snd_pcm_sync_ptr *sync_ptr;
     struct snd_pcm_channel_info ch[2];
     void *addr;
+    /* driver status/control pages, NULL unless they could be mapped */
+    struct snd_pcm_mmap_status *mmap_status;
+    struct snd_pcm_mmap_control *mmap_control;
     int card_no;
     int device_no;
     int start;
@@ -129,6 +132,9 @@ struct mixer {
     struct snd_ctl_elem_info *info;
     struct mixer_ctl *ctl;
     unsigned count;
+    /* open addressed name index, slots hold control index + 1 */
+    unsigned *name_index;
+    unsigned name_index_size;
 };
 
 int get_format(const char* name);
@@ -152,6 +158,7 @@ int param_set_sw_params(struct pcm *pcm, struct snd_pcm_sw_params *sparams);
 void param_dump(struct snd_pcm_hw_params *p);
 int pcm_prepare(struct pcm *pcm);
 long pcm_avail(struct pcm *pcm);
+unsigned pcm_frame_size(struct pcm *pcm);
 
 /* Returns a human readable reason for the last error. */
 const char *pcm_error(struct pcm *pcm);
@@ -169,6 +176,31 @@ int pcm_period_size(struct snd_pcm_hw_params *params);
 int pcm_write(struct pcm *pcm, void *data, unsigned count);
 int pcm_read(struct pcm *pcm, void *data, unsigned count);
 
+/* Direct access to a buffer set up by mmap_buffer().
+ *
+ * pcm_mmap_avail() refreshes the hardware pointer and returns the frames
+ * that can be written (playback) or read (capture). pcm_mmap_write() and
+ * pcm_mmap_read() copy frames to/from the ring at the application pointer,
+ * wrapping at the end of the buffer, advance it and sync with the driver
+ * in one SYNC_PTR ioctl, or none when the status and control pages are
+ * mapped. They fail with -EAGAIN rather than block when fewer than frames
+ * are available as of the last sync. Playback is started once
+ * start_threshold frames are queued.
+ *
+ * Callers that fill or drain the ring themselves use pcm_mmap_begin() to
+ * get the contiguous area at the application pointer and
+ * pcm_mmap_commit() to advance it.
+ *
+ * All return a negative errno on error, -EPIPE on xrun after which the
+ * stream has to be prepared again.
+ */
+long pcm_mmap_avail(struct pcm *pcm);
+int pcm_mmap_write(struct pcm *pcm, const void *data, unsigned frames);
+int pcm_mmap_read(struct pcm *pcm, void *data, unsigned frames);
+int pcm_mmap_begin(struct pcm *pcm, void **areas, unsigned *offset,
+                   unsigned *frames);
+int pcm_mmap_commit(struct pcm *pcm, unsigned frames);
+
 struct mixer;
 struct mixer_ctl;
 
@@ -0,0 +1,567 @@
+/*
+** Copyright (C) 2026 The LineageOS Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/poll.h>
+#include <sys/ioctl.h>
+
+#include <sound/asound.h>
+#include "alsa_audio.h"
+#include "alsa_bench.h"
+
+#define BENCH_DEFAULT_DURATION  10
+#define BENCH_IMPULSE_FRAMES    32
+#define BENCH_IMPULSE_LEVEL     16384
+#define BENCH_DETECT_LEVEL      (BENCH_IMPULSE_LEVEL / 2)
+/* one impulse is in flight at a time, it is given up after a second */
+#define BENCH_IMPULSE_INTERVAL  500000
+#define BENCH_IMPULSE_TIMEOUT   1000000
+#define BENCH_STRESS_BYTES      (1024 * 1024)
+
+struct bench_stats {
+    unsigned count;
+    int64_t min;
+    int64_t max;
+    double sum;
+    double sumsq;
+};
+
+static volatile int stress_stop;
+
+static int64_t now_us(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void stats_add(struct bench_stats *s, int64_t v)
+{
+    if (!s->count || v < s->min)
+        s->min = v;
+    if (!s->count || v > s->max)
+        s->max = v;
+    s->count++;
+    s->sum += v;
+    s->sumsq += (double) v * v;
+}
+
+/* min,avg,max,stddev */
+static void stats_print(struct bench_stats *s)
+{
+    double avg = 0, var = 0;
+
+    if (s->count) {
+        avg = s->sum / s->count;
+        var = s->sumsq / s->count - avg * avg;
+    }
+    printf("%lld,%.1f,%lld,%.1f", (long long) s->min, avg, (long long) s->max,
+           var > 0 ? sqrt(var) : 0.0);
+}
+
+static unsigned channel_flag(unsigned channels)
+{
+    switch (channels) {
+    case 1:
+        return PCM_MONO;
+    case 4:
+        return PCM_QUAD;
+    case 6:
+        return PCM_5POINT1;
+    default:
+        return PCM_STEREO;
+    }
+}
+
+static struct pcm *bench_open(struct bench_config *cfg, char *device,
+                              unsigned dir, unsigned period_bytes)
+{
+    struct snd_pcm_hw_params *params;
+    struct snd_pcm_sw_params *sparams;
+    struct pcm *pcm;
+    unsigned frame_size;
+
+    pcm = pcm_open(dir | (cfg->flags & PCM_MMAP) | channel_flag(cfg->channels) |
+                   DEBUG_OFF, device);
+    if (!pcm_ready(pcm)) {
+        fprintf(stderr, "bench: cannot open %s\n", device);
+        pcm_close(pcm);
+        return NULL;
+    }
+    pcm->channels = cfg->channels;
+    pcm->rate = cfg->rate;
+    pcm->format = SNDRV_PCM_FORMAT_S16_LE;
+
+    params = (struct snd_pcm_hw_params *) calloc(1, sizeof(*params));
+    sparams = (struct snd_pcm_sw_params *) calloc(1, sizeof(*sparams));
+    if (!params || !sparams) {
+        free(params);
+        free(sparams);
+        pcm_close(pcm);
+        return NULL;
+    }
+    param_init(params);
+    param_set_mask(params, SNDRV_PCM_HW_PARAM_ACCESS,
+                   (pcm->flags & PCM_MMAP) ? SNDRV_PCM_ACCESS_MMAP_INTERLEAVED :
+                                             SNDRV_PCM_ACCESS_RW_INTERLEAVED);
+    param_set_mask(params, SNDRV_PCM_HW_PARAM_FORMAT, pcm->format);
+    param_set_mask(params, SNDRV_PCM_HW_PARAM_SUBFORMAT, SNDRV_PCM_SUBFORMAT_STD);
+    if (period_bytes)
+        param_set_min(params, SNDRV_PCM_HW_PARAM_PERIOD_BYTES, period_bytes);
+    else
+        param_set_min(params, SNDRV_PCM_HW_PARAM_PERIOD_TIME, 10);
+    param_set_int(params, SNDRV_PCM_HW_PARAM_SAMPLE_BITS, 16);
+    param_set_int(params, SNDRV_PCM_HW_PARAM_FRAME_BITS, pcm->channels * 16);
+    param_set_int(params, SNDRV_PCM_HW_PARAM_CHANNELS, pcm->channels);
+    param_set_int(params, SNDRV_PCM_HW_PARAM_RATE, pcm->rate);
+#ifdef SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP
+    if (cfg->noirq)
+        params->flags |= SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP;
+#endif
+    param_set_hw_refine(pcm, params);
+    if (param_set_hw_params(pcm, params)) {
+        fprintf(stderr, "bench: cannot set hw params on %s\n", device);
+        free(params);
+        free(sparams);
+        pcm_close(pcm);
+        return NULL;
+    }
+    pcm->buffer_size = pcm_buffer_size(params);
+    pcm->period_size = pcm_period_size(params);
+    pcm->period_cnt = pcm->buffer_size / pcm->period_size;
+    frame_size = pcm_frame_size(pcm);
+
+    /*
+     * Playback only starts once the buffer is full, so every run begins
+     * with the same amount queued, capture starts right away.
+     */
+    sparams->tstamp_mode = SNDRV_PCM_TSTAMP_NONE;
+    sparams->period_step = 1;
+    sparams->avail_min = pcm->period_size / frame_size;
+    sparams->start_threshold = (dir & PCM_IN) ? 1 : pcm->buffer_size / frame_size;
+    sparams->stop_threshold = pcm->buffer_size / frame_size;
+    sparams->xfer_align = pcm->period_size / frame_size;
+    sparams->silence_size = 0;
+    sparams->silence_threshold = 0;
+    if (param_set_sw_params(pcm, sparams)) {
+        fprintf(stderr, "bench: cannot set sw params on %s\n", device);
+        free(sparams);
+        pcm_close(pcm);
+        return NULL;
+    }
+
+    if (((pcm->flags & PCM_MMAP) && mmap_buffer(pcm)) || pcm_prepare(pcm)) {
+        fprintf(stderr, "bench: cannot prepare %s\n", device);
+        pcm_close(pcm);
+        return NULL;
+    }
+    return pcm;
+}
+
+static int bench_restart(struct pcm *pcm)
+{
+    if (pcm_prepare(pcm))
+        return -errno;
+    if ((pcm->flags & PCM_IN) && (pcm->flags & PCM_MMAP)) {
+        if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_START))
+            return -errno;
+        pcm->start = 1;
+    }
+    return 0;
+}
+
+/*
+ * Wait for room or data for a period and move it. Read/write access
+ * blocks in the driver, mmap access polls the device or, without period
+ * interrupts, sleeps for as long as the missing frames take to play.
+ * Xruns are counted in pcm->underruns and the stream is restarted.
+ */
+static int bench_transfer(struct bench_config *cfg, struct pcm *pcm,
+                          void *buf, unsigned frames)
+{
+    struct pollfd pfd;
+    struct timespec ts;
+    long avail;
+    int err;
+
+    if (!(pcm->flags & PCM_MMAP)) {
+        if (pcm->flags & PCM_IN)
+            return pcm_read(pcm, buf, frames * pcm_frame_size(pcm));
+        return pcm_write(pcm, buf, frames * pcm_frame_size(pcm));
+    }
+
+    pfd.fd = pcm->fd;
+    pfd.events = (pcm->flags & PCM_IN) ? POLLIN : POLLOUT;
+    for (;;) {
+        if (!pcm->running) {
+            err = bench_restart(pcm);
+            if (err)
+                return err;
+        }
+        avail = pcm_avail(pcm);
+        if (avail < (long) frames)
+            avail = pcm_mmap_avail(pcm);
+        if (avail == -EPIPE)
+            continue;
+        if (avail < 0)
+            return avail;
+        if (avail >= (long) frames)
+            break;
+        /* less than a period short of the threshold, start it by hand */
+        if (!(pcm->flags & PCM_IN) && !pcm->start) {
+            if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_START))
+                return -errno;
+            pcm->start = 1;
+            continue;
+        }
+        if (cfg->noirq) {
+            int64_t us = (int64_t) (frames - avail) * 1000000 / cfg->rate;
+
+            ts.tv_sec = us / 1000000;
+            ts.tv_nsec = (us % 1000000) * 1000;
+            nanosleep(&ts, NULL);
+        } else {
+            poll(&pfd, 1, TIMEOUT_INFINITE);
+        }
+    }
+
+    if (pcm->flags & PCM_IN)
+        err = pcm_mmap_read(pcm, buf, frames);
+    else
+        err = pcm_mmap_write(pcm, buf, frames);
+    if (err == -EPIPE)
+        err = 0;
+    return err;
+}
+
+static void *stress_thread(void *arg)
+{
+    volatile uint32_t seed = 1;
+    uint8_t *mem = malloc(BENCH_STRESS_BYTES);
+    unsigned i;
+
+    /* keep a core busy and the caches cold */
+    while (!stress_stop) {
+        for (i = 0; i < 4096; i++)
+            seed = seed * 1664525 + 1013904223;
+        if (mem) {
+            for (i = 0; i < BENCH_STRESS_BYTES; i += 64)
+                mem[i] = (uint8_t) seed;
+        }
+    }
+    free(mem);
+    return NULL;
+}
+
+static const char *access_name(struct bench_config *cfg)
+{
+    return (cfg->flags & PCM_MMAP) ? "mmap" : "rw";
+}
+
+static int bench_stream(struct bench_config *cfg, unsigned period_bytes)
+{
+    struct bench_stats jitter;
+    struct pcm *pcm;
+    unsigned frames, skip, wakeups = 0;
+    int64_t nominal, start = 0, last = 0, now, end, cpu_start = 0, cpu_end;
+    unsigned long long moved = 0;
+    int xruns = 0;
+    double fps = 0;
+    void *buf;
+    int err = 0;
+
+    pcm = bench_open(cfg, cfg->device, cfg->flags & PCM_IN, period_bytes);
+    if (!pcm)
+        return -ENODEV;
+    frames = pcm->period_size / pcm_frame_size(pcm);
+    nominal = (int64_t) frames * 1000000 / cfg->rate;
+    buf = calloc(1, pcm->period_size);
+    if (!buf) {
+        pcm_close(pcm);
+        return -ENOMEM;
+    }
+    memset(&jitter, 0, sizeof(jitter));
+
+    /* the first buffer of playback goes in without waiting, skip it */
+    skip = pcm->period_cnt;
+    if (cfg->flags & PCM_IN)
+        err = bench_restart(pcm);
+    end = now_us(CLOCK_MONOTONIC) + (int64_t) cfg->duration * 1000000;
+    while (!err) {
+        err = bench_transfer(cfg, pcm, buf, frames);
+        if (err)
+            break;
+        now = now_us(CLOCK_MONOTONIC);
+        if (now >= end)
+            break;
+        if (skip) {
+            if (!--skip) {
+                start = last = now;
+                cpu_start = now_us(CLOCK_THREAD_CPUTIME_ID);
+                xruns = pcm->underruns;
+            }
+            continue;
+        }
+        stats_add(&jitter, now - last - nominal);
+        last = now;
+        moved += frames;
+        wakeups++;
+    }
+    cpu_end = now_us(CLOCK_THREAD_CPUTIME_ID);
+    xruns = pcm->underruns - xruns;
+    if (err)
+        fprintf(stderr, "bench: %s stopped with %d\n", cfg->device, err);
+
+    if (last > start)
+        fps = (double) moved * 1000000 / (last - start);
+    printf("stream,%s,%s,%d,%u,%u,%u,%u,%u,%u,", cfg->device, access_name(cfg),
+           cfg->noirq, cfg->rate, cfg->channels, frames, pcm->period_cnt,
+           cfg->stress, wakeups);
+    stats_print(&jitter);
+    printf(",%d,%llu,%.1f,%.0f,%.1f\n", xruns, moved, fps,
+           fps ? (fps / cfg->rate - 1.0) * 1000000 : 0.0,
+           wakeups ? (double) (cpu_end - cpu_start) / wakeups : 0.0);
+    fflush(stdout);
+
+    free(buf);
+    pcm_close(pcm);
+    return err;
+}
+
+static int find_impulse(int16_t *buf, unsigned frames, unsigned channels)
+{
+    unsigned i;
+
+    for (i = 0; i < frames; i++) {
+        int16_t s = buf[i * channels];
+
+        if (s > BENCH_DETECT_LEVEL || s < -BENCH_DETECT_LEVEL)
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * Capture paces the loop. After each captured period the playback side
+ * is topped back up to a full buffer, every so often with an impulse at
+ * the start of the period. The latency is taken from the moment that
+ * period was handed to the driver to the moment the captured impulse
+ * frame became available, so it includes the playback buffer.
+ */
+static int bench_latency(struct bench_config *cfg, unsigned period_bytes)
+{
+    struct bench_stats latency;
+    struct pcm *out, *in;
+    char *out_dev, *in_dev;
+    unsigned out_frames, in_frames, i, c, lost = 0;
+    unsigned long long written = 0, captured = 0, queue;
+    int64_t now, end, sent = 0, next;
+    int16_t *obuf = NULL, *ibuf = NULL;
+    int xruns, pending = 0, pos;
+    int err = 0;
+
+    if (cfg->flags & PCM_IN) {
+        in_dev = cfg->device;
+        out_dev = cfg->loopback;
+    } else {
+        out_dev = cfg->device;
+        in_dev = cfg->loopback;
+    }
+    memset(&latency, 0, sizeof(latency));
+    out = bench_open(cfg, out_dev, PCM_OUT, period_bytes);
+    if (!out)
+        return -ENODEV;
+    in = bench_open(cfg, in_dev, PCM_IN, period_bytes);
+    if (!in) {
+        pcm_close(out);
+        return -ENODEV;
+    }
+    out_frames = out->period_size / pcm_frame_size(out);
+    in_frames = in->period_size / pcm_frame_size(in);
+    queue = out->buffer_size / pcm_frame_size(out);
+    obuf = calloc(1, out->period_size);
+    ibuf = calloc(1, in->period_size);
+    if (!obuf || !ibuf) {
+        err = -ENOMEM;
+        goto done;
+    }
+
+    /* a full buffer of silence starts playback, then capture follows */
+    while (!err && written < queue) {
+        err = bench_transfer(cfg, out, obuf, out_frames);
+        written += out_frames;
+    }
+    if (!err)
+        err = bench_restart(in);
+    now = now_us(CLOCK_MONOTONIC);
+    end = now + (int64_t) cfg->duration * 1000000;
+    next = now + BENCH_IMPULSE_INTERVAL;
+    while (!err && now < end) {
+        err = bench_transfer(cfg, in, ibuf, in_frames);
+        if (err)
+            break;
+        now = now_us(CLOCK_MONOTONIC);
+        captured += in_frames;
+
+        if (pending) {
+            pos = find_impulse(ibuf, in_frames, cfg->channels);
+            if (pos >= 0) {
+                stats_add(&latency, now - sent -
+                          (int64_t) (in_frames - pos) * 1000000 / cfg->rate);
+                pending = 0;
+            } else if (now - sent > BENCH_IMPULSE_TIMEOUT) {
+                lost++;
+                pending = 0;
+            }
+        }
+
+        while (!err && written < captured + queue) {
+            int impulse = !pending && now >= next;
+
+            if (impulse) {
+                for (i = 0; i < BENCH_IMPULSE_FRAMES && i < out_frames; i++)
+                    for (c = 0; c < cfg->channels; c++)
+                        obuf[i * cfg->channels + c] = BENCH_IMPULSE_LEVEL;
+            }
+            err = bench_transfer(cfg, out, obuf, out_frames);
+            written += out_frames;
+            if (impulse) {
+                sent = now_us(CLOCK_MONOTONIC);
+                pending = 1;
+                next = sent + BENCH_IMPULSE_INTERVAL;
+                memset(obuf, 0, out->period_size);
+            }
+        }
+    }
+    if (err)
+        fprintf(stderr, "bench: %s -> %s stopped with %d\n", out_dev, in_dev, err);
+
+done:
+    xruns = out->underruns + in->underruns;
+    printf("latency,%s,%s,%s,%d,%u,%u,%u,%u,%u,%u,%u,", cfg->device, cfg->loopback,
+           access_name(cfg), cfg->noirq, cfg->rate, cfg->channels, out_frames,
+           out->period_cnt, cfg->stress, latency.count, lost);
+    stats_print(&latency);
+    printf(",%d\n", xruns);
+    fflush(stdout);
+
+    free(obuf);
+    free(ibuf);
+    pcm_close(in);
+    pcm_close(out);
+    return err;
+}
+
+int bench_parse_mode(const char *name)
+{
+    if (!strcmp(name, "latency"))
+        return BENCH_LATENCY;
+    if (!strcmp(name, "stream"))
+        return BENCH_STREAM;
+    return -EINVAL;
+}
+
+/* comma separated period sizes in bytes, "1024,2048,4096" */
+int bench_parse_periods(struct bench_config *cfg, const char *list)
+{
+    char *end;
+
+    cfg->num_periods = 0;
+    while (*list) {
+        if (cfg->num_periods == BENCH_MAX_PERIODS)
+            return -E2BIG;
+        cfg->periods[cfg->num_periods++] = (unsigned) strtoul(list, &end, 0);
+        if (end == list || (*end && *end != ','))
+            return -EINVAL;
+        list = *end ? end + 1 : end;
+    }
+    return 0;
+}
+
+int bench_run(struct bench_config *cfg)
+{
+    pthread_t threads[16];
+    unsigned i, nthreads = 0;
+    int err = 0, ret;
+
+    if (cfg->channels != 1 && cfg->channels != 2 && cfg->channels != 4 &&
+        cfg->channels != 6) {
+        fprintf(stderr, "bench: %u channels not supported\n", cfg->channels);
+        return -EINVAL;
+    }
+    if (cfg->mode == BENCH_LATENCY && !cfg->loopback) {
+        fprintf(stderr, "bench: latency needs a loopback device\n");
+        return -EINVAL;
+    }
+    if (cfg->noirq && !(cfg->flags & PCM_MMAP)) {
+        fprintf(stderr, "bench: running without period interrupts needs mmap\n");
+        return -EINVAL;
+    }
+#ifndef SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP
+    if (cfg->noirq) {
+        fprintf(stderr, "bench: kernel headers lack SNDRV_PCM_HW_PARAMS_NO_PERIOD_WAKEUP,"
+                " cannot run without period interrupts\n");
+        return -ENOTSUP;
+    }
+#endif
+    if (!cfg->duration)
+        cfg->duration = BENCH_DEFAULT_DURATION;
+    if (!cfg->num_periods) {
+        cfg->periods[0] = 0;
+        cfg->num_periods = 1;
+    }
+
+    if (cfg->mode == BENCH_LATENCY)
+        printf("mode,device,loopback,access,noirq,rate,channels,period_frames,"
+               "periods,stress,trials,lost,latency_min_us,latency_avg_us,"
+               "latency_max_us,latency_stddev_us,xruns\n");
+    else
+        printf("mode,device,access,noirq,rate,channels,period_frames,periods,"
+               "stress,wakeups,jitter_min_us,jitter_avg_us,jitter_max_us,"
+               "jitter_stddev_us,xruns,frames,frames_per_sec,rate_error_ppm,"
+               "cpu_us_per_period\n");
+
+    stress_stop = 0;
+    for (i = 0; i < cfg->stress && i < sizeof(threads) / sizeof(threads[0]); i++) {
+        if (pthread_create(&threads[i], NULL, stress_thread, NULL))
+            break;
+        nthreads++;
+    }
+    if (nthreads < cfg->stress)
+        fprintf(stderr, "bench: only %u stress threads started\n", nthreads);
+
+    for (i = 0; i < cfg->num_periods; i++) {
+        if (cfg->mode == BENCH_LATENCY)
+            ret = bench_latency(cfg, cfg->periods[i]);
+        else
+            ret = bench_stream(cfg, cfg->periods[i]);
+        if (ret && !err)
+            err = ret;
+    }
+
+    stress_stop = 1;
+    for (i = 0; i < nthreads; i++)
+        pthread_join(threads[i], NULL);
+    return err;
+}
@@ -0,0 +1,54 @@
+/*
+** Copyright (C) 2026 The LineageOS Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef _ALSA_BENCH_H_
+#define _ALSA_BENCH_H_
+
+/*
+ * Benchmark modes shared by aplay and arec. Results go to stdout as CSV,
+ * one header line per invocation and one row per period size, progress
+ * and errors go to stderr.
+ */
+
+#define BENCH_MAX_PERIODS 8
+
+enum bench_mode {
+    BENCH_NONE,
+    /* impulse through the device and its loopback, write to read time */
+    BENCH_LATENCY,
+    /* period wakeup jitter, xruns, throughput and cpu per period */
+    BENCH_STREAM,
+};
+
+struct bench_config {
+    int mode;
+    char *device;           /* device under test */
+    char *loopback;         /* other end of the loop, latency mode only */
+    unsigned flags;         /* PCM_IN or PCM_OUT, optionally PCM_MMAP */
+    unsigned rate;
+    unsigned channels;
+    unsigned periods[BENCH_MAX_PERIODS];    /* period sizes in bytes */
+    unsigned num_periods;
+    unsigned duration;      /* seconds per period size */
+    unsigned stress;        /* busy threads competing for the cpu */
+    int noirq;              /* no period interrupts, wake up on a timer */
+};
+
+int bench_parse_mode(const char *name);
+int bench_parse_periods(struct bench_config *cfg, const char *list);
+int bench_run(struct bench_config *cfg);
+
+#endif
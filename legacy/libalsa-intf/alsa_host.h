@@ -0,0 +1,53 @@
+/*
+** Copyright (C) 2026 The LineageOS Project
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+
+#ifndef _ALSA_HOST_H_
+#define _ALSA_HOST_H_
+
+/* Definitions missing when the library is built against glibc for the
+ * host UCM compiler. Not exported, the HAL always builds against bionic.
+ */
+
+#include <string.h>
+
+#if defined(__GLIBC__) && !defined(__BIONIC__) && !defined(strlcpy) && \
+    (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+static inline size_t alsa_host_strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+
+    if (size) {
+        size_t n = (len >= size) ? size - 1 : len;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+
+static inline size_t alsa_host_strlcat(char *dst, const char *src, size_t size)
+{
+    size_t dlen = strnlen(dst, size);
+
+    if (dlen == size)
+        return size + strlen(src);
+    return dlen + alsa_host_strlcpy(dst + dlen, src, size - dlen);
+}
+
+#define strlcpy alsa_host_strlcpy
+#define strlcat alsa_host_strlcat
+#endif
+
+#endif /* _ALSA_HOST_H_ */
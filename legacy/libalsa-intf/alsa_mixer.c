@@ -25,6 +25,7 @@
 #include <ctype.h>
 #include <math.h>
 
+#include <sys/ioctl.h>
 #include <linux/ioctl.h>
 #define __force
 #define __bitwise
@@ -34,6 +35,11 @@
 
 #include "alsa_audio.h"
 
+/* Removed from the uapi headers in Linux 5.x */
+#ifndef SNDRV_CTL_ELEM_ACCESS_TIMESTAMP
+#define SNDRV_CTL_ELEM_ACCESS_TIMESTAMP (1<<2)
+#endif
+
 #define LOG_TAG "alsa_mixer"
 #define LOG_NDEBUG 1
 
@@ -124,6 +130,45 @@ static const char *elem_type_name(snd_ctl_elem_type_t n)
     }
 }
 
+static unsigned mixer_name_hash(const char *name)
+{
+    unsigned hash = 2166136261u;
+    unsigned n;
+
+    for (n = 0; n < SNDRV_CTL_ELEM_ID_NAME_MAXLEN && name[n]; n++) {
+        hash ^= (unsigned char)name[n];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* Index control names so mixer_get_control() does not have to compare
+ * the name against every control on the card. Slots are filled in
+ * control order, so duplicate names resolve to the first control just
+ * like the linear scan does.
+ */
+static void mixer_build_name_index(struct mixer *mixer)
+{
+    unsigned n, slot, size = 16;
+
+    while (size < mixer->count * 2)
+        size <<= 1;
+
+    mixer->name_index = calloc(size, sizeof(unsigned));
+    if (!mixer->name_index) {
+        ALOGE("Failed to allocate mixer name index, using linear lookup\n");
+        return;
+    }
+    mixer->name_index_size = size;
+
+    for (n = 0; n < mixer->count; n++) {
+        slot = mixer_name_hash((char*) mixer->info[n].id.name) & (size - 1);
+        while (mixer->name_index[slot])
+            slot = (slot + 1) & (size - 1);
+        mixer->name_index[slot] = n + 1;
+    }
+}
+
 void mixer_close(struct mixer *mixer)
 {
     unsigned n,m;
@@ -146,6 +191,9 @@ void mixer_close(struct mixer *mixer)
     if (mixer->info)
         free(mixer->info);
 
+    if (mixer->name_index)
+        free(mixer->name_index);
+
     free(mixer);
 }
 
@@ -215,6 +263,8 @@ struct mixer *mixer_open(const char *device)
         }
     }
 
+    mixer_build_name_index(mixer);
+
     free(eid);
     return mixer;
 
@@ -284,7 +334,21 @@ void mixer_dump(struct mixer *mixer)
 struct mixer_ctl *mixer_get_control(struct mixer *mixer,
                                     const char *name, unsigned index)
 {
-    unsigned n;
+    unsigned n, slot;
+
+    if (mixer->name_index) {
+        slot = mixer_name_hash(name) & (mixer->name_index_size - 1);
+        while ((n = mixer->name_index[slot]) != 0) {
+            n--;
+            if (mixer->info[n].id.index == index &&
+                !strncmp(name, (char*) mixer->info[n].id.name,
+                         sizeof(mixer->info[n].id.name)))
+                return mixer->ctl + n;
+            slot = (slot + 1) & (mixer->name_index_size - 1);
+        }
+        return 0;
+    }
+
     for (n = 0; n < mixer->count; n++) {
         if (mixer->info[n].id.index == index) {
             if (!strncmp(name, (char*) mixer->info[n].id.name,
@@ -45,6 +45,7 @@
 #include <linux/types.h>
 
 #include "alsa_audio.h"
+#include "alsa_host.h"
 
 #define DEBUG 1
 
@@ -390,6 +391,17 @@ static int oops(struct pcm *pcm, int e, const char *fmt, ...)
     return -1;
 }
 
+unsigned pcm_frame_size(struct pcm *pcm)
+{
+    if (pcm->flags & PCM_MONO)
+        return 2;
+    else if (pcm->flags & PCM_QUAD)
+        return 8;
+    else if (pcm->flags & PCM_5POINT1)
+        return 12;
+    return 4;
+}
+
 long pcm_avail(struct pcm *pcm)
 {
      struct snd_pcm_sync_ptr *sync_ptr = pcm->sync_ptr;
@@ -405,7 +417,7 @@ long pcm_avail(struct pcm *pcm)
                 avail += pcm->sw_p->boundary;
         return avail;
      } else {
-         long avail = sync_ptr->s.status.hw_ptr - sync_ptr->c.control.appl_ptr + ((pcm->flags & PCM_MONO) ? pcm->buffer_size/2 : pcm->buffer_size/4);
+         long avail = sync_ptr->s.status.hw_ptr - sync_ptr->c.control.appl_ptr + pcm->buffer_size / pcm_frame_size(pcm);
          if (avail < 0)
               avail += pcm->sw_p->boundary;
          else if ((unsigned long) avail >= pcm->sw_p->boundary)
@@ -440,10 +452,33 @@ int mmap_buffer(struct pcm *pcm)
         ALOGV("size = %d\n", size);
     pcm->addr = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED,
                            pcm->fd, 0);
-    if (pcm->addr)
-         return 0;
-    else
+    if (pcm->addr == MAP_FAILED) {
+         pcm->addr = NULL;
          return -errno;
+    }
+
+    /*
+     * Map the driver's status and control records as well so that the
+     * pcm_mmap_* calls can exchange pointers without SYNC_PTR. Not every
+     * architecture allows this, SYNC_PTR is used when it fails.
+     */
+    pcm->mmap_status = mmap(NULL, getpagesize(), PROT_READ, MAP_SHARED,
+                           pcm->fd, SNDRV_PCM_MMAP_OFFSET_STATUS);
+    if (pcm->mmap_status == MAP_FAILED) {
+         pcm->mmap_status = NULL;
+         return 0;
+    }
+    pcm->mmap_control = mmap(NULL, getpagesize(), PROT_READ|PROT_WRITE,
+                           MAP_SHARED, pcm->fd, SNDRV_PCM_MMAP_OFFSET_CONTROL);
+    if (pcm->mmap_control == MAP_FAILED) {
+         munmap(pcm->mmap_status, getpagesize());
+         pcm->mmap_status = NULL;
+         pcm->mmap_control = NULL;
+         return 0;
+    }
+    if (pcm->flags & DEBUG_ON)
+        ALOGV("status and control records mapped\n");
+    return 0;
 }
 
 /*
@@ -516,59 +551,190 @@ int pcm_prepare(struct pcm *pcm)
            return -errno;
     }
     pcm->running = 1;
+    pcm->start = 0;
+
+    /*
+     * Prepare resets the driver's pointers, fetch them once here so the
+     * cached application pointer can be published without reading it
+     * back first.
+     */
+    if (pcm->flags & PCM_MMAP) {
+        pcm->sync_ptr->flags = SNDRV_PCM_SYNC_PTR_APPL | SNDRV_PCM_SYNC_PTR_AVAIL_MIN;
+        sync_ptr(pcm);
+    }
     return 0;
 }
 
-static int pcm_write_mmap(struct pcm *pcm, void *data, unsigned count)
+/*
+ * Publish the cached application pointer and fetch the hardware pointer.
+ * With the control and status records mapped this is a store, a HWSYNC
+ * and a load, otherwise one SYNC_PTR ioctl does all three. The HWSYNC
+ * is what moves hw_ptr when no period interrupt does, e.g. with
+ * PCM_NOIRQ. avail_min is left as set by the sw params.
+ */
+static int pcm_mmap_sync(struct pcm *pcm)
+{
+    struct snd_pcm_sync_ptr *sync_ptr = pcm->sync_ptr;
+
+    if (pcm->mmap_control) {
+        /* ring contents must be visible before the pointer moves */
+        __sync_synchronize();
+        pcm->mmap_control->appl_ptr = sync_ptr->c.control.appl_ptr;
+        if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_HWSYNC))
+            return -errno;
+        sync_ptr->s.status.hw_ptr = pcm->mmap_status->hw_ptr;
+        sync_ptr->s.status.state = pcm->mmap_status->state;
+    } else {
+        sync_ptr->flags = SNDRV_PCM_SYNC_PTR_HWSYNC | SNDRV_PCM_SYNC_PTR_AVAIL_MIN;
+        if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_SYNC_PTR, sync_ptr))
+            return -errno;
+    }
+    if (sync_ptr->s.status.state == SNDRV_PCM_STATE_XRUN)
+        return -EPIPE;
+    return 0;
+}
+
+static int pcm_mmap_xrun(struct pcm *pcm)
+{
+    ALOGE("%s xrun\n", (pcm->flags & PCM_IN) ? "capture" : "playback");
+    pcm->underruns++;
+    pcm->running = 0;
+    pcm->start = 0;
+    return -EPIPE;
+}
+
+long pcm_mmap_avail(struct pcm *pcm)
 {
-    long frames;
     int err;
-    int bytes_written;
 
-    frames = (pcm->flags & PCM_MONO) ? (count / 2) : (count / 4);
+    err = pcm_mmap_sync(pcm);
+    if (err == -EPIPE)
+        return pcm_mmap_xrun(pcm);
+    if (err)
+        return err;
+    return pcm_avail(pcm);
+}
 
-    pcm->sync_ptr->flags = SNDRV_PCM_SYNC_PTR_APPL | SNDRV_PCM_SYNC_PTR_AVAIL_MIN;
-    err = sync_ptr(pcm);
-    if (err == EPIPE) {
-        ALOGE("Failed in sync_ptr\n");
-        /* we failed to make our window -- try to restart */
-        pcm->underruns++;
-        pcm->running = 0;
-        pcm_prepare(pcm);
-    }
-    pcm->sync_ptr->c.control.appl_ptr += frames;
-    pcm->sync_ptr->flags = 0;
+int pcm_mmap_begin(struct pcm *pcm, void **areas, unsigned *offset,
+                   unsigned *frames)
+{
+    unsigned buffer_frames = pcm->buffer_size / pcm_frame_size(pcm);
+    long avail;
 
-    err = sync_ptr(pcm);
-    if (err == EPIPE) {
-        ALOGE("Failed in sync_ptr 2 \n");
-        /* we failed to make our window -- try to restart */
-        pcm->underruns++;
-        pcm->running = 0;
-        pcm_prepare(pcm);
+    if (!pcm->addr)
+        return -EINVAL;
+
+    avail = pcm_avail(pcm);
+    if (avail < 0)
+        avail = 0;
+    *areas = pcm->addr;
+    *offset = pcm->sync_ptr->c.control.appl_ptr % buffer_frames;
+    if (*frames > (unsigned long) avail)
+        *frames = avail;
+    if (*frames > buffer_frames - *offset)
+        *frames = buffer_frames - *offset;
+    return 0;
+}
+
+int pcm_mmap_commit(struct pcm *pcm, unsigned frames)
+{
+    struct snd_pcm_sync_ptr *sync_ptr = pcm->sync_ptr;
+    unsigned buffer_frames = pcm->buffer_size / pcm_frame_size(pcm);
+    snd_pcm_uframes_t appl_ptr;
+    int err;
+
+    appl_ptr = sync_ptr->c.control.appl_ptr + frames;
+    if (appl_ptr >= pcm->sw_p->boundary)
+        appl_ptr -= pcm->sw_p->boundary;
+    sync_ptr->c.control.appl_ptr = appl_ptr;
+
+    err = pcm_mmap_sync(pcm);
+    if (err == -EPIPE)
+        return pcm_mmap_xrun(pcm);
+    if (err) {
+        ALOGE("SNDRV_PCM_IOCTL_SYNC_PTR failed %d\n", err);
+        return err;
     }
-    bytes_written = pcm->sync_ptr->c.control.appl_ptr - pcm->sync_ptr->s.status.hw_ptr;
-    if ((bytes_written >= pcm->sw_p->start_threshold) && (!pcm->start)) {
+
+    if (!(pcm->flags & PCM_IN) && !pcm->start &&
+        buffer_frames - pcm_avail(pcm) >= pcm->sw_p->start_threshold) {
         if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_START)) {
-            err = -errno;
-            if (errno == EPIPE) {
-                ALOGE("Failed in SNDRV_PCM_IOCTL_START\n");
-                /* we failed to make our window -- try to restart */
-                pcm->underruns++;
-                pcm->running = 0;
-                pcm_prepare(pcm);
-            } else {
-                ALOGE("Error no %d \n", errno);
-                return -errno;
-            }
-        } else {
-             ALOGD(" start\n");
-             pcm->start = 1;
+            if (errno == EPIPE)
+                return pcm_mmap_xrun(pcm);
+            ALOGE("SNDRV_PCM_IOCTL_START failed %d\n", errno);
+            return -errno;
         }
+        if (pcm->flags & DEBUG_ON)
+            ALOGV("start\n");
+        pcm->start = 1;
     }
     return 0;
 }
 
+/*
+ * Copy between data and the ring in at most two pieces, up to the end
+ * of the buffer and on from its start, then commit all frames at once.
+ */
+static int pcm_mmap_transfer(struct pcm *pcm, u_int8_t *data, unsigned frames)
+{
+    unsigned frame_size = pcm_frame_size(pcm);
+    unsigned buffer_frames = pcm->buffer_size / frame_size;
+    unsigned offset, count;
+    u_int8_t *ring;
+    long avail;
+
+    if (!pcm->addr)
+        return -EINVAL;
+    avail = pcm_avail(pcm);
+    if (avail < 0 || frames > (unsigned long) avail)
+        return -EAGAIN;
+
+    offset = pcm->sync_ptr->c.control.appl_ptr % buffer_frames;
+    count = buffer_frames - offset;
+    if (count > frames)
+        count = frames;
+    ring = (u_int8_t *) pcm->addr + offset * frame_size;
+
+    if (pcm->flags & PCM_IN) {
+        memcpy(data, ring, count * frame_size);
+        memcpy(data + count * frame_size, pcm->addr,
+               (frames - count) * frame_size);
+    } else {
+        memcpy(ring, data, count * frame_size);
+        memcpy(pcm->addr, data + count * frame_size,
+               (frames - count) * frame_size);
+    }
+    return pcm_mmap_commit(pcm, frames);
+}
+
+int pcm_mmap_write(struct pcm *pcm, const void *data, unsigned frames)
+{
+    if (pcm->flags & PCM_IN)
+        return -EINVAL;
+    return pcm_mmap_transfer(pcm, (u_int8_t *) data, frames);
+}
+
+int pcm_mmap_read(struct pcm *pcm, void *data, unsigned frames)
+{
+    if (!(pcm->flags & PCM_IN))
+        return -EINVAL;
+    return pcm_mmap_transfer(pcm, data, frames);
+}
+
+/* The caller has already filled the ring at dst_address(). */
+static int pcm_write_mmap(struct pcm *pcm, void *data, unsigned count)
+{
+    int err;
+
+    err = pcm_mmap_commit(pcm, count / pcm_frame_size(pcm));
+    if (err == -EPIPE) {
+        /* we failed to make our window -- try to restart */
+        pcm_prepare(pcm);
+        return 0;
+    }
+    return err;
+}
+
 static int pcm_write_nmmap(struct pcm *pcm, void *data, unsigned count)
 {
     struct snd_xferi x;
@@ -579,11 +745,12 @@ static int pcm_write_nmmap(struct pcm *pcm, void *data, unsigned count)
     x.buf = data;
     x.frames =  (count / (channels * 2)) ;
 
-    for (;;) {
+    while (x.frames) {
         if (!pcm->running) {
             if (pcm_prepare(pcm))
                 return -errno;
         }
+        x.result = 0;
         if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_WRITEI_FRAMES, &x)) {
             if (errno == EPIPE) {
                     /* we failed to make our window -- try to restart */
@@ -594,10 +761,15 @@ static int pcm_write_nmmap(struct pcm *pcm, void *data, unsigned count)
             }
             return -errno;
         }
+        if (x.result <= 0)
+            return -EIO;
+        /* a multi-period write may be cut short, send the rest */
+        x.buf = (char *)x.buf + x.result * channels * 2;
+        x.frames -= x.result;
         if (pcm->flags & DEBUG_ON)
-          ALOGV("Sent frame\n");
-        return 0;
+          ALOGV("Sent %ld frames\n", (long)x.result);
     }
+    return 0;
 }
 
 int pcm_write(struct pcm *pcm, void *data, unsigned count)
@@ -726,8 +898,12 @@ int pcm_close(struct pcm *pcm)
             ALOGE("Reset failed");
         }
 
-        if (munmap(pcm->addr, pcm->buffer_size))
+        if (pcm->addr && munmap(pcm->addr, pcm->buffer_size))
             ALOGE("munmap failed");
+        if (pcm->mmap_status) {
+            munmap(pcm->mmap_status, getpagesize());
+            munmap(pcm->mmap_control, getpagesize());
+        }
 
         if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_HW_FREE) < 0) {
             ALOGE("HW_FREE failed");
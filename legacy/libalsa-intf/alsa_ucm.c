@@ -59,13 +59,57 @@
 #include <sys/poll.h>
 #include <stdint.h>
 #include <dlfcn.h>
+#include <endian.h>
 
 #include <linux/ioctl.h>
 #include "msm8960_use_cases.h"
-#if defined(QC_PROP)
-    static void (*acdb_send_audio_cal)(int,int);
-    static void (*acdb_send_voice_cal)(int,int);
-#endif
+#include "alsa_host.h"
+
+/* Names of the well known identifiers, indexed by their id */
+static const char *const snd_ucm_known_idents[SND_UCM_ID_KNOWN_COUNT] = {
+    [SND_UCM_ID_VERB_INACTIVE] = SND_USE_CASE_VERB_INACTIVE,
+    [SND_UCM_ID_VERB_HIFI] = SND_USE_CASE_VERB_HIFI,
+    [SND_UCM_ID_VERB_HIFI_LOW_POWER] = SND_USE_CASE_VERB_HIFI_LOW_POWER,
+    [SND_UCM_ID_VERB_VOICE] = SND_USE_CASE_VERB_VOICE,
+    [SND_UCM_ID_VERB_VOICE_LOW_POWER] = SND_USE_CASE_VERB_VOICE_LOW_POWER,
+    [SND_UCM_ID_VERB_VOICECALL] = SND_USE_CASE_VERB_VOICECALL,
+    [SND_UCM_ID_VERB_IP_VOICECALL] = SND_USE_CASE_VERB_IP_VOICECALL,
+    [SND_UCM_ID_VERB_ANALOG_RADIO] = SND_USE_CASE_VERB_ANALOG_RADIO,
+    [SND_UCM_ID_VERB_DIGITAL_RADIO] = SND_USE_CASE_VERB_DIGITAL_RADIO,
+    [SND_UCM_ID_VERB_FM_REC] = SND_USE_CASE_VERB_FM_REC,
+    [SND_UCM_ID_VERB_FM_A2DP_REC] = SND_USE_CASE_VERB_FM_A2DP_REC,
+    [SND_UCM_ID_VERB_HIFI_REC] = SND_USE_CASE_VERB_HIFI_REC,
+    [SND_UCM_ID_VERB_HIFI_LOWLATENCY_REC] = SND_USE_CASE_VERB_HIFI_LOWLATENCY_REC,
+    [SND_UCM_ID_VERB_DL_REC] = SND_USE_CASE_VERB_DL_REC,
+    [SND_UCM_ID_VERB_UL_DL_REC] = SND_USE_CASE_VERB_UL_DL_REC,
+    [SND_UCM_ID_VERB_HIFI_TUNNEL] = SND_USE_CASE_VERB_HIFI_TUNNEL,
+    [SND_UCM_ID_VERB_HIFI_LOWLATENCY_MUSIC] = SND_USE_CASE_VERB_HIFI_LOWLATENCY_MUSIC,
+    [SND_UCM_ID_VERB_HIFI2] = SND_USE_CASE_VERB_HIFI2,
+    [SND_UCM_ID_VERB_INCALL_REC] = SND_USE_CASE_VERB_INCALL_REC,
+    [SND_UCM_ID_VERB_MI2S] = SND_USE_CASE_VERB_MI2S,
+    [SND_UCM_ID_VERB_VOLTE] = SND_USE_CASE_VERB_VOLTE,
+    [SND_UCM_ID_VERB_ADSP_TESTFWK] = SND_USE_CASE_VERB_ADSP_TESTFWK,
+    [SND_UCM_ID_MOD_CAPTURE_VOICE] = SND_USE_CASE_MOD_CAPTURE_VOICE,
+    [SND_UCM_ID_MOD_CAPTURE_MUSIC] = SND_USE_CASE_MOD_CAPTURE_MUSIC,
+    [SND_UCM_ID_MOD_PLAY_MUSIC] = SND_USE_CASE_MOD_PLAY_MUSIC,
+    [SND_UCM_ID_MOD_PLAY_VOICE] = SND_USE_CASE_MOD_PLAY_VOICE,
+    [SND_UCM_ID_MOD_PLAY_TONE] = SND_USE_CASE_MOD_PLAY_TONE,
+    [SND_UCM_ID_MOD_ECHO_REF] = SND_USE_CASE_MOD_ECHO_REF,
+    [SND_UCM_ID_MOD_PLAY_FM] = SND_USE_CASE_MOD_PLAY_FM,
+    [SND_UCM_ID_MOD_CAPTURE_FM] = SND_USE_CASE_MOD_CAPTURE_FM,
+    [SND_UCM_ID_MOD_CAPTURE_LOWLATENCY_MUSIC] = SND_USE_CASE_MOD_CAPTURE_LOWLATENCY_MUSIC,
+    [SND_UCM_ID_MOD_CAPTURE_A2DP_FM] = SND_USE_CASE_MOD_CAPTURE_A2DP_FM,
+    [SND_UCM_ID_MOD_PLAY_LPA] = SND_USE_CASE_MOD_PLAY_LPA,
+    [SND_UCM_ID_MOD_PLAY_VOIP] = SND_USE_CASE_MOD_PLAY_VOIP,
+    [SND_UCM_ID_MOD_CAPTURE_VOIP] = SND_USE_CASE_MOD_CAPTURE_VOIP,
+    [SND_UCM_ID_MOD_CAPTURE_VOICE_DL] = SND_USE_CASE_MOD_CAPTURE_VOICE_DL,
+    [SND_UCM_ID_MOD_CAPTURE_VOICE_UL_DL] = SND_USE_CASE_MOD_CAPTURE_VOICE_UL_DL,
+    [SND_UCM_ID_MOD_PLAY_TUNNEL] = SND_USE_CASE_MOD_PLAY_TUNNEL,
+    [SND_UCM_ID_MOD_PLAY_LOWLATENCY_MUSIC] = SND_USE_CASE_MOD_PLAY_LOWLATENCY_MUSIC,
+    [SND_UCM_ID_MOD_PLAY_MUSIC2] = SND_USE_CASE_MOD_PLAY_MUSIC2,
+    [SND_UCM_ID_MOD_PLAY_MI2S] = SND_USE_CASE_MOD_PLAY_MI2S,
+    [SND_UCM_ID_MOD_PLAY_VOLTE] = SND_USE_CASE_MOD_PLAY_VOLTE,
+};
 #define PARSE_DEBUG 0
 
 /**
@@ -674,13 +718,10 @@ int use_case_index)
                           uc_mgr->current_rx_device,
                           uc_mgr->current_tx_device);
                     if (uc_mgr->acdb_handle && !uc_mgr->isFusion3Platform) {
-                        acdb_send_voice_cal = dlsym(uc_mgr->acdb_handle,"acdb_loader_send_voice_cal");
-                        if (acdb_send_voice_cal == NULL) {
-                            ALOGE("ucm: dlsym: Error:%s Loading acdb_loader_send_voice_cal", dlerror());
-                        }else {
-                            acdb_send_voice_cal(uc_mgr->current_rx_device,
+                        snd_ucm_load_acdb_symbols(uc_mgr);
+                        if (uc_mgr->acdb_send_voice_cal != NULL)
+                            uc_mgr->acdb_send_voice_cal(uc_mgr->current_rx_device,
                                        uc_mgr->current_tx_device);
-                        }
                    }
                 } else {
                     ALOGV("Voice acdb: Required acdb already pushed \
@@ -702,49 +743,57 @@ int use_case_index)
 int get_use_case_index(snd_use_case_mgr_t *uc_mgr, const char *use_case,
 int ctrl_list_type)
 {
-    use_case_verb_t *verb_list;
+    return get_use_case_index_by_id(uc_mgr,
+               snd_ucm_lookup_ident(uc_mgr->card_ctxt_ptr, use_case, NULL),
+               ctrl_list_type);
+}
+
+/* Find the control list entry of an interned use case name
+ * uc_mgr - UCM structure pointer
+ * id - interned id of the use case name, negative if not interned
+ * ctrl_list_type - verb, device or modifier list of the current verb
+ * returns index in the list, otherwise a negative error code
+ */
+static int get_use_case_index_by_id(snd_use_case_mgr_t *uc_mgr, int id,
+int ctrl_list_type)
+{
+    use_case_verb_t *verb;
     card_mctrl_t *ctrl_list;
-    int ret = 0, index = 0, verb_index;
+    int index, count, verb_index;
 
-    verb_list = uc_mgr->card_ctxt_ptr->use_case_verb_list;
     verb_index = uc_mgr->card_ctxt_ptr->current_verb_index;
+    if((verb_index < 0) ||
+      (!strncmp(uc_mgr->card_ctxt_ptr->current_verb, SND_UCM_END_OF_LIST, 3))) {
+        ALOGE("Invalid current verb value: %s - %d",
+                uc_mgr->card_ctxt_ptr->current_verb, verb_index);
+        return -EINVAL;
+    }
+    verb = &uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index];
     if (ctrl_list_type == CTRL_LIST_VERB) {
-        ctrl_list =
-            uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index].verb_ctrls;
+        ctrl_list = verb->verb_ctrls;
+        count = verb->verb_count;
     } else if (ctrl_list_type == CTRL_LIST_DEVICE) {
-        ctrl_list =
-            uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index].device_ctrls;
+        ctrl_list = verb->device_ctrls;
+        count = verb->device_count;
     } else if (ctrl_list_type == CTRL_LIST_MODIFIER) {
-        ctrl_list =
-            uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index].mod_ctrls;
+        ctrl_list = verb->mod_ctrls;
+        count = verb->mod_count;
     } else {
         ctrl_list = NULL;
+        count = 0;
     }
-    if((verb_index < 0) ||
-      (!strncmp(uc_mgr->card_ctxt_ptr->current_verb, SND_UCM_END_OF_LIST, 3)) ||
-      (ctrl_list == NULL) || (ctrl_list[index].case_name == NULL)) {
+    if (ctrl_list == NULL) {
         ALOGE("Invalid current verb value: %s - %d",
                 uc_mgr->card_ctxt_ptr->current_verb, verb_index);
         return -EINVAL;
     }
-    while(strncmp(ctrl_list[index].case_name, use_case, (strlen(use_case)+1))) {
-        if (!strncmp(ctrl_list[index].case_name, SND_UCM_END_OF_LIST,
-            strlen(SND_UCM_END_OF_LIST))) {
-            ret = -EINVAL;
-            break;
-        }
-        index++;
-        if (ctrl_list[index].case_name == NULL) {
-            ALOGE("Invalid case_name at index %d", index);
-            ret = -EINVAL;
-            break;
-        }
-    }
-    if (ret < 0) {
-        return ret;
-    } else {
-        return index;
+    if (id < 0)
+        return -EINVAL;
+    for (index = 0; index < count; index++) {
+        if (ctrl_list[index].case_id == id)
+            return index;
     }
+    return -EINVAL;
 }
 
 /* Apply the required mixer controls for specific use case
@@ -799,13 +848,10 @@ const char *use_case, int enable, int ctrl_list_type, int uc_index)
                             ctrl_list[uc_index].acdb_id,
                             ctrl_list[uc_index].capability, enable);
                         if (uc_mgr->acdb_handle) {
-                            acdb_send_audio_cal = dlsym(uc_mgr->acdb_handle,"acdb_loader_send_audio_cal");
-                            if (acdb_send_audio_cal == NULL) {
-                                ALOGE("ucm:dlsym:Error:%s Loading acdb_loader_send_audio_cal", dlerror());
-                            } else {
-                                acdb_send_audio_cal(ctrl_list[uc_index].acdb_id,
+                            snd_ucm_load_acdb_symbols(uc_mgr);
+                            if (uc_mgr->acdb_send_audio_cal != NULL)
+                                uc_mgr->acdb_send_audio_cal(ctrl_list[uc_index].acdb_id,
                                                      ctrl_list[uc_index].capability);
-                            }
                         }
                     }
                 }
@@ -822,8 +868,7 @@ const char *use_case, int enable, int ctrl_list_type, int uc_index)
                     ALOGE("No valid controls exist for this case: %s", use_case);
                     break;
                 }
-                ctl = mixer_get_control(uc_mgr->card_ctxt_ptr->mixer_handle,
-                          mixer_list[index].control_name, 0);
+                ctl = mixer_list[index].ctl;
                 if (ctl) {
                     if (mixer_list[index].type == TYPE_INT) {
                         ALOGV("Setting mixer control: %s, value: %d",
@@ -850,9 +895,7 @@ const char *use_case, int enable, int ctrl_list_type, int uc_index)
                        mixer_list = ctrl_list[uc_index].dis_mixer_list;
                        mixer_count = ctrl_list[uc_index].dis_mixer_count;
                        for(i = 0; i < mixer_count; i++) {
-                           ctl = mixer_get_control(
-                                     uc_mgr->card_ctxt_ptr->mixer_handle,
-                                     mixer_list[i].control_name, 0);
+                           ctl = mixer_list[i].ctl;
                            if (ctl) {
                                if (mixer_list[i].type == TYPE_INT) {
                                    ret = mixer_ctl_set(ctl,
@@ -958,7 +1001,7 @@ static int set_controls_of_usecase_for_all_devices(snd_use_case_mgr_t *uc_mgr,
 const char *ident, int enable, int ctrl_list_type)
 {
     card_mctrl_t *dev_list, *uc_list;
-    char *current_device, use_case[MAX_UC_LEN];
+    char *current_device;
     int list_size, index, uc_index, ret = 0, intdev_flag = 0;
     int verb_index, capability = 0, ident_cap = 0, dev_cap =0;
 
@@ -976,7 +1019,7 @@ const char *ident, int enable, int ctrl_list_type)
     } else {
         uc_list = NULL;
     }
-    ident_cap = getUseCaseType(ident);
+    ident_cap = snd_ucm_get_ident_type(uc_mgr->card_ctxt_ptr, -1, ident);
     list_size = snd_ucm_get_size_of_list(uc_mgr->card_ctxt_ptr->dev_list_head);
     for (index = 0; index < list_size; index++) {
         current_device =
@@ -1008,21 +1051,22 @@ const char *ident, int enable, int ctrl_list_type)
                         snd_use_case_apply_voice_acdb(uc_mgr, uc_index);
                      }
                  }
-                 strlcpy(use_case, ident, sizeof(use_case));
-                 strlcat(use_case, current_device, sizeof(use_case));
-                 ALOGV("Applying mixer controls for use case: %s", use_case);
-                 if ((uc_index =
-                      get_use_case_index(uc_mgr, use_case, ctrl_list_type)) < 0) {
-                      ALOGV("No valid use case found: %s", use_case);
+                 ALOGV("Applying mixer controls for use case: %s%s", ident,
+                       current_device);
+                 if ((uc_index = get_use_case_index_by_id(uc_mgr,
+                      snd_ucm_lookup_ident(uc_mgr->card_ctxt_ptr, ident,
+                      current_device), ctrl_list_type)) < 0) {
+                      ALOGV("No valid use case found: %s%s", ident,
+                            current_device);
                       intdev_flag++;
                  } else {
                       if (capability == CAP_VOICE || ident_cap == CAP_VOICE ||
                           capability == ident_cap) {
-                          ret = snd_use_case_apply_mixer_controls(uc_mgr, use_case,
-                                enable, ctrl_list_type, uc_index);
+                          ret = snd_use_case_apply_mixer_controls(uc_mgr,
+                                uc_list[uc_index].case_name, enable,
+                                ctrl_list_type, uc_index);
                       }
                  }
-                 use_case[0] = 0;
                  free(current_device);
              }
         }
@@ -1051,8 +1095,7 @@ const char *ident, int enable, int ctrl_list_type)
 static int set_controls_of_usecase_for_device(snd_use_case_mgr_t *uc_mgr,
 const char *ident, const char *device, int enable, int ctrl_list_type)
 {
-    card_mctrl_t *dev_list;
-    char use_case[MAX_UC_LEN];
+    card_mctrl_t *dev_list, *uc_list;
     int list_size, index, dev_index, uc_index, ret = 0;
     int verb_index, capability = 0;
 
@@ -1062,6 +1105,12 @@ const char *ident, const char *device, int enable, int ctrl_list_type)
         verb_index = 0;
     dev_list =
         uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index].device_ctrls;
+    if (ctrl_list_type == CTRL_LIST_VERB)
+        uc_list =
+            uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index].verb_ctrls;
+    else
+        uc_list =
+            uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index].mod_ctrls;
     if (device != NULL) {
         if (enable) {
             dev_index = get_use_case_index(uc_mgr, device, CTRL_LIST_DEVICE);
@@ -1076,11 +1125,11 @@ const char *ident, const char *device, int enable, int ctrl_list_type)
                     capability);
             }
         }
-        strlcpy(use_case, ident, sizeof(use_case));
-        strlcat(use_case, device, sizeof(use_case));
-    ALOGV("Applying mixer controls for use case: %s", use_case);
-        if ((uc_index = get_use_case_index(uc_mgr, use_case, ctrl_list_type)) < 0) {
-            ALOGV("No valid use case found: %s", use_case );
+    ALOGV("Applying mixer controls for use case: %s%s", ident, device);
+        if ((uc_index = get_use_case_index_by_id(uc_mgr,
+            snd_ucm_lookup_ident(uc_mgr->card_ctxt_ptr, ident, device),
+            ctrl_list_type)) < 0) {
+            ALOGV("No valid use case found: %s%s", ident, device);
             uc_index = get_use_case_index(uc_mgr, ident, ctrl_list_type);
             if (snd_use_case_apply_mixer_controls(uc_mgr, ident, enable,
                 ctrl_list_type, uc_index) < 0) {
@@ -1088,8 +1137,9 @@ const char *ident, const char *device, int enable, int ctrl_list_type)
                      ident);
             }
         } else {
-            ret = snd_use_case_apply_mixer_controls(uc_mgr, use_case, enable,
-                      ctrl_list_type, uc_index);
+            ret = snd_use_case_apply_mixer_controls(uc_mgr,
+                      uc_list[uc_index].case_name, enable, ctrl_list_type,
+                      uc_index);
         }
     } else {
         uc_index = get_use_case_index(uc_mgr, ident, ctrl_list_type);
@@ -1111,156 +1161,152 @@ const char *ident, const char *device, int enable, int ctrl_list_type)
 static int set_controls_of_device_for_all_usecases(snd_use_case_mgr_t *uc_mgr,
 const char *device, int enable)
 {
+    card_ctxt_t *card = uc_mgr->card_ctxt_ptr;
     card_mctrl_t *dev_list, *uc_list;
-    char *ident_value, use_case[MAX_UC_LEN];
-    int verb_index, uc_index, dev_index, capability = 0;
+    char *ident_value;
+    int verb_index, uc_index, dev_index, capability = 0, uc_type;
     int list_size, index = 0, ret = -ENODEV, flag = 0, intdev_flag = 0;
 
     ALOGV("set_controls_of_device_for_all_usecases: %s", device);
-    if ((verb_index = uc_mgr->card_ctxt_ptr->current_verb_index) < 0)
+    if ((verb_index = card->current_verb_index) < 0)
         verb_index = 0;
     dev_list =
-         uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index].device_ctrls;
+         card->use_case_verb_list[verb_index].device_ctrls;
     dev_index = get_use_case_index(uc_mgr, device, CTRL_LIST_DEVICE);
     if (dev_index >= 0)
         capability = dev_list[dev_index].capability;
-    if (strncmp(uc_mgr->card_ctxt_ptr->current_verb, SND_USE_CASE_VERB_INACTIVE,
-        strlen(SND_USE_CASE_VERB_INACTIVE))) {
+    if (card->current_verb_id != SND_UCM_ID_VERB_INACTIVE) {
         uc_list =
-            uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index].verb_ctrls;
-        if (capability == CAP_VOICE ||
-            capability == getUseCaseType(uc_mgr->card_ctxt_ptr->current_verb) ||
-            getUseCaseType(uc_mgr->card_ctxt_ptr->current_verb) == CAP_VOICE) {
-            strlcpy(use_case, uc_mgr->card_ctxt_ptr->current_verb,
-                sizeof(use_case));
-            strlcat(use_case, device, sizeof(use_case));
-            if ((uc_index =
-                get_use_case_index(uc_mgr, use_case, CTRL_LIST_VERB)) < 0) {
-                ALOGV("No valid use case found: %s", use_case);
+            card->use_case_verb_list[verb_index].verb_ctrls;
+        uc_type = snd_ucm_get_ident_type(card, card->current_verb_id,
+                      card->current_verb);
+        if (capability == CAP_VOICE || capability == uc_type ||
+            uc_type == CAP_VOICE) {
+            if ((uc_index = get_use_case_index_by_id(uc_mgr,
+                snd_ucm_lookup_ident(card, card->current_verb, device),
+                CTRL_LIST_VERB)) < 0) {
+                ALOGV("No valid use case found: %s%s", card->current_verb,
+                    device);
                 intdev_flag = 1;
             } else {
                 if (enable) {
                     if (!snd_ucm_get_status_at_index(
-                        uc_mgr->card_ctxt_ptr->dev_list_head, device)) {
+                        card->dev_list_head, device)) {
                         ret = snd_use_case_apply_mixer_controls(uc_mgr, device,
                                   enable, CTRL_LIST_DEVICE, dev_index);
                         if (!ret)
                             snd_ucm_set_status_at_index(
-                            uc_mgr->card_ctxt_ptr->dev_list_head, device,
+                            card->dev_list_head, device,
                             enable, capability);
                             flag = 1;
                     }
                 }
-                ALOGV("set %d for use case value: %s", enable, use_case);
-                ret = snd_use_case_apply_mixer_controls(uc_mgr, use_case,
+                ALOGV("set %d for use case value: %s",
+                    enable, uc_list[uc_index].case_name);
+                ret = snd_use_case_apply_mixer_controls(uc_mgr,
+                          uc_list[uc_index].case_name,
                           enable, CTRL_LIST_VERB, uc_index);
                 if (ret != 0)
                      ALOGE("No valid controls exists for usecase %s and device \
-                          %s, enable: %d", use_case, device, enable);
+                          %s, enable: %d", card->current_verb, device, enable);
             }
         }
         if (intdev_flag) {
             if (enable && !flag) {
                 if (!snd_ucm_get_status_at_index(
-                    uc_mgr->card_ctxt_ptr->dev_list_head, device)) {
+                    card->dev_list_head, device)) {
                     ret = snd_use_case_apply_mixer_controls(uc_mgr,
                               device, enable, CTRL_LIST_DEVICE, dev_index);
                     if (!ret)
                         snd_ucm_set_status_at_index(
-                        uc_mgr->card_ctxt_ptr->dev_list_head, device, enable,
+                        card->dev_list_head, device, enable,
                         capability);
                     flag = 1;
                 }
             }
-            use_case[0] = 0;
-            strlcpy(use_case, uc_mgr->card_ctxt_ptr->current_verb,
-                sizeof(use_case));
-            uc_index = get_use_case_index(uc_mgr, use_case, CTRL_LIST_VERB);
-            if (capability == CAP_VOICE ||
-                capability ==
-                getUseCaseType(uc_mgr->card_ctxt_ptr->current_verb) ||
-                getUseCaseType(uc_mgr->card_ctxt_ptr->current_verb) ==
-                CAP_VOICE) {
-                ALOGV("set %d for use case value: %s", enable, use_case);
-                ret = snd_use_case_apply_mixer_controls(uc_mgr, use_case,
-                          enable, CTRL_LIST_VERB, uc_index);
+            uc_index = get_use_case_index_by_id(uc_mgr, card->current_verb_id,
+                           CTRL_LIST_VERB);
+            if (capability == CAP_VOICE || capability == uc_type ||
+                uc_type == CAP_VOICE) {
+                ALOGV("set %d for use case value: %s", enable,
+                    card->current_verb);
+                ret = snd_use_case_apply_mixer_controls(uc_mgr,
+                          card->current_verb, enable, CTRL_LIST_VERB, uc_index);
                 if (ret != 0)
                       ALOGE("No valid controls exists for usecase %s and \
-                           device %s, enable: %d", use_case, device, enable);
+                           device %s, enable: %d", card->current_verb, device,
+                           enable);
             }
             intdev_flag = 0;
         }
-        use_case[0] = 0;
     }
-    snd_ucm_print_list(uc_mgr->card_ctxt_ptr->mod_list_head);
+    snd_ucm_print_list(card->mod_list_head);
     uc_list =
-        uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index].mod_ctrls;
-    list_size = snd_ucm_get_size_of_list(uc_mgr->card_ctxt_ptr->mod_list_head);
+        card->use_case_verb_list[verb_index].mod_ctrls;
+    list_size = snd_ucm_get_size_of_list(card->mod_list_head);
     for (index = 0; index < list_size; index++) {
         if ((ident_value =
-            snd_ucm_get_value_at_index(uc_mgr->card_ctxt_ptr->mod_list_head,
+            snd_ucm_get_value_at_index(card->mod_list_head,
             index))) {
-            if (capability == CAP_VOICE ||
-                getUseCaseType(ident_value) == CAP_VOICE ||
-                capability == getUseCaseType(ident_value)) {
-                strlcpy(use_case, ident_value, sizeof(use_case));
-                strlcat(use_case, device, sizeof(use_case));
-                if ((uc_index = get_use_case_index(uc_mgr, use_case,
+            uc_type = snd_ucm_get_ident_type(card, -1, ident_value);
+            if (capability == CAP_VOICE || uc_type == CAP_VOICE ||
+                capability == uc_type) {
+                if ((uc_index = get_use_case_index_by_id(uc_mgr,
+                    snd_ucm_lookup_ident(card, ident_value, device),
                     CTRL_LIST_MODIFIER)) < 0) {
-                    ALOGV("No valid use case found: %s", use_case);
+                    ALOGV("No valid use case found: %s%s", ident_value, device);
                     intdev_flag = 1;
                 } else {
                     if (enable && !flag) {
                         if (!snd_ucm_get_status_at_index(
-                            uc_mgr->card_ctxt_ptr->dev_list_head, device)) {
+                            card->dev_list_head, device)) {
                             ret = snd_use_case_apply_mixer_controls(uc_mgr,
                                       device, enable, CTRL_LIST_DEVICE,
                                       dev_index);
                             if (!ret)
                                 snd_ucm_set_status_at_index(
-                                    uc_mgr->card_ctxt_ptr->dev_list_head,
+                                    card->dev_list_head,
                                     device, enable, capability);
                             flag = 1;
                         }
                     }
-                    ALOGV("set %d for use case value: %s", enable, use_case);
+                    ALOGV("set %d for use case value: %s", enable,
+                        uc_list[uc_index].case_name);
                     ret = snd_use_case_apply_mixer_controls(uc_mgr,
-                          use_case, enable, CTRL_LIST_MODIFIER, uc_index);
+                          uc_list[uc_index].case_name, enable,
+                          CTRL_LIST_MODIFIER, uc_index);
                     if (ret != 0)
                         ALOGE("No valid controls exists for usecase %s and \
-                            device %s, enable: %d", use_case, device, enable);
+                            device %s, enable: %d", ident_value, device, enable);
                 }
             }
             if (intdev_flag) {
                 if (enable && !flag) {
                     if (!snd_ucm_get_status_at_index(
-                         uc_mgr->card_ctxt_ptr->dev_list_head, device)) {
+                         card->dev_list_head, device)) {
                         ret = snd_use_case_apply_mixer_controls(uc_mgr,
                                   device, enable, CTRL_LIST_DEVICE, dev_index);
                         if (!ret)
                             snd_ucm_set_status_at_index(
-                            uc_mgr->card_ctxt_ptr->dev_list_head, device,
-                            enable, capability);
+                            card->dev_list_head, device, enable,
+                            capability);
                         flag = 1;
                     }
                 }
-                use_case[0] = 0;
-                strlcpy(use_case, ident_value, sizeof(use_case));
                 uc_index =
                     get_use_case_index(uc_mgr, ident_value, CTRL_LIST_MODIFIER);
-                if (capability == CAP_VOICE ||
-                    capability == getUseCaseType(ident_value) ||
-                    getUseCaseType(ident_value) == CAP_VOICE) {
-                    ALOGV("set %d for use case value: %s", enable, use_case);
-                    ret = snd_use_case_apply_mixer_controls(uc_mgr, use_case,
+                if (capability == CAP_VOICE || capability == uc_type ||
+                    uc_type == CAP_VOICE) {
+                    ALOGV("set %d for use case value: %s", enable, ident_value);
+                    ret = snd_use_case_apply_mixer_controls(uc_mgr, ident_value,
                           enable, CTRL_LIST_MODIFIER, uc_index);
                     if (ret != 0)
                          ALOGE("No valid controls exists for usecase %s and \
-                              device %s, enable: %d", use_case, device, enable);
+                              device %s, enable: %d", ident_value, device,
+                              enable);
                 }
                 intdev_flag = 0;
             }
-            use_case[0] = 0;
             free(ident_value);
         }
     }
@@ -1268,7 +1314,7 @@ const char *device, int enable)
         ret = snd_use_case_apply_mixer_controls(uc_mgr, device, enable,
                   CTRL_LIST_DEVICE, dev_index);
         if (!ret)
-            snd_ucm_set_status_at_index(uc_mgr->card_ctxt_ptr->dev_list_head,
+            snd_ucm_set_status_at_index(card->dev_list_head,
                 device, enable, capability);
     }
     return ret;
@@ -1308,9 +1354,8 @@ static int get_usecase_type(snd_use_case_mgr_t *uc_mgr, const char *usecase)
 static int set_controls_of_device_for_usecase(snd_use_case_mgr_t *uc_mgr,
     const char *device, const char *usecase, int enable)
 {
-    card_mctrl_t *dev_list;
-    char use_case[MAX_UC_LEN];
-    int ret = -ENODEV, uc_index, dev_index;
+    card_mctrl_t *dev_list, *uc_list;
+    int ret = -ENODEV, uc_index, dev_index, uc_type;
     int verb_index, capability = 0;
 
     ALOGV("set_device_for_ident(): %s %s", device, usecase);
@@ -1321,11 +1366,17 @@ static int set_controls_of_device_for_usecase(snd_use_case_mgr_t *uc_mgr,
     dev_index = get_use_case_index(uc_mgr, device, CTRL_LIST_DEVICE);
     capability = dev_list[dev_index].capability;
     if (usecase != NULL) {
-        strlcpy(use_case, usecase, sizeof(use_case));
-        strlcat(use_case, device, sizeof(use_case));
-        if ((uc_index = get_use_case_index(uc_mgr, use_case,
-            get_usecase_type(uc_mgr, usecase))) < 0) {
-            ALOGV("No valid use case found: %s", use_case);
+        uc_type = get_usecase_type(uc_mgr, usecase);
+        if (uc_type == CTRL_LIST_VERB)
+            uc_list =
+                uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index].verb_ctrls;
+        else
+            uc_list =
+                uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index].mod_ctrls;
+        if ((uc_index = get_use_case_index_by_id(uc_mgr,
+            snd_ucm_lookup_ident(uc_mgr->card_ctxt_ptr, usecase, device),
+            uc_type)) < 0) {
+            ALOGV("No valid use case found: %s%s", usecase, device);
         } else {
             if (enable) {
                 if (!snd_ucm_get_status_at_index(
@@ -1338,14 +1389,14 @@ static int set_controls_of_device_for_usecase(snd_use_case_mgr_t *uc_mgr,
                         capability);
                 }
             }
-            ALOGV("set %d for use case value: %s", enable, use_case);
-            ret = snd_use_case_apply_mixer_controls(uc_mgr, use_case, enable,
-                      get_usecase_type(uc_mgr, usecase), uc_index);
+            ALOGV("set %d for use case value: %s", enable,
+                uc_list[uc_index].case_name);
+            ret = snd_use_case_apply_mixer_controls(uc_mgr,
+                      uc_list[uc_index].case_name, enable, uc_type, uc_index);
             if (ret != 0)
                 ALOGE("No valid controls exists for usecase %s and device %s, \
-                     enable: %d", use_case, device, enable);
+                     enable: %d", usecase, device, enable);
         }
-        use_case[0] = 0;
     } else {
         if (enable) {
             if (!snd_ucm_get_status_at_index(
@@ -1369,92 +1420,21 @@ static int set_controls_of_device_for_usecase(snd_use_case_mgr_t *uc_mgr,
     return ret;
 }
 
-/**
- * Set new value for an identifier
+/* Apply one identifier, called with card_lock held
  * uc_mgr - UCM structure
- * identifier - _verb, _enadev, _disdev, _enamod, _dismod
- *        _swdev, _swmod
- * value - Value to be set
+ * ident_id - SND_UCM_SET_* identifier
+ * value - verb, device or modifier name
+ * value_id - interned id of value, negative to look it up
  * returns 0 on success, otherwise a negative error code
  */
-int snd_use_case_set(snd_use_case_mgr_t *uc_mgr,
-                     const char *identifier,
-                     const char *value)
+static int snd_use_case_set_l(snd_use_case_mgr_t *uc_mgr, int ident_id,
+                              const char *value, int value_id)
 {
     use_case_verb_t *verb_list;
-    char ident[MAX_STR_LEN], *ident1, *ident2, *temp_ptr;
+    char *ident1;
     int verb_index, list_size, index = 0, ret = -EINVAL;
 
-    pthread_mutex_lock(&uc_mgr->card_ctxt_ptr->card_lock);
-    if ((uc_mgr->snd_card_index >= (int)MAX_NUM_CARDS) || (value == NULL) ||
-        (uc_mgr->snd_card_index < 0) || (uc_mgr->card_ctxt_ptr == NULL) ||
-        (identifier == NULL)) {
-        ALOGE("snd_use_case_set(): failed, invalid arguments");
-        pthread_mutex_unlock(&uc_mgr->card_ctxt_ptr->card_lock);
-        return -EINVAL;
-    }
-
-    ALOGD("snd_use_case_set(): uc_mgr %p identifier %s value %s", uc_mgr,
-         identifier, value);
-    strlcpy(ident, identifier, sizeof(ident));
-    if(!(ident1 = strtok_r(ident, "/", &temp_ptr))) {
-        ALOGV("No multiple identifiers found in identifier value");
-        ident[0] = 0;
-    } else {
-        if (!strncmp(ident1, "_swdev", 6)) {
-            if(!(ident2 = strtok_r(NULL, "/", &temp_ptr))) {
-                ALOGD("Invalid disable device value: %s, but enabling new \
-                     device", ident2);
-            } else {
-                ret = snd_ucm_del_ident_from_list(
-                          &uc_mgr->card_ctxt_ptr->dev_list_head, ident2);
-                if (ret < 0) {
-                    ALOGV("Ignore device %s disable, device not part of \
-                         enabled list", ident2);
-                } else {
-                    ALOGV("swdev: device value to be disabled: %s", ident2);
-                    /* Disable mixer controls for
-                     * corresponding use cases and device */
-                    ret = set_controls_of_device_for_all_usecases(uc_mgr,
-                              ident2, 0);
-                    if (ret < 0) {
-                        ALOGV("Device %s not disabled, no valid use case \
-                              found: %d", ident2, errno);
-                    }
-                }
-            }
-            pthread_mutex_unlock(&uc_mgr->card_ctxt_ptr->card_lock);
-            ret = snd_use_case_set(uc_mgr, "_enadev", value);
-            if (ret < 0) {
-                ALOGV("Device %s not enabled, no valid use case found: %d",
-                    value, errno);
-            }
-            return ret;
-        } else if (!strncmp(ident1, "_swmod", 6)) {
-            pthread_mutex_unlock(&uc_mgr->card_ctxt_ptr->card_lock);
-            if(!(ident2 = strtok_r(NULL, "/", &temp_ptr))) {
-                ALOGD("Invalid modifier value: %s, but enabling new modifier",
-                    ident2);
-            } else {
-                ret = snd_use_case_set(uc_mgr, "_dismod", ident2);
-                if (ret < 0) {
-                    ALOGV("Modifier %s not disabled, no valid use case \
-                         found: %d", ident2, errno);
-                }
-            }
-            ret = snd_use_case_set(uc_mgr, "_enamod", value);
-            if (ret < 0) {
-                ALOGV("Modifier %s not enabled, no valid use case found: %d",
-                    value, errno);
-            }
-            return ret;
-        } else {
-            ALOGV("No switch device/modifier option found: %s", ident1);
-        }
-        ident[0] = 0;
-    }
-
-    if (!strncmp(identifier, "_verb", 5)) {
+    if (ident_id == SND_UCM_SET_VERB) {
         /* Check if value is valid verb */
         while (strncmp(uc_mgr->card_ctxt_ptr->verb_list[index],
                SND_UCM_END_OF_LIST, strlen(SND_UCM_END_OF_LIST))) {
@@ -1465,17 +1445,17 @@ int snd_use_case_set(snd_use_case_mgr_t *uc_mgr,
             }
             index++;
         }
-        if ((ret < 0) && (strncmp(value, SND_USE_CASE_VERB_INACTIVE,
-            strlen(SND_USE_CASE_VERB_INACTIVE)))) {
+        if (value_id < 0)
+            value_id = snd_ucm_lookup_ident(uc_mgr->card_ctxt_ptr, value, NULL);
+        if ((ret < 0) && (value_id != SND_UCM_ID_VERB_INACTIVE)) {
             ALOGE("Invalid verb identifier value");
         } else {
             ALOGV("Index:%d Verb:%s", index,
                 uc_mgr->card_ctxt_ptr->verb_list[index]);
             /* Disable the mixer controls for current use case
              * for all the enabled devices */
-            if (strncmp(uc_mgr->card_ctxt_ptr->current_verb,
-                SND_USE_CASE_VERB_INACTIVE,
-                strlen(SND_USE_CASE_VERB_INACTIVE))) {
+            if (uc_mgr->card_ctxt_ptr->current_verb_id !=
+                SND_UCM_ID_VERB_INACTIVE) {
                 ret = set_controls_of_usecase_for_all_devices(uc_mgr,
                       uc_mgr->card_ctxt_ptr->current_verb, 0, CTRL_LIST_VERB);
                 if (ret != 0)
@@ -1483,17 +1463,16 @@ int snd_use_case_set(snd_use_case_mgr_t *uc_mgr,
                         uc_mgr->card_ctxt_ptr->current_verb);
             }
             strlcpy(uc_mgr->card_ctxt_ptr->current_verb, value, MAX_STR_LEN);
+            uc_mgr->card_ctxt_ptr->current_verb_id = value_id;
             /* Enable the mixer controls for the new use case
              * for all the enabled devices */
-            if (strncmp(uc_mgr->card_ctxt_ptr->current_verb,
-               SND_USE_CASE_VERB_INACTIVE,
-               strlen(SND_USE_CASE_VERB_INACTIVE))) {
+            if (value_id != SND_UCM_ID_VERB_INACTIVE) {
                uc_mgr->card_ctxt_ptr->current_verb_index = index;
                ret = set_controls_of_usecase_for_all_devices(uc_mgr,
                      uc_mgr->card_ctxt_ptr->current_verb, 1, CTRL_LIST_VERB);
             }
         }
-    } else if (!strncmp(identifier, "_enadev", 7)) {
+    } else if (ident_id == SND_UCM_SET_ENADEV) {
         index = 0; ret = 0;
         list_size =
             snd_ucm_get_size_of_list(uc_mgr->card_ctxt_ptr->dev_list_head);
@@ -1518,7 +1497,7 @@ int snd_use_case_set(snd_use_case_mgr_t *uc_mgr,
         snd_ucm_print_list(uc_mgr->card_ctxt_ptr->dev_list_head);
         /* Apply Mixer controls of all verb and modifiers for this device*/
         ret = set_controls_of_device_for_all_usecases(uc_mgr, value, 1);
-    } else if (!strncmp(identifier, "_disdev", 7)) {
+    } else if (ident_id == SND_UCM_SET_DISDEV) {
         ret = snd_ucm_get_status_at_index(uc_mgr->card_ctxt_ptr->dev_list_head,
                   value);
         if (ret < 0) {
@@ -1545,7 +1524,7 @@ int snd_use_case_set(snd_use_case_mgr_t *uc_mgr,
                           CTRL_LIST_DEVICE, index);
             }
         }
-    } else if (!strncmp(identifier, "_enamod", 7)) {
+    } else if (ident_id == SND_UCM_SET_ENAMOD) {
         index = 0; ret = 0;
         verb_index = uc_mgr->card_ctxt_ptr->current_verb_index;
         if (verb_index < 0) {
@@ -1574,7 +1553,7 @@ int snd_use_case_set(snd_use_case_mgr_t *uc_mgr,
                           CTRL_LIST_MODIFIER);
             }
         }
-    } else if (!strncmp(identifier, "_dismod", 7)) {
+    } else if (ident_id == SND_UCM_SET_DISMOD) {
         ret = snd_ucm_del_ident_from_list(&uc_mgr->card_ctxt_ptr->mod_list_head,
                   value);
         if (ret < 0) {
@@ -1586,9 +1565,142 @@ int snd_use_case_set(snd_use_case_mgr_t *uc_mgr,
             ret = set_controls_of_usecase_for_all_devices(uc_mgr, value, 0,
                       CTRL_LIST_MODIFIER);
         }
+    } else {
+        ALOGE("Unknown identifier id: %d", ident_id);
+    }
+    return ret;
+}
+
+/**
+ * Set new value for an identifier
+ * uc_mgr - UCM structure
+ * identifier - _verb, _enadev, _disdev, _enamod, _dismod
+ *        _swdev, _swmod
+ * value - Value to be set
+ * returns 0 on success, otherwise a negative error code
+ */
+int snd_use_case_set(snd_use_case_mgr_t *uc_mgr,
+                     const char *identifier,
+                     const char *value)
+{
+    char ident[MAX_STR_LEN], *ident1, *ident2, *temp_ptr;
+    int ident_id, ret = -EINVAL;
+
+    pthread_mutex_lock(&uc_mgr->card_ctxt_ptr->card_lock);
+    if ((uc_mgr->snd_card_index >= (int)MAX_NUM_CARDS) || (value == NULL) ||
+        (uc_mgr->snd_card_index < 0) || (uc_mgr->card_ctxt_ptr == NULL) ||
+        (identifier == NULL)) {
+        ALOGE("snd_use_case_set(): failed, invalid arguments");
+        pthread_mutex_unlock(&uc_mgr->card_ctxt_ptr->card_lock);
+        return -EINVAL;
+    }
+
+    ALOGD("snd_use_case_set(): uc_mgr %p identifier %s value %s", uc_mgr,
+         identifier, value);
+    strlcpy(ident, identifier, sizeof(ident));
+    if(!(ident1 = strtok_r(ident, "/", &temp_ptr))) {
+        ALOGV("No multiple identifiers found in identifier value");
+        ident[0] = 0;
+    } else {
+        if (!strncmp(ident1, "_swdev", 6)) {
+            if(!(ident2 = strtok_r(NULL, "/", &temp_ptr))) {
+                ALOGD("Invalid disable device value: %s, but enabling new \
+                     device", ident2);
+            } else {
+                ret = snd_ucm_del_ident_from_list(
+                          &uc_mgr->card_ctxt_ptr->dev_list_head, ident2);
+                if (ret < 0) {
+                    ALOGV("Ignore device %s disable, device not part of \
+                         enabled list", ident2);
+                } else {
+                    ALOGV("swdev: device value to be disabled: %s", ident2);
+                    /* Disable mixer controls for
+                     * corresponding use cases and device */
+                    ret = set_controls_of_device_for_all_usecases(uc_mgr,
+                              ident2, 0);
+                    if (ret < 0) {
+                        ALOGV("Device %s not disabled, no valid use case \
+                              found: %d", ident2, errno);
+                    }
+                }
+            }
+            pthread_mutex_unlock(&uc_mgr->card_ctxt_ptr->card_lock);
+            ret = snd_use_case_set(uc_mgr, "_enadev", value);
+            if (ret < 0) {
+                ALOGV("Device %s not enabled, no valid use case found: %d",
+                    value, errno);
+            }
+            return ret;
+        } else if (!strncmp(ident1, "_swmod", 6)) {
+            pthread_mutex_unlock(&uc_mgr->card_ctxt_ptr->card_lock);
+            if(!(ident2 = strtok_r(NULL, "/", &temp_ptr))) {
+                ALOGD("Invalid modifier value: %s, but enabling new modifier",
+                    ident2);
+            } else {
+                ret = snd_use_case_set(uc_mgr, "_dismod", ident2);
+                if (ret < 0) {
+                    ALOGV("Modifier %s not disabled, no valid use case \
+                         found: %d", ident2, errno);
+                }
+            }
+            ret = snd_use_case_set(uc_mgr, "_enamod", value);
+            if (ret < 0) {
+                ALOGV("Modifier %s not enabled, no valid use case found: %d",
+                    value, errno);
+            }
+            return ret;
+        } else {
+            ALOGV("No switch device/modifier option found: %s", ident1);
+        }
+        ident[0] = 0;
+    }
+
+    if (!strncmp(identifier, "_verb", 5)) {
+        ident_id = SND_UCM_SET_VERB;
+    } else if (!strncmp(identifier, "_enadev", 7)) {
+        ident_id = SND_UCM_SET_ENADEV;
+    } else if (!strncmp(identifier, "_disdev", 7)) {
+        ident_id = SND_UCM_SET_DISDEV;
+    } else if (!strncmp(identifier, "_enamod", 7)) {
+        ident_id = SND_UCM_SET_ENAMOD;
+    } else if (!strncmp(identifier, "_dismod", 7)) {
+        ident_id = SND_UCM_SET_DISMOD;
     } else {
         ALOGE("Unknown identifier value: %s", identifier);
+        pthread_mutex_unlock(&uc_mgr->card_ctxt_ptr->card_lock);
+        return -EINVAL;
+    }
+    ret = snd_use_case_set_l(uc_mgr, ident_id, value, -ENOENT);
+    pthread_mutex_unlock(&uc_mgr->card_ctxt_ptr->card_lock);
+    return ret;
+}
+
+/**
+ * Set new value for an identifier by id
+ * uc_mgr - UCM structure
+ * ident_id - SND_UCM_SET_VERB, _ENADEV, _DISDEV, _ENAMOD or _DISMOD
+ * value_id - interned id of the verb, device or modifier
+ * returns 0 on success, otherwise a negative error code
+ */
+int snd_use_case_set_id(snd_use_case_mgr_t *uc_mgr, int ident_id,
+                        int value_id)
+{
+    const char *value;
+    int ret;
+
+    if ((uc_mgr == NULL) || (uc_mgr->card_ctxt_ptr == NULL)) {
+        ALOGE("snd_use_case_set_id(): failed, invalid arguments");
+        return -EINVAL;
+    }
+    if ((value = snd_use_case_get_name(uc_mgr, value_id)) == NULL) {
+        ALOGE("snd_use_case_set_id(): invalid value id %d", value_id);
+        return -EINVAL;
     }
+
+    ALOGD("snd_use_case_set_id(): uc_mgr %p identifier %d value %s", uc_mgr,
+         ident_id, value);
+    pthread_mutex_lock(&uc_mgr->card_ctxt_ptr->card_lock);
+    ret = snd_use_case_set_l(uc_mgr, ident_id, value, value_id);
     pthread_mutex_unlock(&uc_mgr->card_ctxt_ptr->card_lock);
     return ret;
 }
@@ -1708,6 +1820,8 @@ int snd_use_case_set_case(snd_use_case_mgr_t *uc_mgr,
                         uc_mgr->card_ctxt_ptr->current_verb);
             }
             strlcpy(uc_mgr->card_ctxt_ptr->current_verb, value, MAX_STR_LEN);
+            uc_mgr->card_ctxt_ptr->current_verb_id =
+                snd_ucm_lookup_ident(uc_mgr->card_ctxt_ptr, value, NULL);
             /* Enable the mixer controls for the new use case
              * for specified device */
             if (strncmp(uc_mgr->card_ctxt_ptr->current_verb,
@@ -1951,26 +2065,44 @@ int snd_use_case_mgr_open(snd_use_case_mgr_t **uc_mgr, const char *card_name)
         uc_mgr_ptr->current_modifier_list = NULL;
         uc_mgr_ptr->current_tx_device = -1;
         uc_mgr_ptr->current_rx_device = -1;
-        pthread_mutexattr_init(&uc_mgr_ptr->card_ctxt_ptr->card_lock_attr);
-        pthread_mutex_init(&uc_mgr_ptr->card_ctxt_ptr->card_lock,
+        if (snd_ucm_init_idents(uc_mgr_ptr->card_ctxt_ptr) < 0) {
+            ALOGE("Failed to allocate memory for identifier table");
+            free(uc_mgr_ptr->card_ctxt_ptr->control_device);
+            free(uc_mgr_ptr->card_ctxt_ptr->card_name);
+            free(uc_mgr_ptr->card_ctxt_ptr);
+            free(uc_mgr_ptr);
+            uc_mgr_ptr = NULL;
+            return -ENOMEM;
+        }
+        pthread_mutexattr_init(&uc_mgr_ptr->card_ctxt_ptr->card_lock_attr);
+        pthread_mutex_init(&uc_mgr_ptr->card_ctxt_ptr->card_lock,
             &uc_mgr_ptr->card_ctxt_ptr->card_lock_attr);
         strlcpy(uc_mgr_ptr->card_ctxt_ptr->current_verb,
                 SND_USE_CASE_VERB_INACTIVE, MAX_STR_LEN);
+        uc_mgr_ptr->card_ctxt_ptr->current_verb_id = SND_UCM_ID_VERB_INACTIVE;
         /* Reset all mixer controls if any applied
          * previously for the same card */
     snd_use_case_mgr_reset(uc_mgr_ptr);
         uc_mgr_ptr->card_ctxt_ptr->current_verb_index = -1;
-        /* Parse config files and update mixer controls */
-        ret = snd_ucm_parse(&uc_mgr_ptr);
-        if(ret < 0) {
-            ALOGE("Failed to parse config files: %d", ret);
-            snd_ucm_free_mixer_list(&uc_mgr_ptr);
-        }
+        /* Open the mixer before parsing so that controls of each verb
+         * are resolved as soon as the verb is parsed */
         ALOGV("Open mixer device: %s",
             uc_mgr_ptr->card_ctxt_ptr->control_device);
         uc_mgr_ptr->card_ctxt_ptr->mixer_handle =
             mixer_open(uc_mgr_ptr->card_ctxt_ptr->control_device);
         ALOGV("Mixer handle %p", uc_mgr_ptr->card_ctxt_ptr->mixer_handle);
+        /* Use the compiled image when it is current, parse config
+         * files and update mixer controls otherwise */
+        uc_mgr_ptr->card_ctxt_ptr->config_dir = CONFIG_DIR;
+        if (snd_ucm_image_load(uc_mgr_ptr) == 0)
+            ret = 0;
+        else
+            ret = snd_ucm_parse(&uc_mgr_ptr);
+        if(ret < 0) {
+            ALOGE("Failed to parse config files: %d", ret);
+            snd_ucm_free_mixer_list(&uc_mgr_ptr);
+        }
+        snd_ucm_load_acdb_symbols(uc_mgr_ptr);
         *uc_mgr = uc_mgr_ptr;
     }
     ALOGV("snd_use_case_open(): returning instance %p", uc_mgr_ptr);
@@ -2017,6 +2149,7 @@ int snd_use_case_mgr_close(snd_use_case_mgr_t *uc_mgr)
     uc_mgr->snd_card_index = -1;
     uc_mgr->current_tx_device = -1;
     uc_mgr->current_rx_device = -1;
+    snd_ucm_free_idents(uc_mgr->card_ctxt_ptr);
     free(uc_mgr->card_ctxt_ptr->control_device);
     free(uc_mgr->card_ctxt_ptr->card_name);
     free(uc_mgr->card_ctxt_ptr);
@@ -2081,6 +2214,7 @@ int snd_use_case_mgr_reset(snd_use_case_mgr_t *uc_mgr)
                 uc_mgr->card_ctxt_ptr->current_verb);
         strlcpy(uc_mgr->card_ctxt_ptr->current_verb, SND_USE_CASE_VERB_INACTIVE,
             MAX_STR_LEN);
+        uc_mgr->card_ctxt_ptr->current_verb_id = SND_UCM_ID_VERB_INACTIVE;
     }
     /* Disable mixer controls of all the enabled devices */
     list_size = snd_ucm_get_size_of_list(uc_mgr->card_ctxt_ptr->dev_list_head);
@@ -2125,7 +2259,7 @@ void *second_stage_parsing_thread(void *uc_mgr_ptr)
     char *p = NULL, *verb_name = NULL, *file_name = NULL, *temp_ptr = NULL;
     snd_use_case_mgr_t **uc_mgr = (snd_use_case_mgr_t **)&uc_mgr_ptr;
 
-    strlcpy(path, CONFIG_DIR, (strlen(CONFIG_DIR)+1));
+    strlcpy(path, (*uc_mgr)->card_ctxt_ptr->config_dir, sizeof(path));
     strlcat(path, (*uc_mgr)->card_ctxt_ptr->card_name, sizeof(path));
     ALOGV("master config file path:%s", path);
     fd = open(path, O_RDONLY);
@@ -2266,7 +2400,12 @@ int snd_use_case_mgr_wait_for_parsing(snd_use_case_mgr_t *uc_mgr)
 {
     int ret;
 
+    /* Nothing to wait for when loaded from a compiled image or when
+     * the config has a single file */
+    if (!uc_mgr->thr_valid)
+        return 0;
     ret = pthread_join(uc_mgr->thr, NULL);
+    uc_mgr->thr_valid = false;
     return ret;
 }
 
@@ -2284,7 +2423,7 @@ static int snd_ucm_parse(snd_use_case_mgr_t **uc_mgr)
     char *file_name = NULL, *temp_ptr;
     char path[200];
 
-    strlcpy(path, CONFIG_DIR, (strlen(CONFIG_DIR)+1));
+    strlcpy(path, (*uc_mgr)->card_ctxt_ptr->config_dir, sizeof(path));
     strlcat(path, (*uc_mgr)->card_ctxt_ptr->card_name, sizeof(path));
     ALOGV("master config file path:%s", path);
     fd = open(path, O_RDONLY);
@@ -2304,6 +2443,8 @@ static int snd_ucm_parse(snd_use_case_mgr_t **uc_mgr)
         close(fd);
         return -EINVAL;
     }
+    snd_ucm_record_source((*uc_mgr)->card_ctxt_ptr,
+        (*uc_mgr)->card_ctxt_ptr->card_name);
     current_str = read_buf;
     verb_count = get_verb_count(current_str);
     (*uc_mgr)->card_ctxt_ptr->use_case_verb_list =
@@ -2427,9 +2568,10 @@ static int snd_ucm_parse(snd_use_case_mgr_t **uc_mgr)
         ALOGD("Creating Parsing thread uc_mgr %p\n", uc_mgr);
         rc = pthread_create(&(*uc_mgr)->thr, 0, second_stage_parsing_thread,
                  (void*)(*uc_mgr));
-        if(rc < 0) {
+        if(rc != 0) {
             ALOGE("Failed to create parsing thread rc %d errno %d\n", rc, errno);
         } else {
+            (*uc_mgr)->thr_valid = true;
             ALOGV("Prasing thread created successfully\n");
         }
     }
@@ -2691,6 +2833,9 @@ char *current_str, int num_verbs)
     if (ret < 0) {
         ALOGE("Failed to parse config file ret %d errno %d\n", ret, errno);
     } else {
+        for (index = 0; strncmp((*uc_mgr)->card_ctxt_ptr->verb_list[index],
+             SND_UCM_END_OF_LIST, 3); index++)
+            snd_ucm_index_verb(*uc_mgr, index);
         ALOGV("Prasing done successfully\n");
 #if PARSE_DEBUG
         /* Prints use cases and mixer controls parsed from config files */
@@ -2878,9 +3023,10 @@ const char *file_name, int index)
     char path[200];
     use_case_verb_t *verb_list;
 
-    strlcpy(path, CONFIG_DIR, (strlen(CONFIG_DIR)+1));
+    strlcpy(path, (*uc_mgr)->card_ctxt_ptr->config_dir, sizeof(path));
     strlcat(path, file_name, sizeof(path));
     ALOGV("path:%s", path);
+    snd_ucm_record_source((*uc_mgr)->card_ctxt_ptr, file_name);
     verb_list = (*uc_mgr)->card_ctxt_ptr->use_case_verb_list;
     while(1) {
         device_count = 0; modifier_count = 0;
@@ -3090,6 +3236,8 @@ const char *file_name, int index)
             break;
         }
     }
+    if (ret == 0)
+        snd_ucm_index_verb(*uc_mgr, index);
     return ret;
 }
 
@@ -3498,6 +3646,7 @@ int size)
             break;
         }
         strlcpy(list->control_name, p, (strlen(p)+1)*sizeof(char));
+        list->ctl = NULL;
         p = strtok_r(NULL, ":", &temp_ptr);
         if (p == NULL)
             break;
@@ -3580,6 +3729,1043 @@ int size)
     return ret;
 }
 
+/* Resolve the control names of one mixer list to control handles */
+static void snd_ucm_resolve_list(struct mixer *mixer, mixer_control_t *list,
+int count)
+{
+    int index;
+
+    for (index = 0; index < count; index++) {
+        list[index].ctl = mixer_get_control(mixer,
+                              list[index].control_name, 0);
+        if (list[index].ctl == NULL)
+            ALOGV("Mixer control %s not found", list[index].control_name);
+    }
+}
+
+/* Intern the use case names of a control list and resolve their
+ * controls against the card mixer
+ */
+static void snd_ucm_index_list(snd_use_case_mgr_t *uc_mgr, card_mctrl_t *list,
+int count)
+{
+    struct mixer *mixer = uc_mgr->card_ctxt_ptr->mixer_handle;
+    int index;
+
+    for (index = 0; list && index < count; index++) {
+        /* A section without a Name can not be looked up anyway */
+        list[index].case_id = list[index].case_name ?
+            snd_ucm_intern_ident(uc_mgr->card_ctxt_ptr,
+                list[index].case_name) : -ENOENT;
+        if (mixer == NULL)
+            continue;
+        snd_ucm_resolve_list(mixer, list[index].ena_mixer_list,
+            list[index].ena_mixer_count);
+        snd_ucm_resolve_list(mixer, list[index].dis_mixer_list,
+            list[index].dis_mixer_count);
+    }
+}
+
+/* Index a parsed verb, its devices and modifiers once, so enabling a
+ * use case or device neither compares names nor looks controls up
+ * by name again.
+ * uc_mgr - UCM structure pointer
+ * verb_index - index of the verb whose lists were just parsed
+ */
+static void snd_ucm_index_verb(snd_use_case_mgr_t *uc_mgr, int verb_index)
+{
+    use_case_verb_t *verb = &uc_mgr->card_ctxt_ptr->use_case_verb_list[verb_index];
+
+    snd_ucm_index_list(uc_mgr, verb->verb_ctrls, verb->verb_count);
+    /* Device and modifier lists may be shared between verbs,
+     * indexing them again is harmless */
+    snd_ucm_index_list(uc_mgr, verb->device_ctrls, verb->device_count);
+    snd_ucm_index_list(uc_mgr, verb->mod_ctrls, verb->mod_count);
+}
+
+/* Hash of prefix followed by suffix, so that composed use case names
+ * like verb and device can be looked up without building the string
+ */
+static unsigned snd_ucm_ident_hash(const char *prefix, const char *suffix)
+{
+    unsigned hash = 2166136261u;
+
+    for (; *prefix; prefix++)
+        hash = (hash ^ (unsigned char)*prefix) * 16777619u;
+    for (; suffix && *suffix; suffix++)
+        hash = (hash ^ (unsigned char)*suffix) * 16777619u;
+    return hash & (SND_UCM_IDENT_HASH_SIZE - 1);
+}
+
+/* Called with ident_lock held */
+static struct snd_ucm_intern_node *snd_ucm_find_ident_l(card_ctxt_t *card,
+const char *prefix, const char *suffix)
+{
+    struct snd_ucm_intern_node *node;
+    size_t len = strlen(prefix);
+
+    if (suffix == NULL)
+        suffix = "";
+    node = card->ident_hash[snd_ucm_ident_hash(prefix, suffix)];
+    for (; node != NULL; node = node->next) {
+        if (!strncmp(node->name, prefix, len) && !strcmp(node->name + len, suffix))
+            return node;
+    }
+    return NULL;
+}
+
+/* Return the id of a name, adding it to the table if not yet interned
+ * card - card context
+ * name - verb, device or modifier name
+ * returns id on success, negative error code otherwise
+ */
+static int snd_ucm_intern_ident(card_ctxt_t *card, const char *name)
+{
+    struct snd_ucm_intern_node *node, **nodes;
+    unsigned bucket;
+    int id = -ENOMEM;
+
+    pthread_mutex_lock(&card->ident_lock);
+    if ((node = snd_ucm_find_ident_l(card, name, NULL)) != NULL) {
+        pthread_mutex_unlock(&card->ident_lock);
+        return node->id;
+    }
+    if (card->ident_count == card->ident_size) {
+        nodes = (struct snd_ucm_intern_node **)realloc(card->ident_nodes,
+                    (card->ident_size + 32) * sizeof(*nodes));
+        if (nodes == NULL) {
+            pthread_mutex_unlock(&card->ident_lock);
+            return -ENOMEM;
+        }
+        card->ident_nodes = nodes;
+        card->ident_size += 32;
+    }
+    node = (struct snd_ucm_intern_node *)malloc(sizeof(*node));
+    if (node != NULL) {
+        node->name = strdup(name);
+        if (node->name == NULL) {
+            free(node);
+        } else {
+            node->id = card->ident_count;
+            node->type = -1;
+            bucket = snd_ucm_ident_hash(name, NULL);
+            node->next = card->ident_hash[bucket];
+            card->ident_hash[bucket] = node;
+            card->ident_nodes[card->ident_count++] = node;
+            id = node->id;
+        }
+    }
+    pthread_mutex_unlock(&card->ident_lock);
+    return id;
+}
+
+/* Return the id of prefix followed by suffix, -ENOENT if not interned */
+static int snd_ucm_lookup_ident(card_ctxt_t *card, const char *prefix,
+const char *suffix)
+{
+    struct snd_ucm_intern_node *node;
+    int id = -ENOENT;
+
+    pthread_mutex_lock(&card->ident_lock);
+    if ((node = snd_ucm_find_ident_l(card, prefix, suffix)) != NULL)
+        id = node->id;
+    pthread_mutex_unlock(&card->ident_lock);
+    return id;
+}
+
+/* Return the capability of a use case, evaluated once per interned name
+ * card - card context
+ * id - interned id, or negative to look name up
+ * name - use case name
+ */
+static int snd_ucm_get_ident_type(card_ctxt_t *card, int id, const char *name)
+{
+    struct snd_ucm_intern_node *node = NULL;
+    int type;
+
+    pthread_mutex_lock(&card->ident_lock);
+    if (id >= 0 && id < card->ident_count)
+        node = card->ident_nodes[id];
+    else
+        node = snd_ucm_find_ident_l(card, name, NULL);
+    if (node != NULL && node->type >= 0) {
+        type = node->type;
+    } else {
+        type = getUseCaseType(name);
+        if (node != NULL)
+            node->type = type;
+    }
+    pthread_mutex_unlock(&card->ident_lock);
+    return type;
+}
+
+/* Create the identifier table and intern the well known names */
+static int snd_ucm_init_idents(card_ctxt_t *card)
+{
+    int index;
+
+    memset(card->ident_hash, 0, sizeof(card->ident_hash));
+    card->ident_nodes = NULL;
+    card->ident_count = 0;
+    card->ident_size = 0;
+    pthread_mutex_init(&card->ident_lock, NULL);
+    for (index = 0; index < SND_UCM_ID_KNOWN_COUNT; index++) {
+        if (snd_ucm_intern_ident(card, snd_ucm_known_idents[index]) != index) {
+            snd_ucm_free_idents(card);
+            return -ENOMEM;
+        }
+    }
+    return 0;
+}
+
+static void snd_ucm_free_idents(card_ctxt_t *card)
+{
+    int index;
+
+    for (index = 0; index < card->ident_count; index++) {
+        free(card->ident_nodes[index]->name);
+        free(card->ident_nodes[index]);
+    }
+    free(card->ident_nodes);
+    card->ident_nodes = NULL;
+    card->ident_count = 0;
+    card->ident_size = 0;
+    memset(card->ident_hash, 0, sizeof(card->ident_hash));
+    pthread_mutex_destroy(&card->ident_lock);
+}
+
+/**
+ * Get the interned id of a verb, device or modifier name
+ * uc_mgr - UCM structure, NULL to resolve only the well known names
+ * name - verb, device or modifier name
+ * returns id on success, -ENOENT if the name is not known
+ */
+int snd_use_case_get_id(snd_use_case_mgr_t *uc_mgr, const char *name)
+{
+    int index;
+
+    if (name == NULL)
+        return -EINVAL;
+    if (uc_mgr != NULL && uc_mgr->card_ctxt_ptr != NULL)
+        return snd_ucm_lookup_ident(uc_mgr->card_ctxt_ptr, name, NULL);
+    for (index = 0; index < SND_UCM_ID_KNOWN_COUNT; index++) {
+        if (!strcmp(snd_ucm_known_idents[index], name))
+            return index;
+    }
+    return -ENOENT;
+}
+
+/**
+ * Get the name of an interned id
+ * uc_mgr - UCM structure, NULL to resolve only the well known ids
+ * id - interned id
+ * returns name, NULL if the id is not valid
+ */
+const char *snd_use_case_get_name(snd_use_case_mgr_t *uc_mgr, int id)
+{
+    const char *name = NULL;
+
+    if (id < 0)
+        return NULL;
+    if (id < SND_UCM_ID_KNOWN_COUNT)
+        return snd_ucm_known_idents[id];
+    if (uc_mgr != NULL && uc_mgr->card_ctxt_ptr != NULL) {
+        pthread_mutex_lock(&uc_mgr->card_ctxt_ptr->ident_lock);
+        if (id < uc_mgr->card_ctxt_ptr->ident_count)
+            name = uc_mgr->card_ctxt_ptr->ident_nodes[id]->name;
+        pthread_mutex_unlock(&uc_mgr->card_ctxt_ptr->ident_lock);
+    }
+    return name;
+}
+
+/* Look up the ACDB loader entry points once per loader handle.
+ * The handle is assigned by the client after snd_use_case_mgr_open(),
+ * so this is attempted at open and again when the handle changes.
+ * uc_mgr - UCM structure pointer
+ */
+static void snd_ucm_load_acdb_symbols(snd_use_case_mgr_t *uc_mgr)
+{
+    if (uc_mgr->acdb_sym_handle == uc_mgr->acdb_handle)
+        return;
+
+    uc_mgr->acdb_sym_handle = uc_mgr->acdb_handle;
+    uc_mgr->acdb_send_audio_cal = NULL;
+    uc_mgr->acdb_send_voice_cal = NULL;
+    if (uc_mgr->acdb_handle == NULL)
+        return;
+
+    uc_mgr->acdb_send_audio_cal = (void (*)(int, int))dlsym(
+        uc_mgr->acdb_handle, "acdb_loader_send_audio_cal");
+    if (uc_mgr->acdb_send_audio_cal == NULL)
+        ALOGE("ucm:dlsym:Error:%s Loading acdb_loader_send_audio_cal", dlerror());
+    uc_mgr->acdb_send_voice_cal = (void (*)(int, int))dlsym(
+        uc_mgr->acdb_handle, "acdb_loader_send_voice_cal");
+    if (uc_mgr->acdb_send_voice_cal == NULL)
+        ALOGE("ucm: dlsym: Error:%s Loading acdb_loader_send_voice_cal", dlerror());
+}
+
+/* Remember a config file read while compiling an image */
+static void snd_ucm_record_source(card_ctxt_t *card, const char *file_name)
+{
+    char **sources;
+
+    if (card->record_sources <= 0)
+        return;
+    sources = (char **)realloc(card->sources,
+                  (card->source_count + 1) * sizeof(char *));
+    if (sources == NULL) {
+        card->record_sources = -ENOMEM;
+        return;
+    }
+    card->sources = sources;
+    if ((sources[card->source_count] = strdup(file_name)) == NULL) {
+        card->record_sources = -ENOMEM;
+        return;
+    }
+    card->source_count++;
+}
+
+static uint32_t snd_ucm_fnv1a(uint32_t hash, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+
+    while (len--)
+        hash = (hash ^ *p++) * 16777619u;
+    return hash;
+}
+
+/* Size and modification time of a config file, to tell whether an
+ * image is stale without reading the file
+ * Returns 0 on sucess, negative error code otherwise
+ */
+static int snd_ucm_stat_file(const char *path, uint32_t *size, time_t *mtime)
+{
+    struct stat st;
+
+    if (stat(path, &st) < 0)
+        return -errno;
+    if (st.st_size > (off_t)UINT32_MAX)
+        return -EINVAL;
+    *size = (uint32_t)st.st_size;
+    *mtime = st.st_mtime;
+    return 0;
+}
+
+static inline const char *snd_ucm_image_str(const char *strings, uint32_t off)
+{
+    return (off == SND_UCM_IMAGE_NONE) ? NULL : (strings + off);
+}
+
+static int snd_ucm_image_check_table(const struct snd_ucm_image_header *hdr,
+uint32_t offset, uint32_t count, size_t size)
+{
+    uint64_t end = (uint64_t)offset + (uint64_t)count * size;
+
+    if ((offset % sizeof(uint32_t)) || (offset < sizeof(*hdr)) ||
+        (end > hdr->image_size))
+        return -EINVAL;
+    return 0;
+}
+
+static int snd_ucm_image_check_str(const struct snd_ucm_image_header *hdr,
+uint32_t off, int optional)
+{
+    if (off == SND_UCM_IMAGE_NONE)
+        return optional ? 0 : -EINVAL;
+    return (off < hdr->string_size) ? 0 : -EINVAL;
+}
+
+static int snd_ucm_image_check_range(uint32_t first, uint32_t count,
+uint32_t total)
+{
+    return (((uint64_t)first + count) <= total) ? 0 : -EINVAL;
+}
+
+/* Check that a control list of the image is in range and terminated */
+static int snd_ucm_image_check_list(const char *image,
+uint32_t first, uint32_t count)
+{
+    const struct snd_ucm_image_header *hdr =
+        (const struct snd_ucm_image_header *)image;
+    const struct snd_ucm_image_case *icase =
+        (const struct snd_ucm_image_case *)(image + hdr->case_offset);
+    const char *name;
+
+    if (snd_ucm_image_check_range(first, count + 1, hdr->case_count) < 0)
+        return -EINVAL;
+    name = snd_ucm_image_str(image + hdr->string_offset,
+               icase[first + count].name);
+    if ((name == NULL) || strcmp(name, SND_UCM_END_OF_LIST))
+        return -EINVAL;
+    return 0;
+}
+
+/* Validate a mapped image against its format and the text configs it
+ * was compiled from. A config is taken as changed when its size differs
+ * or it is newer than the image, so that images generated at build time
+ * stay valid with the timestamps of the system image.
+ * Returns 0 on sucess, negative error code otherwise
+ */
+static int snd_ucm_image_validate(card_ctxt_t *card, const char *image,
+size_t size, time_t image_mtime)
+{
+    const struct snd_ucm_image_header *hdr =
+        (const struct snd_ucm_image_header *)image;
+    const struct snd_ucm_image_source *isrc;
+    const struct snd_ucm_image_verb *iverb;
+    const struct snd_ucm_image_case *icase;
+    const struct snd_ucm_image_control *ictl;
+    const uint32_t *ivalue;
+    char path[200];
+    uint32_t index, src_size;
+    time_t src_mtime;
+
+    if ((hdr->magic != SND_UCM_IMAGE_MAGIC) ||
+        (hdr->version != SND_UCM_IMAGE_VERSION) ||
+        (hdr->image_size != size)) {
+        ALOGE("Compiled UCM image has wrong magic, version or size");
+        return -EINVAL;
+    }
+    if (hdr->checksum != snd_ucm_fnv1a(2166136261u, image + sizeof(*hdr),
+                             size - sizeof(*hdr))) {
+        ALOGE("Compiled UCM image checksum mismatch");
+        return -EINVAL;
+    }
+    if (snd_ucm_image_check_table(hdr, hdr->source_offset, hdr->source_count,
+            sizeof(*isrc)) ||
+        snd_ucm_image_check_table(hdr, hdr->verb_offset, hdr->verb_count,
+            sizeof(*iverb)) ||
+        snd_ucm_image_check_table(hdr, hdr->case_offset, hdr->case_count,
+            sizeof(*icase)) ||
+        snd_ucm_image_check_table(hdr, hdr->control_offset, hdr->control_count,
+            sizeof(*ictl)) ||
+        snd_ucm_image_check_table(hdr, hdr->value_offset, hdr->value_count,
+            sizeof(*ivalue)) ||
+        snd_ucm_image_check_table(hdr, hdr->string_offset, hdr->string_size,
+            1) ||
+        (hdr->verb_count == 0) || (hdr->string_size == 0) ||
+        (image[hdr->string_offset + hdr->string_size - 1] != '\0')) {
+        ALOGE("Compiled UCM image has invalid tables");
+        return -EINVAL;
+    }
+
+    ivalue = (const uint32_t *)(image + hdr->value_offset);
+    for (index = 0; index < hdr->value_count; index++) {
+        if (snd_ucm_image_check_str(hdr, ivalue[index], 0))
+            goto invalid;
+    }
+    ictl = (const struct snd_ucm_image_control *)(image + hdr->control_offset);
+    for (index = 0; index < hdr->control_count; index++, ictl++) {
+        if (snd_ucm_image_check_str(hdr, ictl->name, 0) ||
+            snd_ucm_image_check_str(hdr, ictl->string, 1))
+            goto invalid;
+        if ((ictl->type == TYPE_MULTI_VAL) &&
+            snd_ucm_image_check_range(ictl->value_first, ictl->value,
+                hdr->value_count))
+            goto invalid;
+    }
+    icase = (const struct snd_ucm_image_case *)(image + hdr->case_offset);
+    for (index = 0; index < hdr->case_count; index++, icase++) {
+        if (snd_ucm_image_check_str(hdr, icase->name, 1) ||
+            snd_ucm_image_check_str(hdr, icase->playback_dev_name, 1) ||
+            snd_ucm_image_check_str(hdr, icase->capture_dev_name, 1) ||
+            snd_ucm_image_check_str(hdr, icase->effects_mixer_ctl, 1) ||
+            snd_ucm_image_check_range(icase->ena_first, icase->ena_count,
+                hdr->control_count) ||
+            snd_ucm_image_check_range(icase->dis_first, icase->dis_count,
+                hdr->control_count))
+            goto invalid;
+    }
+    iverb = (const struct snd_ucm_image_verb *)(image + hdr->verb_offset);
+    for (index = 0; index < hdr->verb_count; index++, iverb++) {
+        if (snd_ucm_image_check_str(hdr, iverb->name, 0) ||
+            snd_ucm_image_check_list(image, iverb->verb_first,
+                iverb->verb_count) ||
+            snd_ucm_image_check_list(image, iverb->device_first,
+                iverb->device_count) ||
+            snd_ucm_image_check_list(image, iverb->mod_first,
+                iverb->mod_count))
+            goto invalid;
+    }
+
+    /* Fall back to the text configs as soon as one was changed */
+    isrc = (const struct snd_ucm_image_source *)(image + hdr->source_offset);
+    for (index = 0; index < hdr->source_count; index++, isrc++) {
+        if (snd_ucm_image_check_str(hdr, isrc->name, 0))
+            goto invalid;
+        strlcpy(path, card->config_dir, sizeof(path));
+        strlcat(path, image + hdr->string_offset + isrc->name, sizeof(path));
+        if (snd_ucm_stat_file(path, &src_size, &src_mtime) < 0 ||
+            (src_size != isrc->size) || (src_mtime > image_mtime)) {
+            ALOGD("Compiled UCM image is stale, %s changed", path);
+            return -ESTALE;
+        }
+    }
+    return 0;
+
+invalid:
+    ALOGE("Compiled UCM image has invalid entries");
+    return -EINVAL;
+}
+
+/* Load the use case lists of a card from its compiled image.
+ * Names and values stay in the read only mapping, the lists pointing
+ * at them are one allocation and nothing is left to parse afterwards.
+ * uc_mgr - use case manager structure
+ * Returns 0 on sucess, negative error code otherwise
+ */
+static int snd_ucm_image_load(snd_use_case_mgr_t *uc_mgr)
+{
+    card_ctxt_t *card = uc_mgr->card_ctxt_ptr;
+    const struct snd_ucm_image_header *hdr;
+    const struct snd_ucm_image_verb *iverb;
+    const struct snd_ucm_image_case *icase;
+    const struct snd_ucm_image_control *ictl;
+    const uint32_t *ivalue;
+    const char *strings;
+    use_case_verb_t *verbs;
+    card_mctrl_t *cases;
+    mixer_control_t *controls;
+    char **verb_names, **names, **values;
+    char *image, *lists;
+    char path[200];
+    struct stat st;
+    uint32_t index;
+    int fd, ret;
+
+#if __BYTE_ORDER != __LITTLE_ENDIAN
+    /* Tables are used in place, only little endian hosts can map them */
+    ALOGV("Compiled UCM images need a little endian host, parsing config files");
+    return -ENOTSUP;
+#endif
+    strlcpy(path, card->config_dir, sizeof(path));
+    strlcat(path, card->card_name, sizeof(path));
+    strlcat(path, SND_UCM_IMAGE_SUFFIX, sizeof(path));
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ALOGV("No compiled UCM image %s, parsing config files", path);
+        return -ENOENT;
+    }
+    if ((fstat(fd, &st) < 0) ||
+        (st.st_size < (off_t)sizeof(struct snd_ucm_image_header))) {
+        ALOGE("Invalid compiled UCM image %s", path);
+        close(fd);
+        return -EINVAL;
+    }
+    image = (char *)mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        ALOGE("failed to mmap %s error %d", path, errno);
+        return -EINVAL;
+    }
+    ret = snd_ucm_image_validate(card, image, st.st_size, st.st_mtime);
+    if (ret < 0) {
+        munmap(image, st.st_size);
+        return ret;
+    }
+
+    hdr = (const struct snd_ucm_image_header *)image;
+    iverb = (const struct snd_ucm_image_verb *)(image + hdr->verb_offset);
+    icase = (const struct snd_ucm_image_case *)(image + hdr->case_offset);
+    ictl = (const struct snd_ucm_image_control *)(image + hdr->control_offset);
+    ivalue = (const uint32_t *)(image + hdr->value_offset);
+    strings = image + hdr->string_offset;
+
+    lists = (char *)calloc(1, hdr->verb_count * sizeof(use_case_verb_t) +
+                hdr->case_count * sizeof(card_mctrl_t) +
+                hdr->control_count * sizeof(mixer_control_t) +
+                (hdr->verb_count + 1 + hdr->case_count + hdr->value_count) *
+                sizeof(char *));
+    if (lists == NULL) {
+        munmap(image, st.st_size);
+        return -ENOMEM;
+    }
+    verbs = (use_case_verb_t *)lists;
+    cases = (card_mctrl_t *)(verbs + hdr->verb_count);
+    controls = (mixer_control_t *)(cases + hdr->case_count);
+    verb_names = (char **)(controls + hdr->control_count);
+    names = verb_names + hdr->verb_count + 1;
+    values = names + hdr->case_count;
+
+    for (index = 0; index < hdr->value_count; index++)
+        values[index] = (char *)snd_ucm_image_str(strings, ivalue[index]);
+    for (index = 0; index < hdr->control_count; index++, ictl++) {
+        controls[index].control_name =
+            (char *)snd_ucm_image_str(strings, ictl->name);
+        controls[index].type = ictl->type;
+        controls[index].value = ictl->value;
+        controls[index].string =
+            (char *)snd_ucm_image_str(strings, ictl->string);
+        controls[index].mulval = (ictl->type == TYPE_MULTI_VAL) ?
+            (values + ictl->value_first) : NULL;
+        controls[index].ctl = NULL;
+    }
+    for (index = 0; index < hdr->case_count; index++, icase++) {
+        names[index] = (char *)snd_ucm_image_str(strings, icase->name);
+        cases[index].case_name = names[index];
+        cases[index].ena_mixer_count = icase->ena_count;
+        cases[index].ena_mixer_list = icase->ena_count ?
+            (controls + icase->ena_first) : NULL;
+        cases[index].dis_mixer_count = icase->dis_count;
+        cases[index].dis_mixer_list = icase->dis_count ?
+            (controls + icase->dis_first) : NULL;
+        cases[index].playback_dev_name =
+            (char *)snd_ucm_image_str(strings, icase->playback_dev_name);
+        cases[index].capture_dev_name =
+            (char *)snd_ucm_image_str(strings, icase->capture_dev_name);
+        cases[index].effects_mixer_ctl =
+            (char *)snd_ucm_image_str(strings, icase->effects_mixer_ctl);
+        cases[index].acdb_id = icase->acdb_id;
+        cases[index].capability = icase->capability;
+        cases[index].case_id = -1;
+    }
+    for (index = 0; index < hdr->verb_count; index++, iverb++) {
+        verb_names[index] = (char *)snd_ucm_image_str(strings, iverb->name);
+        verbs[index].use_case_name = verb_names[index];
+        verbs[index].device_list = names + iverb->device_first;
+        verbs[index].modifier_list = names + iverb->mod_first;
+        verbs[index].verb_count = iverb->verb_count;
+        verbs[index].device_count = iverb->device_count;
+        verbs[index].mod_count = iverb->mod_count;
+        verbs[index].verb_ctrls = cases + iverb->verb_first;
+        verbs[index].device_ctrls = cases + iverb->device_first;
+        verbs[index].mod_ctrls = cases + iverb->mod_first;
+    }
+    verb_names[hdr->verb_count] = (char *)SND_UCM_END_OF_LIST;
+
+    pthread_mutex_lock(&card->card_lock);
+    card->image = image;
+    card->image_size = st.st_size;
+    card->image_lists = lists;
+    card->use_case_verb_list = verbs;
+    card->verb_list = verb_names;
+    pthread_mutex_unlock(&card->card_lock);
+    for (index = 0; index < hdr->verb_count; index++)
+        snd_ucm_index_verb(uc_mgr, index);
+    ALOGD("Loaded compiled UCM image %s with %u verbs", path, hdr->verb_count);
+    return 0;
+}
+
+#define SND_UCM_IMAGE_STR_HASH_SIZE 1024
+
+struct snd_ucm_image_buf {
+    char *data;
+    size_t size;
+    size_t alloc;
+};
+
+struct snd_ucm_image_str_node {
+    uint32_t offset;
+    struct snd_ucm_image_str_node *next;
+};
+
+/* Image being compiled, errors are sticky so that appends need not
+ * be checked one by one */
+struct snd_ucm_image_writer {
+    struct snd_ucm_image_buf sources;
+    struct snd_ucm_image_buf verbs;
+    struct snd_ucm_image_buf cases;
+    struct snd_ucm_image_buf controls;
+    struct snd_ucm_image_buf values;
+    struct snd_ucm_image_buf strings;
+    struct snd_ucm_image_str_node *str_hash[SND_UCM_IMAGE_STR_HASH_SIZE];
+    int error;
+};
+
+/* Append data to a section, returns the offset it was written at */
+static uint32_t snd_ucm_image_add(struct snd_ucm_image_writer *w,
+struct snd_ucm_image_buf *buf, const void *data, size_t len)
+{
+    uint32_t offset = (uint32_t)buf->size;
+    size_t alloc;
+    char *ptr;
+
+    if (w->error)
+        return 0;
+    if (buf->size + len > buf->alloc) {
+        alloc = buf->alloc ? buf->alloc : 1024;
+        while (alloc < buf->size + len)
+            alloc *= 2;
+        if ((alloc > UINT32_MAX) ||
+            ((ptr = (char *)realloc(buf->data, alloc)) == NULL)) {
+            w->error = -ENOMEM;
+            return 0;
+        }
+        buf->data = ptr;
+        buf->alloc = alloc;
+    }
+    memcpy(buf->data + buf->size, data, len);
+    buf->size += len;
+    return offset;
+}
+
+/* Add a string once to the string table, returns its offset */
+static uint32_t snd_ucm_image_add_str(struct snd_ucm_image_writer *w,
+const char *str)
+{
+    struct snd_ucm_image_str_node *node;
+    size_t len;
+    unsigned bucket;
+
+    if (str == NULL)
+        return SND_UCM_IMAGE_NONE;
+    len = strlen(str) + 1;
+    bucket = snd_ucm_fnv1a(2166136261u, str, len) &
+                 (SND_UCM_IMAGE_STR_HASH_SIZE - 1);
+    for (node = w->str_hash[bucket]; node != NULL; node = node->next) {
+        if (!strcmp(w->strings.data + node->offset, str))
+            return node->offset;
+    }
+    node = (struct snd_ucm_image_str_node *)malloc(sizeof(*node));
+    if (node == NULL) {
+        w->error = -ENOMEM;
+        return SND_UCM_IMAGE_NONE;
+    }
+    node->offset = snd_ucm_image_add(w, &w->strings, str, len);
+    if (w->error) {
+        free(node);
+        return SND_UCM_IMAGE_NONE;
+    }
+    node->next = w->str_hash[bucket];
+    w->str_hash[bucket] = node;
+    return node->offset;
+}
+
+/* Add the controls of a sequence, returns the index of the first one */
+static uint32_t snd_ucm_image_add_controls(struct snd_ucm_image_writer *w,
+const mixer_control_t *list, int count)
+{
+    struct snd_ucm_image_control ictl;
+    uint32_t first = w->controls.size / sizeof(ictl), value;
+    unsigned index;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        memset(&ictl, 0, sizeof(ictl));
+        ictl.name = snd_ucm_image_add_str(w, list[i].control_name);
+        ictl.type = list[i].type;
+        ictl.value = list[i].value;
+        ictl.string = snd_ucm_image_add_str(w, list[i].string);
+        ictl.value_first = SND_UCM_IMAGE_NONE;
+        if (list[i].type == TYPE_MULTI_VAL) {
+            ictl.value_first = w->values.size / sizeof(value);
+            if (list[i].mulval == NULL)
+                ictl.value = 0;
+            for (index = 0; index < ictl.value; index++) {
+                value = snd_ucm_image_add_str(w, list[i].mulval[index]);
+                snd_ucm_image_add(w, &w->values, &value, sizeof(value));
+            }
+        }
+        snd_ucm_image_add(w, &w->controls, &ictl, sizeof(ictl));
+    }
+    return first;
+}
+
+/* Add a list of use cases followed by its end of list entry, returns
+ * the index of the first case */
+static uint32_t snd_ucm_image_add_cases(struct snd_ucm_image_writer *w,
+const card_mctrl_t *list, int count)
+{
+    struct snd_ucm_image_case icase;
+    uint32_t first = w->cases.size / sizeof(icase);
+    int i;
+
+    for (i = 0; i <= count; i++) {
+        memset(&icase, 0, sizeof(icase));
+        icase.playback_dev_name = SND_UCM_IMAGE_NONE;
+        icase.capture_dev_name = SND_UCM_IMAGE_NONE;
+        icase.effects_mixer_ctl = SND_UCM_IMAGE_NONE;
+        if (i == count) {
+            icase.name = snd_ucm_image_add_str(w, SND_UCM_END_OF_LIST);
+        } else {
+            icase.name = snd_ucm_image_add_str(w, list[i].case_name);
+            icase.playback_dev_name =
+                snd_ucm_image_add_str(w, list[i].playback_dev_name);
+            icase.capture_dev_name =
+                snd_ucm_image_add_str(w, list[i].capture_dev_name);
+            icase.effects_mixer_ctl =
+                snd_ucm_image_add_str(w, list[i].effects_mixer_ctl);
+            icase.acdb_id = list[i].acdb_id;
+            icase.capability = list[i].capability;
+            icase.ena_first = snd_ucm_image_add_controls(w,
+                                  list[i].ena_mixer_list,
+                                  list[i].ena_mixer_count);
+            icase.ena_count = list[i].ena_mixer_count;
+            icase.dis_first = snd_ucm_image_add_controls(w,
+                                  list[i].dis_mixer_list,
+                                  list[i].dis_mixer_count);
+            icase.dis_count = list[i].dis_mixer_count;
+        }
+        snd_ucm_image_add(w, &w->cases, &icase, sizeof(icase));
+    }
+    return first;
+}
+
+/* Convert a table of 32 bit fields to the little endian image format */
+static void snd_ucm_image_to_le(void *data, size_t size)
+{
+    uint32_t *p = (uint32_t *)data;
+    size_t index;
+
+    for (index = 0; index < size / sizeof(uint32_t); index++)
+        p[index] = htole32(p[index]);
+}
+
+static int snd_ucm_write_all(int fd, const void *data, size_t len)
+{
+    const char *p = (const char *)data;
+    ssize_t n;
+
+    while (len > 0) {
+        n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Write the parsed lists of a card as an image
+ * uc_mgr - use case manager structure, with all verbs parsed
+ * image_path - file to write
+ * Returns 0 on sucess, negative error code otherwise
+ */
+static int snd_ucm_image_write(snd_use_case_mgr_t *uc_mgr,
+const char *image_path)
+{
+    card_ctxt_t *card = uc_mgr->card_ctxt_ptr;
+    use_case_verb_t *verb_list = card->use_case_verb_list;
+    struct snd_ucm_image_writer w;
+    struct snd_ucm_image_header hdr;
+    struct snd_ucm_image_source isrc;
+    struct snd_ucm_image_verb iverb, *prev_verbs;
+    struct snd_ucm_image_str_node *node;
+    struct snd_ucm_image_buf *sections[6];
+    char path[200], tmp_path[256];
+    uint32_t offset;
+    time_t mtime;
+    int index, prev, fd, ret = 0;
+
+    memset(&w, 0, sizeof(w));
+    if (card->record_sources < 0)
+        return card->record_sources;
+    for (index = 0; index < card->source_count; index++) {
+        strlcpy(path, card->config_dir, sizeof(path));
+        strlcat(path, card->sources[index], sizeof(path));
+        ret = snd_ucm_stat_file(path, &isrc.size, &mtime);
+        if (ret < 0) {
+            ALOGE("failed to read config file %s error %d", path, ret);
+            goto done;
+        }
+        isrc.name = snd_ucm_image_add_str(&w, card->sources[index]);
+        snd_ucm_image_add(&w, &w.sources, &isrc, sizeof(isrc));
+    }
+    for (index = 0; strncmp(card->verb_list[index], SND_UCM_END_OF_LIST,
+         strlen(SND_UCM_END_OF_LIST) + 1); index++) {
+        if ((verb_list[index].verb_ctrls == NULL) ||
+            (verb_list[index].device_ctrls == NULL) ||
+            (verb_list[index].mod_ctrls == NULL)) {
+            ALOGE("Use case %s was not parsed", card->verb_list[index]);
+            ret = -EINVAL;
+            goto done;
+        }
+        memset(&iverb, 0, sizeof(iverb));
+        iverb.name = snd_ucm_image_add_str(&w, verb_list[index].use_case_name);
+        iverb.verb_first = snd_ucm_image_add_cases(&w,
+                               verb_list[index].verb_ctrls,
+                               verb_list[index].verb_count);
+        iverb.verb_count = verb_list[index].verb_count;
+        /* Verbs of a single config file share the device and modifier
+         * lists of the first verb, keep them shared in the image */
+        prev_verbs = (struct snd_ucm_image_verb *)w.verbs.data;
+        for (prev = 0; prev < index; prev++) {
+            if (verb_list[prev].device_ctrls == verb_list[index].device_ctrls)
+                break;
+        }
+        if ((prev < index) && !w.error) {
+            iverb.device_first = prev_verbs[prev].device_first;
+        } else {
+            iverb.device_first = snd_ucm_image_add_cases(&w,
+                                     verb_list[index].device_ctrls,
+                                     verb_list[index].device_count);
+        }
+        iverb.device_count = verb_list[index].device_count;
+        for (prev = 0; prev < index; prev++) {
+            if (verb_list[prev].mod_ctrls == verb_list[index].mod_ctrls)
+                break;
+        }
+        if ((prev < index) && !w.error) {
+            iverb.mod_first = prev_verbs[prev].mod_first;
+        } else {
+            iverb.mod_first = snd_ucm_image_add_cases(&w,
+                                  verb_list[index].mod_ctrls,
+                                  verb_list[index].mod_count);
+        }
+        iverb.mod_count = verb_list[index].mod_count;
+        snd_ucm_image_add(&w, &w.verbs, &iverb, sizeof(iverb));
+    }
+    if (w.error) {
+        ret = w.error;
+        goto done;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SND_UCM_IMAGE_MAGIC;
+    hdr.version = SND_UCM_IMAGE_VERSION;
+    offset = sizeof(hdr);
+    hdr.source_offset = offset;
+    hdr.source_count = w.sources.size / sizeof(struct snd_ucm_image_source);
+    offset += w.sources.size;
+    hdr.verb_offset = offset;
+    hdr.verb_count = w.verbs.size / sizeof(struct snd_ucm_image_verb);
+    offset += w.verbs.size;
+    hdr.case_offset = offset;
+    hdr.case_count = w.cases.size / sizeof(struct snd_ucm_image_case);
+    offset += w.cases.size;
+    hdr.control_offset = offset;
+    hdr.control_count = w.controls.size / sizeof(struct snd_ucm_image_control);
+    offset += w.controls.size;
+    hdr.value_offset = offset;
+    hdr.value_count = w.values.size / sizeof(uint32_t);
+    offset += w.values.size;
+    hdr.string_offset = offset;
+    hdr.string_size = w.strings.size;
+    offset += w.strings.size;
+    hdr.image_size = offset;
+
+    /* Same order as the offsets above, all but the strings are
+     * tables of 32 bit fields */
+    sections[0] = &w.sources;
+    sections[1] = &w.verbs;
+    sections[2] = &w.cases;
+    sections[3] = &w.controls;
+    sections[4] = &w.values;
+    sections[5] = &w.strings;
+    hdr.checksum = 2166136261u;
+    for (index = 0; index < 6; index++) {
+        if (index < 5)
+            snd_ucm_image_to_le(sections[index]->data, sections[index]->size);
+        hdr.checksum = snd_ucm_fnv1a(hdr.checksum, sections[index]->data,
+                           sections[index]->size);
+    }
+    ALOGD("Compiled %u verbs, %u cases, %u controls into %s (%u bytes)",
+        hdr.verb_count, hdr.case_count, hdr.control_count, image_path,
+        hdr.image_size);
+    snd_ucm_image_to_le(&hdr, sizeof(hdr));
+
+    /* Write to a temporary file first so that a reader never maps a
+     * partially written image */
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", image_path);
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        ret = -errno;
+        ALOGE("failed to create %s error %d", tmp_path, errno);
+        goto done;
+    }
+    ret = snd_ucm_write_all(fd, &hdr, sizeof(hdr));
+    for (index = 0; (ret == 0) && (index < 6); index++)
+        ret = snd_ucm_write_all(fd, sections[index]->data,
+                  sections[index]->size);
+    if (close(fd) < 0 && ret == 0)
+        ret = -errno;
+    if ((ret == 0) && (rename(tmp_path, image_path) < 0))
+        ret = -errno;
+    if (ret < 0) {
+        ALOGE("failed to write %s error %d", image_path, ret);
+        unlink(tmp_path);
+    }
+
+done:
+    for (index = 0; index < SND_UCM_IMAGE_STR_HASH_SIZE; index++) {
+        while ((node = w.str_hash[index]) != NULL) {
+            w.str_hash[index] = node->next;
+            free(node);
+        }
+    }
+    free(w.sources.data);
+    free(w.verbs.data);
+    free(w.cases.data);
+    free(w.controls.data);
+    free(w.values.data);
+    free(w.strings.data);
+    return ret;
+}
+
+/**
+ * Compile the config files of a card into the image that
+ * snd_use_case_mgr_open() maps instead of parsing them
+ * card_name - name of the master config file
+ * config_dir - directory of the config files ending with '/',
+ *              NULL for CONFIG_DIR
+ * image_path - file to write, NULL for the image in config_dir
+ * Returns 0 on sucess, negative error code otherwise
+ */
+int snd_use_case_mgr_compile(const char *card_name, const char *config_dir,
+const char *image_path)
+{
+    snd_use_case_mgr_t *uc_mgr;
+    card_ctxt_t *card;
+    char path[200];
+    int index, ret;
+
+    if (card_name == NULL) {
+        ALOGE("snd_use_case_mgr_compile: failed, invalid arguments");
+        return -EINVAL;
+    }
+    if (config_dir == NULL)
+        config_dir = CONFIG_DIR;
+    if (image_path == NULL) {
+        snprintf(path, sizeof(path), "%s%s%s", config_dir, card_name,
+            SND_UCM_IMAGE_SUFFIX);
+        image_path = path;
+    }
+
+    uc_mgr = (snd_use_case_mgr_t *)calloc(1, sizeof(snd_use_case_mgr_t));
+    if (uc_mgr == NULL)
+        return -ENOMEM;
+    card = (card_ctxt_t *)calloc(1, sizeof(card_ctxt_t));
+    if (card == NULL) {
+        free(uc_mgr);
+        return -ENOMEM;
+    }
+    uc_mgr->card_ctxt_ptr = card;
+    card->card_name = strdup(card_name);
+    if ((card->card_name == NULL) || (snd_ucm_init_idents(card) < 0)) {
+        free(card->card_name);
+        free(card);
+        free(uc_mgr);
+        return -ENOMEM;
+    }
+    pthread_mutex_init(&card->card_lock, NULL);
+    card->config_dir = config_dir;
+    card->record_sources = 1;
+    card->current_verb_index = -1;
+
+    /* No mixer is opened, so this only parses and interns names */
+    ret = snd_ucm_parse(&uc_mgr);
+    snd_use_case_mgr_wait_for_parsing(uc_mgr);
+    if (ret == 0)
+        ret = snd_ucm_image_write(uc_mgr, image_path);
+    else
+        ALOGE("Failed to parse config files: %d", ret);
+    if (card->verb_list != NULL)
+        snd_ucm_free_mixer_list(&uc_mgr);
+
+    for (index = 0; index < card->source_count; index++)
+        free(card->sources[index]);
+    free(card->sources);
+    snd_ucm_free_idents(card);
+    pthread_mutex_destroy(&card->card_lock);
+    free(card->card_name);
+    free(card);
+    free(uc_mgr);
+    return ret;
+}
+
 void free_list(card_mctrl_t *list, int verb_index, int count)
 {
     int case_index = 0, index = 0, mindex = 0;
@@ -3649,6 +4835,18 @@ void snd_ucm_free_mixer_list(snd_use_case_mgr_t **uc_mgr)
     int index = 0, verb_index = 0;
 
     pthread_mutex_lock(&(*uc_mgr)->card_ctxt_ptr->card_lock);
+    if ((*uc_mgr)->card_ctxt_ptr->image != NULL) {
+        /* Lists point into the image and were allocated as one block */
+        free((*uc_mgr)->card_ctxt_ptr->image_lists);
+        munmap((*uc_mgr)->card_ctxt_ptr->image,
+            (*uc_mgr)->card_ctxt_ptr->image_size);
+        (*uc_mgr)->card_ctxt_ptr->image_lists = NULL;
+        (*uc_mgr)->card_ctxt_ptr->image = NULL;
+        (*uc_mgr)->card_ctxt_ptr->use_case_verb_list = NULL;
+        (*uc_mgr)->card_ctxt_ptr->verb_list = NULL;
+        pthread_mutex_unlock(&(*uc_mgr)->card_ctxt_ptr->card_lock);
+        return;
+    }
     verb_list = (*uc_mgr)->card_ctxt_ptr->use_case_verb_list;
     while(strncmp((*uc_mgr)->card_ctxt_ptr->verb_list[verb_index],
           SND_UCM_END_OF_LIST, 3)) {
@@ -314,6 +314,25 @@ int snd_use_case_set(snd_use_case_mgr_t *uc_mgr,
                      const char *identifier,
                      const char *value);
 
+/** Identifiers of snd_use_case_set_id() */
+enum {
+	SND_UCM_SET_VERB,	/**< _verb */
+	SND_UCM_SET_ENADEV,	/**< _enadev */
+	SND_UCM_SET_DISDEV,	/**< _disdev */
+	SND_UCM_SET_ENAMOD,	/**< _enamod */
+	SND_UCM_SET_DISMOD,	/**< _dismod */
+};
+
+/**
+ * \brief Set new value for an identifier without parsing names
+ * \param uc_mgr Use case manager
+ * \param ident_id One of SND_UCM_SET_*
+ * \param value_id Id returned by snd_use_case_get_id()
+ * \return Zero if success, otherwise a negative error code
+ */
+int snd_use_case_set_id(snd_use_case_mgr_t *uc_mgr, int ident_id,
+                        int value_id);
+
 /**
  * \brief Open and initialise use case core for sound card
  * \param uc_mgr Returned use case manager pointer
@@ -344,6 +363,37 @@ int snd_use_case_mgr_close(snd_use_case_mgr_t *uc_mgr);
  */
 int snd_use_case_mgr_reset(snd_use_case_mgr_t *uc_mgr);
 
+/**
+ * \brief Get the interned id of a verb, device or modifier name
+ * \param uc_mgr Use case manager, NULL for the well known names only
+ * \param name Verb, device or modifier name
+ * \return id if success, -ENOENT if the name is not known
+ */
+int snd_use_case_get_id(snd_use_case_mgr_t *uc_mgr, const char *name);
+
+/**
+ * \brief Get the name of an interned id
+ * \param uc_mgr Use case manager, NULL for the well known ids only
+ * \param id Id returned by snd_use_case_get_id()
+ * \return name if success, NULL if the id is not valid
+ */
+const char *snd_use_case_get_name(snd_use_case_mgr_t *uc_mgr, int id);
+
+/** Suffix of the compiled image of a card, next to its config files */
+#define SND_UCM_IMAGE_SUFFIX    ".bin"
+
+/**
+ * \brief Compile the config files of a card into the image that
+ *        snd_use_case_mgr_open() maps instead of parsing them
+ * \param card_name Sound card name
+ * \param config_dir Directory of the config files ending with '/',
+ *        NULL for the directory the library loads from
+ * \param image_path File to write, NULL for the image in config_dir
+ * \return zero if success, otherwise a negative error code
+ */
+int snd_use_case_mgr_compile(const char *card_name, const char *config_dir,
+                             const char *image_path);
+
 /*
  * helper functions
  */
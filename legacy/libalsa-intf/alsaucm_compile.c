@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2012, Code Aurora Forum. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Code Aurora Forum, Inc. nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Compiles the UCM config files of a card into the image that
+ * snd_use_case_mgr_open() maps instead of parsing the text files.
+ * The image is only used while the config files it was compiled
+ * from are unchanged, so it has to be regenerated with them.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+
+#include "alsa_ucm.h"
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s <card name> [config dir] [image file]\n"
+        "  config dir defaults to the directory the library loads from,\n"
+        "  image file defaults to <config dir>/<card name>%s\n",
+        prog, SND_UCM_IMAGE_SUFFIX);
+}
+
+int main(int argc, char **argv)
+{
+    char config_dir[200];
+    const char *dir = NULL, *image = NULL;
+    size_t len;
+    int ret;
+
+    if (argc < 2 || argc > 4) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (argc > 2) {
+        /* The library appends file names to the directory as is */
+        len = strlen(argv[2]);
+        if (len + 2 > sizeof(config_dir)) {
+            fprintf(stderr, "Config dir %s is too long\n", argv[2]);
+            return 1;
+        }
+        snprintf(config_dir, sizeof(config_dir), "%s%s", argv[2],
+            (len && argv[2][len - 1] == '/') ? "" : "/");
+        dir = config_dir;
+    }
+    if (argc > 3)
+        image = argv[3];
+
+    ret = snd_use_case_mgr_compile(argv[1], dir, image);
+    if (ret < 0) {
+        fprintf(stderr, "Failed to compile %s: %s\n", argv[1], strerror(-ret));
+        return 1;
+    }
+    return 0;
+}
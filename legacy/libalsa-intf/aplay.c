@@ -28,6 +28,7 @@
 
 #include <sound/asound.h>
 #include "alsa_audio.h"
+#include "alsa_bench.h"
 
 #ifndef ANDROID
 #define strlcat g_strlcat
@@ -49,6 +50,8 @@ static int period = 0;
 static int compressed = 0;
 static char *compr_codec;
 static int piped = 0;
+static struct bench_config bench;
+static char *period_list;
 
 static struct option long_options[] =
 {
@@ -60,6 +63,11 @@ static struct option long_options[] =
     {"channel", 1, 0, 'C'},
     {"format", 1, 0, 'F'},
     {"period", 1, 0, 'B'},
+    {"bench", 1, 0, 'b'},
+    {"loopback", 1, 0, 'l'},
+    {"stress", 1, 0, 's'},
+    {"time", 1, 0, 't'},
+    {"noirq", 0, 0, 'n'},
     {"compressed", 0, 0, 'T'},
     {0, 0, 0, 0}
 };
@@ -174,8 +182,9 @@ static int play_file(unsigned rate, unsigned channels, int fd,
     int nfds = 1;
     struct snd_xferi x;
     unsigned offset = 0;
+    unsigned ring_offset, count, frame_size;
+    void *area;
     int err;
-    static int start = 0;
     struct pollfd pfd[1];
     int remainingData = 0;
 
@@ -278,7 +287,8 @@ static int play_file(unsigned rate, unsigned channels, int fd,
         pfd[0].fd = pcm->timer_fd;
         pfd[0].events = POLLIN;
 
-        frames = (pcm->flags & PCM_MONO) ? (bufsize / 2) : (bufsize / 4);
+        frame_size = pcm_frame_size(pcm);
+        frames = bufsize / frame_size;
         for (;;) {
              if (!pcm->running) {
                   if (pcm_prepare(pcm)) {
@@ -286,43 +296,40 @@ static int play_file(unsigned rate, unsigned channels, int fd,
                       pcm_close(pcm);
                       return -errno;
                   }
-                  pcm->running = 1;
-                  start = 0;
-             }
-             /* Sync the current Application pointer from the kernel */
-             pcm->sync_ptr->flags = SNDRV_PCM_SYNC_PTR_APPL | SNDRV_PCM_SYNC_PTR_AVAIL_MIN;//SNDRV_PCM_SYNC_PTR_HWSYNC;
-             err = sync_ptr(pcm);
-             if (err == EPIPE) {
-                 fprintf(stderr, "Aplay:Failed in sync_ptr \n");
-                 /* we failed to make our window -- try to restart */
-                 pcm->underruns++;
-                 pcm->running = 0;
-                 continue;
              }
              /*
-              * Check for the available buffer in driver. If available buffer is
-              * less than avail_min we need to wait
+              * Check for the available buffer in driver. The pointers returned
+              * by the last commit are good enough unless they show less than
+              * avail_min, only then ask the driver again and wait.
               */
              avail = pcm_avail(pcm);
-             if (avail < 0) {
-                 fprintf(stderr, "Aplay:Failed in pcm_avail\n");
-                 pcm_close(pcm);
-                 return avail;
-             }
              if (avail < pcm->sw_p->avail_min) {
-                 poll(pfd, nfds, TIMEOUT_INFINITE);
-                 continue;
+                 avail = pcm_mmap_avail(pcm);
+                 if (avail == -EPIPE)
+                     continue;
+                 if (avail < 0) {
+                     fprintf(stderr, "Aplay:Failed in pcm_mmap_avail\n");
+                     pcm_close(pcm);
+                     return avail;
+                 }
+                 if (avail < pcm->sw_p->avail_min) {
+                     poll(pfd, nfds, TIMEOUT_INFINITE);
+                     continue;
+                 }
              }
              /*
               * Now that we have buffer size greater than avail_min available to
-              * to be written we need to calcutate the buffer offset where we can
-              * start writting.
+              * to be written get the area at the application pointer, up to the
+              * end of the buffer.
               */
-             dst_addr = dst_address(pcm);
+             count = frames;
+             pcm_mmap_begin(pcm, &area, &ring_offset, &count);
+             dst_addr = (u_int8_t *) area + ring_offset * frame_size;
+             bufsize = count * frame_size;
 
              if (debug) {
                  fprintf(stderr, "dst_addr = 0x%08x\n", dst_addr);
-                 fprintf(stderr, "Aplay:avail = %d frames = %d\n",avail, frames);
+                 fprintf(stderr, "Aplay:avail = %d frames = %d\n",avail, count);
                  fprintf(stderr, "Aplay:sync_ptr->s.status.hw_ptr %ld  pcm->buffer_size %d  sync_ptr->c.control.appl_ptr %ld\n",
                             pcm->sync_ptr->s.status.hw_ptr,
                             pcm->buffer_size,
@@ -336,10 +343,8 @@ static int play_file(unsigned rate, unsigned channels, int fd,
              memset(dst_addr, 0x0, bufsize);
 
              if (data_sz && !piped) {
-                 if (remainingData < bufsize) {
+                 if (remainingData < bufsize)
                      bufsize = remainingData;
-                     frames = (pcm->flags & PCM_MONO) ? (remainingData / 2) : (remainingData / 4);
-                 }
              }
 
              err = read(fd, dst_addr , bufsize);
@@ -348,26 +353,19 @@ static int play_file(unsigned rate, unsigned channels, int fd,
              if (err <= 0)
                  break;
 
-             if (data_sz && !piped) {
-                 remainingData -= bufsize;
-                 if (remainingData <= 0)
-                     break;
-             }
-
              /*
-              * Increment the application pointer with data written to kernel.
-              * Update kernel with the new sync pointer.
+              * Advance the application pointer and update the kernel, this
+              * also starts the driver once the start threshold is queued.
               */
-             pcm->sync_ptr->c.control.appl_ptr += frames;
-             pcm->sync_ptr->flags = 0;
-
-             err = sync_ptr(pcm);
-             if (err == EPIPE) {
-                 fprintf(stderr, "Aplay:Failed in sync_ptr 2 \n");
+             err = pcm_mmap_commit(pcm, count);
+             if (err == -EPIPE) {
+                 fprintf(stderr, "Aplay:Failed in pcm_mmap_commit\n");
                  /* we failed to make our window -- try to restart */
-                 pcm->underruns++;
-                 pcm->running = 0;
                  continue;
+             } else if (err) {
+                 fprintf(stderr, "Aplay:Error no %d \n", -err);
+                 pcm_close(pcm);
+                 return err;
              }
 
              if (debug) {
@@ -375,7 +373,7 @@ static int play_file(unsigned rate, unsigned channels, int fd,
                             pcm->sync_ptr->s.status.hw_ptr,
                             pcm->sync_ptr->c.control.appl_ptr);
 #ifdef QCOM_COMPRESSED_AUDIO_ENABLED
-                 if (compressed && start) {
+                 if (compressed && pcm->start) {
                     struct snd_compr_tstamp tstamp;
 		    if (ioctl(pcm->fd, SNDRV_COMPRESS_TSTAMP, &tstamp))
 			fprintf(stderr, "Aplay: failed SNDRV_COMPRESS_TSTAMP\n");
@@ -384,39 +382,20 @@ static int play_file(unsigned rate, unsigned channels, int fd,
 		}
 #endif
              }
-             /*
-              * If we have reached start threshold of buffer prefill,
-              * its time to start the driver.
-              */
-                 if(start)
-                     goto start_done;
-                 if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_START)) {
-                     err = -errno;
-                     if (errno == EPIPE) {
-                         fprintf(stderr, "Aplay:Failed in SNDRV_PCM_IOCTL_START\n");
-                         /* we failed to make our window -- try to restart */
-                         pcm->underruns++;
-                         pcm->running = 0;
-                         continue;
-                    } else {
-                        fprintf(stderr, "Aplay:Error no %d \n", errno);
-                        pcm_close(pcm);
-                        return -errno;
-                    }
-                } else
-                    start = 1;
-
-start_done:
-                offset += frames;
+             offset += count;
+
+             if (data_sz && !piped) {
+                 remainingData -= bufsize;
+                 if (remainingData <= 0)
+                     break;
+             }
         }
         while(1) {
-            pcm->sync_ptr->flags = SNDRV_PCM_SYNC_PTR_APPL | SNDRV_PCM_SYNC_PTR_AVAIL_MIN;//SNDRV_PCM_SYNC_PTR_HWSYNC;
-            sync_ptr(pcm);
             /*
-             * Check for the available buffer in driver. If available buffer is
-             * less than avail_min we need to wait
+             * Wait for the driver to play out everything that was queued.
              */
-            if (pcm->sync_ptr->s.status.hw_ptr >= pcm->sync_ptr->c.control.appl_ptr) {
+            if (pcm_mmap_avail(pcm) < 0 ||
+                pcm->sync_ptr->s.status.hw_ptr >= pcm->sync_ptr->c.control.appl_ptr) {
                 fprintf(stderr, "Aplay:sync_ptr->s.status.hw_ptr %ld  sync_ptr->c.control.appl_ptr %ld\n",
                            pcm->sync_ptr->s.status.hw_ptr,
                            pcm->sync_ptr->c.control.appl_ptr);
@@ -577,7 +556,12 @@ int main(int argc, char **argv)
 		"-R             -- Rate\n"
                 "-V		-- verbose\n"
 		"-F             -- Format\n"
-                "-B             -- Period\n"
+                "-B             -- Period, a comma separated list with -b\n"
+                "-b <latency|stream>  -- Benchmark, CSV results on stdout\n"
+                "-l <hw:C,D>    -- Loopback device for the latency benchmark\n"
+                "-s <threads>   -- Busy threads during the benchmark\n"
+                "-t <seconds>   -- Benchmark time per period size\n"
+                "-n             -- Benchmark without period interrupts\n"
                 "-T <MP3, AAC, AC3_PASS_THROUGH>  -- Compressed\n"
                 "<file> \n");
            fprintf(stderr, "Formats Supported:\n");
@@ -587,7 +571,7 @@ int main(int argc, char **argv)
            fprintf(stderr, "\nSome of these may not be available on selected hardware\n");
            return 0;
      }
-     while ((c = getopt_long(argc, argv, "PVMD:R:C:F:B:T:", long_options, &option_index)) != -1) {
+     while ((c = getopt_long(argc, argv, "PVMD:R:C:F:B:T:b:l:s:t:n", long_options, &option_index)) != -1) {
        switch (c) {
        case 'P':
           pcm_flag = 0;
@@ -613,6 +597,26 @@ int main(int argc, char **argv)
           break;
        case 'B':
           period = (int)strtol(optarg, NULL, 0);
+          period_list = optarg;
+          break;
+       case 'b':
+          bench.mode = bench_parse_mode(optarg);
+          if (bench.mode < 0) {
+              fprintf(stderr, "Aplay:unknown benchmark %s\n", optarg);
+              return -EINVAL;
+          }
+          break;
+       case 'l':
+          bench.loopback = optarg;
+          break;
+       case 's':
+          bench.stress = (unsigned)strtol(optarg, NULL, 0);
+          break;
+       case 't':
+          bench.duration = (unsigned)strtol(optarg, NULL, 0);
+          break;
+       case 'n':
+          bench.noirq = 1;
           break;
        case 'T':
           compressed = 1;
@@ -629,7 +633,12 @@ int main(int argc, char **argv)
                 "-C		-- Channels\n"
 		"-R             -- Rate\n"
 		"-F             -- Format\n"
-                "-B             -- Period\n"
+                "-B             -- Period, a comma separated list with -b\n"
+                "-b <latency|stream>  -- Benchmark, CSV results on stdout\n"
+                "-l <hw:C,D>    -- Loopback device for the latency benchmark\n"
+                "-s <threads>   -- Busy threads during the benchmark\n"
+                "-t <seconds>   -- Benchmark time per period size\n"
+                "-n             -- Benchmark without period interrupts\n"
                 "-T             -- Compressed\n"
                 "<file> \n");
            fprintf(stderr, "Formats Supported:\n");
@@ -641,6 +650,17 @@ int main(int argc, char **argv)
        }
 
     }
+    if (bench.mode) {
+        bench.device = device;
+        bench.flags = PCM_OUT | (strncmp(mmap, "M", sizeof("M")) ? 0 : PCM_MMAP);
+        bench.rate = rate;
+        bench.channels = ch;
+        if (period_list && bench_parse_periods(&bench, period_list)) {
+            fprintf(stderr, "Aplay:bad period list %s\n", period_list);
+            return -EINVAL;
+        }
+        return bench_run(&bench);
+    }
     filename = (char*) calloc(1, 30);
     if (!filename) {
           fprintf(stderr, "Aplay:Failed to allocate filename!");
@@ -29,6 +29,7 @@
 #include <limits.h>
 
 #include "alsa_audio.h"
+#include "alsa_bench.h"
 
 #define ID_RIFF 0x46464952
 #define ID_WAVE 0x45564157
@@ -53,6 +54,8 @@ static char *data;
 static int format = SNDRV_PCM_FORMAT_S16_LE;
 static int period = 0;
 static int piped = 0;
+static struct bench_config bench;
+static char *period_list;
 
 static struct option long_options[] =
 {
@@ -65,6 +68,11 @@ static struct option long_options[] =
     {"duration", 1, 0, 'T'},
     {"format", 1, 0, 'F'},
     {"period", 1, 0, 'B'},
+    {"bench", 1, 0, 'b'},
+    {"loopback", 1, 0, 'l'},
+    {"stress", 1, 0, 's'},
+    {"time", 1, 0, 't'},
+    {"noirq", 0, 0, 'n'},
     {0, 0, 0, 0}
 };
 
@@ -180,10 +188,10 @@ int record_file(unsigned rate, unsigned channels, int fd, unsigned count,  unsig
     unsigned xfer, bufsize;
     int r, avail;
     int nfds = 1;
-    static int start = 0;
-    struct snd_xferi x;
     long frames;
     unsigned offset = 0;
+    unsigned ring_offset, count_frames, frame_size;
+    void *area;
     int err;
     struct pollfd pfd[1];
     int rec_size = 0;
@@ -265,53 +273,48 @@ int record_file(unsigned rate, unsigned channels, int fd, unsigned count,  unsig
         pfd[0].events = POLLIN;
 
         hdr.data_sz = 0;
-        if (pcm->flags & PCM_MONO) {
-                frames = bufsize / 2;
-        } else if (pcm->flags & PCM_QUAD) {
-                frames = bufsize / 8;
-        } else if (pcm->flags & PCM_5POINT1) {
-                frames = bufsize / 12;
-        } else{
-                frames = bufsize / 4;
-        }
-        x.frames = frames;
+        frame_size = pcm_frame_size(pcm);
+        frames = bufsize / frame_size;
         for(;;) {
 		if (!pcm->running) {
                     if (pcm_prepare(pcm))
                         return --errno;
-                    start = 0;
-                }
-                /* Sync the current Application pointer from the kernel */
-		pcm->sync_ptr->flags = SNDRV_PCM_SYNC_PTR_APPL | SNDRV_PCM_SYNC_PTR_AVAIL_MIN;//SNDRV_PCM_SYNC_PTR_HWSYNC;
-                err = sync_ptr(pcm);
-                if (err == EPIPE) {
-                     fprintf(stderr, "Arec:Failed in sync_ptr \n");
-                     /* we failed to make our window -- try to restart */
-                     //pcm->overruns++;
-                     pcm->running = 0;
-                     continue;
+                    if (ioctl(pcm->fd, SNDRV_PCM_IOCTL_START)) {
+                        fprintf(stderr, "Arec:Error no %d \n", errno);
+                        return -errno;
+                    }
                 }
                /*
-                * Check for the available data in driver. If available data is
-                * less than avail_min we need to wait
+                * Check for the available data in driver. The pointers returned
+                * by the last commit are good enough unless they show less than
+                * avail_min, only then ask the driver again and wait.
                 */
                 avail = pcm_avail(pcm);
+                if (avail < pcm->sw_p->avail_min) {
+                        avail = pcm_mmap_avail(pcm);
+                        if (avail == -EPIPE) {
+                             fprintf(stderr, "Arec:Failed in pcm_mmap_avail \n");
+                             /* we failed to make our window -- try to restart */
+                             continue;
+                        }
+                        if (avail < 0)
+                                return avail;
+                }
                 if (debug)
                      fprintf(stderr, "Arec:avail 1 = %d frames = %ld\n",avail, frames);
-                if (avail < 0)
-                        return avail;
                 if (avail < pcm->sw_p->avail_min) {
                         poll(pfd, nfds, TIMEOUT_INFINITE);
                         continue;
                 }
-	 	if (x.frames > avail)
-                        frames = avail;
                /*
                 * Now that we have data size greater than avail_min available to
-                * to be read we need to calcutate the buffer offset where we can
-                * start reading from.
+                * to be read get the area at the application pointer, up to the
+                * end of the buffer.
                 */
-                dst_addr = dst_address(pcm);
+                count_frames = frames;
+                pcm_mmap_begin(pcm, &area, &ring_offset, &count_frames);
+                dst_addr = (u_int8_t *) area + ring_offset * frame_size;
+                bufsize = count_frames * frame_size;
 
                /*
                 * Write to the file at the destination address from kernel mmaped buffer
@@ -321,15 +324,14 @@ int record_file(unsigned rate, unsigned channels, int fd, unsigned count,  unsig
                     fprintf(stderr, "Arec:could not write %d bytes\n", bufsize);
                     return -errno;
                 }
-                x.frames -= frames;
-                pcm->sync_ptr->c.control.appl_ptr += frames;
-		pcm->sync_ptr->flags = 0;
-                err = sync_ptr(pcm);
-                if (err == EPIPE) {
-                     fprintf(stderr, "Arec:Failed in sync_ptr \n");
+                err = pcm_mmap_commit(pcm, count_frames);
+                if (err == -EPIPE) {
+                     fprintf(stderr, "Arec:Failed in pcm_mmap_commit \n");
                      /* we failed to make our window -- try to restart */
-                     pcm->running = 0;
                      continue;
+                } else if (err) {
+                     fprintf(stderr, "Arec:Error no %d \n", -err);
+                     return err;
                 }
                 rec_size += bufsize;
                 hdr.data_sz += bufsize;
@@ -531,7 +533,12 @@ int main(int argc, char **argv)
                 "-R		-- Rate\n"
                 "-T		-- Time in seconds for recording\n"
 		"-F             -- Format\n"
-                "-B             -- Period\n"
+                "-B             -- Period, a comma separated list with -b\n"
+                "-b <latency|stream>  -- Benchmark, CSV results on stdout\n"
+                "-l <hw:C,D>    -- Loopback device for the latency benchmark\n"
+                "-s <threads>   -- Busy threads during the benchmark\n"
+                "-t <seconds>   -- Benchmark time per period size\n"
+                "-n             -- Benchmark without period interrupts\n"
                 "<file> \n");
            for (i = 0; i < SNDRV_PCM_FORMAT_LAST; ++i)
                if (get_format_name(i))
@@ -539,7 +546,7 @@ int main(int argc, char **argv)
            fprintf(stderr, "\nSome of these may not be available on selected hardware\n");
           return 0;
     }
-    while ((c = getopt_long(argc, argv, "PVMD:R:C:T:F:B:", long_options, &option_index)) != -1) {
+    while ((c = getopt_long(argc, argv, "PVMD:R:C:T:F:B:b:l:s:t:n", long_options, &option_index)) != -1) {
        switch (c) {
        case 'P':
           pcm_flag = 0;
@@ -567,6 +574,26 @@ int main(int argc, char **argv)
           break;
        case 'B':
           period = (int)strtol(optarg, NULL, 0);
+          period_list = optarg;
+          break;
+       case 'b':
+          bench.mode = bench_parse_mode(optarg);
+          if (bench.mode < 0) {
+              fprintf(stderr, "Arec:unknown benchmark %s\n", optarg);
+              return -EINVAL;
+          }
+          break;
+       case 'l':
+          bench.loopback = optarg;
+          break;
+       case 's':
+          bench.stress = (unsigned)strtol(optarg, NULL, 0);
+          break;
+       case 't':
+          bench.duration = (unsigned)strtol(optarg, NULL, 0);
+          break;
+       case 'n':
+          bench.noirq = 1;
           break;
        default:
           printf("\nUsage: arec [options] <file>\n"
@@ -579,7 +606,12 @@ int main(int argc, char **argv)
                 "-R		-- Rate\n"
                 "-T		-- Time in seconds for recording\n"
 		"-F             -- Format\n"
-                "-B             -- Period\n"
+                "-B             -- Period, a comma separated list with -b\n"
+                "-b <latency|stream>  -- Benchmark, CSV results on stdout\n"
+                "-l <hw:C,D>    -- Loopback device for the latency benchmark\n"
+                "-s <threads>   -- Busy threads during the benchmark\n"
+                "-t <seconds>   -- Benchmark time per period size\n"
+                "-n             -- Benchmark without period interrupts\n"
                 "<file> \n");
            for (i = 0; i < SNDRV_PCM_FORMAT_LAST; ++i)
                if (get_format_name(i))
@@ -588,6 +620,17 @@ int main(int argc, char **argv)
           return -EINVAL;
        }
     }
+    if (bench.mode) {
+        bench.device = device;
+        bench.flags = PCM_IN | (strncmp(mmap, "M", sizeof("M")) ? 0 : PCM_MMAP);
+        bench.rate = rate;
+        bench.channels = ch;
+        if (period_list && bench_parse_periods(&bench, period_list)) {
+            fprintf(stderr, "Arec:bad period list %s\n", period_list);
+            return -EINVAL;
+        }
+        return bench_run(&bench);
+    }
     filename = (char*) calloc(1, 30);
      if (!filename) {
           fprintf(stderr, "Arec:Failed to allocate filename!");
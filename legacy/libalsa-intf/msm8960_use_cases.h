@@ -36,6 +36,7 @@ extern "C" {
 #include "alsa_ucm.h"
 #include "alsa_audio.h"
 #include <stdbool.h>
+#include <stdint.h>
 #include <pthread.h>
 #define SND_UCM_END_OF_LIST "end"
 
@@ -106,6 +107,7 @@ typedef struct mixer_control {
     unsigned value;
     char *string;
     char **mulval;
+    struct mixer_ctl *ctl;
 }mixer_control_t;
 
 /* Use case mixer controls structure */
@@ -120,6 +122,7 @@ typedef struct card_mctrl {
     int acdb_id;
     int capability;
     char *effects_mixer_ctl;
+    int case_id;
 }card_mctrl_t;
 
 /* identifier node structure for identifier list*/
@@ -130,6 +133,16 @@ struct snd_ucm_ident_node {
     struct snd_ucm_ident_node *next;
 };
 
+#define SND_UCM_IDENT_HASH_SIZE 64
+
+/* interned verb, device or modifier name */
+struct snd_ucm_intern_node {
+    char *name;
+    int id;
+    int type;
+    struct snd_ucm_intern_node *next;
+};
+
 /* Structure to maintain the valid devices and
  * modifiers list per each use case */
 typedef struct use_case_verb {
@@ -156,8 +169,21 @@ typedef struct card_ctxt {
     pthread_mutex_t card_lock;
     pthread_mutexattr_t card_lock_attr;
     int current_verb_index;
+    int current_verb_id;
     use_case_verb_t *use_case_verb_list;
     char **verb_list;
+    struct snd_ucm_intern_node *ident_hash[SND_UCM_IDENT_HASH_SIZE];
+    struct snd_ucm_intern_node **ident_nodes;
+    int ident_count;
+    int ident_size;
+    pthread_mutex_t ident_lock;
+    const char *config_dir;
+    void *image;
+    size_t image_size;
+    void *image_lists;
+    int record_sources;
+    char **sources;
+    int source_count;
 }card_ctxt_t;
 
 /** use case manager structure */
@@ -171,12 +197,83 @@ struct snd_use_case_mgr {
     int current_rx_device;
     card_ctxt_t *card_ctxt_ptr;
     pthread_t thr;
+    bool thr_valid;
     void *acdb_handle;
     bool isFusion3Platform;
+    void *acdb_sym_handle;
+    void (*acdb_send_audio_cal)(int, int);
+    void (*acdb_send_voice_cal)(int, int);
 };
 
 #define MAX_NUM_CARDS (sizeof(card_list)/sizeof(char *))
 
+/* Compiled UCM image, written by snd_use_case_mgr_compile() and loaded
+ * from CONFIG_DIR/<card name>.bin when it matches the text configs.
+ * Fields are little endian, table offsets are from the start of the
+ * image and string references are offsets into the string table.
+ * Every device, modifier and verb control list is followed by an
+ * "end" case, as the text parser does.
+ */
+#define SND_UCM_IMAGE_MAGIC     0x424d4355 /* "UCMB" */
+#define SND_UCM_IMAGE_VERSION   2
+#define SND_UCM_IMAGE_NONE      0xffffffff
+
+struct snd_ucm_image_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t image_size;
+    uint32_t checksum;          /* of everything after the header */
+    uint32_t source_count;
+    uint32_t source_offset;
+    uint32_t verb_count;
+    uint32_t verb_offset;
+    uint32_t case_count;
+    uint32_t case_offset;
+    uint32_t control_count;
+    uint32_t control_offset;
+    uint32_t value_count;
+    uint32_t value_offset;
+    uint32_t string_size;
+    uint32_t string_offset;
+};
+
+/* Text config the image was compiled from */
+struct snd_ucm_image_source {
+    uint32_t name;
+    uint32_t size;
+};
+
+struct snd_ucm_image_verb {
+    uint32_t name;
+    uint32_t verb_first;
+    uint32_t verb_count;
+    uint32_t device_first;
+    uint32_t device_count;
+    uint32_t mod_first;
+    uint32_t mod_count;
+};
+
+struct snd_ucm_image_case {
+    uint32_t name;
+    uint32_t playback_dev_name;
+    uint32_t capture_dev_name;
+    uint32_t effects_mixer_ctl;
+    int32_t acdb_id;
+    int32_t capability;
+    uint32_t ena_first;
+    uint32_t ena_count;
+    uint32_t dis_first;
+    uint32_t dis_count;
+};
+
+struct snd_ucm_image_control {
+    uint32_t name;
+    uint32_t type;
+    uint32_t value;
+    uint32_t string;
+    uint32_t value_first;       /* into the value table, TYPE_MULTI_VAL */
+};
+
 /* Valid sound cards list */
 static const char *card_list[] = {
     "snd_soc_msm",
@@ -283,6 +380,56 @@ static card_mapping_t card_mapping_list[] = {
 #define SND_USE_CASE_MOD_PLAY_MI2S       "Play MI2S"
 #define SND_USE_CASE_MOD_PLAY_VOLTE   "Play VoLTE"
 
+/* Ids of the verbs and modifiers above. These are interned first when
+ * the use case manager is opened so they are the same on every card,
+ * names that only appear in the config files get ids after them.
+ */
+enum {
+    SND_UCM_ID_VERB_INACTIVE,
+    SND_UCM_ID_VERB_HIFI,
+    SND_UCM_ID_VERB_HIFI_LOW_POWER,
+    SND_UCM_ID_VERB_VOICE,
+    SND_UCM_ID_VERB_VOICE_LOW_POWER,
+    SND_UCM_ID_VERB_VOICECALL,
+    SND_UCM_ID_VERB_IP_VOICECALL,
+    SND_UCM_ID_VERB_ANALOG_RADIO,
+    SND_UCM_ID_VERB_DIGITAL_RADIO,
+    SND_UCM_ID_VERB_FM_REC,
+    SND_UCM_ID_VERB_FM_A2DP_REC,
+    SND_UCM_ID_VERB_HIFI_REC,
+    SND_UCM_ID_VERB_HIFI_LOWLATENCY_REC,
+    SND_UCM_ID_VERB_DL_REC,
+    SND_UCM_ID_VERB_UL_DL_REC,
+    SND_UCM_ID_VERB_HIFI_TUNNEL,
+    SND_UCM_ID_VERB_HIFI_LOWLATENCY_MUSIC,
+    SND_UCM_ID_VERB_HIFI2,
+    SND_UCM_ID_VERB_INCALL_REC,
+    SND_UCM_ID_VERB_MI2S,
+    SND_UCM_ID_VERB_VOLTE,
+    SND_UCM_ID_VERB_ADSP_TESTFWK,
+    SND_UCM_ID_MOD_CAPTURE_VOICE,
+    SND_UCM_ID_MOD_CAPTURE_MUSIC,
+    SND_UCM_ID_MOD_PLAY_MUSIC,
+    SND_UCM_ID_MOD_PLAY_VOICE,
+    SND_UCM_ID_MOD_PLAY_TONE,
+    SND_UCM_ID_MOD_ECHO_REF,
+    SND_UCM_ID_MOD_PLAY_FM,
+    SND_UCM_ID_MOD_CAPTURE_FM,
+    SND_UCM_ID_MOD_CAPTURE_LOWLATENCY_MUSIC,
+    SND_UCM_ID_MOD_CAPTURE_A2DP_FM,
+    SND_UCM_ID_MOD_PLAY_LPA,
+    SND_UCM_ID_MOD_PLAY_VOIP,
+    SND_UCM_ID_MOD_CAPTURE_VOIP,
+    SND_UCM_ID_MOD_CAPTURE_VOICE_DL,
+    SND_UCM_ID_MOD_CAPTURE_VOICE_UL_DL,
+    SND_UCM_ID_MOD_PLAY_TUNNEL,
+    SND_UCM_ID_MOD_PLAY_LOWLATENCY_MUSIC,
+    SND_UCM_ID_MOD_PLAY_MUSIC2,
+    SND_UCM_ID_MOD_PLAY_MI2S,
+    SND_UCM_ID_MOD_PLAY_VOLTE,
+    SND_UCM_ID_KNOWN_COUNT,
+};
+
 /* List utility functions for maintaining enabled devices and modifiers */
 static int snd_ucm_add_ident_to_list(struct snd_ucm_ident_node **head, const char *value);
 static char *snd_ucm_get_value_at_index(struct snd_ucm_ident_node *head, int index);
@@ -314,6 +461,19 @@ static int snd_ucm_extract_dev_name(char *buf, char **dev_name);
 static int snd_ucm_extract_controls(char *buf, mixer_control_t **mixer_list, int count);
 static int snd_ucm_print(snd_use_case_mgr_t *uc_mgr);
 static void snd_ucm_free_mixer_list(snd_use_case_mgr_t **uc_mgr);
+static void snd_ucm_index_verb(snd_use_case_mgr_t *uc_mgr, int verb_index);
+/* Identifier interning functions */
+static int snd_ucm_init_idents(card_ctxt_t *card);
+static void snd_ucm_free_idents(card_ctxt_t *card);
+static int snd_ucm_intern_ident(card_ctxt_t *card, const char *name);
+static int snd_ucm_lookup_ident(card_ctxt_t *card, const char *prefix, const char *suffix);
+static int snd_ucm_get_ident_type(card_ctxt_t *card, int id, const char *name);
+static int get_use_case_index_by_id(snd_use_case_mgr_t *uc_mgr, int id, int ctrl_list_type);
+static void snd_ucm_load_acdb_symbols(snd_use_case_mgr_t *uc_mgr);
+/* Compiled image functions */
+static void snd_ucm_record_source(card_ctxt_t *card, const char *file_name);
+static int snd_ucm_image_load(snd_use_case_mgr_t *uc_mgr);
+static int snd_ucm_image_write(snd_use_case_mgr_t *uc_mgr, const char *image_path);
 #ifdef __cplusplus
 }
 #endif
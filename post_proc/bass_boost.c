@@ -56,9 +56,10 @@ int bassboost_set_strength(bassboost_context_t *context, uint32_t strength)
 
     offload_bassboost_set_strength(&(context->offload_bass), strength);
     if (context->ctl)
-        offload_bassboost_send_params(context->ctl, &context->offload_bass,
-                                      OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG |
-                                      OFFLOAD_SEND_BASSBOOST_STRENGTH);
+        offload_effects_queue_params(OFFLOAD_PARAMS_BASSBOOST, context->ctl,
+                                     &context->offload_bass,
+                                     OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG |
+                                     OFFLOAD_SEND_BASSBOOST_STRENGTH);
     return 0;
 }
 
@@ -158,9 +159,9 @@ int bassboost_set_device(effect_context_t *context, uint32_t device)
             if (effect_is_active(&bass_ctxt->common)) {
                 offload_bassboost_set_enable_flag(&(bass_ctxt->offload_bass), false);
                 if (bass_ctxt->ctl)
-                    offload_bassboost_send_params(bass_ctxt->ctl,
-                                                  &bass_ctxt->offload_bass,
-                                                  OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG);
+                    offload_effects_queue_params(OFFLOAD_PARAMS_BASSBOOST, bass_ctxt->ctl,
+                                                 &bass_ctxt->offload_bass,
+                                                 OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG);
             }
             bass_ctxt->temp_disabled = true;
         }
@@ -169,9 +170,9 @@ int bassboost_set_device(effect_context_t *context, uint32_t device)
             if (effect_is_active(&bass_ctxt->common)) {
                 offload_bassboost_set_enable_flag(&(bass_ctxt->offload_bass), true);
                 if (bass_ctxt->ctl)
-                    offload_bassboost_send_params(bass_ctxt->ctl,
-                                                  &bass_ctxt->offload_bass,
-                                                  OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG);
+                    offload_effects_queue_params(OFFLOAD_PARAMS_BASSBOOST, bass_ctxt->ctl,
+                                                 &bass_ctxt->offload_bass,
+                                                 OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG);
             }
             bass_ctxt->temp_disabled = false;
         }
@@ -227,10 +228,10 @@ int bassboost_enable(effect_context_t *context)
         !(bass_ctxt->temp_disabled)) {
         offload_bassboost_set_enable_flag(&(bass_ctxt->offload_bass), true);
         if (bass_ctxt->ctl && bass_ctxt->strength)
-            offload_bassboost_send_params(bass_ctxt->ctl,
-                                          &bass_ctxt->offload_bass,
-                                          OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG |
-                                          OFFLOAD_SEND_BASSBOOST_STRENGTH);
+            offload_effects_queue_params(OFFLOAD_PARAMS_BASSBOOST, bass_ctxt->ctl,
+                                         &bass_ctxt->offload_bass,
+                                         OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG |
+                                         OFFLOAD_SEND_BASSBOOST_STRENGTH);
     }
     return 0;
 }
@@ -243,9 +244,9 @@ int bassboost_disable(effect_context_t *context)
     if (offload_bassboost_get_enable_flag(&(bass_ctxt->offload_bass))) {
         offload_bassboost_set_enable_flag(&(bass_ctxt->offload_bass), false);
         if (bass_ctxt->ctl)
-            offload_bassboost_send_params(bass_ctxt->ctl,
-                                          &bass_ctxt->offload_bass,
-                                          OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG);
+            offload_effects_queue_params(OFFLOAD_PARAMS_BASSBOOST, bass_ctxt->ctl,
+                                         &bass_ctxt->offload_bass,
+                                         OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG);
     }
     return 0;
 }
@@ -259,9 +260,10 @@ int bassboost_start(effect_context_t *context, output_context_t *output)
     ALOGV("output->ctl: %p", output->ctl);
     if (offload_bassboost_get_enable_flag(&(bass_ctxt->offload_bass)))
         if (bass_ctxt->ctl)
-            offload_bassboost_send_params(bass_ctxt->ctl, &bass_ctxt->offload_bass,
-                                          OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG |
-                                          OFFLOAD_SEND_BASSBOOST_STRENGTH);
+            offload_effects_queue_params(OFFLOAD_PARAMS_BASSBOOST, bass_ctxt->ctl,
+                                         &bass_ctxt->offload_bass,
+                                         OFFLOAD_SEND_BASSBOOST_ENABLE_FLAG |
+                                         OFFLOAD_SEND_BASSBOOST_STRENGTH);
     return 0;
 }
 
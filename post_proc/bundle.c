@@ -19,6 +19,7 @@
 
 #include <pthread.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include <cutils/list.h>
 #include <cutils/log.h>
@@ -68,16 +69,138 @@ struct listnode active_outputs_list;
  * created_effects_list or active_outputs_list
  */
 pthread_mutex_t lock;
+/* signaled when parameters are queued on an output, waited on by flush_thread */
+pthread_cond_t flush_cond;
+pthread_t flush_thread;
+/* false if the flush thread could not be created: parameters are sent at once */
+bool flush_thread_started;
 
 
 /*
  *  Local functions
  */
+static int64_t now_ns()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void send_params_l(output_context_t *output, int type)
+{
+    struct offload_pending_params *pending = &output->pending[type];
+
+    switch (type) {
+    case OFFLOAD_PARAMS_EQ:
+        offload_eq_send_params(output->ctl, pending->params, pending->flags);
+        pending->sent_enable = ((struct eq_params *)pending->params)->enable_flag;
+        break;
+    case OFFLOAD_PARAMS_BASSBOOST:
+        offload_bassboost_send_params(output->ctl, pending->params, pending->flags);
+        pending->sent_enable =
+                ((struct bass_boost_params *)pending->params)->enable_flag;
+        break;
+    case OFFLOAD_PARAMS_VIRTUALIZER:
+        offload_virtualizer_send_params(output->ctl, pending->params, pending->flags);
+        pending->sent_enable =
+                ((struct virtualizer_params *)pending->params)->enable_flag;
+        break;
+    case OFFLOAD_PARAMS_REVERB:
+        offload_reverb_send_params(output->ctl, pending->params, pending->flags);
+        pending->sent_enable = ((struct reverb_params *)pending->params)->enable_flag;
+        break;
+    }
+    pending->params = NULL;
+    pending->flags = 0;
+    output->params_sent++;
+}
+
+/* Sends all parameter sets pending on the output, called with lock held */
+static void flush_output_params_l(output_context_t *output)
+{
+    int type;
+
+    for (type = 0; type < OFFLOAD_PARAMS_MAX; type++) {
+        if (output->pending[type].params != NULL)
+            send_params_l(output, type);
+    }
+    output->params_pending = false;
+    output->last_flush_ns = now_ns();
+}
+
+static int params_enable_flag(int type, void *params)
+{
+    switch (type) {
+    case OFFLOAD_PARAMS_EQ:
+        return ((struct eq_params *)params)->enable_flag;
+    case OFFLOAD_PARAMS_BASSBOOST:
+        return ((struct bass_boost_params *)params)->enable_flag;
+    case OFFLOAD_PARAMS_VIRTUALIZER:
+        return ((struct virtualizer_params *)params)->enable_flag;
+    case OFFLOAD_PARAMS_REVERB:
+        return ((struct reverb_params *)params)->enable_flag;
+    }
+    return -1;
+}
+
+/*
+ * Flushes coalesced parameter updates of every output at most once per
+ * OFFLOAD_PARAMS_FLUSH_INTERVAL_MS.
+ */
+static void *flush_thread_loop(void *arg __unused)
+{
+    const int64_t interval_ns = OFFLOAD_PARAMS_FLUSH_INTERVAL_MS * 1000000LL;
+    struct listnode *node;
+    struct timespec ts;
+
+    pthread_mutex_lock(&lock);
+    while (true) {
+        int64_t now = now_ns();
+        int64_t next_ns = 0;
+
+        list_for_each(node, &active_outputs_list) {
+            output_context_t *out_ctxt = node_to_item(node,
+                                                      output_context_t,
+                                                      outputs_list_node);
+            if (!out_ctxt->params_pending)
+                continue;
+            if (now - out_ctxt->last_flush_ns >= interval_ns)
+                flush_output_params_l(out_ctxt);
+            else if (next_ns == 0 || out_ctxt->last_flush_ns + interval_ns < next_ns)
+                next_ns = out_ctxt->last_flush_ns + interval_ns;
+        }
+
+        if (next_ns == 0) {
+            pthread_cond_wait(&flush_cond, &lock);
+        } else {
+            /* flush_cond uses CLOCK_MONOTONIC, see init_once() */
+            ts.tv_sec = next_ns / 1000000000LL;
+            ts.tv_nsec = next_ns % 1000000000LL;
+            pthread_cond_timedwait(&flush_cond, &lock, &ts);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
 static void init_once() {
+    pthread_condattr_t attr;
+
     list_init(&created_effects_list);
     list_init(&active_outputs_list);
 
     pthread_mutex_init(&lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&flush_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    flush_thread_started = pthread_create(&flush_thread, NULL,
+                                          flush_thread_loop, NULL) == 0;
+    if (!flush_thread_started)
+        ALOGW("%s: cannot create flush thread, parameters will not be coalesced",
+              __func__);
 
     init_status = 0;
 }
@@ -146,6 +269,9 @@ void remove_effect_from_output(output_context_t * output,
         if (fx_ctxt == context) {
             if (context->ops.stop)
                 context->ops.stop(context, output);
+            /* pending parameters may point into the context being detached */
+            if (output->params_pending)
+                flush_output_params_l(output);
             list_remove(&context->output_node);
             return;
         }
@@ -181,9 +307,8 @@ bool effects_enabled()
 __attribute__ ((visibility ("default")))
 int offload_effects_bundle_hal_start_output(audio_io_handle_t output, int pcm_id)
 {
-    int ret = 0;
+    int ret = 0, i;
     struct listnode *node;
-    char mixer_string[128];
     output_context_t * out_ctxt = NULL;
 
     ALOGV("%s output %d pcm_id %d", __func__, output, pcm_id);
@@ -199,30 +324,18 @@ int offload_effects_bundle_hal_start_output(audio_io_handle_t output, int pcm_id
     }
 
     out_ctxt = (output_context_t *)
-                                 malloc(sizeof(output_context_t));
+                                 calloc(1, sizeof(output_context_t));
     out_ctxt->handle = output;
     out_ctxt->pcm_device_id = pcm_id;
+    for (i = 0; i < OFFLOAD_PARAMS_MAX; i++)
+        out_ctxt->pending[i].sent_enable = -1;
 
     /* populate the mixer control to send offload parameters */
-    snprintf(mixer_string, sizeof(mixer_string),
-             "%s %d", "Audio Effects Config", out_ctxt->pcm_device_id);
-    out_ctxt->mixer = mixer_open(MIXER_CARD);
-    if (!out_ctxt->mixer) {
-        ALOGE("Failed to open mixer");
-        out_ctxt->ctl = NULL;
+    if (offload_update_mixer_and_effects_ctl(MIXER_CARD, out_ctxt->pcm_device_id,
+                                             &out_ctxt->mixer, &out_ctxt->ctl) < 0) {
         ret = -EINVAL;
         free(out_ctxt);
         goto exit;
-    } else {
-        out_ctxt->ctl = mixer_get_ctl_by_name(out_ctxt->mixer, mixer_string);
-        if (!out_ctxt->ctl) {
-            ALOGE("mixer_get_ctl_by_name failed");
-            mixer_close(out_ctxt->mixer);
-            out_ctxt->mixer = NULL;
-            ret = -EINVAL;
-            free(out_ctxt);
-            goto exit;
-        }
     }
 
     list_init(&out_ctxt->effects_list);
@@ -265,8 +378,12 @@ int offload_effects_bundle_hal_stop_output(audio_io_handle_t output, int pcm_id)
         goto exit;
     }
 
-    if (out_ctxt->mixer)
-        mixer_close(out_ctxt->mixer);
+    if (out_ctxt->params_pending)
+        flush_output_params_l(out_ctxt);
+    ALOGV("%s: %u parameter updates sent as %u", __func__,
+          out_ctxt->params_queued, out_ctxt->params_sent);
+
+    offload_close_mixer(&out_ctxt->mixer);
 
     list_for_each(fx_node, &out_ctxt->effects_list) {
         effect_context_t *fx_ctxt = node_to_item(fx_node,
@@ -286,6 +403,85 @@ exit:
 }
 
 
+/*
+ * Called by the audio HAL when the sound card goes offline or comes back
+ * online: cached mixer controls of the card are no longer valid.
+ */
+__attribute__ ((visibility ("default")))
+int offload_effects_bundle_hal_set_card_status(int card, int status)
+{
+    ALOGV("%s card %d status %d", __func__, card, status);
+
+    if (lib_init() != 0)
+        return init_status;
+
+    offload_invalidate_mixer(card);
+    return 0;
+}
+
+
+/*
+ * Queues an update of an effect's offload parameters on the output owning ctl.
+ * Updates of the same effect are merged and flushed at a bounded rate; a
+ * change of the enable state is sent immediately, together with everything
+ * else pending on the output. Called with lock held.
+ */
+int offload_effects_queue_params(int type, struct mixer_ctl *ctl, void *params,
+                                 unsigned flags)
+{
+    struct listnode *node;
+    output_context_t *output = NULL;
+    struct offload_pending_params *pending;
+    int enable;
+
+    if (type < 0 || type >= OFFLOAD_PARAMS_MAX || params == NULL)
+        return -EINVAL;
+
+    list_for_each(node, &active_outputs_list) {
+        output_context_t *out_ctxt = node_to_item(node,
+                                                  output_context_t,
+                                                  outputs_list_node);
+        if (out_ctxt->ctl == ctl) {
+            output = out_ctxt;
+            break;
+        }
+    }
+
+    if (output == NULL) {
+        switch (type) {
+        case OFFLOAD_PARAMS_EQ:
+            return offload_eq_send_params(ctl, params, flags);
+        case OFFLOAD_PARAMS_BASSBOOST:
+            return offload_bassboost_send_params(ctl, params, flags);
+        case OFFLOAD_PARAMS_VIRTUALIZER:
+            return offload_virtualizer_send_params(ctl, params, flags);
+        case OFFLOAD_PARAMS_REVERB:
+            return offload_reverb_send_params(ctl, params, flags);
+        }
+    }
+
+    pending = &output->pending[type];
+    /* another instance of the same effect type: do not merge across them */
+    if (pending->params != NULL && pending->params != params) {
+        send_params_l(output, type);
+        pending->sent_enable = -1;
+    }
+    pending->params = params;
+    pending->flags |= flags;
+    output->params_pending = true;
+    output->params_queued++;
+
+    /* Bit 0 is the enable flag of every effect module */
+    enable = params_enable_flag(type, params);
+    if (!flush_thread_started ||
+        ((flags & 1) && enable != pending->sent_enable)) {
+        flush_output_params_l(output);
+    } else {
+        pthread_cond_signal(&flush_cond);
+    }
+    return 0;
+}
+
 /*
  * Effect operations
  */
@@ -28,8 +28,26 @@
 #define MIXER_CARD 0
 #define SOUND_CARD 0
 
+/* Minimum interval between two parameter flushes to the same output */
+#define OFFLOAD_PARAMS_FLUSH_INTERVAL_MS 40
+
 extern const struct effect_interface_s effect_interface;
 
+/* Offload parameter sets coalesced per output */
+enum {
+    OFFLOAD_PARAMS_EQ,
+    OFFLOAD_PARAMS_BASSBOOST,
+    OFFLOAD_PARAMS_VIRTUALIZER,
+    OFFLOAD_PARAMS_REVERB,
+    OFFLOAD_PARAMS_MAX,
+};
+
+struct offload_pending_params {
+    void *params;           /* effect parameters to send, NULL if nothing pending */
+    unsigned flags;         /* union of OFFLOAD_SEND_* flags requested since last flush */
+    int sent_enable;        /* enable flag last sent to the DSP, -1 if unknown */
+};
+
 typedef struct output_context_s output_context_t;
 typedef struct effect_ops_s effect_ops_t;
 typedef struct effect_context_s effect_context_t;
@@ -45,6 +63,12 @@ struct output_context_s {
     int pcm_device_id;
     struct mixer *mixer;
     struct mixer_ctl *ctl;
+    /* parameter updates not yet sent to the DSP */
+    struct offload_pending_params pending[OFFLOAD_PARAMS_MAX];
+    bool params_pending;
+    int64_t last_flush_ns;
+    uint32_t params_queued;
+    uint32_t params_sent;
 };
 
 /* effect specific operations.
@@ -84,6 +108,9 @@ struct effect_context_s {
 
 int set_config(effect_context_t *context, effect_config_t *config);
 
+int offload_effects_queue_params(int type, struct mixer_ctl *ctl, void *params,
+                                 unsigned flags);
+
 bool effect_is_active(effect_context_t *context);
 
 #endif /* OFFLOAD_EFFECT_BUNDLE_H */
@@ -18,9 +18,12 @@
 //#define LOG_NDEBUG 0
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <errno.h>
 #include <stdbool.h>
+#include <pthread.h>
 
+#include <cutils/list.h>
 #include <cutils/log.h>
 #include <tinyalsa/asoundlib.h>
 #include <sound/audio_effects.h>
@@ -54,36 +57,145 @@ const int map_reverb_opensl_preset_2_offload_preset
     {6, 20}
 };
 
+/*
+ * Mixer handles are expensive to open as the whole control list of the card
+ * is enumerated, so one handle per card is kept open for the lifetime of the
+ * process and effects controls are resolved once per PCM device.
+ * A handle invalidated on a card state change is closed when its last user
+ * releases it.
+ */
+#define EFFECTS_CTL_CACHE_SIZE 64
+
+struct mixer_cache_entry {
+    struct listnode node;
+    int card;
+    struct mixer *mixer;
+    int refs;
+    bool stale;
+    struct mixer_ctl *ctl[EFFECTS_CTL_CACHE_SIZE];
+};
+
+static struct listnode mixer_cache_list = { &mixer_cache_list, &mixer_cache_list };
+static pthread_mutex_t mixer_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct mixer_cache_entry *get_mixer_cache_entry_l(int card)
+{
+    struct listnode *node;
+    struct mixer_cache_entry *entry;
+
+    list_for_each(node, &mixer_cache_list) {
+        entry = node_to_item(node, struct mixer_cache_entry, node);
+        if (entry->card == card && !entry->stale)
+            return entry;
+    }
+
+    entry = (struct mixer_cache_entry *)calloc(1, sizeof(*entry));
+    if (entry == NULL)
+        return NULL;
+    entry->mixer = mixer_open(card);
+    if (entry->mixer == NULL) {
+        ALOGE("Failed to open mixer");
+        free(entry);
+        return NULL;
+    }
+    entry->card = card;
+    list_add_tail(&mixer_cache_list, &entry->node);
+    return entry;
+}
+
+static void free_mixer_cache_entry_l(struct mixer_cache_entry *entry)
+{
+    list_remove(&entry->node);
+    mixer_close(entry->mixer);
+    free(entry);
+}
+
 int offload_update_mixer_and_effects_ctl(int card, int device_id,
-                                         struct mixer *mixer,
-                                         struct mixer_ctl *ctl)
+                                         struct mixer **mixer,
+                                         struct mixer_ctl **ctl)
 {
     char mixer_string[128];
+    struct mixer_cache_entry *entry;
+    struct mixer_ctl *effects_ctl = NULL;
 
-    snprintf(mixer_string, sizeof(mixer_string),
-             "%s %d", "Audio Effects Config", device_id);
-    ALOGV("%s: mixer_string: %s", __func__, mixer_string);
-    mixer = mixer_open(card);
-    if (!mixer) {
-        ALOGE("Failed to open mixer");
-        ctl = NULL;
+    *mixer = NULL;
+    *ctl = NULL;
+
+    pthread_mutex_lock(&mixer_cache_lock);
+    entry = get_mixer_cache_entry_l(card);
+    if (entry == NULL) {
+        pthread_mutex_unlock(&mixer_cache_lock);
         return -EINVAL;
-    } else {
-        ctl = mixer_get_ctl_by_name(mixer, mixer_string);
-        if (!ctl) {
+    }
+
+    if (device_id >= 0 && device_id < EFFECTS_CTL_CACHE_SIZE)
+        effects_ctl = entry->ctl[device_id];
+    if (effects_ctl == NULL) {
+        snprintf(mixer_string, sizeof(mixer_string),
+                 "%s %d", "Audio Effects Config", device_id);
+        ALOGV("%s: mixer_string: %s", __func__, mixer_string);
+        effects_ctl = mixer_get_ctl_by_name(entry->mixer, mixer_string);
+        if (!effects_ctl) {
             ALOGE("mixer_get_ctl_by_name failed");
-            mixer_close(mixer);
-            mixer = NULL;
+            if (entry->refs == 0)
+                free_mixer_cache_entry_l(entry);
+            pthread_mutex_unlock(&mixer_cache_lock);
             return -EINVAL;
         }
+        if (device_id >= 0 && device_id < EFFECTS_CTL_CACHE_SIZE)
+            entry->ctl[device_id] = effects_ctl;
     }
-    ALOGV("mixer: %p, ctl: %p", mixer, ctl);
+    entry->refs++;
+    *mixer = entry->mixer;
+    *ctl = effects_ctl;
+    pthread_mutex_unlock(&mixer_cache_lock);
+
+    ALOGV("mixer: %p, ctl: %p", *mixer, *ctl);
     return 0;
 }
 
-void offload_close_mixer(struct mixer *mixer)
+void offload_close_mixer(struct mixer **mixer)
 {
-    mixer_close(mixer);
+    struct listnode *node;
+    struct mixer_cache_entry *entry;
+
+    if (*mixer == NULL)
+        return;
+
+    pthread_mutex_lock(&mixer_cache_lock);
+    list_for_each(node, &mixer_cache_list) {
+        entry = node_to_item(node, struct mixer_cache_entry, node);
+        if (entry->mixer == *mixer) {
+            if (--entry->refs == 0 && entry->stale)
+                free_mixer_cache_entry_l(entry);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mixer_cache_lock);
+    *mixer = NULL;
+}
+
+/*
+ * Drops the cached mixer handle and controls of a card whose state changed:
+ * controls are recreated by the driver when the card comes back online.
+ */
+void offload_invalidate_mixer(int card)
+{
+    struct listnode *node, *tempnode;
+    struct mixer_cache_entry *entry;
+
+    pthread_mutex_lock(&mixer_cache_lock);
+    list_for_each_safe(node, tempnode, &mixer_cache_list) {
+        entry = node_to_item(node, struct mixer_cache_entry, node);
+        if (entry->card != card || entry->stale)
+            continue;
+        ALOGV("%s: card %d, %d users", __func__, card, entry->refs);
+        if (entry->refs == 0)
+            free_mixer_cache_entry_l(entry);
+        else
+            entry->stale = true;
+    }
+    pthread_mutex_unlock(&mixer_cache_lock);
 }
 
 void offload_bassboost_set_device(struct bass_boost_params *bassboost,
@@ -107,9 +107,10 @@ int equalizer_set_band_level(equalizer_context_t *context, int32_t band,
                                equalizer_band_presets_freq,
                                context->band_levels);
     if (context->ctl)
-        offload_eq_send_params(context->ctl, &context->offload_eq,
-                               OFFLOAD_SEND_EQ_ENABLE_FLAG |
-                               OFFLOAD_SEND_EQ_BANDS_LEVEL);
+        offload_effects_queue_params(OFFLOAD_PARAMS_EQ, context->ctl,
+                                     &context->offload_eq,
+                                     OFFLOAD_SEND_EQ_ENABLE_FLAG |
+                                     OFFLOAD_SEND_EQ_BANDS_LEVEL);
     return 0;
 }
 
@@ -164,9 +165,10 @@ int equalizer_set_preset(equalizer_context_t *context, int preset)
                                equalizer_band_presets_freq,
                                context->band_levels);
     if(context->ctl)
-        offload_eq_send_params(context->ctl, &context->offload_eq,
-                               OFFLOAD_SEND_EQ_ENABLE_FLAG |
-                               OFFLOAD_SEND_EQ_PRESET);
+        offload_effects_queue_params(OFFLOAD_PARAMS_EQ, context->ctl,
+                                     &context->offload_eq,
+                                     OFFLOAD_SEND_EQ_ENABLE_FLAG |
+                                     OFFLOAD_SEND_EQ_PRESET);
     return 0;
 }
 
@@ -509,9 +511,10 @@ int equalizer_enable(effect_context_t *context)
     if (!offload_eq_get_enable_flag(&(eq_ctxt->offload_eq))) {
         offload_eq_set_enable_flag(&(eq_ctxt->offload_eq), true);
         if (eq_ctxt->ctl)
-            offload_eq_send_params(eq_ctxt->ctl, &eq_ctxt->offload_eq,
-                                   OFFLOAD_SEND_EQ_ENABLE_FLAG |
-                                   OFFLOAD_SEND_EQ_BANDS_LEVEL);
+            offload_effects_queue_params(OFFLOAD_PARAMS_EQ, eq_ctxt->ctl,
+                                         &eq_ctxt->offload_eq,
+                                         OFFLOAD_SEND_EQ_ENABLE_FLAG |
+                                         OFFLOAD_SEND_EQ_BANDS_LEVEL);
     }
     return 0;
 }
@@ -524,8 +527,9 @@ int equalizer_disable(effect_context_t *context)
     if (offload_eq_get_enable_flag(&(eq_ctxt->offload_eq))) {
         offload_eq_set_enable_flag(&(eq_ctxt->offload_eq), false);
         if (eq_ctxt->ctl)
-            offload_eq_send_params(eq_ctxt->ctl, &eq_ctxt->offload_eq,
-                                   OFFLOAD_SEND_EQ_ENABLE_FLAG);
+            offload_effects_queue_params(OFFLOAD_PARAMS_EQ, eq_ctxt->ctl,
+                                         &eq_ctxt->offload_eq,
+                                         OFFLOAD_SEND_EQ_ENABLE_FLAG);
     }
     return 0;
 }
@@ -538,9 +542,10 @@ int equalizer_start(effect_context_t *context, output_context_t *output)
     eq_ctxt->ctl = output->ctl;
     if (offload_eq_get_enable_flag(&(eq_ctxt->offload_eq)))
         if (eq_ctxt->ctl)
-            offload_eq_send_params(eq_ctxt->ctl, &eq_ctxt->offload_eq,
-                                   OFFLOAD_SEND_EQ_ENABLE_FLAG |
-                                   OFFLOAD_SEND_EQ_BANDS_LEVEL);
+            offload_effects_queue_params(OFFLOAD_PARAMS_EQ, eq_ctxt->ctl,
+                                         &eq_ctxt->offload_eq,
+                                         OFFLOAD_SEND_EQ_ENABLE_FLAG |
+                                         OFFLOAD_SEND_EQ_BANDS_LEVEL);
     return 0;
 }
 
@@ -56,9 +56,10 @@ int virtualizer_set_strength(virtualizer_context_t *context, uint32_t strength)
 
     offload_virtualizer_set_strength(&(context->offload_virt), strength);
     if (context->ctl)
-        offload_virtualizer_send_params(context->ctl, &context->offload_virt,
-                                        OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG |
-                                        OFFLOAD_SEND_VIRTUALIZER_STRENGTH);
+        offload_effects_queue_params(OFFLOAD_PARAMS_VIRTUALIZER, context->ctl,
+                                     &context->offload_virt,
+                                     OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG |
+                                     OFFLOAD_SEND_VIRTUALIZER_STRENGTH);
     return 0;
 }
 
@@ -158,9 +159,9 @@ int virtualizer_set_device(effect_context_t *context, uint32_t device)
             if (effect_is_active(&virt_ctxt->common)) {
                 offload_virtualizer_set_enable_flag(&(virt_ctxt->offload_virt), false);
                 if (virt_ctxt->ctl)
-                    offload_virtualizer_send_params(virt_ctxt->ctl,
-                                                    &virt_ctxt->offload_virt,
-                                                    OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG);
+                    offload_effects_queue_params(OFFLOAD_PARAMS_VIRTUALIZER, virt_ctxt->ctl,
+                                                 &virt_ctxt->offload_virt,
+                                                 OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG);
             }
             virt_ctxt->temp_disabled = true;
         }
@@ -169,9 +170,9 @@ int virtualizer_set_device(effect_context_t *context, uint32_t device)
             if (effect_is_active(&virt_ctxt->common)) {
                 offload_virtualizer_set_enable_flag(&(virt_ctxt->offload_virt), true);
                 if (virt_ctxt->ctl)
-                    offload_virtualizer_send_params(virt_ctxt->ctl,
-                                                    &virt_ctxt->offload_virt,
-                                                    OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG);
+                    offload_effects_queue_params(OFFLOAD_PARAMS_VIRTUALIZER, virt_ctxt->ctl,
+                                                 &virt_ctxt->offload_virt,
+                                                 OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG);
             }
             virt_ctxt->temp_disabled = false;
         }
@@ -227,10 +228,10 @@ int virtualizer_enable(effect_context_t *context)
         !(virt_ctxt->temp_disabled)) {
         offload_virtualizer_set_enable_flag(&(virt_ctxt->offload_virt), true);
         if (virt_ctxt->ctl && virt_ctxt->strength)
-            offload_virtualizer_send_params(virt_ctxt->ctl,
-                                          &virt_ctxt->offload_virt,
-                                          OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG |
-                                          OFFLOAD_SEND_BASSBOOST_STRENGTH);
+            offload_effects_queue_params(OFFLOAD_PARAMS_VIRTUALIZER, virt_ctxt->ctl,
+                                         &virt_ctxt->offload_virt,
+                                         OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG |
+                                         OFFLOAD_SEND_BASSBOOST_STRENGTH);
     }
     return 0;
 }
@@ -243,9 +244,9 @@ int virtualizer_disable(effect_context_t *context)
     if (offload_virtualizer_get_enable_flag(&(virt_ctxt->offload_virt))) {
         offload_virtualizer_set_enable_flag(&(virt_ctxt->offload_virt), false);
         if (virt_ctxt->ctl)
-            offload_virtualizer_send_params(virt_ctxt->ctl,
-                                          &virt_ctxt->offload_virt,
-                                          OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG);
+            offload_effects_queue_params(OFFLOAD_PARAMS_VIRTUALIZER, virt_ctxt->ctl,
+                                         &virt_ctxt->offload_virt,
+                                         OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG);
     }
     return 0;
 }
@@ -258,9 +259,10 @@ int virtualizer_start(effect_context_t *context, output_context_t *output)
     virt_ctxt->ctl = output->ctl;
     if (offload_virtualizer_get_enable_flag(&(virt_ctxt->offload_virt)))
         if (virt_ctxt->ctl)
-            offload_virtualizer_send_params(virt_ctxt->ctl, &virt_ctxt->offload_virt,
-                                          OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG |
-                                          OFFLOAD_SEND_VIRTUALIZER_STRENGTH);
+            offload_effects_queue_params(OFFLOAD_PARAMS_VIRTUALIZER, virt_ctxt->ctl,
+                                         &virt_ctxt->offload_virt,
+                                         OFFLOAD_SEND_VIRTUALIZER_ENABLE_FLAG |
+                                         OFFLOAD_SEND_VIRTUALIZER_STRENGTH);
     return 0;
 }
 
@@ -91,6 +91,9 @@ struct vol_listener_context_s {
     uint32_t dev_id;
     float left_vol;
     float right_vol;
+    /* contribution of this context to stream_energy, see update_context_energy_l() */
+    bool contributing;
+    float energy;
 };
 
 /* volume listener, music UUID: 08b8b058-0590-11e5-ac71-0025b32654a0 */
@@ -206,6 +209,23 @@ struct listnode vol_effect_list;
 /* lock must be held when modifying or accessing created_effects_list */
 pthread_mutex_t vol_listner_init_lock;
 
+/* Energy sum per stream type of the contexts active on a device with gain dependent
+ * calibration, maintained incrementally on each volume, state or device change.
+ * Protected by vol_listner_init_lock */
+static double stream_energy[MAX_STREAM_TYPES];
+static int stream_contributors[MAX_STREAM_TYPES];
+
+/* Calibration levels are sent to the HAL by cal_thread so that effect commands do not wait
+ * for the HAL locks. Protected by vol_listner_init_lock */
+static pthread_t cal_thread;
+static bool cal_thread_created;
+static pthread_cond_t cal_cond;
+/* level waiting for cal_thread, and level cal_thread is sending, -1 for none */
+static int pending_gain_dep_cal_level = -1;
+static int sending_gain_dep_cal_level = -1;
+/* last send failed: re-evaluate the level on the next change even if the volume is the same */
+static bool gain_dep_cal_failed;
+
 /* Treblized modules locations */
 static const char *primary_audio_hal_path[] =
     {"/vendor/lib/hw/", "/system/lib/hw/"};
@@ -236,6 +256,14 @@ static void dump_list_l()
                 context->dev_id, context->state, context->session_id, context->left_vol,context->right_vol);
     }
 
+    for (int i = 0; i < MAX_STREAM_TYPES; i++) {
+        if (stream_contributors[i] > 0)
+            ALOGW("%s: streamType [%d] contributors [%d] energy [%f]", __func__, i,
+                  stream_contributors[i], stream_energy[i]);
+    }
+    ALOGW("%s: cal level (current/sending/pending) [%d / %d / %d]", __func__,
+          current_gain_dep_cal_level, sending_gain_dep_cal_level, pending_gain_dep_cal_level);
+
     ALOGW("DUMP_END :: ===========");
 }
 
@@ -254,42 +282,107 @@ static inline bool valid_dev_in_context(struct vol_listener_context_s *context)
     return false;
 }
 
+/*
+ * Records the outcome of sending a calibration level. The current level only changes once the
+ * HAL accepted it, so that a failed level is sent again on the next evaluation.
+ * Called with vol_listner_init_lock held.
+ */
+static void gain_dep_cal_set_result_l(int level, bool sent)
+{
+    if (sent) {
+        current_gain_dep_cal_level = level;
+        gain_dep_cal_failed = false;
+    } else {
+        ALOGE("%s: Failed to set gain dep cal level %d", __func__, level);
+        gain_dep_cal_failed = true;
+    }
+}
+
+/* Sends the last selected calibration level to the HAL, outside of effect commands */
+static void *cal_thread_loop(void *arg __unused)
+{
+    int level;
+    bool sent;
+
+    pthread_mutex_lock(&vol_listner_init_lock);
+    while (true) {
+        while (pending_gain_dep_cal_level == -1)
+            pthread_cond_wait(&cal_cond, &vol_listner_init_lock);
+        level = pending_gain_dep_cal_level;
+        pending_gain_dep_cal_level = -1;
+        sending_gain_dep_cal_level = level;
+        pthread_mutex_unlock(&vol_listner_init_lock);
+
+        // intermediate levels selected while this is in progress are skipped
+        sent = send_gain_dep_cal(level);
+
+        pthread_mutex_lock(&vol_listner_init_lock);
+        sending_gain_dep_cal_level = -1;
+        gain_dep_cal_set_result_l(level, sent);
+    }
+    pthread_mutex_unlock(&vol_listner_init_lock);
+    return NULL;
+}
+
+/*
+ * Updates the contribution of a context to the energy sum. Returns true if it changed.
+ * Called with vol_listner_init_lock held.
+ */
+static bool update_context_energy_l(vol_listener_context_t *context)
+{
+    bool contributing = context->state == VOL_LISTENER_STATE_ACTIVE &&
+                        valid_dev_in_context(context);
+    float energy = 0;
+    uint32_t type = context->stream_type;
+
+    if (contributing) {
+        // pick loudest of both channels
+        float vol = fmax(context->left_vol, context->right_vol);
+        energy = vol * vol;
+    }
+    if (contributing == context->contributing && energy == context->energy)
+        return false;
+
+    stream_energy[type] += energy - context->energy;
+    if (contributing != context->contributing)
+        stream_contributors[type] += contributing ? 1 : -1;
+    // do not let rounding errors accumulate once nothing contributes
+    if (stream_contributors[type] == 0)
+        stream_energy[type] = 0;
+
+    context->contributing = contributing;
+    context->energy = energy;
+    return true;
+}
+
 static void check_and_set_gain_dep_cal()
 {
-    // iterate through list and make decision to set new gain dep cal level for speaker device
-    // 1. find all usecase active on speaker
-    // 2. find energy sum for each usecase
-    // 3. find the highest of all the active usecase
-    // 4. if new value is different than the current value then load new calibration
+    // make decision to set new gain dep cal level for speaker device from the energy sum of
+    // all usecases active on speaker:
+    // if new value is different than the current value then load new calibration
 
-    struct listnode *node = NULL;
     float new_vol = -1.0;
     int max_level = 0;
-    vol_listener_context_t *context = NULL;
+    double sum_energy = 0;
+    bool sum_energy_used = false;
+    int target_level;
     if (dumping_enabled) {
         dump_list_l();
     }
 
     ALOGV("%s ==> Start ...", __func__);
 
-    float sum_energy = 0.0;
-    bool sum_energy_used = false;
-    float temp_vol = 0;
-    // compute energy sum for the active speaker device (pick loudest of both channels)
-    list_for_each(node, &vol_effect_list) {
-        context = node_to_item(node, struct vol_listener_context_s, effect_list_node);
-        if ((context->state == VOL_LISTENER_STATE_ACTIVE) &&
-            valid_dev_in_context(context)) {
+    for (int i = 0; i < MAX_STREAM_TYPES; i++) {
+        if (stream_contributors[i] > 0) {
             sum_energy_used = true;
-            temp_vol = fmax(context->left_vol, context->right_vol);
-            sum_energy += temp_vol * temp_vol;
+            sum_energy += stream_energy[i];
         }
     }
     if (sum_energy_used) {
         new_vol = fmin(sqrt(sum_energy), 1.0);
     }
 
-    if (new_vol != current_vol) {
+    if (new_vol != current_vol || gain_dep_cal_failed) {
         ALOGV("%s:: Change in decision :: current volume is %f new volume is %f",
               __func__, current_vol, new_vol);
 
@@ -315,12 +408,21 @@ static void check_and_set_gain_dep_cal()
                 }
             }
 
+            // level the HAL has or will have once queued sends complete
+            target_level = pending_gain_dep_cal_level != -1 ? pending_gain_dep_cal_level :
+                           sending_gain_dep_cal_level != -1 ? sending_gain_dep_cal_level :
+                           current_gain_dep_cal_level;
+
             // check here if previous gain dep cal level was not same
             if (gain_dep_cal_level != -1) {
-                if (gain_dep_cal_level != current_gain_dep_cal_level) {
-                    // decision made .. send new level now
-                    if (!send_gain_dep_cal(gain_dep_cal_level)) {
-                        ALOGE("%s: Failed to set gain dep cal level", __func__);
+                if (gain_dep_cal_level != target_level || gain_dep_cal_failed) {
+                    // decision made .. send new level now, or from cal_thread if available
+                    if (cal_thread_created) {
+                        pending_gain_dep_cal_level = gain_dep_cal_level;
+                        pthread_cond_signal(&cal_cond);
+                    } else {
+                        gain_dep_cal_set_result_l(gain_dep_cal_level,
+                                                  send_gain_dep_cal(gain_dep_cal_level));
                     }
 
                     if (dumping_enabled) {
@@ -333,9 +435,7 @@ static void check_and_set_gain_dep_cal()
                               gain_dep_cal_level);
                     }
 
-                    // Gain level change info send to lower layer that has logic to re-apply on
-                    // failure, so change current gain level to reflect new level
-                    current_gain_dep_cal_level = gain_dep_cal_level;
+                    // current_gain_dep_cal_level is updated once the level was sent
                     current_vol = new_vol;
                 } else {
                     if (dumping_enabled) {
@@ -461,7 +561,7 @@ static int vol_effect_command(effect_handle_t self,
 
         // After changing the state and if device is speaker
         // recalculate gain dep cal level
-        if (valid_dev_in_context(context)) {
+        if (update_context_energy_l(context)) {
             check_and_set_gain_dep_cal();
         }
 
@@ -488,7 +588,7 @@ static int vol_effect_command(effect_handle_t self,
 
         // After changing the state and if device is speaker
         // recalculate gain dep cal level
-        if (valid_dev_in_context(context)) {
+        if (update_context_energy_l(context)) {
             check_and_set_gain_dep_cal();
         }
 
@@ -505,7 +605,6 @@ static int vol_effect_command(effect_handle_t self,
     case EFFECT_CMD_SET_DEVICE:
     {
         uint32_t new_device;
-        bool recompute_gain_dep_cal_Level = false;
         ALOGV("cmd called EFFECT_CMD_SET_DEVICE ");
 
         if (p_cmd_data == NULL) {
@@ -518,16 +617,10 @@ static int vol_effect_command(effect_handle_t self,
         ALOGV("%s :: EFFECT_CMD_SET_DEVICE: (current/new) device (0x%x / 0x%x)",
                __func__, context->dev_id, new_device);
 
-        // check if old or new device is speaker
-        if (valid_dev_in_context(context) ||
-            new_device == AUDIO_DEVICE_OUT_SPEAKER ||
-            new_device == AUDIO_DEVICE_OUT_SPEAKER_SAFE) {
-            recompute_gain_dep_cal_Level = true;
-        }
-
         context->dev_id = new_device;
 
-        if (recompute_gain_dep_cal_Level) {
+        // recompute if moving to or from speaker changed the energy sum
+        if (update_context_energy_l(context)) {
             check_and_set_gain_dep_cal();
         }
     }
@@ -536,7 +629,6 @@ static int vol_effect_command(effect_handle_t self,
     case EFFECT_CMD_SET_VOLUME:
     {
         float left_vol = 0, right_vol = 0;
-        bool recompute_gain_dep_cal_Level = false;
 
         ALOGV("cmd called EFFECT_CMD_SET_VOLUME");
         if (p_cmd_data == NULL || cmd_size != 2 * sizeof(uint32_t)) {
@@ -546,10 +638,6 @@ static int vol_effect_command(effect_handle_t self,
             goto exit;
         }
 
-        if (valid_dev_in_context(context)) {
-            recompute_gain_dep_cal_Level = true;
-        }
-
         left_vol = (float)(*(uint32_t *)p_cmd_data) / (1 << 24);
         right_vol = (float)(*((uint32_t *)p_cmd_data + 1)) / (1 << 24);
         ALOGV("Current Volume (%f / %f ) new Volume (%f / %f)", context->left_vol,
@@ -559,7 +647,7 @@ static int vol_effect_command(effect_handle_t self,
         context->right_vol = right_vol;
 
         // recompute gan dep cal level only if volume changed on speaker device
-        if (recompute_gain_dep_cal_Level) {
+        if (update_context_energy_l(context)) {
             check_and_set_gain_dep_cal();
         }
     }
@@ -623,6 +711,7 @@ static void init_once()
     get_custom_gain_table = NULL;
 
     pthread_mutex_init(&vol_listner_init_lock, NULL);
+    pthread_cond_init(&cal_cond, NULL);
 
     strcpy(primary_hal_path, PRIMARY_HAL_FILENAME);
     // get hal function pointer
@@ -680,6 +769,13 @@ static void init_once()
     headset_cal_enabled = property_get_bool(
         "vendor.audio.volume.headset.gain.depcal",
         property_get_bool("audio.volume.headset.gain.depcal", false));
+    if (send_gain_dep_cal != NULL) {
+        cal_thread_created = pthread_create(&cal_thread, NULL, cal_thread_loop, NULL) == 0;
+        if (!cal_thread_created)
+            ALOGW("%s: cannot create calibration thread, sending from effect commands",
+                  __func__);
+    }
+
     init_status = 0;
     list_init(&vol_effect_list);
     initialized = true;
@@ -778,9 +874,8 @@ static int vol_prc_lib_release(effect_handle_t handle)
         if (context == recv_contex) {
             ALOGV("--- Found something to remove ---");
             PRINT_STREAM_TYPE(context->stream_type);
-            if (valid_dev_in_context(context)) {
-                recompute_flag = true;
-            }
+            context->state = VOL_LISTENER_STATE_UNINITIALIZED;
+            recompute_flag = update_context_energy_l(context);
             list_remove(&context->effect_list_node);
             free(context);
             status = 0;
@@ -20,12 +20,22 @@
 #include <dlfcn.h>
 #include <math.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/prctl.h>
 #include <time.h>
 #include <unistd.h>
 
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define VISUALIZER_USE_NEON
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define VISUALIZER_USE_SSE2
+#endif
+
 #include <cutils/list.h>
 #include <cutils/log.h>
 #include <system/thread_defs.h>
@@ -89,6 +99,13 @@ struct output_context_s {
     struct listnode effects_list; /* list of effects attached to this output */
 };
 
+/* Immutable list of the effects the capture thread must process: active effects with a
+ * process() operation attached to an active output. */
+typedef struct process_snapshot_s {
+    int count;
+    effect_context_t *effects[];
+} process_snapshot_t;
+
 
 /* maximum time since last capture buffer update before resetting capture buffer. This means
   that the framework has stopped playing audio and we must start returning silence */
@@ -101,19 +118,46 @@ struct output_context_s {
 /* maximum number of buffers for which we keep track of the measurements */
 #define MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS 25 /* note: buffer index is stored in uint8_t */
 
+/* Measurement mode computing a magnitude spectrum of the captured audio once per capture period,
+ * shared by all visualizers enabling it. Read with VISUALIZER_PARAM_SPECTRUM as
+ * VISUALIZER_SPECTRUM_BINS int32_t magnitudes in mB relative to a full scale sine, from DC to
+ * half the capture sampling rate. */
+#define MEASUREMENT_MODE_SPECTRUM 0x2
+#define VISUALIZER_PARAM_SPECTRUM 0x10000
+
+#define VISUALIZER_SPECTRUM_FFT_SIZE 512
+#define VISUALIZER_SPECTRUM_BINS (VISUALIZER_SPECTRUM_FFT_SIZE / 2)
+
 typedef struct buffer_stats_s {
     bool is_valid;
     uint16_t peak_u16; /* the positive peak of the absolute value of the samples in a buffer */
     float rms_squared; /* the average square of the samples in a buffer */
 } buffer_stats_t;
 
+#define DSP_OUTPUT_LATENCY_MS 0 /* Fudge factor for latency after capture point in audio DSP */
+
+/* capture bytes kept in a result: the largest capture plus the DSP latency at 48 kHz */
+#define RESULT_CAPTURE_SIZE (VISUALIZER_CAPTURE_SIZE_MAX + DSP_OUTPUT_LATENCY_MS * 48)
+
+/* What VISUALIZER_CMD_CAPTURE and VISUALIZER_CMD_MEASURE report, published by process() after
+ * each buffer. */
+typedef struct visualizer_result_s {
+    struct timespec update_time; /* when it was published, tv_sec is 0 before the first buffer */
+    uint8_t capture[RESULT_CAPTURE_SIZE]; /* last capture samples, oldest first */
+    uint16_t peak_u16; /* measurement window summary */
+    float sum_rms_squared;
+    uint8_t nb_valid_meas;
+} visualizer_result_t;
+
+/* set in result_middle when the slot it designates was published and not read yet */
+#define RESULT_NEW 0x4
+
 typedef struct visualizer_context_s {
     effect_context_t common;
 
     uint32_t capture_idx;
     uint32_t capture_size;
     uint32_t scaling_mode;
-    uint32_t last_capture_idx;
     uint32_t latency;
     struct timespec buffer_update_time;
     uint8_t capture_buf[CAPTURE_BUF_SIZE];
@@ -123,6 +167,13 @@ typedef struct visualizer_context_s {
     uint8_t meas_wndw_size_in_buffers;
     uint8_t meas_buffer_idx;
     buffer_stats_t past_meas[MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS];
+    /* Results exchanged without process_lock: process() fills results[result_back] and swaps it
+     * with result_middle, the commands swap result_front with result_middle when it holds a new
+     * one. Each side only touches the slot it owns. */
+    visualizer_result_t results[3];
+    _Atomic uint32_t result_middle;
+    uint32_t result_back;  /* capture thread only */
+    uint32_t result_front; /* commands, with lock held */
 } visualizer_context_t;
 
 
@@ -165,7 +216,9 @@ struct listnode active_outputs_list;
 /* thread capturing PCM from Proxy port and calling the process function on each enabled effect
  * attached to an active output stream */
 pthread_t capture_thread;
-/* lock must be held when modifying or accessing created_effects_list or active_outputs_list */
+/* lock must be held when modifying or accessing created_effects_list or active_outputs_list.
+ * created_effects_list is also modified with process_lock held, so that the capture thread can
+ * check effect_exists() while processing */
 pthread_mutex_t lock;
 /* thread_lock must be held when starting or stopping the capture thread.
  * Locking order: thread_lock -> lock */
@@ -177,8 +230,37 @@ pthread_cond_t cond;
 bool exit_thread;
 /* 0 if the capture thread was created successfully */
 int thread_status;
-
-#define DSP_OUTPUT_LATENCY_MS 0 /* Fudge factor for latency after capture point in audio DSP */
+/* Effects processed by the capture thread without holding lock. Replaced with
+ * publish_process_snapshot_l() whenever the list or the state of attached effects changes. */
+_Atomic(process_snapshot_t *) process_snapshot;
+/* held by the capture thread while processing a snapshot. Taken by the control path after
+ * replacing the snapshot, to wait until the previous one and the effects it references are no
+ * longer in use, and by effect_command() around commands touching the capture or configuration
+ * state of an effect. Locking order: lock -> process_lock */
+pthread_mutex_t process_lock;
+/* number of buffers read by the capture thread */
+uint32_t capture_period;
+/* spectrum of the buffer read in spectrum_period, updated by the capture thread and read
+ * by VISUALIZER_PARAM_SPECTRUM, both with process_lock held */
+static uint32_t spectrum_period;
+static bool spectrum_valid;
+static int32_t spectrum_mb[VISUALIZER_SPECTRUM_BINS];
+/* Hann window and FFT twiddle factors, initialized once */
+static float spectrum_window[VISUALIZER_SPECTRUM_FFT_SIZE];
+static float spectrum_window_gain;
+static float spectrum_cos[VISUALIZER_SPECTRUM_FFT_SIZE / 2];
+static float spectrum_sin[VISUALIZER_SPECTRUM_FFT_SIZE / 2];
+/* statistics, protected by lock */
+uint32_t snapshot_publishes;
+/* number of times the control path had to wait for the capture thread to finish processing */
+uint32_t process_lock_waits;
+
+/* Mixer handle of the proxy capture card and resolved proxy control, kept open
+ * across capture thread restarts. Closed on card state changes.
+ * Protected by lock. */
+static struct mixer *proxy_mixer;
+static int proxy_mixer_card = -1;
+static struct mixer_ctl *proxy_ctl;
 
 /* Retry for delay for mixer open */
 #define RETRY_NUMBER 10
@@ -206,13 +288,42 @@ struct pcm_config pcm_config_capture = {
  *  Local functions
  */
 
+static void init_spectrum_tables() {
+    int i;
+
+    spectrum_window_gain = 0;
+    for (i = 0; i < VISUALIZER_SPECTRUM_FFT_SIZE; i++) {
+        spectrum_window[i] = 0.5f - 0.5f * cosf(2 * M_PI * i / VISUALIZER_SPECTRUM_FFT_SIZE);
+        spectrum_window_gain += spectrum_window[i];
+    }
+    for (i = 0; i < VISUALIZER_SPECTRUM_FFT_SIZE / 2; i++) {
+        spectrum_cos[i] = cosf(2 * M_PI * i / VISUALIZER_SPECTRUM_FFT_SIZE);
+        spectrum_sin[i] = -sinf(2 * M_PI * i / VISUALIZER_SPECTRUM_FFT_SIZE);
+    }
+}
+
 static void init_once() {
+    init_spectrum_tables();
+    /* loaded once here rather than by each visualizer_init(), which runs concurrently for
+     * effects being created */
+    acdb_handle = dlopen(LIB_ACDB_LOADER, RTLD_NOW);
+    if (acdb_handle == NULL) {
+        ALOGE("%s: DLOPEN failed for %s", __func__, LIB_ACDB_LOADER);
+    } else {
+        acdb_send_audio_cal = (acdb_send_audio_cal_t)dlsym(acdb_handle,
+                                                "acdb_loader_send_audio_cal");
+        if (!acdb_send_audio_cal)
+            ALOGE("%s: Could not find the symbol acdb_send_audio_cal from %s",
+                  __func__, LIB_ACDB_LOADER);
+    }
     list_init(&created_effects_list);
     list_init(&active_outputs_list);
 
     pthread_mutex_init(&lock, NULL);
     pthread_mutex_init(&thread_lock, NULL);
+    pthread_mutex_init(&process_lock, NULL);
     pthread_cond_init(&cond, NULL);
+    atomic_init(&process_snapshot, NULL);
     exit_thread = false;
     thread_status = -1;
 
@@ -252,6 +363,63 @@ output_context_t *get_output(audio_io_handle_t output) {
     return NULL;
 }
 
+/* Builds and publishes the list of effects to process from active_outputs_list.
+ * When this returns, the capture thread does not reference the previous list nor any effect
+ * that is not part of the new one. Called with lock held. */
+void publish_process_snapshot_l() {
+    struct listnode *out_node;
+    struct listnode *fx_node;
+    process_snapshot_t *snapshot = NULL;
+    process_snapshot_t *old;
+    int count = 0;
+
+    list_for_each(out_node, &active_outputs_list) {
+        output_context_t *out_ctxt = node_to_item(out_node,
+                                                  output_context_t,
+                                                  outputs_list_node);
+        list_for_each(fx_node, &out_ctxt->effects_list) {
+            effect_context_t *fx_ctxt = node_to_item(fx_node,
+                                                         effect_context_t,
+                                                         output_node);
+            if (fx_ctxt->state == EFFECT_STATE_ACTIVE && fx_ctxt->ops.process != NULL)
+                count++;
+        }
+    }
+
+    if (count > 0) {
+        snapshot = (process_snapshot_t *)malloc(sizeof(process_snapshot_t) +
+                                                count * sizeof(effect_context_t *));
+        if (snapshot == NULL) {
+            ALOGE("%s: cannot allocate snapshot of %d effects", __func__, count);
+        } else {
+            snapshot->count = 0;
+            list_for_each(out_node, &active_outputs_list) {
+                output_context_t *out_ctxt = node_to_item(out_node,
+                                                          output_context_t,
+                                                          outputs_list_node);
+                list_for_each(fx_node, &out_ctxt->effects_list) {
+                    effect_context_t *fx_ctxt = node_to_item(fx_node,
+                                                                 effect_context_t,
+                                                                 output_node);
+                    if (fx_ctxt->state == EFFECT_STATE_ACTIVE && fx_ctxt->ops.process != NULL)
+                        snapshot->effects[snapshot->count++] = fx_ctxt;
+                }
+            }
+        }
+    }
+
+    old = atomic_exchange_explicit(&process_snapshot, snapshot, memory_order_acq_rel);
+    snapshot_publishes++;
+
+    /* wait for the capture thread to be done with the previous snapshot */
+    if (pthread_mutex_trylock(&process_lock) != 0) {
+        process_lock_waits++;
+        pthread_mutex_lock(&process_lock);
+    }
+    pthread_mutex_unlock(&process_lock);
+    free(old);
+}
+
 void add_effect_to_output(output_context_t * output, effect_context_t *context) {
     struct listnode *fx_node;
 
@@ -265,6 +433,7 @@ void add_effect_to_output(output_context_t * output, effect_context_t *context)
     list_add_tail(&output->effects_list, &context->output_node);
     if (context->ops.start)
         context->ops.start(context, output);
+    publish_process_snapshot_l();
 }
 
 void remove_effect_from_output(output_context_t * output, effect_context_t *context) {
@@ -278,6 +447,7 @@ void remove_effect_from_output(output_context_t * output, effect_context_t *cont
             if (context->ops.stop)
                 context->ops.stop(context, output);
             list_remove(&context->output_node);
+            publish_process_snapshot_l();
             return;
         }
     }
@@ -303,19 +473,48 @@ bool effects_enabled() {
     return false;
 }
 
-int configure_proxy_capture(struct mixer *mixer, int value) {
+/* Called with lock held */
+static void close_proxy_mixer_l() {
+    if (proxy_mixer != NULL)
+        mixer_close(proxy_mixer);
+    proxy_mixer = NULL;
+    proxy_mixer_card = -1;
+    proxy_ctl = NULL;
+}
+
+/* Called with lock held */
+static struct mixer *get_proxy_mixer_l(int card) {
+    if (proxy_mixer != NULL && proxy_mixer_card != card)
+        close_proxy_mixer_l();
+    if (proxy_mixer == NULL) {
+        proxy_mixer = mixer_open(card);
+        if (proxy_mixer != NULL)
+            proxy_mixer_card = card;
+    }
+    return proxy_mixer;
+}
+
+/* Called with lock held */
+int configure_proxy_capture(int value) {
     const char *proxy_ctl_name = "AFE_PCM_RX Audio Mixer MultiMedia4";
-    struct mixer_ctl *ctl;
+    struct mixer *mixer;
 
     if (value && acdb_send_audio_cal)
         acdb_send_audio_cal(AFE_PROXY_ACDB_ID, ACDB_DEV_TYPE_OUT);
 
-    ctl = mixer_get_ctl_by_name(mixer, proxy_ctl_name);
-    if (ctl == NULL) {
+    mixer = get_proxy_mixer_l(capture_config.snd_card_num);
+    if (mixer == NULL) {
+        ALOGW("%s: could not open mixer for card %d", __func__,
+              capture_config.snd_card_num);
+        return -ENODEV;
+    }
+    if (proxy_ctl == NULL)
+        proxy_ctl = mixer_get_ctl_by_name(mixer, proxy_ctl_name);
+    if (proxy_ctl == NULL) {
         ALOGW("%s: could not get %s ctl", __func__, proxy_ctl_name);
         return -EINVAL;
     }
-    if (mixer_ctl_set_value(ctl, 0, value) != 0)
+    if (mixer_ctl_set_value(proxy_ctl, 0, value) != 0)
         ALOGW("%s: error setting value %d on %s ", __func__, value, proxy_ctl_name);
 
     return 0;
@@ -329,8 +528,8 @@ void *capture_thread_loop(void *arg __unused)
     buf.frameCount = AUDIO_CAPTURE_PERIOD_SIZE;
     buf.s16 = data;
     bool capture_enabled = false;
-    struct mixer *mixer;
     struct pcm *pcm = NULL;
+    process_snapshot_t *snapshot;
     int ret;
     int retry_num = 0;
 
@@ -340,13 +539,12 @@ void *capture_thread_loop(void *arg __unused)
 
     pthread_mutex_lock(&lock);
 
-    mixer = mixer_open(capture_config.snd_card_num);
-    while (mixer == NULL && retry_num < RETRY_NUMBER) {
+    while (get_proxy_mixer_l(capture_config.snd_card_num) == NULL &&
+           retry_num < RETRY_NUMBER) {
         usleep(RETRY_US);
-        mixer = mixer_open(capture_config.snd_card_num);
         retry_num++;
     }
-    if (mixer == NULL) {
+    if (proxy_mixer == NULL) {
         pthread_mutex_unlock(&lock);
         return NULL;
     }
@@ -357,7 +555,7 @@ void *capture_thread_loop(void *arg __unused)
         }
         if (effects_enabled()) {
             if (!capture_enabled) {
-                ret = configure_proxy_capture(mixer, 1);
+                ret = configure_proxy_capture(1);
                 if (ret == 0) {
                     pcm = pcm_open(capture_config.snd_card_num,
                                    capture_config.capture_device_id,
@@ -366,7 +564,7 @@ void *capture_thread_loop(void *arg __unused)
                         ALOGW("%s: %s", __func__, pcm_get_error(pcm));
                         pcm_close(pcm);
                         pcm = NULL;
-                        configure_proxy_capture(mixer, 0);
+                        configure_proxy_capture(0);
                     } else {
                         capture_enabled = true;
                         ALOGD("%s: capture ENABLED", __func__);
@@ -377,7 +575,7 @@ void *capture_thread_loop(void *arg __unused)
             if (capture_enabled) {
                 if (pcm != NULL)
                     pcm_close(pcm);
-                configure_proxy_capture(mixer, 0);
+                configure_proxy_capture(0);
                 ALOGD("%s: capture DISABLED", __func__);
                 capture_enabled = false;
             }
@@ -386,42 +584,42 @@ void *capture_thread_loop(void *arg __unused)
         if (!capture_enabled)
             continue;
 
+        /* capture and process without lock for as long as effects are enabled: the control
+         * path publishes an empty snapshot when the last effect is disabled or detached */
         pthread_mutex_unlock(&lock);
-        ret = pcm_mmap_read(pcm, data, sizeof(data));
-        pthread_mutex_lock(&lock);
-
-        if (ret == 0) {
-            struct listnode *out_node;
-
-            list_for_each(out_node, &active_outputs_list) {
-                output_context_t *out_ctxt = node_to_item(out_node,
-                                                          output_context_t,
-                                                          outputs_list_node);
-                struct listnode *fx_node;
-
-                list_for_each(fx_node, &out_ctxt->effects_list) {
-                    effect_context_t *fx_ctxt = node_to_item(fx_node,
-                                                                effect_context_t,
-                                                                output_node);
-                    if (fx_ctxt->ops.process != NULL)
+        do {
+            ret = pcm_mmap_read(pcm, data, sizeof(data));
+            if (ret == 0)
+                capture_period++;
+
+            pthread_mutex_lock(&process_lock);
+            snapshot = atomic_load_explicit(&process_snapshot, memory_order_acquire);
+            if (snapshot != NULL && ret == 0) {
+                int i;
+
+                for (i = 0; i < snapshot->count; i++) {
+                    effect_context_t *fx_ctxt = snapshot->effects[i];
+                    if (effect_exists(fx_ctxt))
                         fx_ctxt->ops.process(fx_ctxt, &buf, &buf);
                 }
             }
-        } else {
-            ALOGW("%s: read status %d %s", __func__, ret, pcm_get_error(pcm));
-        }
+            pthread_mutex_unlock(&process_lock);
+
+            if (ret != 0)
+                ALOGW("%s: read status %d %s", __func__, ret, pcm_get_error(pcm));
+        } while (snapshot != NULL);
+        pthread_mutex_lock(&lock);
     }
 
     if (capture_enabled) {
         if (pcm != NULL)
             pcm_close(pcm);
-        configure_proxy_capture(mixer, 0);
+        configure_proxy_capture(0);
     }
-    mixer_close(mixer);
+    ALOGD("thread exit, %u snapshots published, %u waits for processing",
+          snapshot_publishes, process_lock_waits);
     pthread_mutex_unlock(&lock);
 
-    ALOGD("thread exit");
-
     return NULL;
 }
 
@@ -473,6 +671,7 @@ int visualizer_hal_start_output(audio_io_handle_t output, int pcm_id,
                         capture_thread_loop, NULL);
     }
     list_add_tail(&active_outputs_list, &out_ctxt->outputs_list_node);
+    publish_process_snapshot_l();
     pthread_cond_signal(&cond);
 
 exit:
@@ -510,6 +709,7 @@ int visualizer_hal_stop_output(audio_io_handle_t output, int pcm_id) {
             fx_ctxt->ops.stop(fx_ctxt, out_ctxt);
     }
     list_remove(&out_ctxt->outputs_list_node);
+    publish_process_snapshot_l();
     pthread_cond_signal(&cond);
 
     if (list_empty(&active_outputs_list)) {
@@ -531,6 +731,40 @@ exit:
     return ret;
 }
 
+/*
+ * Called by the audio HAL when the sound card goes offline or comes back
+ * online: the cached proxy mixer handle and control are no longer valid.
+ */
+__attribute__ ((visibility ("default")))
+int visualizer_hal_set_card_status(int card, int status) {
+    ALOGV("%s card %d status %d", __func__, card, status);
+
+    if (lib_init() != 0)
+        return init_status;
+
+    pthread_mutex_lock(&lock);
+    if (proxy_mixer_card == card)
+        close_proxy_mixer_l();
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
+/*
+ * Called by the audio HAL from its dump() to report the capture thread statistics.
+ */
+__attribute__ ((visibility ("default")))
+int visualizer_hal_dump(int fd) {
+    if (lib_init() != 0)
+        return init_status;
+
+    pthread_mutex_lock(&lock);
+    dprintf(fd, "  Offload visualizer:\n");
+    dprintf(fd, "    Snapshots published: %u\n", snapshot_publishes);
+    dprintf(fd, "    Waits for processing: %u\n", process_lock_waits);
+    pthread_mutex_unlock(&lock);
+    return 0;
+}
+
 
 /*
  * Effect operations
@@ -564,13 +798,13 @@ void get_config(effect_context_t *context, effect_config_t *config)
  * Visualizer operations
  */
 
-uint32_t visualizer_get_delta_time_ms_from_updated_time(visualizer_context_t* visu_ctxt) {
+static uint32_t get_delta_time_ms(const struct timespec *time) {
     uint32_t delta_ms = 0;
-    if (visu_ctxt->buffer_update_time.tv_sec != 0) {
+    if (time->tv_sec != 0) {
         struct timespec ts;
         if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0) {
-            time_t secs = ts.tv_sec - visu_ctxt->buffer_update_time.tv_sec;
-            long nsec = ts.tv_nsec - visu_ctxt->buffer_update_time.tv_nsec;
+            time_t secs = ts.tv_sec - time->tv_sec;
+            long nsec = ts.tv_nsec - time->tv_nsec;
             if (nsec < 0) {
                 --secs;
                 nsec += 1000000000;
@@ -581,15 +815,88 @@ uint32_t visualizer_get_delta_time_ms_from_updated_time(visualizer_context_t* vi
     return delta_ms;
 }
 
+uint32_t visualizer_get_delta_time_ms_from_updated_time(visualizer_context_t* visu_ctxt) {
+    return get_delta_time_ms(&visu_ctxt->buffer_update_time);
+}
+
+/* Summarizes the measurement window into a result. Called from process() or with
+ * process_lock held */
+static void visualizer_summarize_meas(visualizer_context_t *visu_ctxt,
+                                      visualizer_result_t *result) {
+    uint32_t i;
+
+    /* only use actual measurements, otherwise the first RMS measure happening before
+     * MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS have been played will always be artificially
+     * low */
+    result->peak_u16 = 0;
+    result->sum_rms_squared = 0.0f;
+    result->nb_valid_meas = 0;
+    for (i=0 ; i < visu_ctxt->meas_wndw_size_in_buffers ; i++) {
+        if (visu_ctxt->past_meas[i].is_valid) {
+            if (visu_ctxt->past_meas[i].peak_u16 > result->peak_u16) {
+                result->peak_u16 = visu_ctxt->past_meas[i].peak_u16;
+            }
+            result->sum_rms_squared += visu_ctxt->past_meas[i].rms_squared;
+            result->nb_valid_meas++;
+        }
+    }
+}
+
+/* Empties all result slots. Called with lock and process_lock held */
+static void visualizer_reset_results(visualizer_context_t *visu_ctxt) {
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        visu_ctxt->results[i].update_time.tv_sec = 0;
+        visu_ctxt->results[i].update_time.tv_nsec = 0;
+        memset(visu_ctxt->results[i].capture, 0x80, RESULT_CAPTURE_SIZE);
+        visualizer_summarize_meas(visu_ctxt, &visu_ctxt->results[i]);
+    }
+    visu_ctxt->result_back = 0;
+    visu_ctxt->result_front = 1;
+    atomic_store_explicit(&visu_ctxt->result_middle, 2, memory_order_release);
+}
+
+/* Publishes the capture and measurements of the buffer just processed. Called from process() */
+static void visualizer_publish_result(visualizer_context_t *visu_ctxt) {
+    visualizer_result_t *result = &visu_ctxt->results[visu_ctxt->result_back];
+    /* the last RESULT_CAPTURE_SIZE bytes before capture_idx, which may wrap */
+    uint32_t first = (visu_ctxt->capture_idx + CAPTURE_BUF_SIZE - RESULT_CAPTURE_SIZE) %
+            CAPTURE_BUF_SIZE;
+    uint32_t size = CAPTURE_BUF_SIZE - first;
+
+    if (size > RESULT_CAPTURE_SIZE)
+        size = RESULT_CAPTURE_SIZE;
+    memcpy(result->capture, visu_ctxt->capture_buf + first, size);
+    memcpy(result->capture + size, visu_ctxt->capture_buf, RESULT_CAPTURE_SIZE - size);
+    result->update_time = visu_ctxt->buffer_update_time;
+    visualizer_summarize_meas(visu_ctxt, result);
+
+    visu_ctxt->result_back = atomic_exchange_explicit(&visu_ctxt->result_middle,
+            visu_ctxt->result_back | RESULT_NEW, memory_order_acq_rel) & ~RESULT_NEW;
+}
+
+/* Returns the last published result and whether it is new since the previous call. Called
+ * with lock held */
+static const visualizer_result_t *visualizer_get_result(visualizer_context_t *visu_ctxt,
+                                                        bool *is_new) {
+    *is_new = (atomic_load_explicit(&visu_ctxt->result_middle, memory_order_relaxed) &
+            RESULT_NEW) != 0;
+    if (*is_new)
+        visu_ctxt->result_front = atomic_exchange_explicit(&visu_ctxt->result_middle,
+                visu_ctxt->result_front, memory_order_acq_rel) & ~RESULT_NEW;
+    return &visu_ctxt->results[visu_ctxt->result_front];
+}
+
 int visualizer_reset(effect_context_t *context)
 {
     visualizer_context_t * visu_ctxt = (visualizer_context_t *)context;
 
     visu_ctxt->capture_idx = 0;
-    visu_ctxt->last_capture_idx = 0;
     visu_ctxt->buffer_update_time.tv_sec = 0;
     visu_ctxt->latency = DSP_OUTPUT_LATENCY_MS;
     memset(visu_ctxt->capture_buf, 0x80, CAPTURE_BUF_SIZE);
+    visualizer_reset_results(visu_ctxt);
     return 0;
 }
 
@@ -632,25 +939,13 @@ int visualizer_init(effect_context_t *context)
 
     set_config(context, &context->config);
 
-    if (acdb_handle == NULL) {
-        acdb_handle = dlopen(LIB_ACDB_LOADER, RTLD_NOW);
-        if (acdb_handle == NULL) {
-            ALOGE("%s: DLOPEN failed for %s", __func__, LIB_ACDB_LOADER);
-        } else {
-            acdb_send_audio_cal = (acdb_send_audio_cal_t)dlsym(acdb_handle,
-                                                    "acdb_loader_send_audio_cal");
-            if (!acdb_send_audio_cal)
-                ALOGE("%s: Could not find the symbol acdb_send_audio_cal from %s",
-                      __func__, LIB_ACDB_LOADER);
-            }
-    }
-
     return 0;
 }
 
 int visualizer_get_parameter(effect_context_t *context, effect_param_t *p, uint32_t *size)
 {
     visualizer_context_t *visu_ctxt = (visualizer_context_t *)context;
+    const uint32_t reply_size = *size;
 
     p->status = 0;
     *size = sizeof(effect_param_t) + sizeof(uint32_t);
@@ -677,6 +972,27 @@ int visualizer_get_parameter(effect_context_t *context, effect_param_t *p, uint3
         p->vsize = sizeof(uint32_t);
         *size += sizeof(uint32_t);
         break;
+    case VISUALIZER_PARAM_SPECTRUM: {
+        int32_t *spectrum = (int32_t *)p->data + 1;
+        int i;
+
+        if (reply_size < *size + sizeof(spectrum_mb) ||
+                !(visu_ctxt->meas_mode & MEASUREMENT_MODE_SPECTRUM)) {
+            p->status = -EINVAL;
+            break;
+        }
+        /* return silence when audio is not flowing anymore */
+        if (spectrum_valid && context->state == EFFECT_STATE_ACTIVE &&
+                visualizer_get_delta_time_ms_from_updated_time(visu_ctxt) <= MAX_STALL_TIME_MS &&
+                visu_ctxt->buffer_update_time.tv_sec != 0) {
+            memcpy(spectrum, spectrum_mb, sizeof(spectrum_mb));
+        } else {
+            for (i = 0; i < VISUALIZER_SPECTRUM_BINS; i++)
+                spectrum[i] = -9600;
+        }
+        p->vsize = sizeof(spectrum_mb);
+        *size += sizeof(spectrum_mb);
+        } break;
     default:
         p->status = -EINVAL;
     }
@@ -692,6 +1008,8 @@ int visualizer_set_parameter(effect_context_t *context, effect_param_t *p, uint3
 
     switch (*(uint32_t *)p->data) {
     case VISUALIZER_PARAM_CAPTURE_SIZE:
+        if (*((uint32_t *)p->data + 1) > VISUALIZER_CAPTURE_SIZE_MAX)
+            return -EINVAL;
         visu_ctxt->capture_size = *((uint32_t *)p->data + 1);
         ALOGV("%s set capture_size = %d", __func__, visu_ctxt->capture_size);
         break;
@@ -714,16 +1032,181 @@ int visualizer_set_parameter(effect_context_t *context, effect_param_t *p, uint3
     return 0;
 }
 
-/* Real process function called from capture thread. Called with lock held */
+/* Peak and sum of squares of a buffer of 16 bit samples for the measurements. The squares are
+ * accumulated in float, sample by sample, which does not vectorize without changing the result.
+ * Also returns the largest value of smp < 0 ? -smp - 1 : smp for the capture scaling, so that
+ * the buffer is only read once before the downmix. */
+static void visualizer_measure(const int16_t *in, uint32_t count, int16_t *peak,
+                               float *rms_squared_acc, int32_t *max_norm) {
+    int16_t max_sample = 0;
+    float acc = 0;
+    int32_t norm = 0;
+    uint32_t i;
+
+    for (i = 0 ; i < count ; i++) {
+        if (in[i] > max_sample) {
+            max_sample = in[i];
+        } else if (-in[i] > max_sample) {
+            max_sample = -in[i];
+        }
+        acc += (in[i] * in[i]);
+        int32_t smp = in[i];
+        if (smp < 0) smp = -smp - 1;
+        if (smp > norm) norm = smp;
+    }
+    *peak = max_sample;
+    *rms_squared_acc = acc;
+    *max_norm = norm;
+}
+
+/* Largest value of smp < 0 ? -smp - 1 : smp in a buffer of 16 bit samples, for the capture
+ * scaling when no measurement is requested */
+static int32_t visualizer_get_max_norm(const int16_t *in, uint32_t count) {
+    int32_t max_norm = 0;
+    uint32_t i = 0;
+
+#if defined(VISUALIZER_USE_NEON)
+    int16x8_t vmax_norm = vdupq_n_s16(0);
+
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16(in + i);
+        vmax_norm = vmaxq_s16(vmax_norm, veorq_s16(x, vshrq_n_s16(x, 15)));
+    }
+    {
+        int16_t lanes[8];
+        int j;
+
+        vst1q_s16(lanes, vmax_norm);
+        for (j = 0; j < 8; j++)
+            if (lanes[j] > max_norm) max_norm = lanes[j];
+    }
+#elif defined(VISUALIZER_USE_SSE2)
+    __m128i vmax_norm = _mm_setzero_si128();
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(in + i));
+        vmax_norm = _mm_max_epi16(vmax_norm, _mm_xor_si128(x, _mm_srai_epi16(x, 15)));
+    }
+    {
+        int16_t lanes[8];
+        int j;
+
+        _mm_storeu_si128((__m128i *)lanes, vmax_norm);
+        for (j = 0; j < 8; j++)
+            if (lanes[j] > max_norm) max_norm = lanes[j];
+    }
+#endif
+    for (; i < count; i++) {
+        int32_t smp = in[i];
+        if (smp < 0) smp = -smp - 1;
+        if (smp > max_norm) max_norm = smp;
+    }
+    return max_norm;
+}
+
+/* Downmixes stereo frames to 8 bit unsigned capture samples: ((L + R) >> shift) ^ 0x80 */
+static void visualizer_downmix_to_u8(const int16_t *in, uint8_t *out, uint32_t frames,
+                                     int32_t shift) {
+    uint32_t i = 0;
+
+#if defined(VISUALIZER_USE_NEON)
+    const int32x4_t vshift = vdupq_n_s32(-shift);
+    const uint8x8_t bias = vdup_n_u8(0x80);
+
+    for (; i + 8 <= frames; i += 8) {
+        int32x4_t lo = vshlq_s32(vpaddlq_s16(vld1q_s16(in + 2 * i)), vshift);
+        int32x4_t hi = vshlq_s32(vpaddlq_s16(vld1q_s16(in + 2 * i + 8)), vshift);
+        /* narrowing keeps the low bits, as the (uint8_t) cast does */
+        int8x8_t smp = vmovn_s16(vcombine_s16(vmovn_s32(lo), vmovn_s32(hi)));
+        vst1_u8(out + i, veor_u8(vreinterpret_u8_s8(smp), bias));
+    }
+#elif defined(VISUALIZER_USE_SSE2)
+    const __m128i ones = _mm_set1_epi16(1);
+    const __m128i low_byte = _mm_set1_epi32(0xff);
+    const __m128i bias = _mm_set1_epi8((char)0x80);
+    const __m128i vshift = _mm_cvtsi32_si128(shift);
+
+    for (; i + 16 <= frames; i += 16) {
+        __m128i s0 = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(in + 2 * i)), ones);
+        __m128i s1 = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(in + 2 * i + 8)), ones);
+        __m128i s2 = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(in + 2 * i + 16)), ones);
+        __m128i s3 = _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(in + 2 * i + 24)), ones);
+        /* keep the low byte before packing so that packing does not saturate */
+        s0 = _mm_and_si128(_mm_sra_epi32(s0, vshift), low_byte);
+        s1 = _mm_and_si128(_mm_sra_epi32(s1, vshift), low_byte);
+        s2 = _mm_and_si128(_mm_sra_epi32(s2, vshift), low_byte);
+        s3 = _mm_and_si128(_mm_sra_epi32(s3, vshift), low_byte);
+        __m128i smp = _mm_packus_epi16(_mm_packs_epi32(s0, s1), _mm_packs_epi32(s2, s3));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_xor_si128(smp, bias));
+    }
+#endif
+    for (; i < frames; i++) {
+        int32_t smp = in[2 * i] + in[2 * i + 1];
+        smp = smp >> shift;
+        out[i] = ((uint8_t)smp)^0x80;
+    }
+}
+
+/* Computes spectrum_mb from the last VISUALIZER_SPECTRUM_FFT_SIZE frames of a stereo 16 bit
+ * buffer, downmixed to mono. Called from the capture thread only */
+static void visualizer_compute_spectrum(const int16_t *in, uint32_t frames) {
+    float re[VISUALIZER_SPECTRUM_FFT_SIZE];
+    float im[VISUALIZER_SPECTRUM_FFT_SIZE];
+    const uint32_t n = VISUALIZER_SPECTRUM_FFT_SIZE;
+    uint32_t first = frames > n ? frames - n : 0;
+    uint32_t i, j, len;
+
+    /* windowed input in bit reversed order */
+    for (i = 0, j = 0; i < n; i++) {
+        float smp = 0;
+        if (first + i < frames)
+            smp = (in[2 * (first + i)] + in[2 * (first + i) + 1]) * 0.5f;
+        re[j] = smp * spectrum_window[i];
+        im[j] = 0;
+        uint32_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j |= bit;
+    }
+
+    /* iterative radix-2 FFT */
+    for (len = 2; len <= n; len <<= 1) {
+        uint32_t half = len >> 1;
+        uint32_t step = n / len;
+        for (i = 0; i < n; i += len) {
+            for (j = 0; j < half; j++) {
+                float wr = spectrum_cos[j * step];
+                float wi = spectrum_sin[j * step];
+                float xr = re[i + j + half] * wr - im[i + j + half] * wi;
+                float xi = re[i + j + half] * wi + im[i + j + half] * wr;
+                re[i + j + half] = re[i + j] - xr;
+                im[i + j + half] = im[i + j] - xi;
+                re[i + j] += xr;
+                im[i + j] += xi;
+            }
+        }
+    }
+
+    /* a full scale sine has a magnitude of 32767 * window gain / 2 */
+    const float scale = 2.0f / (spectrum_window_gain * 32767.0f);
+    for (i = 0; i < VISUALIZER_SPECTRUM_BINS; i++) {
+        float mag = sqrtf(re[i] * re[i] + im[i] * im[i]) * scale;
+        if (mag < 0.000016f)
+            spectrum_mb[i] = -9600; //-96dB
+        else
+            spectrum_mb[i] = (int32_t)(2000 * log10f(mag));
+    }
+    spectrum_valid = true;
+}
+
+/* Real process function called from capture thread. Called with process_lock held: the context
+ * is part of the published snapshot and cannot be released until this returns */
 int visualizer_process(effect_context_t *context,
                        audio_buffer_t *inBuffer,
                        audio_buffer_t *outBuffer)
 {
     visualizer_context_t *visu_ctxt = (visualizer_context_t *)context;
 
-    if (!effect_exists(context))
-        return -EINVAL;
-
     if (inBuffer == NULL || inBuffer->raw == NULL ||
         outBuffer == NULL || outBuffer->raw == NULL ||
         inBuffer->frameCount != outBuffer->frameCount ||
@@ -731,45 +1214,55 @@ int visualizer_process(effect_context_t *context,
         return -EINVAL;
     }
 
+    /* all code below assumes stereo 16 bit PCM output and input */
+    const uint32_t sample_count = inBuffer->frameCount * 2;
+    int32_t max_norm = -1;
+    int32_t shift;
+
+    /* one spectrum per capture period, whatever the number of visualizers requesting it */
+    if ((visu_ctxt->meas_mode & MEASUREMENT_MODE_SPECTRUM) &&
+            (!spectrum_valid || spectrum_period != capture_period)) {
+        visualizer_compute_spectrum(inBuffer->s16, inBuffer->frameCount);
+        spectrum_period = capture_period;
+    }
+
     // perform measurements if needed
     if (visu_ctxt->meas_mode & MEASUREMENT_MODE_PEAK_RMS) {
-        // find the peak and RMS squared for the new buffer
-        uint32_t inIdx;
-        int16_t max_sample = 0;
-        float rms_squared_acc = 0;
-        for (inIdx = 0 ; inIdx < inBuffer->frameCount * visu_ctxt->channel_count ; inIdx++) {
-            if (inBuffer->s16[inIdx] > max_sample) {
-                max_sample = inBuffer->s16[inIdx];
-            } else if (-inBuffer->s16[inIdx] > max_sample) {
-                max_sample = -inBuffer->s16[inIdx];
+        /* reset measurements if last measurement was too long ago (which implies stored
+         * measurements aren't relevant anymore and shouldn't bias the new one) */
+        if (visualizer_get_delta_time_ms_from_updated_time(visu_ctxt) >
+                DISCARD_MEASUREMENTS_TIME_MS) {
+            uint32_t i;
+            ALOGV("Discarding measurements, last measurement is too old");
+            for (i=0 ; i<visu_ctxt->meas_wndw_size_in_buffers ; i++) {
+                visu_ctxt->past_meas[i].is_valid = false;
+                visu_ctxt->past_meas[i].peak_u16 = 0;
+                visu_ctxt->past_meas[i].rms_squared = 0;
             }
-            rms_squared_acc += (inBuffer->s16[inIdx] * inBuffer->s16[inIdx]);
+            visu_ctxt->meas_buffer_idx = 0;
         }
+        // find the peak and RMS squared for the new buffer
+        int16_t max_sample;
+        float rms_squared_acc;
+        visualizer_measure(inBuffer->s16, sample_count, &max_sample, &rms_squared_acc,
+                           &max_norm);
         // store the measurement
         visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].peak_u16 = (uint16_t)max_sample;
         visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].rms_squared =
-                rms_squared_acc / (inBuffer->frameCount * visu_ctxt->channel_count);
+                rms_squared_acc / sample_count;
         visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].is_valid = true;
         if (++visu_ctxt->meas_buffer_idx >= visu_ctxt->meas_wndw_size_in_buffers) {
             visu_ctxt->meas_buffer_idx = 0;
         }
     }
 
-    /* all code below assumes stereo 16 bit PCM output and input */
-    int32_t shift;
-
     if (visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_NORMALIZED) {
         /* derive capture scaling factor from peak value in current buffer
-         * this gives more interesting captures for display. */
-        shift = 32;
-        int len = inBuffer->frameCount * 2;
-        int i;
-        for (i = 0; i < len; i++) {
-            int32_t smp = inBuffer->s16[i];
-            if (smp < 0) smp = -smp - 1; /* take care to keep the max negative in range */
-            int32_t clz = __builtin_clz(smp);
-            if (shift > clz) shift = clz;
-        }
+         * this gives more interesting captures for display.
+         * The smallest leading zero count is the one of the largest value. */
+        if (max_norm < 0)
+            max_norm = visualizer_get_max_norm(inBuffer->s16, sample_count);
+        shift = max_norm == 0 ? 32 : __builtin_clz(max_norm);
         /* A maximum amplitude signal will have 17 leading zeros, which we want to
          * translate to a shift of 8 (for converting 16 bit to 8 bit) */
         shift = 25 - shift;
@@ -785,28 +1278,33 @@ int visualizer_process(effect_context_t *context,
         shift = 9;
     }
 
-    uint32_t capt_idx;
-    uint32_t in_idx;
-    uint8_t *buf = visu_ctxt->capture_buf;
-    for (in_idx = 0, capt_idx = visu_ctxt->capture_idx;
-         in_idx < inBuffer->frameCount;
-         in_idx++, capt_idx++) {
-        if (capt_idx >= CAPTURE_BUF_SIZE) {
+    /* downmix in contiguous runs up to the end of the capture ring buffer */
+    uint32_t capt_idx = visu_ctxt->capture_idx;
+    uint32_t in_idx = 0;
+    if (capt_idx >= CAPTURE_BUF_SIZE) {
+        /* wrap around */
+        capt_idx = 0;
+    }
+    while (in_idx < inBuffer->frameCount) {
+        uint32_t frames = inBuffer->frameCount - in_idx;
+        if (frames > CAPTURE_BUF_SIZE - capt_idx)
+            frames = CAPTURE_BUF_SIZE - capt_idx;
+        visualizer_downmix_to_u8(inBuffer->s16 + 2 * in_idx, visu_ctxt->capture_buf + capt_idx,
+                                 frames, shift);
+        in_idx += frames;
+        capt_idx += frames;
+        if (capt_idx >= CAPTURE_BUF_SIZE && in_idx < inBuffer->frameCount) {
             /* wrap around */
             capt_idx = 0;
         }
-        int32_t smp = inBuffer->s16[2 * in_idx] + inBuffer->s16[2 * in_idx + 1];
-        smp = smp >> shift;
-        buf[capt_idx] = ((uint8_t)smp)^0x80;
     }
 
-    /* XXX the following two should really be atomic, though it probably doesn't
-     * matter much for visualization purposes */
     visu_ctxt->capture_idx = capt_idx;
     /* update last buffer update time stamp */
     if (clock_gettime(CLOCK_MONOTONIC, &visu_ctxt->buffer_update_time) < 0) {
         visu_ctxt->buffer_update_time.tv_sec = 0;
     }
+    visualizer_publish_result(visu_ctxt);
 
     if (context->state != EFFECT_STATE_ACTIVE) {
         ALOGV("%s DONE inactive", __func__);
@@ -833,47 +1331,29 @@ int visualizer_command(effect_context_t * context, uint32_t cmdCode, uint32_t cm
             break;
 
         if (context->state == EFFECT_STATE_ACTIVE) {
+            bool is_new;
+            const visualizer_result_t *result = visualizer_get_result(visu_ctxt, &is_new);
             int32_t latency_ms = visu_ctxt->latency;
-            const uint32_t delta_ms = visualizer_get_delta_time_ms_from_updated_time(visu_ctxt);
+            const uint32_t delta_ms = get_delta_time_ms(&result->update_time);
             if (latency_ms < delta_ms) {
                 latency_ms = 0;
             } else {
                 latency_ms -= delta_ms;
             }
-            const uint32_t delta_smp = context->config.inputCfg.samplingRate * latency_ms / 1000;
-
-            int32_t capture_point = 0;
-            __builtin_sub_overflow(visu_ctxt->capture_idx, visu_ctxt->capture_size + delta_smp,
-                                   &capture_point);
-            int32_t capture_size = visu_ctxt->capture_size;
-            if (capture_point < 0) {
-                int32_t size = -capture_point;
-                if (size > capture_size)
-                    size = capture_size;
-
-                memcpy(pReplyData,
-                       visu_ctxt->capture_buf + CAPTURE_BUF_SIZE + capture_point,
-                       size);
-                pReplyData = (void *)((size_t)pReplyData + size);
-                capture_size -= size;
-                capture_point = 0;
-            }
-            memcpy(pReplyData,
-                   visu_ctxt->capture_buf + capture_point,
-                   capture_size);
-
+            uint32_t delta_smp = context->config.inputCfg.samplingRate * latency_ms / 1000;
+            if (delta_smp > RESULT_CAPTURE_SIZE - visu_ctxt->capture_size)
+                delta_smp = RESULT_CAPTURE_SIZE - visu_ctxt->capture_size;
 
             /* if audio framework has stopped playing audio although the effect is still
-             * active we must clear the capture buffer to return silence */
-            if ((visu_ctxt->last_capture_idx == visu_ctxt->capture_idx) &&
-                    (visu_ctxt->buffer_update_time.tv_sec != 0)) {
-                if (delta_ms > MAX_STALL_TIME_MS) {
-                    ALOGV("%s capture going to idle", __func__);
-                    visu_ctxt->buffer_update_time.tv_sec = 0;
-                    memset(pReplyData, 0x80, visu_ctxt->capture_size);
-                }
+             * active we must return silence */
+            if (!is_new && result->update_time.tv_sec != 0 && delta_ms > MAX_STALL_TIME_MS) {
+                ALOGV("%s capture going to idle", __func__);
+                memset(pReplyData, 0x80, visu_ctxt->capture_size);
+            } else {
+                memcpy(pReplyData,
+                       result->capture + RESULT_CAPTURE_SIZE - visu_ctxt->capture_size - delta_smp,
+                       visu_ctxt->capture_size);
             }
-            visu_ctxt->last_capture_idx = visu_ctxt->capture_idx;
         } else {
             memset(pReplyData, 0x80, visu_ctxt->capture_size);
         }
@@ -892,35 +1372,20 @@ int visualizer_command(effect_context_t * context, uint32_t cmdCode, uint32_t cm
             android_errorWriteLog(0x534e4554, "30229821");
             return -EINVAL;
         }
+        bool is_new;
+        const visualizer_result_t *result = visualizer_get_result(visu_ctxt, &is_new);
         uint16_t peak_u16 = 0;
         float sum_rms_squared = 0.0f;
         uint8_t nb_valid_meas = 0;
-        /* reset measurements if last measurement was too long ago (which implies stored
-         * measurements aren't relevant anymore and shouldn't bias the new one) */
-        const int32_t delay_ms = visualizer_get_delta_time_ms_from_updated_time(visu_ctxt);
+        /* ignore measurements if last measurement was too long ago: process() discards them
+         * when the next buffer comes */
+        const int32_t delay_ms = get_delta_time_ms(&result->update_time);
         if (delay_ms > DISCARD_MEASUREMENTS_TIME_MS) {
-            uint32_t i;
             ALOGV("Discarding measurements, last measurement is %dms old", delay_ms);
-            for (i=0 ; i<visu_ctxt->meas_wndw_size_in_buffers ; i++) {
-                visu_ctxt->past_meas[i].is_valid = false;
-                visu_ctxt->past_meas[i].peak_u16 = 0;
-                visu_ctxt->past_meas[i].rms_squared = 0;
-            }
-            visu_ctxt->meas_buffer_idx = 0;
         } else {
-            /* only use actual measurements, otherwise the first RMS measure happening before
-             * MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS have been played will always be artificially
-             * low */
-            uint32_t i;
-            for (i=0 ; i < visu_ctxt->meas_wndw_size_in_buffers ; i++) {
-                if (visu_ctxt->past_meas[i].is_valid) {
-                    if (visu_ctxt->past_meas[i].peak_u16 > peak_u16) {
-                        peak_u16 = visu_ctxt->past_meas[i].peak_u16;
-                    }
-                    sum_rms_squared += visu_ctxt->past_meas[i].rms_squared;
-                    nb_valid_meas++;
-                }
-            }
+            peak_u16 = result->peak_u16;
+            sum_rms_squared = result->sum_rms_squared;
+            nb_valid_meas = result->nb_valid_meas;
         }
         float rms = nb_valid_meas == 0 ? 0.0f : sqrtf(sum_rms_squared / nb_valid_meas);
         int32_t* p_int_reply_data = (int32_t*)pReplyData;
@@ -1004,7 +1469,9 @@ int effect_lib_create(const effect_uuid_t *uuid,
     context->state = EFFECT_STATE_INITIALIZED;
 
     pthread_mutex_lock(&lock);
+    pthread_mutex_lock(&process_lock);
     list_add_tail(&created_effects_list, &context->effects_list_node);
+    pthread_mutex_unlock(&process_lock);
     output_context_t *out_ctxt = get_output(ioId);
     if (out_ctxt != NULL)
         add_effect_to_output(out_ctxt, context);
@@ -1032,7 +1499,9 @@ int effect_lib_release(effect_handle_t handle) {
         output_context_t *out_ctxt = get_output(context->out_handle);
         if (out_ctxt != NULL)
             remove_effect_from_output(out_ctxt, context);
+        pthread_mutex_lock(&process_lock);
         list_remove(&context->effects_list_node);
+        pthread_mutex_unlock(&process_lock);
         if (context->ops.release)
             context->ops.release(context);
         free(context);
@@ -1102,6 +1571,7 @@ int effect_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
     effect_context_t * context = (effect_context_t *)self;
     int retsize;
     int status = 0;
+    bool process_locked = false;
 
     pthread_mutex_lock(&lock);
 
@@ -1115,6 +1585,17 @@ int effect_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
         goto exit;
     }
 
+    /* The capture thread processes the effect with process_lock held only. Commands changing
+     * the attached effects take process_lock themselves before publishing a new snapshot,
+     * captures and measurements read the results process() publishes for them, all others read
+     * or modify state shared with process() */
+    if (cmdCode != EFFECT_CMD_ENABLE && cmdCode != EFFECT_CMD_DISABLE &&
+            cmdCode != EFFECT_CMD_OFFLOAD && cmdCode != VISUALIZER_CMD_CAPTURE &&
+            cmdCode != VISUALIZER_CMD_MEASURE) {
+        pthread_mutex_lock(&process_lock);
+        process_locked = true;
+    }
+
 //    ALOGV_IF(cmdCode != VISUALIZER_CMD_CAPTURE,
 //             "%s command %d cmdSize %d", __func__, cmdCode, cmdSize);
 
@@ -1163,9 +1644,12 @@ int effect_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
             status = -ENOSYS;
             goto exit;
         }
+        pthread_mutex_lock(&process_lock);
         context->state = EFFECT_STATE_ACTIVE;
         if (context->ops.enable)
             context->ops.enable(context);
+        pthread_mutex_unlock(&process_lock);
+        publish_process_snapshot_l();
         pthread_cond_signal(&cond);
         ALOGV("%s EFFECT_CMD_ENABLE", __func__);
         *(int *)pReplyData = 0;
@@ -1179,9 +1663,12 @@ int effect_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
             status = -ENOSYS;
             goto exit;
         }
+        pthread_mutex_lock(&process_lock);
         context->state = EFFECT_STATE_INITIALIZED;
         if (context->ops.disable)
             context->ops.disable(context);
+        pthread_mutex_unlock(&process_lock);
+        publish_process_snapshot_l();
         pthread_cond_signal(&cond);
         ALOGV("%s EFFECT_CMD_DISABLE", __func__);
         *(int *)pReplyData = 0;
@@ -1266,6 +1753,8 @@ int effect_command(effect_handle_t self, uint32_t cmdCode, uint32_t cmdSize,
     }
 
 exit:
+    if (process_locked)
+        pthread_mutex_unlock(&process_lock);
     pthread_mutex_unlock(&lock);
 
 //    ALOGV_IF(cmdCode != VISUALIZER_CMD_CAPTURE,"%s DONE", __func__);
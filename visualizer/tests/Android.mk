@@ -0,0 +1,64 @@
+LOCAL_PATH:= $(call my-dir)
+
+# Tests of the offload visualizer, linked against a fake proxy capture card
+# (fake_proxy_card.c) instead of libtinyalsa.
+visualizer_test_cflags := \
+    -Wall \
+    -Werror \
+    -Wno-unused-variable \
+    -Wno-unused-function \
+    -D__unused='__attribute__((unused))'
+
+visualizer_test_includes := \
+	external/tinyalsa/include \
+	$(call include-path-for, audio-effects)
+
+# Capture thread against concurrent effect create/release, run on the host
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES:= \
+	visualizer_stress_test.c \
+	fake_proxy_card.c
+LOCAL_CFLAGS += $(visualizer_test_cflags)
+LOCAL_C_INCLUDES := $(visualizer_test_includes)
+LOCAL_HEADER_LIBRARIES := libhardware_headers libsystem_headers
+LOCAL_STATIC_LIBRARIES := libcutils liblog
+LOCAL_LDLIBS := -lpthread -ldl -lm
+LOCAL_MODULE:= libqcomvisualizer_stress_test
+LOCAL_LICENSE_KINDS:= SPDX-license-identifier-Apache-2.0
+LOCAL_LICENSE_CONDITIONS:= notice
+LOCAL_MODULE_HOST_OS:= linux
+LOCAL_GTEST:= false
+include $(BUILD_HOST_NATIVE_TEST)
+
+# visualizer_process() against a copy of the original scalar loop, bit for bit,
+# and timings of both: SSE2 on the host, NEON on the device
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES:= \
+	visualizer_simd_test.c \
+	fake_proxy_card.c
+LOCAL_CFLAGS += $(visualizer_test_cflags)
+LOCAL_C_INCLUDES := $(visualizer_test_includes)
+LOCAL_HEADER_LIBRARIES := libhardware_headers libsystem_headers
+LOCAL_STATIC_LIBRARIES := libcutils liblog
+LOCAL_LDLIBS := -lpthread -ldl -lm
+LOCAL_MODULE:= libqcomvisualizer_simd_test
+LOCAL_LICENSE_KINDS:= SPDX-license-identifier-Apache-2.0
+LOCAL_LICENSE_CONDITIONS:= notice
+LOCAL_MODULE_HOST_OS:= linux
+LOCAL_GTEST:= false
+include $(BUILD_HOST_NATIVE_TEST)
+
+include $(CLEAR_VARS)
+LOCAL_SRC_FILES:= \
+	visualizer_simd_test.c \
+	fake_proxy_card.c
+LOCAL_CFLAGS += $(visualizer_test_cflags)
+LOCAL_C_INCLUDES := $(visualizer_test_includes)
+LOCAL_HEADER_LIBRARIES := libhardware_headers libsystem_headers
+LOCAL_SHARED_LIBRARIES := libcutils liblog libdl
+LOCAL_MODULE:= libqcomvisualizer_simd_test_device
+LOCAL_LICENSE_KINDS:= SPDX-license-identifier-Apache-2.0
+LOCAL_LICENSE_CONDITIONS:= notice
+LOCAL_PROPRIETARY_MODULE := true
+LOCAL_GTEST:= false
+include $(BUILD_NATIVE_TEST)
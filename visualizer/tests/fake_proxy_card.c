@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <unistd.h>
+
+#include <tinyalsa/asoundlib.h>
+
+#include "fake_proxy_card.h"
+
+static int fake_mixer;
+static int fake_ctl;
+static int fake_pcm;
+_Atomic uint32_t fake_proxy_reads;
+
+struct mixer *mixer_open(unsigned int card __unused)
+{
+    return (struct mixer *)&fake_mixer;
+}
+
+void mixer_close(struct mixer *mixer __unused)
+{
+}
+
+struct mixer_ctl *mixer_get_ctl_by_name(struct mixer *mixer __unused, const char *name __unused)
+{
+    return (struct mixer_ctl *)&fake_ctl;
+}
+
+int mixer_ctl_set_value(struct mixer_ctl *ctl __unused, unsigned int id __unused,
+                        int value __unused)
+{
+    return 0;
+}
+
+struct pcm *pcm_open(unsigned int card __unused, unsigned int device __unused,
+                     unsigned int flags __unused, struct pcm_config *config __unused)
+{
+    return (struct pcm *)&fake_pcm;
+}
+
+int pcm_is_ready(struct pcm *pcm __unused)
+{
+    return 1;
+}
+
+int pcm_close(struct pcm *pcm __unused)
+{
+    return 0;
+}
+
+const char *pcm_get_error(struct pcm *pcm __unused)
+{
+    return "";
+}
+
+int pcm_mmap_read(struct pcm *pcm __unused, void *data, unsigned int count)
+{
+    int16_t *samples = (int16_t *)data;
+    unsigned int i;
+
+    usleep(FAKE_PROXY_READ_PERIOD_US);
+    for (i = 0; i < count / sizeof(int16_t); i++)
+        samples[i] = (int16_t)(16384 * sinf(2 * M_PI * 1000 * (i / 2) / 48000));
+    atomic_fetch_add(&fake_proxy_reads, 1);
+    return 0;
+}
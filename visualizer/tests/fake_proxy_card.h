@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FAKE_PROXY_CARD_H
+#define FAKE_PROXY_CARD_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Fake proxy capture card replacing libtinyalsa: a dummy mixer and a PCM
+ * returning a 1 kHz tone, one period every FAKE_PROXY_READ_PERIOD_US.
+ */
+#define FAKE_PROXY_READ_PERIOD_US 2000
+
+/* number of periods read from the fake PCM */
+extern _Atomic uint32_t fake_proxy_reads;
+
+#define EXPECT(cond) do {                                                     \
+        if (!(cond)) {                                                        \
+            fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                          \
+        }                                                                     \
+    } while (0)
+
+#endif
@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Checks visualizer_process(), with its NEON (ARM) or SSE2 (x86) helpers,
+ * against a copy of the original scalar process loop: the capture ring, the
+ * capture index and the stored measurements must match bit for bit on random
+ * and worst case buffers of all lengths around the vector widths. Then times
+ * both on capture periods of the proxy port.
+ */
+
+#include "../offload_visualizer.c"
+
+#include "fake_proxy_card.h"
+
+#define TEST_MAX_FRAMES 1024
+#define TEST_BUFFERS 400
+#define BENCH_BUFFERS 20000
+
+/* state touched by the original process loop */
+typedef struct baseline_ctxt_s {
+    uint32_t capture_idx;
+    uint32_t scaling_mode;
+    uint8_t capture_buf[CAPTURE_BUF_SIZE];
+    uint8_t channel_count;
+    uint32_t meas_mode;
+    uint8_t meas_wndw_size_in_buffers;
+    uint8_t meas_buffer_idx;
+    buffer_stats_t past_meas[MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS];
+    struct timespec buffer_update_time;
+} baseline_ctxt_t;
+
+/* visualizer_process() as it was before the SIMD helpers, from the measurements to the time
+ * stamp update */
+static void baseline_process(baseline_ctxt_t *visu_ctxt, audio_buffer_t *inBuffer)
+{
+    // perform measurements if needed
+    if (visu_ctxt->meas_mode & MEASUREMENT_MODE_PEAK_RMS) {
+        // find the peak and RMS squared for the new buffer
+        uint32_t inIdx;
+        int16_t max_sample = 0;
+        float rms_squared_acc = 0;
+        for (inIdx = 0 ; inIdx < inBuffer->frameCount * visu_ctxt->channel_count ; inIdx++) {
+            if (inBuffer->s16[inIdx] > max_sample) {
+                max_sample = inBuffer->s16[inIdx];
+            } else if (-inBuffer->s16[inIdx] > max_sample) {
+                max_sample = -inBuffer->s16[inIdx];
+            }
+            rms_squared_acc += (inBuffer->s16[inIdx] * inBuffer->s16[inIdx]);
+        }
+        // store the measurement
+        visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].peak_u16 = (uint16_t)max_sample;
+        visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].rms_squared =
+                rms_squared_acc / (inBuffer->frameCount * visu_ctxt->channel_count);
+        visu_ctxt->past_meas[visu_ctxt->meas_buffer_idx].is_valid = true;
+        if (++visu_ctxt->meas_buffer_idx >= visu_ctxt->meas_wndw_size_in_buffers) {
+            visu_ctxt->meas_buffer_idx = 0;
+        }
+    }
+
+    /* all code below assumes stereo 16 bit PCM output and input */
+    int32_t shift;
+
+    if (visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_NORMALIZED) {
+        /* derive capture scaling factor from peak value in current buffer
+         * this gives more interesting captures for display. */
+        shift = 32;
+        int len = inBuffer->frameCount * 2;
+        int i;
+        for (i = 0; i < len; i++) {
+            int32_t smp = inBuffer->s16[i];
+            if (smp < 0) smp = -smp - 1; /* take care to keep the max negative in range */
+            /* __builtin_clz(0) is undefined, the ARM clz instruction gives 32 */
+            int32_t clz = smp == 0 ? 32 : __builtin_clz(smp);
+            if (shift > clz) shift = clz;
+        }
+        /* A maximum amplitude signal will have 17 leading zeros, which we want to
+         * translate to a shift of 8 (for converting 16 bit to 8 bit) */
+        shift = 25 - shift;
+        /* Never scale by less than 8 to avoid returning unaltered PCM signal. */
+        if (shift < 3) {
+            shift = 3;
+        }
+        /* add one to combine the division by 2 needed after summing
+         * left and right channels below */
+        shift++;
+    } else {
+        assert(visu_ctxt->scaling_mode == VISUALIZER_SCALING_MODE_AS_PLAYED);
+        shift = 9;
+    }
+
+    uint32_t capt_idx;
+    uint32_t in_idx;
+    uint8_t *buf = visu_ctxt->capture_buf;
+    for (in_idx = 0, capt_idx = visu_ctxt->capture_idx;
+         in_idx < inBuffer->frameCount;
+         in_idx++, capt_idx++) {
+        if (capt_idx >= CAPTURE_BUF_SIZE) {
+            /* wrap around */
+            capt_idx = 0;
+        }
+        int32_t smp = inBuffer->s16[2 * in_idx] + inBuffer->s16[2 * in_idx + 1];
+        smp = smp >> shift;
+        buf[capt_idx] = ((uint8_t)smp)^0x80;
+    }
+
+    /* XXX the following two should really be atomic, though it probably doesn't
+     * matter much for visualization purposes */
+    visu_ctxt->capture_idx = capt_idx;
+    /* update last buffer update time stamp */
+    if (clock_gettime(CLOCK_MONOTONIC, &visu_ctxt->buffer_update_time) < 0) {
+        visu_ctxt->buffer_update_time.tv_sec = 0;
+    }
+}
+
+static visualizer_context_t *new_visualizer(uint32_t meas_mode, uint32_t scaling_mode)
+{
+    visualizer_context_t *visu_ctxt = calloc(1, sizeof(visualizer_context_t));
+
+    EXPECT(visu_ctxt != NULL);
+    visualizer_init(&visu_ctxt->common);
+    visu_ctxt->meas_mode = meas_mode;
+    visu_ctxt->scaling_mode = scaling_mode;
+    visu_ctxt->common.state = EFFECT_STATE_ACTIVE;
+    return visu_ctxt;
+}
+
+static baseline_ctxt_t *new_baseline(const visualizer_context_t *visu_ctxt)
+{
+    baseline_ctxt_t *base = calloc(1, sizeof(baseline_ctxt_t));
+
+    EXPECT(base != NULL);
+    base->capture_idx = visu_ctxt->capture_idx;
+    base->scaling_mode = visu_ctxt->scaling_mode;
+    memcpy(base->capture_buf, visu_ctxt->capture_buf, CAPTURE_BUF_SIZE);
+    base->channel_count = visu_ctxt->channel_count;
+    base->meas_mode = visu_ctxt->meas_mode;
+    base->meas_wndw_size_in_buffers = visu_ctxt->meas_wndw_size_in_buffers;
+    base->meas_buffer_idx = visu_ctxt->meas_buffer_idx;
+    memcpy(base->past_meas, visu_ctxt->past_meas, sizeof(base->past_meas));
+    return base;
+}
+
+static void fill(int16_t *buf, uint32_t count, int pattern)
+{
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        switch (pattern) {
+        case 0:
+            buf[i] = (int16_t)(rand() & 0xffff);
+            break;
+        case 1:
+            buf[i] = (i & 1) ? 32767 : -32768;
+            break;
+        case 2:
+            /* -32768 first, then smaller values: the original peak search settles on those */
+            buf[i] = i == 0 ? -32768 : (int16_t)((rand() % 2001) - 1000);
+            break;
+        case 3:
+            buf[i] = 32767;
+            break;
+        case 4:
+            buf[i] = 0;
+            break;
+        case 5:
+            /* large sums, where float accumulation rounds */
+            buf[i] = (int16_t)(30000 + rand() % 2767) * ((rand() & 1) ? 1 : -1);
+            break;
+        default:
+            buf[i] = (int16_t)((rand() % 7) - 3);
+            break;
+        }
+    }
+}
+
+static void expect_same(const visualizer_context_t *visu_ctxt, const baseline_ctxt_t *base)
+{
+    int i;
+
+    EXPECT(visu_ctxt->capture_idx == base->capture_idx);
+    EXPECT(memcmp(visu_ctxt->capture_buf, base->capture_buf, CAPTURE_BUF_SIZE) == 0);
+    EXPECT(visu_ctxt->meas_buffer_idx == base->meas_buffer_idx);
+    for (i = 0; i < MEASUREMENT_WINDOW_MAX_SIZE_IN_BUFFERS; i++) {
+        EXPECT(visu_ctxt->past_meas[i].is_valid == base->past_meas[i].is_valid);
+        EXPECT(visu_ctxt->past_meas[i].peak_u16 == base->past_meas[i].peak_u16);
+        EXPECT(memcmp(&visu_ctxt->past_meas[i].rms_squared, &base->past_meas[i].rms_squared,
+                      sizeof(float)) == 0);
+    }
+}
+
+/* feeds the same buffers to both, long enough to wrap the capture ring */
+static void check(uint32_t meas_mode, uint32_t scaling_mode)
+{
+    static int16_t samples[2 * TEST_MAX_FRAMES + 1];
+    visualizer_context_t *visu_ctxt = new_visualizer(meas_mode, scaling_mode);
+    baseline_ctxt_t *base = new_baseline(visu_ctxt);
+    audio_buffer_t buf;
+    uint32_t frames;
+    int n;
+
+    for (n = 0; n < TEST_BUFFERS; n++) {
+        frames = (n < 40) ? n + 1 : (uint32_t)(rand() % TEST_MAX_FRAMES) + 1;
+        fill(samples, 2 * frames + 1, n % 7);
+        buf.frameCount = frames;
+        /* unaligned start every other buffer */
+        buf.s16 = samples + (n & 1);
+        EXPECT(visualizer_process(&visu_ctxt->common, &buf, &buf) == 0);
+        baseline_process(base, &buf);
+        expect_same(visu_ctxt, base);
+    }
+    free(base);
+    free(visu_ctxt);
+}
+
+static void bench(const char *name, uint32_t meas_mode, uint32_t scaling_mode)
+{
+    static int16_t samples[2 * AUDIO_CAPTURE_PERIOD_SIZE];
+    visualizer_context_t *visu_ctxt = new_visualizer(meas_mode, scaling_mode);
+    baseline_ctxt_t *base = new_baseline(visu_ctxt);
+    audio_buffer_t buf = { .frameCount = AUDIO_CAPTURE_PERIOD_SIZE, .s16 = samples };
+    struct timespec t0, t1, t2;
+    int n;
+
+    fill(samples, 2 * AUDIO_CAPTURE_PERIOD_SIZE, 0);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (n = 0; n < BENCH_BUFFERS; n++)
+        baseline_process(base, &buf);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (n = 0; n < BENCH_BUFFERS; n++)
+        visualizer_process(&visu_ctxt->common, &buf, &buf);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+    printf("%-22s original %6lld ns, now %6lld ns per %d frame period\n", name,
+           ((t1.tv_sec - t0.tv_sec) * 1000000000LL + t1.tv_nsec - t0.tv_nsec) / BENCH_BUFFERS,
+           ((t2.tv_sec - t1.tv_sec) * 1000000000LL + t2.tv_nsec - t1.tv_nsec) / BENCH_BUFFERS,
+           AUDIO_CAPTURE_PERIOD_SIZE);
+    free(base);
+    free(visu_ctxt);
+}
+
+int main(void)
+{
+    srand(1);
+    check(MEASUREMENT_MODE_PEAK_RMS, VISUALIZER_SCALING_MODE_NORMALIZED);
+    check(MEASUREMENT_MODE_NONE, VISUALIZER_SCALING_MODE_NORMALIZED);
+    check(MEASUREMENT_MODE_PEAK_RMS, VISUALIZER_SCALING_MODE_AS_PLAYED);
+    check(MEASUREMENT_MODE_NONE, VISUALIZER_SCALING_MODE_AS_PLAYED);
+
+#if defined(VISUALIZER_USE_NEON)
+    printf("NEON matches the original process loop\n");
+#elif defined(VISUALIZER_USE_SSE2)
+    printf("SSE2 matches the original process loop\n");
+#else
+    printf("no SIMD path built, scalar only\n");
+#endif
+
+    bench("normalized, peak/rms", MEASUREMENT_MODE_PEAK_RMS, VISUALIZER_SCALING_MODE_NORMALIZED);
+    bench("normalized", MEASUREMENT_MODE_NONE, VISUALIZER_SCALING_MODE_NORMALIZED);
+    bench("as played", MEASUREMENT_MODE_NONE, VISUALIZER_SCALING_MODE_AS_PLAYED);
+
+    printf("PASS\n");
+    return 0;
+}
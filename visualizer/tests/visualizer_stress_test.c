@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2026 The LineageOS Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stress test of the capture thread against the control path: visualizers are
+ * created, configured, polled and released on several threads while the
+ * capture thread processes the published snapshots from a fake proxy PCM.
+ * Captures and measurements must also complete while process_lock is held.
+ * Meant to be run under ThreadSanitizer as well.
+ */
+
+#include "../offload_visualizer.c"
+
+#include "fake_proxy_card.h"
+
+#define TEST_OUTPUT 13
+#define TEST_CONTROL_THREADS 4
+#define TEST_DURATION_MS 2000
+/* a command waiting on process_lock fails the test instead of hanging it */
+#define WATCHDOG_SEC 5
+
+static _Atomic bool test_done;
+static _Atomic uint32_t test_cycles;
+
+static int send_command(effect_handle_t handle, uint32_t cmd, uint32_t size, void *data,
+                        uint32_t reply_size, void *reply)
+{
+    return (*handle)->command(handle, cmd, size, data, &reply_size, reply);
+}
+
+static void *control_thread(void *arg __unused)
+{
+    effect_offload_param_t offload = { .isOffload = true, .ioHandle = TEST_OUTPUT };
+    uint8_t capture[VISUALIZER_CAPTURE_SIZE_MAX];
+    int32_t measure[MEASUREMENT_COUNT];
+    uint32_t param[5];  /* effect_param_t, parameter id and value */
+    effect_param_t *p = (effect_param_t *)param;
+    effect_config_t config;
+    effect_handle_t handle;
+    int reply;
+    int i;
+
+    while (!atomic_load(&test_done)) {
+        EXPECT(AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(&visualizer_descriptor.uuid, 0,
+                                                           TEST_OUTPUT, &handle) == 0);
+        EXPECT(send_command(handle, EFFECT_CMD_INIT, 0, NULL, sizeof(reply), &reply) == 0);
+        EXPECT(send_command(handle, EFFECT_CMD_GET_CONFIG, 0, NULL,
+                            sizeof(config), &config) == -EINVAL);
+        EXPECT(send_command(handle, EFFECT_CMD_OFFLOAD, sizeof(offload), &offload,
+                            sizeof(reply), &reply) == 0);
+        EXPECT(send_command(handle, EFFECT_CMD_GET_CONFIG, 0, NULL,
+                            sizeof(config), &config) == 0);
+        EXPECT(send_command(handle, EFFECT_CMD_SET_CONFIG, sizeof(config), &config,
+                            sizeof(reply), &reply) == 0);
+
+        p->psize = sizeof(uint32_t);
+        p->vsize = sizeof(uint32_t);
+        *(uint32_t *)p->data = VISUALIZER_PARAM_MEASUREMENT_MODE;
+        *((uint32_t *)p->data + 1) = MEASUREMENT_MODE_PEAK_RMS | MEASUREMENT_MODE_SPECTRUM;
+        EXPECT(send_command(handle, EFFECT_CMD_SET_PARAM, sizeof(param), param,
+                            sizeof(reply), &reply) == 0);
+
+        EXPECT(send_command(handle, EFFECT_CMD_ENABLE, 0, NULL, sizeof(reply), &reply) == 0);
+        for (i = 0; i < 5; i++) {
+            send_command(handle, VISUALIZER_CMD_CAPTURE, 0, NULL, sizeof(capture), capture);
+            send_command(handle, VISUALIZER_CMD_MEASURE, 0, NULL, sizeof(measure), measure);
+            if (i == 2)
+                send_command(handle, EFFECT_CMD_RESET, 0, NULL, 0, NULL);
+            usleep(FAKE_PROXY_READ_PERIOD_US / 2);
+        }
+        EXPECT(send_command(handle, EFFECT_CMD_DISABLE, 0, NULL, sizeof(reply), &reply) == 0);
+        EXPECT(AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(handle) == 0);
+        atomic_fetch_add(&test_cycles, 1);
+    }
+    return NULL;
+}
+
+struct results {
+    effect_handle_t handle;
+    uint8_t capture[VISUALIZER_CAPTURE_SIZE_MAX];
+    int32_t measure[MEASUREMENT_COUNT];
+};
+
+static void *results_thread(void *arg)
+{
+    struct results *res = (struct results *)arg;
+
+    EXPECT(send_command(res->handle, VISUALIZER_CMD_CAPTURE, 0, NULL,
+                        sizeof(res->capture), res->capture) == 0);
+    EXPECT(send_command(res->handle, VISUALIZER_CMD_MEASURE, 0, NULL,
+                        sizeof(res->measure), res->measure) == 0);
+    return NULL;
+}
+
+/* CAPTURE and MEASURE read the published results without process_lock */
+static void test_results_without_process_lock(void)
+{
+    effect_offload_param_t offload = { .isOffload = true, .ioHandle = TEST_OUTPUT };
+    struct results res;
+    uint32_t param[5];  /* effect_param_t, parameter id and value */
+    effect_param_t *p = (effect_param_t *)param;
+    effect_handle_t handle;
+    pthread_t thread;
+    char dump[256] = "";
+    FILE *fp;
+    int reply;
+    int i, silent;
+
+    EXPECT(visualizer_hal_start_output(TEST_OUTPUT, 0, 0, 0) == 0);
+    EXPECT(AUDIO_EFFECT_LIBRARY_INFO_SYM.create_effect(&visualizer_descriptor.uuid, 0,
+                                                       TEST_OUTPUT, &handle) == 0);
+    EXPECT(send_command(handle, EFFECT_CMD_INIT, 0, NULL, sizeof(reply), &reply) == 0);
+    EXPECT(send_command(handle, EFFECT_CMD_OFFLOAD, sizeof(offload), &offload,
+                        sizeof(reply), &reply) == 0);
+    p->psize = sizeof(uint32_t);
+    p->vsize = sizeof(uint32_t);
+    *(uint32_t *)p->data = VISUALIZER_PARAM_MEASUREMENT_MODE;
+    *((uint32_t *)p->data + 1) = MEASUREMENT_MODE_PEAK_RMS;
+    EXPECT(send_command(handle, EFFECT_CMD_SET_PARAM, sizeof(param), param,
+                        sizeof(reply), &reply) == 0);
+    *(uint32_t *)p->data = VISUALIZER_PARAM_CAPTURE_SIZE;
+    *((uint32_t *)p->data + 1) = VISUALIZER_CAPTURE_SIZE_MAX + 1;
+    EXPECT(send_command(handle, EFFECT_CMD_SET_PARAM, sizeof(param), param,
+                        sizeof(reply), &reply) == 0);
+    EXPECT(reply == -EINVAL);
+    EXPECT(send_command(handle, EFFECT_CMD_ENABLE, 0, NULL, sizeof(reply), &reply) == 0);
+    usleep(10 * FAKE_PROXY_READ_PERIOD_US);
+
+    /* the capture thread is stuck before process() meanwhile */
+    res.handle = handle;
+    alarm(WATCHDOG_SEC);
+    pthread_mutex_lock(&process_lock);
+    EXPECT(pthread_create(&thread, NULL, results_thread, &res) == 0);
+    pthread_join(thread, NULL);
+    pthread_mutex_unlock(&process_lock);
+    alarm(0);
+
+    for (i = 0, silent = 0; i < VISUALIZER_CAPTURE_SIZE_MAX; i++)
+        silent += res.capture[i] == 0x80;
+    printf("capture %d/%d silent, peak %d mB, rms %d mB\n", silent, VISUALIZER_CAPTURE_SIZE_MAX,
+           res.measure[MEASUREMENT_IDX_PEAK], res.measure[MEASUREMENT_IDX_RMS]);
+    EXPECT(silent < VISUALIZER_CAPTURE_SIZE_MAX / 2);
+    EXPECT(res.measure[MEASUREMENT_IDX_PEAK] > -9600 && res.measure[MEASUREMENT_IDX_RMS] > -9600);
+    EXPECT(res.measure[MEASUREMENT_IDX_RMS] < res.measure[MEASUREMENT_IDX_PEAK]);
+
+    fp = tmpfile();
+    EXPECT(fp != NULL);
+    EXPECT(visualizer_hal_dump(fileno(fp)) == 0);
+    rewind(fp);
+    fread(dump, 1, sizeof(dump) - 1, fp);
+    fclose(fp);
+    EXPECT(strstr(dump, "Waits for processing:") != NULL);
+
+    EXPECT(send_command(handle, EFFECT_CMD_DISABLE, 0, NULL, sizeof(reply), &reply) == 0);
+    EXPECT(AUDIO_EFFECT_LIBRARY_INFO_SYM.release_effect(handle) == 0);
+    EXPECT(visualizer_hal_stop_output(TEST_OUTPUT, 0) == 0);
+}
+
+int main(void)
+{
+    pthread_t threads[TEST_CONTROL_THREADS];
+    int i;
+
+    test_results_without_process_lock();
+
+    EXPECT(visualizer_hal_start_output(TEST_OUTPUT, 0, 0, 0) == 0);
+    for (i = 0; i < TEST_CONTROL_THREADS; i++)
+        EXPECT(pthread_create(&threads[i], NULL, control_thread, NULL) == 0);
+
+    usleep(TEST_DURATION_MS * 1000);
+    atomic_store(&test_done, true);
+    for (i = 0; i < TEST_CONTROL_THREADS; i++)
+        pthread_join(threads[i], NULL);
+    EXPECT(visualizer_hal_stop_output(TEST_OUTPUT, 0) == 0);
+
+    pthread_mutex_lock(&lock);
+    printf("%u create/release cycles, %u reads, %u snapshots, %u waits for processing\n",
+           atomic_load(&test_cycles), atomic_load(&fake_proxy_reads), snapshot_publishes,
+           process_lock_waits);
+    EXPECT(list_empty(&created_effects_list));
+    EXPECT(list_empty(&active_outputs_list));
+    EXPECT(atomic_load(&process_snapshot) == NULL);
+    pthread_mutex_unlock(&lock);
+    EXPECT(atomic_load(&test_cycles) > 0);
+    EXPECT(atomic_load(&fake_proxy_reads) > 0);
+
+    printf("PASS\n");
+    return 0;
+}